@@ -30,10 +30,47 @@
 
 #include "simba.h"
 
+/* Set in the size of freed buffers, which are multiples of four. */
+#define HEADER_FREED                                        0x1
+
 struct header_t {
     size_t size;
 };
 
+/**
+ * Free given buffer, and move free_p past all free buffers starting
+ * at free_p.
+ */
+static int free_any_order(struct circular_heap_t *self_p,
+                          struct header_t *header_p)
+{
+    /* Already freed? */
+    if (header_p->size & HEADER_FREED) {
+        return (-EINVAL);
+    }
+
+    header_p->size |= HEADER_FREED;
+
+    while (self_p->free_p != self_p->alloc_p) {
+        /* Skip the unused memory at the end of the buffer. */
+        if ((self_p->alloc_p < self_p->free_p)
+            && (self_p->free_p == self_p->wrap_p)) {
+            self_p->free_p = self_p->begin_p;
+            continue;
+        }
+
+        header_p = self_p->free_p;
+
+        if ((header_p->size & HEADER_FREED) == 0) {
+            break;
+        }
+
+        self_p->free_p += (header_p->size & ~HEADER_FREED);
+    }
+
+    return (0);
+}
+
 int circular_heap_init(struct circular_heap_t *self_p,
                        void *buf_p,
                        size_t size)
@@ -46,6 +83,20 @@ int circular_heap_init(struct circular_heap_t *self_p,
     self_p->end_p = (buf_p + size);
     self_p->alloc_p = buf_p;
     self_p->free_p = buf_p;
+    self_p->wrap_p = NULL;
+    self_p->free_order = CIRCULAR_HEAP_FREE_ORDER_ALLOCATION;
+
+    return (0);
+}
+
+int circular_heap_set_free_order(struct circular_heap_t *self_p,
+                                 int free_order)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN((free_order == CIRCULAR_HEAP_FREE_ORDER_ALLOCATION)
+            || (free_order == CIRCULAR_HEAP_FREE_ORDER_ANY), EINVAL);
+
+    self_p->free_order = free_order;
 
     return (0);
 }
@@ -72,6 +123,7 @@ void *circular_heap_alloc(struct circular_heap_t *self_p,
             self_p->alloc_p += size;
         } else if ((self_p->free_p - self_p->begin_p) > size) {
             header_p = self_p->begin_p;
+            self_p->wrap_p = self_p->alloc_p;
             self_p->alloc_p = (self_p->begin_p + size);
         }
     } else {
@@ -104,6 +156,10 @@ int circular_heap_free(struct circular_heap_t *self_p,
     header_p = buf_p;
     header_p--;
 
+    if (self_p->free_order == CIRCULAR_HEAP_FREE_ORDER_ANY) {
+        return (free_any_order(self_p, header_p));
+    }
+
     ASSERTN((header_p == self_p->free_p)
             || (header_p == self_p->begin_p), EINVAL);
 
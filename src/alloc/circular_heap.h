@@ -33,17 +33,34 @@
 
 #include "simba.h"
 
+/**
+ * Buffers must be freed in the same order as they were allocated.
+ * This is the default free order.
+ */
+#define CIRCULAR_HEAP_FREE_ORDER_ALLOCATION                 0
+
+/**
+ * Buffers may be freed in any order. Freed buffers are marked as
+ * free, and their memory is reused once all older buffers are freed.
+ */
+#define CIRCULAR_HEAP_FREE_ORDER_ANY                        1
+
 /* Circular_Heap. */
 struct circular_heap_t {
     void *begin_p;
     void *end_p;
     void *alloc_p;
     void *free_p;
+    /* End of the newest buffer before alloc_p wrapped around to
+       begin_p. Valid when alloc_p is before free_p. */
+    void *wrap_p;
+    int free_order;
 };
 
 /**
  * Initialize given circular heap. Buffers must be freed in the same
- * order as they were allocated.
+ * order as they were allocated, unless changed with
+ * ``circular_heap_set_free_order()``.
  *
  * @param[in] self_p Circular heap to initialize.
  * @param[in] buf_p Memory buffer to use for the circular heap.
@@ -55,6 +72,19 @@ int circular_heap_init(struct circular_heap_t *self_p,
                        void *buf_p,
                        size_t size);
 
+/**
+ * Set the order in which buffers must be freed. Must be called
+ * before any buffer is allocated.
+ *
+ * @param[in] self_p Circular heap.
+ * @param[in] free_order One of ``CIRCULAR_HEAP_FREE_ORDER_ALLOCATION``
+ *                       and ``CIRCULAR_HEAP_FREE_ORDER_ANY``.
+ *
+ * @return zero(0) or negative error code.
+ */
+int circular_heap_set_free_order(struct circular_heap_t *self_p,
+                                 int free_order);
+
 /**
  * Allocate a buffer of given size from given circular heap.
  *
@@ -68,12 +98,13 @@ void *circular_heap_alloc(struct circular_heap_t *self_p,
                           size_t size);
 
 /**
- * Free the oldest allocated buffer, previously allocated with
+ * Free given buffer, previously allocated with
  * ``circular_heap_alloc()``.
  *
  * @param[in] self_p Circular heap to free to.
  * @param[in] buf_p Buffer to free. Must be the oldest allocated
- *                  buffer.
+ *                  buffer, unless the free order is
+ *                  ``CIRCULAR_HEAP_FREE_ORDER_ANY``.
  *
  * @return zero(0) or negative error code.
  */
@@ -30,6 +30,19 @@
 
 #include "simba.h"
 
+/* Dynamic block sizes are multiples of this. */
+#define DYNAMIC_ALIGNMENT sizeof(void *)
+
+/* Smallest dynamic block size, with room for the free list links. */
+#define DYNAMIC_SIZE_MIN sizeof(struct heap_dynamic_free_t)
+
+/* Blocks of this size and bigger are in the last size class. */
+#define DYNAMIC_SIZE_MAX                                                \
+    (1UL << (CONFIG_HEAP_DYNAMIC_FL_MAX + HEAP_DYNAMIC_SL_LOG2))
+
+/* Maximum number of allocator frames in a backtrace. */
+#define LEAK_TRACKING_SKIP_MAX 4
+
 struct heap_buffer_header_t {
     union {
         struct heap_fixed_t *fixed_p;
@@ -37,120 +50,1163 @@ struct heap_buffer_header_t {
     } u;
     size_t size;
     int count;
+#if CONFIG_HEAP_LEAK_TRACKING == 1
+    struct {
+        struct heap_buffer_header_t *next_p;
+        struct heap_buffer_header_t *prev_p;
+    } allocated;
+    void *backtrace[CONFIG_HEAP_LEAK_TRACKING_DEPTH];
+#endif
+};
+
+/**
+ * A block in the dynamic heap. The count is zero(0) for free blocks,
+ * which are merged with free neighbours, except the lowest block,
+ * which is given back to the unallocated memory.
+ */
+struct heap_dynamic_block_t {
+    /** Previous block in memory, or NULL for the lowest block. */
+    struct heap_dynamic_block_t *prev_p;
+    struct heap_buffer_header_t header;
+};
+
+/**
+ * Free list links, stored in the buffer of free blocks.
+ */
+struct heap_dynamic_free_t {
+    struct heap_dynamic_block_t *next_p;
+    struct heap_dynamic_block_t *prev_p;
+};
+
+#if CONFIG_HEAP_STATS == 1
+
+struct module_t {
+    int8_t initialized;
+    struct heap_t *heaps_p;
+    struct fs_counter_t allocs;
+    struct fs_counter_t frees;
+    struct fs_counter_t failures;
+    struct fs_command_t cmd_list;
+    struct fs_command_t cmd_sizes;
+#if CONFIG_HEAP_LEAK_TRACKING == 1
+    struct fs_command_t cmd_leaks;
+#endif
 };
 
-static void *alloc_fixed_size(struct heap_t *self_p,
-                              size_t size)
+static struct module_t module;
+
+#endif
+
+#if CONFIG_HEAP_MAGAZINES == 1
+
+/* Number of buffers moved at a time between a magazine and its
+   heap. */
+#define MAGAZINE_BATCH (CONFIG_HEAP_MAGAZINE_SIZE / 2)
+
+/**
+ * Free buffers of one fixed size, linked through their headers.
+ */
+struct heap_magazine_t {
+    struct heap_buffer_header_t *buffers_p;
+    int length;
+};
+
+/**
+ * The magazines of a thread, one per fixed size.
+ */
+struct heap_magazines_t {
+    struct heap_magazine_t sizes[HEAP_FIXED_SIZES_MAX];
+};
+
+/* Generation of the most recently initialized heap. */
+static uint32_t generation;
+
+#endif
+
+/**
+ * Smallest fixed size that fits given size, or NULL if given size is
+ * too big.
+ */
+static struct heap_fixed_t *fixed_find(struct heap_t *self_p,
+                                       size_t size)
+{
+    struct heap_fixed_t *fixed_p;
+
+    for (fixed_p = self_p->fixed;
+         fixed_p != &self_p->fixed[HEAP_FIXED_SIZES_MAX];
+         fixed_p++) {
+        if (size <= fixed_p->size) {
+            return (fixed_p);
+        }
+    }
+
+    return (NULL);
+}
+
+/**
+ * Take a buffer from the free list of given fixed size, or allocate a
+ * new buffer from the unallocated memory if the list is empty.
+ */
+static struct heap_buffer_header_t *fixed_take(struct heap_t *self_p,
+                                               struct heap_fixed_t *fixed_p)
+{
+    struct heap_buffer_header_t *header_p;
+    size_t left;
+    char *next_p;
+
+    if (fixed_p->free_p != NULL) {
+        header_p = fixed_p->free_p;
+        fixed_p->free_p = header_p->u.next_p;
+    } else {
+        next_p = self_p->next_p;
+
+        /* Out of memory?. */
+        left = ((char *)self_p->dynamic.begin_p - next_p);
+
+        if (left < (sizeof(*header_p) + fixed_p->size)) {
+            return (NULL);
+        }
+
+        header_p = self_p->next_p;
+        next_p += (sizeof(*header_p) + fixed_p->size);
+        self_p->next_p = next_p;
+    }
+
+    header_p->u.fixed_p = fixed_p;
+
+    return (header_p);
+}
+
+static void *alloc_fixed_size(struct heap_t *self_p,
+                              size_t size)
+{
+    struct heap_buffer_header_t *header_p;
+    struct heap_fixed_t *fixed_p;
+
+    fixed_p = fixed_find(self_p, size);
+
+    if (fixed_p == NULL) {
+        return (NULL);
+    }
+
+    header_p = fixed_take(self_p, fixed_p);
+
+    if (header_p == NULL) {
+        return (NULL);
+    }
+
+    /* Initialize the allocated buffer. */
+    header_p->size = size;
+    header_p->count = 1;
+
+    return (&header_p[1]);
+}
+
+/**
+ * First and second level size class of given block size.
+ */
+static void mapping_insert(size_t size, int *fl_p, int *sl_p)
+{
+    int fl;
+
+    if (size >= DYNAMIC_SIZE_MAX) {
+        *fl_p = (CONFIG_HEAP_DYNAMIC_FL_MAX - 1);
+        *sl_p = (HEAP_DYNAMIC_SL_MAX - 1);
+
+        return;
+    }
+
+    fl = (31 - bits_clz_32(size));
+    *sl_p = ((size >> (fl - HEAP_DYNAMIC_SL_LOG2)) & (HEAP_DYNAMIC_SL_MAX - 1));
+    *fl_p = (fl - HEAP_DYNAMIC_SL_LOG2);
+}
+
+/**
+ * First and second level size class where all blocks are at least
+ * given size.
+ *
+ * @return zero(0) or -1 if the size is too big.
+ */
+static int mapping_search(size_t size, int *fl_p, int *sl_p)
+{
+    int fl;
+
+    if (size >= DYNAMIC_SIZE_MAX) {
+        return (-1);
+    }
+
+    fl = (31 - bits_clz_32(size));
+    size += ((1 << (fl - HEAP_DYNAMIC_SL_LOG2)) - 1);
+
+    if (size >= DYNAMIC_SIZE_MAX) {
+        return (-1);
+    }
+
+    mapping_insert(size, fl_p, sl_p);
+
+    return (0);
+}
+
+static struct heap_dynamic_block_t *block_from_header(
+    struct heap_buffer_header_t *header_p)
+{
+    return ((struct heap_dynamic_block_t *)
+            ((char *)header_p - offsetof(struct heap_dynamic_block_t, header)));
+}
+
+static struct heap_dynamic_free_t *block_links(
+    struct heap_dynamic_block_t *block_p)
+{
+    return ((struct heap_dynamic_free_t *)&(&block_p->header)[1]);
+}
+
+/**
+ * The block after given block in memory, or NULL if given block is
+ * the last one.
+ */
+static struct heap_dynamic_block_t *block_next(
+    struct heap_t *self_p,
+    struct heap_dynamic_block_t *block_p)
+{
+    char *next_p;
+
+    next_p = ((char *)&(&block_p->header)[1] + block_p->header.size);
+
+    if (next_p == self_p->dynamic.end_p) {
+        return (NULL);
+    }
+
+    return ((struct heap_dynamic_block_t *)next_p);
+}
+
+static int block_is_free(struct heap_dynamic_block_t *block_p)
+{
+    return ((block_p != NULL) && (block_p->header.count == 0));
+}
+
+/**
+ * Add given free block to the free list of its size class.
+ */
+static void block_insert(struct heap_t *self_p,
+                         struct heap_dynamic_block_t *block_p)
+{
+    struct heap_dynamic_t *dynamic_p;
+    struct heap_dynamic_block_t *head_p;
+    int fl;
+    int sl;
+
+    dynamic_p = &self_p->dynamic;
+    mapping_insert(block_p->header.size, &fl, &sl);
+    head_p = dynamic_p->free_p[fl][sl];
+    block_p->header.count = 0;
+    block_links(block_p)->prev_p = NULL;
+    block_links(block_p)->next_p = head_p;
+
+    if (head_p != NULL) {
+        block_links(head_p)->prev_p = block_p;
+    }
+
+    dynamic_p->free_p[fl][sl] = block_p;
+    dynamic_p->fl_bitmap |= (1UL << fl);
+    dynamic_p->sl_bitmap[fl] |= (1 << sl);
+}
+
+/**
+ * Remove given free block from the free list of its size class.
+ */
+static void block_remove(struct heap_t *self_p,
+                         struct heap_dynamic_block_t *block_p)
+{
+    struct heap_dynamic_t *dynamic_p;
+    struct heap_dynamic_free_t *links_p;
+    int fl;
+    int sl;
+
+    dynamic_p = &self_p->dynamic;
+    mapping_insert(block_p->header.size, &fl, &sl);
+    links_p = block_links(block_p);
+
+    if (links_p->next_p != NULL) {
+        block_links(links_p->next_p)->prev_p = links_p->prev_p;
+    }
+
+    if (links_p->prev_p != NULL) {
+        block_links(links_p->prev_p)->next_p = links_p->next_p;
+    } else {
+        dynamic_p->free_p[fl][sl] = links_p->next_p;
+
+        if (links_p->next_p == NULL) {
+            dynamic_p->sl_bitmap[fl] &= ~(1 << sl);
+
+            if (dynamic_p->sl_bitmap[fl] == 0) {
+                dynamic_p->fl_bitmap &= ~(1UL << fl);
+            }
+        }
+    }
+}
+
+/**
+ * Find a free block of at least given size.
+ */
+static struct heap_dynamic_block_t *block_find(struct heap_t *self_p,
+                                               size_t size)
+{
+    struct heap_dynamic_t *dynamic_p;
+    uint32_t fl_map;
+    uint32_t sl_map;
+    int fl;
+    int sl;
+
+    dynamic_p = &self_p->dynamic;
+
+    if (mapping_search(size, &fl, &sl) == 0) {
+        sl_map = (dynamic_p->sl_bitmap[fl] & (~0UL << sl));
+
+        if (sl_map == 0) {
+            fl_map = (dynamic_p->fl_bitmap & (~0UL << (fl + 1)));
+
+            if (fl_map != 0) {
+                fl = bits_ctz_32(fl_map);
+                sl_map = dynamic_p->sl_bitmap[fl];
+            }
+        }
+
+        if (sl_map != 0) {
+            sl = bits_ctz_32(sl_map);
+
+            return (dynamic_p->free_p[fl][sl]);
+        }
+    }
+
+    return (NULL);
+}
+
+/**
+ * Find a free block of at least given size in the size class of
+ * given size. Only used when out of memory, as the blocks in the
+ * list are searched one by one.
+ */
+static struct heap_dynamic_block_t *block_find_exact(struct heap_t *self_p,
+                                                     size_t size)
+{
+    struct heap_dynamic_block_t *block_p;
+    int fl;
+    int sl;
+
+    mapping_insert(size, &fl, &sl);
+    block_p = self_p->dynamic.free_p[fl][sl];
+
+    while ((block_p != NULL) && (block_p->header.size < size)) {
+        block_p = block_links(block_p)->next_p;
+    }
+
+    return (block_p);
+}
+
+/**
+ * Split given allocated block into one block of given size and a
+ * free block, if the remainder is big enough for a block.
+ */
+static void block_split(struct heap_t *self_p,
+                        struct heap_dynamic_block_t *block_p,
+                        size_t size)
+{
+    struct heap_dynamic_block_t *rest_p;
+    struct heap_dynamic_block_t *next_p;
+
+    if (block_p->header.size < (size + sizeof(*rest_p) + DYNAMIC_SIZE_MIN)) {
+        return;
+    }
+
+    next_p = block_next(self_p, block_p);
+    rest_p = (struct heap_dynamic_block_t *)((char *)&(&block_p->header)[1]
+                                             + size);
+    rest_p->prev_p = block_p;
+    rest_p->header.u.fixed_p = NULL;
+    rest_p->header.size = (block_p->header.size - size - sizeof(*rest_p));
+    block_p->header.size = size;
+
+    if (next_p != NULL) {
+        next_p->prev_p = rest_p;
+    }
+
+    block_insert(self_p, rest_p);
+}
+
+/**
+ * Allocate a new block of given size below the lowest block.
+ */
+static struct heap_dynamic_block_t *block_new(struct heap_t *self_p,
+                                              size_t size)
+{
+    struct heap_dynamic_block_t *block_p;
+    char *begin_p;
+
+    begin_p = self_p->dynamic.begin_p;
+
+    /* Out of memory? */
+    if ((size_t)(begin_p - (char *)self_p->next_p)
+        < (sizeof(*block_p) + size)) {
+        return (NULL);
+    }
+
+    block_p = (struct heap_dynamic_block_t *)(begin_p
+                                              - sizeof(*block_p)
+                                              - size);
+    block_p->prev_p = NULL;
+    block_p->header.size = size;
+    block_p->header.count = 1;
+
+    if (begin_p != self_p->dynamic.end_p) {
+        ((struct heap_dynamic_block_t *)begin_p)->prev_p = block_p;
+    }
+
+    self_p->dynamic.begin_p = block_p;
+
+    return (block_p);
+}
+
+static void *alloc_dynamic_size(struct heap_t *self_p,
+                                size_t size)
+{
+    struct heap_dynamic_block_t *block_p;
+
+    if (size >= DYNAMIC_SIZE_MAX) {
+        return (NULL);
+    }
+
+    if (size < DYNAMIC_SIZE_MIN) {
+        size = DYNAMIC_SIZE_MIN;
+    }
+
+    size = ((size + DYNAMIC_ALIGNMENT - 1) & ~(DYNAMIC_ALIGNMENT - 1));
+
+    /* Prefer a free block, then new memory, and last a free block
+       in the size class of given size. */
+    block_p = block_find(self_p, size);
+
+    if (block_p == NULL) {
+        block_p = block_new(self_p, size);
+
+        if (block_p == NULL) {
+            block_p = block_find_exact(self_p, size);
+
+            if (block_p == NULL) {
+                return (NULL);
+            }
+        }
+    }
+
+    if (block_is_free(block_p)) {
+        block_remove(self_p, block_p);
+        block_split(self_p, block_p, size);
+    }
+
+    /* Initialize the allocated buffer. */
+    block_p->header.u.fixed_p = NULL;
+    block_p->header.count = 1;
+
+    return (&(&block_p->header)[1]);
+}
+
+static int free_fixed_size(struct heap_t *self_p,
+                           struct heap_buffer_header_t *header_p)
+{
+    struct heap_fixed_t *fixed_p;
+
+    /* Add the buffer to the free list of its fixed size. */
+    fixed_p = header_p->u.fixed_p;
+    header_p->u.next_p = fixed_p->free_p;
+    fixed_p->free_p = header_p;
+
+    return (0);
+}
+
+static int free_dynamic_buffer(struct heap_t *self_p,
+                               struct heap_buffer_header_t *header_p)
+{
+    struct heap_dynamic_block_t *block_p;
+    struct heap_dynamic_block_t *next_p;
+
+    block_p = block_from_header(header_p);
+    next_p = block_next(self_p, block_p);
+
+    /* Merge with the next block. */
+    if (block_is_free(next_p)) {
+        block_remove(self_p, next_p);
+        block_p->header.size += (sizeof(*next_p) + next_p->header.size);
+        next_p = block_next(self_p, block_p);
+
+        if (next_p != NULL) {
+            next_p->prev_p = block_p;
+        }
+    }
+
+    /* Merge with the previous block. */
+    if (block_is_free(block_p->prev_p)) {
+        block_remove(self_p, block_p->prev_p);
+        block_p->prev_p->header.size += (sizeof(*block_p)
+                                         + block_p->header.size);
+        block_p = block_p->prev_p;
+
+        if (next_p != NULL) {
+            next_p->prev_p = block_p;
+        }
+    }
+
+    if (block_p->prev_p == NULL) {
+        /* Give the lowest block back to the unallocated memory. */
+        if (next_p != NULL) {
+            next_p->prev_p = NULL;
+            self_p->dynamic.begin_p = next_p;
+        } else {
+            self_p->dynamic.begin_p = self_p->dynamic.end_p;
+        }
+    } else {
+        block_insert(self_p, block_p);
+    }
+
+    return (0);
+}
+
+#if CONFIG_HEAP_STATS == 1
+
+/**
+ * Number of bytes available to the user of given allocated buffer.
+ */
+static size_t buffer_size(struct heap_buffer_header_t *header_p)
+{
+    if (header_p->u.fixed_p != NULL) {
+        return (header_p->u.fixed_p->size);
+    }
+
+    return (header_p->size);
+}
+
+#if CONFIG_HEAP_LEAK_TRACKING == 1
+
+/**
+ * Save the backtrace of given allocated buffer, starting at given
+ * caller of the allocator.
+ */
+static void stats_backtrace(struct heap_buffer_header_t *header_p,
+                            void *caller_p)
+{
+    void *backtrace[2 * (CONFIG_HEAP_LEAK_TRACKING_DEPTH
+                         + LEAK_TRACKING_SKIP_MAX)];
+    int depth;
+    int first;
+    int i;
+
+    depth = sys_backtrace(backtrace, sizeof(backtrace));
+
+    /* Skip the frames of the allocator. */
+    for (first = 0; first < depth; first++) {
+        if (backtrace[2 * first] == caller_p) {
+            break;
+        }
+    }
+
+    if (first == depth) {
+        backtrace[0] = caller_p;
+        first = 0;
+        depth = 1;
+    }
+
+    for (i = 0; i < CONFIG_HEAP_LEAK_TRACKING_DEPTH; i++) {
+        if (first + i < depth) {
+            header_p->backtrace[i] = backtrace[2 * (first + i)];
+        } else {
+            header_p->backtrace[i] = NULL;
+        }
+    }
+}
+
+#endif
+
+/**
+ * Count an allocation of given buffer by the user. Fixed size
+ * allocations from magazines are counted without locking the heap.
+ */
+static void stats_count_alloc(struct heap_t *self_p,
+                              struct heap_buffer_header_t *header_p)
+{
+    int fl;
+    int sl;
+
+    if (header_p->u.fixed_p != NULL) {
+#if CONFIG_HEAP_MAGAZINES == 1
+        __atomic_add_fetch(&header_p->u.fixed_p->number_of_allocs,
+                           1,
+                           __ATOMIC_RELAXED);
+#else
+        header_p->u.fixed_p->number_of_allocs++;
+#endif
+    } else {
+        mapping_insert(header_p->size, &fl, &sl);
+        self_p->dynamic.number_of_allocs[fl]++;
+    }
+
+    fs_counter_increment(&module.allocs, 1);
+}
+
+/**
+ * Count a free of a buffer by the user.
+ */
+static void stats_count_free(void)
+{
+    fs_counter_increment(&module.frees, 1);
+}
+
+/**
+ * Add given buffer to the memory in use. Buffers cached in magazines
+ * are in use from the heap's point of view. The heap must be locked.
+ */
+static void stats_alloc(struct heap_t *self_p,
+                        struct heap_buffer_header_t *header_p,
+                        void *caller_p)
+{
+    self_p->stats.used += buffer_size(header_p);
+    self_p->stats.number_of_buffers++;
+
+    if (self_p->stats.used > self_p->stats.used_max) {
+        self_p->stats.used_max = self_p->stats.used;
+    }
+
+#if CONFIG_HEAP_LEAK_TRACKING == 1
+    stats_backtrace(header_p, caller_p);
+
+    header_p->allocated.prev_p = NULL;
+    header_p->allocated.next_p = self_p->buffers_p;
+
+    if (header_p->allocated.next_p != NULL) {
+        header_p->allocated.next_p->allocated.prev_p = header_p;
+    }
+
+    self_p->buffers_p = header_p;
+#endif
+}
+
+/**
+ * Remove given buffer from the memory in use. The heap must be
+ * locked.
+ */
+static void stats_free(struct heap_t *self_p,
+                       struct heap_buffer_header_t *header_p)
+{
+    self_p->stats.used -= buffer_size(header_p);
+    self_p->stats.number_of_buffers--;
+
+#if CONFIG_HEAP_LEAK_TRACKING == 1
+    if (header_p->allocated.next_p != NULL) {
+        header_p->allocated.next_p->allocated.prev_p =
+            header_p->allocated.prev_p;
+    }
+
+    if (header_p->allocated.prev_p != NULL) {
+        header_p->allocated.prev_p->allocated.next_p =
+            header_p->allocated.next_p;
+    } else {
+        self_p->buffers_p = header_p->allocated.next_p;
+    }
+#endif
+}
+
+static void stats_failure(struct heap_t *self_p)
+{
+    self_p->stats.number_of_failures++;
+    fs_counter_increment(&module.failures, 1);
+}
+
+static void stats_init(struct heap_t *self_p)
+{
+    int i;
+    struct heap_t **heap_pp;
+
+    /* A reinitialized heap must be registered again, as its
+       registry link is cleared below. */
+    sys_lock();
+
+    for (heap_pp = &module.heaps_p;
+         *heap_pp != NULL;
+         heap_pp = &(*heap_pp)->registered_next_p) {
+        if (*heap_pp == self_p) {
+            *heap_pp = self_p->registered_next_p;
+            break;
+        }
+    }
+
+    sys_unlock();
+
+    self_p->name_p = NULL;
+    self_p->registered_next_p = NULL;
+    self_p->stats.used = 0;
+    self_p->stats.used_max = 0;
+    self_p->stats.number_of_buffers = 0;
+    self_p->stats.number_of_failures = 0;
+    self_p->stats.free = 0;
+    self_p->stats.largest_free = 0;
+    self_p->stats.fragmentation = 0;
+
+    for (i = 0; i < HEAP_FIXED_SIZES_MAX; i++) {
+        self_p->fixed[i].number_of_allocs = 0;
+    }
+
+    for (i = 0; i < CONFIG_HEAP_DYNAMIC_FL_MAX; i++) {
+        self_p->dynamic.number_of_allocs[i] = 0;
+    }
+
+#if CONFIG_HEAP_LEAK_TRACKING == 1
+    self_p->buffers_p = NULL;
+#endif
+}
+
+static const char *heap_name(struct heap_t *heap_p)
+{
+    if (heap_p->name_p == NULL) {
+        return ("");
+    }
+
+    return (heap_p->name_p);
+}
+
+static int cmd_list_cb(int argc,
+                       const char *argv[],
+                       void *chout_p,
+                       void *chin_p,
+                       void *arg_p,
+                       void *call_arg_p)
+{
+    struct heap_t *heap_p;
+    struct heap_stats_t stats;
+
+    std_fprintf(chout_p,
+                OSTR("                NAME       SIZE       USED   USED-MAX"
+                     "    BUFFERS       FREE    LARGEST  FRAGMENTATION"
+                     "   FAILURES\r\n"));
+
+    for (heap_p = module.heaps_p;
+         heap_p != NULL;
+         heap_p = heap_p->registered_next_p) {
+        heap_get_stats(heap_p, &stats);
+        std_fprintf(chout_p,
+                    OSTR("%20s %10lu %10lu %10lu %10lu %10lu %10lu"
+                         "           %3d%% %10lu\r\n"),
+                    heap_name(heap_p),
+                    (unsigned long)heap_p->size,
+                    (unsigned long)stats.used,
+                    (unsigned long)stats.used_max,
+                    (unsigned long)stats.number_of_buffers,
+                    (unsigned long)stats.free,
+                    (unsigned long)stats.largest_free,
+                    stats.fragmentation,
+                    (unsigned long)stats.number_of_failures);
+    }
+
+    return (0);
+}
+
+static int cmd_sizes_cb(int argc,
+                        const char *argv[],
+                        void *chout_p,
+                        void *chin_p,
+                        void *arg_p,
+                        void *call_arg_p)
+{
+    struct heap_t *heap_p;
+    int i;
+
+    for (heap_p = module.heaps_p;
+         heap_p != NULL;
+         heap_p = heap_p->registered_next_p) {
+        std_fprintf(chout_p,
+                    OSTR("%s\r\n"
+                         "                SIZE     ALLOCS\r\n"),
+                    heap_name(heap_p));
+
+        mutex_lock(&heap_p->mutex);
+
+        for (i = 0; i < HEAP_FIXED_SIZES_MAX; i++) {
+            if (heap_p->fixed[i].number_of_allocs == 0) {
+                continue;
+            }
+
+            std_fprintf(chout_p,
+                        OSTR("%20lu %10lu\r\n"),
+                        (unsigned long)heap_p->fixed[i].size,
+                        (unsigned long)heap_p->fixed[i].number_of_allocs);
+        }
+
+        for (i = 0; i < CONFIG_HEAP_DYNAMIC_FL_MAX; i++) {
+            if (heap_p->dynamic.number_of_allocs[i] == 0) {
+                continue;
+            }
+
+            std_fprintf(chout_p,
+                        OSTR("%9lu-%10lu %10lu\r\n"),
+                        (1UL << (i + HEAP_DYNAMIC_SL_LOG2)),
+                        (1UL << (i + HEAP_DYNAMIC_SL_LOG2 + 1)) - 1,
+                        (unsigned long)heap_p->dynamic.number_of_allocs[i]);
+        }
+
+        mutex_unlock(&heap_p->mutex);
+    }
+
+    return (0);
+}
+
+#if CONFIG_HEAP_LEAK_TRACKING == 1
+
+static int cmd_leaks_cb(int argc,
+                        const char *argv[],
+                        void *chout_p,
+                        void *chin_p,
+                        void *arg_p,
+                        void *call_arg_p)
 {
+    struct heap_t *heap_p;
     struct heap_buffer_header_t *header_p;
-    struct heap_fixed_t *fixed_p = self_p->fixed;
-    size_t left;
-    char *next_p;
+    int i;
 
-    while (fixed_p != &self_p->fixed[HEAP_FIXED_SIZES_MAX]) {
-        if (size <= fixed_p->size) {
-            if (fixed_p->free_p != NULL) {
-                header_p = fixed_p->free_p;
-                fixed_p->free_p = header_p->u.next_p;
-            } else {
-                next_p = self_p->next_p;
+    for (heap_p = module.heaps_p;
+         heap_p != NULL;
+         heap_p = heap_p->registered_next_p) {
+        std_fprintf(chout_p, OSTR("%s\r\n"), heap_name(heap_p));
+
+        mutex_lock(&heap_p->mutex);
+
+        for (header_p = heap_p->buffers_p;
+             header_p != NULL;
+             header_p = header_p->allocated.next_p) {
+            /* Skip free buffers in magazines. */
+            if (header_p->count == 0) {
+                continue;
+            }
 
-                /* Out of memory?. */
-                left = (self_p->size - (next_p - (char *)self_p->buf_p));
+            std_fprintf(chout_p,
+                        OSTR("  0x%08lx %lu bytes, count %d\r\n"),
+                        (unsigned long)(uintptr_t)&header_p[1],
+                        (unsigned long)buffer_size(header_p),
+                        header_p->count);
 
-                if (left < (sizeof(*header_p) + fixed_p->size)) {
+            for (i = 0; i < CONFIG_HEAP_LEAK_TRACKING_DEPTH; i++) {
+                if (header_p->backtrace[i] == NULL) {
                     break;
                 }
 
-                header_p = self_p->next_p;
-                next_p += (sizeof(*header_p) + fixed_p->size);
-                self_p->next_p = next_p;
+                std_fprintf(chout_p,
+                            OSTR("    : 0x%08lx\r\n"),
+                            (unsigned long)(uintptr_t)header_p->backtrace[i]);
             }
+        }
+
+        mutex_unlock(&heap_p->mutex);
+    }
+
+    return (0);
+}
+
+#endif
+
+#endif
+
+/**
+ * Allocate a buffer of given size. The heap must be locked.
+ */
+static void *alloc(struct heap_t *self_p,
+                   size_t size,
+                   void *caller_p)
+{
+    void *buf_p;
+
+    if (size <= self_p->fixed[HEAP_FIXED_SIZES_MAX - 1].size) {
+        buf_p = alloc_fixed_size(self_p, size);
+    } else {
+        buf_p = alloc_dynamic_size(self_p, size);
+    }
+
+#if CONFIG_HEAP_STATS == 1
+    if (buf_p != NULL) {
+        stats_alloc(self_p,
+                    &((struct heap_buffer_header_t *)buf_p)[-1],
+                    caller_p);
+        stats_count_alloc(self_p,
+                          &((struct heap_buffer_header_t *)buf_p)[-1]);
+    } else {
+        stats_failure(self_p);
+    }
+#endif
+
+    return (buf_p);
+}
+
+/**
+ * Give given buffer, with a share count of zero(0), back to the
+ * heap. The heap must be locked.
+ */
+static int release(struct heap_t *self_p,
+                   struct heap_buffer_header_t *header_p)
+{
+#if CONFIG_HEAP_STATS == 1
+    stats_free(self_p, header_p);
+#endif
 
-            /* Initialize the allocated buffer. */
-            header_p->u.fixed_p = fixed_p;
-            header_p->size = size;
-            header_p->count = 1;
+    if (header_p->u.fixed_p != NULL) {
+        return (free_fixed_size(self_p, header_p));
+    } else {
+        return (free_dynamic_buffer(self_p, header_p));
+    }
+}
+
+/**
+ * Decrement the share count of given buffer. The count is changed
+ * atomically if buffers are freed without locking the heap.
+ *
+ * @return Share count after the decrement, or -1 if the buffer is
+ *         not allocated.
+ */
+static int count_put(struct heap_buffer_header_t *header_p)
+{
+#if CONFIG_HEAP_MAGAZINES == 1
+    int count;
 
-            return (&header_p[1]);
+    count = __atomic_load_n(&header_p->count, __ATOMIC_RELAXED);
 
+    do {
+        if (count <= 0) {
+            return (-1);
         }
+    } while (!__atomic_compare_exchange_n(&header_p->count,
+                                          &count,
+                                          count - 1,
+                                          1,
+                                          __ATOMIC_ACQ_REL,
+                                          __ATOMIC_RELAXED));
 
-        fixed_p++;
+    return (count - 1);
+#else
+    if (header_p->count <= 0) {
+        return (-1);
     }
 
-    return (NULL);
+    header_p->count--;
+
+    return (header_p->count);
+#endif
 }
 
-static void *alloc_dynamic_size(struct heap_t *self_p,
-                                size_t size)
+#if CONFIG_HEAP_MAGAZINES == 1
+
+/**
+ * Magazines of the current thread, or NULL if the thread is not
+ * attached to given heap.
+ */
+static struct heap_magazines_t *magazines_get(struct heap_t *self_p)
 {
-    struct heap_buffer_header_t *header_p, *prev_p;
-    size_t left;
-    char *next_p;
+    struct thrd_t *thrd_p;
 
-    /* Allocate from the free list. */
-    header_p = self_p->dynamic.free_p;
-    prev_p = NULL;
+    thrd_p = thrd_self();
+
+    /* Allocations before the thread module is initialized. */
+    if (thrd_p == NULL) {
+        return (NULL);
+    }
 
-    while (header_p != NULL) {
-        if (size <= header_p->size) {
-            header_p->count = 1;
+    if ((thrd_p->heap.heap_p != self_p)
+        || (thrd_p->heap.generation != self_p->generation)) {
+        return (NULL);
+    }
 
-            if (prev_p != NULL) {
-                prev_p->u.next_p = header_p->u.next_p;
-            } else {
-                self_p->dynamic.free_p = header_p->u.next_p;
-            }
+    return (thrd_p->heap.magazines_p);
+}
+
+/**
+ * Move free buffers of given fixed size from the heap to given
+ * magazine, up to a batch. At most one buffer is allocated from the
+ * unallocated memory, as fixed size buffers are never given back to
+ * it. The heap must be locked.
+ */
+static void magazine_fill(struct heap_t *self_p,
+                          struct heap_magazine_t *magazine_p,
+                          struct heap_fixed_t *fixed_p)
+{
+    struct heap_buffer_header_t *header_p;
+
+    while (magazine_p->length < MAGAZINE_BATCH) {
+        if ((fixed_p->free_p == NULL) && (magazine_p->length > 0)) {
+            break;
+        }
 
-            header_p->u.fixed_p = NULL;
+        header_p = fixed_take(self_p, fixed_p);
 
-            return (&header_p[1]);
+        if (header_p == NULL) {
+            break;
         }
 
-        prev_p = header_p;
-        header_p = header_p->u.next_p;
+        header_p->size = fixed_p->size;
+        header_p->count = 0;
+
+#if CONFIG_HEAP_STATS == 1
+        stats_alloc(self_p, header_p, NULL);
+#endif
+
+        header_p->u.next_p = magazine_p->buffers_p;
+        magazine_p->buffers_p = header_p;
+        magazine_p->length++;
     }
+}
 
-    next_p = self_p->next_p;
+/**
+ * Give given number of buffers in given magazine back to the
+ * heap. The heap must be locked.
+ */
+static void magazine_drain(struct heap_t *self_p,
+                           struct heap_magazine_t *magazine_p,
+                           struct heap_fixed_t *fixed_p,
+                           int length)
+{
+    struct heap_buffer_header_t *header_p;
 
-    /* Allocate new memory. */
-    left = (self_p->size - (next_p - (char *)self_p->buf_p));
+    while (length > 0) {
+        header_p = magazine_p->buffers_p;
+        magazine_p->buffers_p = header_p->u.next_p;
+        magazine_p->length--;
+        length--;
 
-    if (left < (sizeof(*header_p) + size)) {
-        return (NULL);
+        header_p->u.fixed_p = fixed_p;
+        release(self_p, header_p);
+    }
+}
+
+/**
+ * Allocate a fixed size buffer from given magazines, refilling the
+ * magazine from the heap if empty.
+ */
+static void *magazines_alloc(struct heap_t *self_p,
+                             struct heap_magazines_t *magazines_p,
+                             size_t size)
+{
+    struct heap_buffer_header_t *header_p;
+    struct heap_magazine_t *magazine_p;
+    struct heap_fixed_t *fixed_p;
+
+    fixed_p = fixed_find(self_p, size);
+    magazine_p = &magazines_p->sizes[fixed_p - self_p->fixed];
+
+    if (magazine_p->length == 0) {
+        mutex_lock(&self_p->mutex);
+        magazine_fill(self_p, magazine_p, fixed_p);
+
+#if CONFIG_HEAP_STATS == 1
+        if (magazine_p->length == 0) {
+            stats_failure(self_p);
+        }
+#endif
+
+        mutex_unlock(&self_p->mutex);
+
+        if (magazine_p->length == 0) {
+            return (NULL);
+        }
     }
 
-    header_p = self_p->next_p;
-    next_p += (sizeof(*header_p) + size);
-    self_p->next_p = next_p;
+    header_p = magazine_p->buffers_p;
+    magazine_p->buffers_p = header_p->u.next_p;
+    magazine_p->length--;
 
     /* Initialize the allocated buffer. */
-    header_p->u.fixed_p = NULL;
+    header_p->u.fixed_p = fixed_p;
     header_p->size = size;
     header_p->count = 1;
 
+#if CONFIG_HEAP_STATS == 1
+    stats_count_alloc(self_p, header_p);
+#endif
+
     return (&header_p[1]);
 }
 
-static int free_fixed_size(struct heap_t *self_p,
-                           struct heap_buffer_header_t *header_p)
+/**
+ * Put given free buffer in a magazine of the current thread, draining
+ * the magazine to the heap if full.
+ *
+ * @return zero(0) if the buffer was put in a magazine, otherwise -1.
+ */
+static int magazines_free(struct heap_t *self_p,
+                          struct heap_buffer_header_t *header_p)
 {
+    struct heap_magazines_t *magazines_p;
+    struct heap_magazine_t *magazine_p;
     struct heap_fixed_t *fixed_p;
 
-    /* Add the buffer to the free list of its fixed size. */
     fixed_p = header_p->u.fixed_p;
-    header_p->u.next_p = fixed_p->free_p;
-    fixed_p->free_p = header_p;
+
+    if (fixed_p == NULL) {
+        return (-1);
+    }
+
+    magazines_p = magazines_get(self_p);
+
+    if (magazines_p == NULL) {
+        return (-1);
+    }
+
+    magazine_p = &magazines_p->sizes[fixed_p - self_p->fixed];
+
+    if (magazine_p->length == CONFIG_HEAP_MAGAZINE_SIZE) {
+        mutex_lock(&self_p->mutex);
+        magazine_drain(self_p, magazine_p, fixed_p, MAGAZINE_BATCH);
+        mutex_unlock(&self_p->mutex);
+    }
+
+    header_p->u.next_p = magazine_p->buffers_p;
+    magazine_p->buffers_p = header_p;
+    magazine_p->length++;
 
     return (0);
 }
 
-static int free_dynamic_buffer(struct heap_t *self_p,
-                               struct heap_buffer_header_t *header_p)
+#endif
+
+int heap_module_init(void)
 {
-    header_p->u.next_p = self_p->dynamic.free_p;
-    self_p->dynamic.free_p = header_p;
+#if CONFIG_HEAP_STATS == 1
+    /* Return immediately if the module is already initialized. */
+    if (module.initialized == 1) {
+        return (0);
+    }
+
+    module.initialized = 1;
+
+    fs_module_init();
+
+    fs_counter_init(&module.allocs, FSTR("/alloc/heap/allocs"), 0);
+    fs_counter_register(&module.allocs);
+    fs_counter_init(&module.frees, FSTR("/alloc/heap/frees"), 0);
+    fs_counter_register(&module.frees);
+    fs_counter_init(&module.failures, FSTR("/alloc/heap/failures"), 0);
+    fs_counter_register(&module.failures);
+
+    fs_command_init(&module.cmd_list,
+                    CSTR("/alloc/heap/list"),
+                    cmd_list_cb,
+                    NULL);
+    fs_command_register(&module.cmd_list);
+
+    fs_command_init(&module.cmd_sizes,
+                    CSTR("/alloc/heap/sizes"),
+                    cmd_sizes_cb,
+                    NULL);
+    fs_command_register(&module.cmd_sizes);
+
+#if CONFIG_HEAP_LEAK_TRACKING == 1
+    fs_command_init(&module.cmd_leaks,
+                    CSTR("/alloc/heap/leaks"),
+                    cmd_leaks_cb,
+                    NULL);
+    fs_command_register(&module.cmd_leaks);
+#endif
+#endif
 
     return (0);
 }
@@ -165,17 +1221,46 @@ int heap_init(struct heap_t *self_p,
     ASSERTN(size > 0, EINVAL);
 
     int i;
+    int j;
+    uintptr_t end;
 
     self_p->buf_p = buf_p;
     self_p->size = size;
     self_p->next_p = buf_p;
 
+#if CONFIG_HEAP_MAGAZINES == 1
+    generation++;
+    self_p->generation = generation;
+#endif
+
     for (i = 0; i < HEAP_FIXED_SIZES_MAX; i++) {
         self_p->fixed[i].free_p = NULL;
         self_p->fixed[i].size = sizes[i];
     }
 
-    self_p->dynamic.free_p = NULL;
+    /* Dynamic blocks are aligned to the end of the buffer. */
+    end = ((uintptr_t)buf_p + size);
+    end &= ~(uintptr_t)(DYNAMIC_ALIGNMENT - 1);
+
+    if (end < (uintptr_t)buf_p) {
+        end = (uintptr_t)buf_p;
+    }
+
+#if CONFIG_HEAP_STATS == 1
+    stats_init(self_p);
+#endif
+
+    self_p->dynamic.begin_p = (void *)end;
+    self_p->dynamic.end_p = (void *)end;
+    self_p->dynamic.fl_bitmap = 0;
+
+    for (i = 0; i < CONFIG_HEAP_DYNAMIC_FL_MAX; i++) {
+        self_p->dynamic.sl_bitmap[i] = 0;
+
+        for (j = 0; j < HEAP_DYNAMIC_SL_MAX; j++) {
+            self_p->dynamic.free_p[i][j] = NULL;
+        }
+    }
 
     return (mutex_init(&self_p->mutex));
 }
@@ -186,16 +1271,31 @@ void *heap_alloc(struct heap_t *self_p,
     ASSERTNRN(self_p != NULL, EINVAL);
     ASSERTNRN(size > 0, EINVAL);
 
-    void *buf_p = NULL;
+    void *buf_p;
 
-    mutex_lock(&self_p->mutex);
+#if CONFIG_HEAP_MAGAZINES == 1
+    struct heap_magazines_t *magazines_p;
 
     if (size <= self_p->fixed[HEAP_FIXED_SIZES_MAX - 1].size) {
-        buf_p = alloc_fixed_size(self_p, size);
-    } else {
-        buf_p = alloc_dynamic_size(self_p, size);
+        magazines_p = magazines_get(self_p);
+
+        if (magazines_p != NULL) {
+            buf_p = magazines_alloc(self_p, magazines_p, size);
+
+#if CONFIG_HEAP_LEAK_TRACKING == 1
+            if (buf_p != NULL) {
+                stats_backtrace(&((struct heap_buffer_header_t *)buf_p)[-1],
+                                __builtin_return_address(0));
+            }
+#endif
+
+            return (buf_p);
+        }
     }
+#endif
 
+    mutex_lock(&self_p->mutex);
+    buf_p = alloc(self_p, size, __builtin_return_address(0));
     mutex_unlock(&self_p->mutex);
 
     return (buf_p);
@@ -212,25 +1312,36 @@ int heap_free(struct heap_t *self_p,
 
     header_p = &((struct heap_buffer_header_t *)buf_p)[-1];
 
-    mutex_lock(&self_p->mutex);
+#if CONFIG_HEAP_MAGAZINES == 1
+    count = count_put(header_p);
 
-    if (header_p->count > 0) {
-        header_p->count--;
-        count = header_p->count;
+    /* Free when count is zero. */
+    if (count == 0) {
+#if CONFIG_HEAP_STATS == 1
+        stats_count_free();
+#endif
 
-        /* Free when count is zero. */
-        if (count == 0) {
-            if (header_p->u.fixed_p != NULL) {
-                count = free_fixed_size(self_p, header_p);
-            } else {
-                count = free_dynamic_buffer(self_p, header_p);
-            }
+        if (magazines_free(self_p, header_p) != 0) {
+            mutex_lock(&self_p->mutex);
+            count = release(self_p, header_p);
+            mutex_unlock(&self_p->mutex);
         }
-    } else {
-        count = -1;
+    }
+#else
+    mutex_lock(&self_p->mutex);
+
+    count = count_put(header_p);
+
+    /* Free when count is zero. */
+    if (count == 0) {
+#if CONFIG_HEAP_STATS == 1
+        stats_count_free();
+#endif
+        count = release(self_p, header_p);
     }
 
     mutex_unlock(&self_p->mutex);
+#endif
 
     return (count);
 }
@@ -247,9 +1358,185 @@ int heap_share(struct heap_t *self_p,
 
     header_p = &((struct heap_buffer_header_t *)buf_p)[-1];
 
+#if CONFIG_HEAP_MAGAZINES == 1
+    __atomic_add_fetch(&header_p->count, count, __ATOMIC_RELAXED);
+#else
     mutex_lock(&self_p->mutex);
     header_p->count += count;
     mutex_unlock(&self_p->mutex);
+#endif
+
+    return (0);
+}
+
+#if CONFIG_HEAP_MAGAZINES == 1
+
+int heap_magazines_attach(struct heap_t *self_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+
+    struct thrd_t *thrd_p;
+    struct heap_magazines_t *magazines_p;
+    int i;
+
+    heap_magazines_detach();
+
+    mutex_lock(&self_p->mutex);
+    magazines_p = alloc(self_p,
+                        sizeof(*magazines_p),
+                        __builtin_return_address(0));
+    mutex_unlock(&self_p->mutex);
+
+    if (magazines_p == NULL) {
+        return (-ENOMEM);
+    }
+
+    for (i = 0; i < HEAP_FIXED_SIZES_MAX; i++) {
+        magazines_p->sizes[i].buffers_p = NULL;
+        magazines_p->sizes[i].length = 0;
+    }
+
+    thrd_p = thrd_self();
+    thrd_p->heap.heap_p = self_p;
+    thrd_p->heap.generation = self_p->generation;
+    thrd_p->heap.magazines_p = magazines_p;
+
+    return (0);
+}
+
+int heap_magazines_detach(void)
+{
+    struct thrd_t *thrd_p;
+    struct heap_t *heap_p;
+    struct heap_magazines_t *magazines_p;
+    struct heap_buffer_header_t *header_p;
+    int i;
+
+    thrd_p = thrd_self();
+    heap_p = thrd_p->heap.heap_p;
+
+    if (heap_p == NULL) {
+        return (0);
+    }
+
+    /* The magazines are gone if the heap has been initialized
+       again. */
+    if (thrd_p->heap.generation == heap_p->generation) {
+        magazines_p = thrd_p->heap.magazines_p;
+
+        mutex_lock(&heap_p->mutex);
+
+        for (i = 0; i < HEAP_FIXED_SIZES_MAX; i++) {
+            magazine_drain(heap_p,
+                           &magazines_p->sizes[i],
+                           &heap_p->fixed[i],
+                           magazines_p->sizes[i].length);
+        }
+
+        header_p = &((struct heap_buffer_header_t *)magazines_p)[-1];
+        header_p->count = 0;
+        release(heap_p, header_p);
+#if CONFIG_HEAP_STATS == 1
+        stats_count_free();
+#endif
+
+        mutex_unlock(&heap_p->mutex);
+    }
+
+    thrd_p->heap.heap_p = NULL;
+    thrd_p->heap.magazines_p = NULL;
+
+    return (0);
+}
+
+#endif
+
+#if CONFIG_HEAP_STATS == 1
+
+int heap_register(struct heap_t *self_p, const char *name_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(name_p != NULL, EINVAL);
+
+    struct heap_t *heap_p;
+
+    self_p->name_p = name_p;
+
+    sys_lock();
+
+    for (heap_p = module.heaps_p;
+         heap_p != NULL;
+         heap_p = heap_p->registered_next_p) {
+        if (heap_p == self_p) {
+            break;
+        }
+    }
+
+    if (heap_p == NULL) {
+        self_p->registered_next_p = module.heaps_p;
+        module.heaps_p = self_p;
+    }
+
+    sys_unlock();
+
+    return (0);
+}
+
+int heap_get_stats(struct heap_t *self_p, struct heap_stats_t *stats_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(stats_p != NULL, EINVAL);
+
+    struct heap_dynamic_block_t *block_p;
+    size_t left;
+    size_t largest;
+    int fl;
+    int sl;
+
+    mutex_lock(&self_p->mutex);
+
+    *stats_p = self_p->stats;
+
+    /* Memory not yet allocated. */
+    left = ((char *)self_p->dynamic.begin_p - (char *)self_p->next_p);
+    stats_p->free = left;
+    largest = left;
+
+    /* Free blocks. */
+    for (fl = 0; fl < CONFIG_HEAP_DYNAMIC_FL_MAX; fl++) {
+        for (sl = 0; sl < HEAP_DYNAMIC_SL_MAX; sl++) {
+            block_p = self_p->dynamic.free_p[fl][sl];
+
+            while (block_p != NULL) {
+                left = (sizeof(*block_p) + block_p->header.size);
+                stats_p->free += left;
+
+                if (left > largest) {
+                    largest = left;
+                }
+
+                block_p = block_links(block_p)->next_p;
+            }
+        }
+    }
+
+    mutex_unlock(&self_p->mutex);
+
+    if (largest > sizeof(*block_p)) {
+        stats_p->largest_free = ((largest - sizeof(*block_p))
+                                 & ~(DYNAMIC_ALIGNMENT - 1));
+    } else {
+        stats_p->largest_free = 0;
+    }
+
+    if (stats_p->free > 0) {
+        stats_p->fragmentation = (100 - ((100ULL * largest)
+                                         / stats_p->free));
+    } else {
+        stats_p->fragmentation = 0;
+    }
 
     return (0);
 }
+
+#endif
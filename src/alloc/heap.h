@@ -41,12 +41,69 @@
 struct heap_fixed_t {
     void *free_p;
     size_t size;
+#if CONFIG_HEAP_STATS == 1
+    /** Number of buffers allocated of this size. */
+    uint32_t number_of_allocs;
+#endif
 };
 
+/**
+ * Number of second level size classes per first level size class of
+ * the dynamic heap, as a power of two.
+ */
+#define HEAP_DYNAMIC_SL_LOG2 2
+#define HEAP_DYNAMIC_SL_MAX (1 << HEAP_DYNAMIC_SL_LOG2)
+
+/**
+ * The dynamic heap is a two-level segregated fit (TLSF)
+ * allocator. Its blocks are allocated downwards from the end of the
+ * heap buffer.
+ */
 struct heap_dynamic_t {
-    void *free_p;
+    /** Lowest allocated block, or end of the heap buffer. */
+    void *begin_p;
+    /** End of the heap buffer. */
+    void *end_p;
+    /** Non-empty first level size classes. */
+    uint32_t fl_bitmap;
+    /** Non-empty second level size classes. */
+    uint8_t sl_bitmap[CONFIG_HEAP_DYNAMIC_FL_MAX];
+    /** Free lists per size class. */
+    void *free_p[CONFIG_HEAP_DYNAMIC_FL_MAX][HEAP_DYNAMIC_SL_MAX];
+#if CONFIG_HEAP_STATS == 1
+    /** Number of buffers allocated per first level size class. */
+    uint32_t number_of_allocs[CONFIG_HEAP_DYNAMIC_FL_MAX];
+#endif
 };
 
+#if CONFIG_HEAP_STATS == 1
+
+/**
+ * Heap statistics.
+ */
+struct heap_stats_t {
+    /** Number of bytes in allocated buffers. */
+    size_t used;
+    /** Highest number of bytes in allocated buffers since the heap
+        was initialized. */
+    size_t used_max;
+    /** Number of allocated buffers. */
+    size_t number_of_buffers;
+    /** Number of failed allocations. */
+    uint32_t number_of_failures;
+    /** Number of free bytes in the dynamic heap, including memory
+        not yet allocated. Free fixed size buffers are not included. */
+    size_t free;
+    /** Size of the biggest buffer that can be allocated from the
+        dynamic heap. */
+    size_t largest_free;
+    /** Percentage of the free bytes that can not be allocated as one
+        buffer. */
+    int fragmentation;
+};
+
+#endif
+
 /**
  * The heap struct.
  */
@@ -57,8 +114,33 @@ struct heap_t {
     struct heap_fixed_t fixed[HEAP_FIXED_SIZES_MAX];
     struct heap_dynamic_t dynamic;
     struct mutex_t mutex;
+#if CONFIG_HEAP_MAGAZINES == 1
+    /** Changed when the heap is initialized, invalidating magazines
+        of threads attached to the heap. */
+    uint32_t generation;
+#endif
+#if CONFIG_HEAP_STATS == 1
+    const char *name_p;
+    struct heap_t *registered_next_p;
+    struct heap_stats_t stats;
+#endif
+#if CONFIG_HEAP_LEAK_TRACKING == 1
+    /** Allocated buffers, most recent first. */
+    void *buffers_p;
+#endif
 };
 
+/**
+ * Initialize the heap module. This function must be called before
+ * calling any other function in this module.
+ *
+ * The module will only be initialized once even if this function is
+ * called multiple times.
+ *
+ * @return zero(0) or negative error code
+ */
+int heap_module_init(void);
+
 /**
  * Initialize given heap.
  *
@@ -79,6 +161,9 @@ int heap_init(struct heap_t *self_p,
  * if the requested buffer size is greater than the biggest fixed size
  * buffer.
  *
+ * Free dynamic buffers are split to the requested size, and merged
+ * with free neighbours when freed, both in constant time.
+ *
  * @param[in] self_p Heap to allocate from.
  * @param[in] size Number of bytes to allocate.
  *
@@ -113,4 +198,63 @@ int heap_share(struct heap_t *self_p,
                const void *buf_p,
                int count);
 
+#if CONFIG_HEAP_MAGAZINES == 1
+
+/**
+ * Attach the current thread to given heap. Fixed size buffers freed
+ * by the thread are cached in per-thread magazines instead of being
+ * returned to the heap, and allocations by the thread are first
+ * served from the magazines. Magazines are refilled from and drained
+ * to the heap in batches of ``CONFIG_HEAP_MAGAZINE_SIZE / 2``
+ * buffers, so most allocations and frees do not lock the heap.
+ *
+ * A thread is attached to at most one heap. The current thread is
+ * detached from its previous heap, if any.
+ *
+ * Buffers in magazines are allocated from the heap's point of view,
+ * and are included in its used memory statistics.
+ *
+ * @param[in] self_p Heap to attach to.
+ *
+ * @return zero(0) or negative error code.
+ */
+int heap_magazines_attach(struct heap_t *self_p);
+
+/**
+ * Detach the current thread from its heap, giving all buffers in its
+ * magazines back to the heap. Called when a thread terminates.
+ *
+ * @return zero(0) or negative error code.
+ */
+int heap_magazines_detach(void);
+
+#endif
+
+#if CONFIG_HEAP_STATS == 1
+
+/**
+ * Register given heap with given name, listing it in the
+ * `/alloc/heap/...` file system commands. Registering a heap again
+ * only changes its name. `heap_init()` unregisters the heap, so a
+ * reinitialized heap must be registered again.
+ *
+ * @param[in] self_p Heap to register.
+ * @param[in] name_p Heap name.
+ *
+ * @return zero(0) or negative error code.
+ */
+int heap_register(struct heap_t *self_p, const char *name_p);
+
+/**
+ * Get statistics of given heap.
+ *
+ * @param[in] self_p Heap to get statistics of.
+ * @param[out] stats_p Heap statistics.
+ *
+ * @return zero(0) or negative error code.
+ */
+int heap_get_stats(struct heap_t *self_p, struct heap_stats_t *stats_p);
+
+#endif
+
 #endif
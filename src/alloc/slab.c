@@ -0,0 +1,348 @@
+/**
+ * @section License
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014-2017, Erik Moqvist
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+/* Marks the free list link of allocated objects. */
+#define ALLOCATED ((void *)1)
+
+struct module_t {
+    int8_t initialized;
+    struct slab_t *slabs_p;
+#if CONFIG_SLAB_FS_COMMAND_LIST == 1
+    struct fs_command_t cmd_list;
+#endif
+};
+
+static struct module_t module;
+
+/**
+ * The free list link of given object, stored at the end of its slot
+ * to keep the object constructed while free.
+ */
+static void **object_link(struct slab_t *self_p, void *object_p)
+{
+    return ((void **)((char *)object_p
+                      + self_p->slot_size
+                      - sizeof(void *)));
+}
+
+#if CONFIG_SLAB_FS_COMMAND_LIST == 1
+
+static const char *slab_name(struct slab_t *slab_p)
+{
+    if (slab_p->name_p == NULL) {
+        return ("");
+    }
+
+    return (slab_p->name_p);
+}
+
+static int cmd_list_cb(int argc,
+                       const char *argv[],
+                       void *chout_p,
+                       void *chin_p,
+                       void *arg_p,
+                       void *call_arg_p)
+{
+    struct slab_t *slab_p;
+    struct slab_stats_t stats;
+
+    std_fprintf(chout_p,
+                OSTR("                NAME  SLOT-SIZE    OBJECTS       USED"
+                     "   USED-MAX     ALLOCS   FAILURES\r\n"));
+
+    for (slab_p = module.slabs_p;
+         slab_p != NULL;
+         slab_p = slab_p->registered_next_p) {
+        slab_get_stats(slab_p, &stats);
+        std_fprintf(chout_p,
+                    OSTR("%20s %10lu %10lu %10lu %10lu %10lu %10lu\r\n"),
+                    slab_name(slab_p),
+                    (unsigned long)slab_p->slot_size,
+                    (unsigned long)stats.number_of_objects,
+                    (unsigned long)stats.used,
+                    (unsigned long)stats.used_max,
+                    (unsigned long)stats.number_of_allocs,
+                    (unsigned long)stats.number_of_failures);
+    }
+
+    return (0);
+}
+
+#endif
+
+int slab_module_init(void)
+{
+    /* Return immediately if the module is already initialized. */
+    if (module.initialized == 1) {
+        return (0);
+    }
+
+    module.initialized = 1;
+
+#if CONFIG_SLAB_FS_COMMAND_LIST == 1
+    fs_module_init();
+
+    fs_command_init(&module.cmd_list,
+                    CSTR("/alloc/slab/list"),
+                    cmd_list_cb,
+                    NULL);
+    fs_command_register(&module.cmd_list);
+#endif
+
+    return (0);
+}
+
+int slab_init(struct slab_t *self_p,
+              void *buf_p,
+              size_t size,
+              size_t object_size,
+              slab_object_fn_t constructor,
+              slab_object_fn_t destructor,
+              void *arg_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(buf_p != NULL, EINVAL);
+    ASSERTN(object_size > 0, EINVAL);
+
+    uintptr_t begin;
+    uintptr_t end;
+    char *object_p;
+    void **link_pp;
+
+    self_p->slot_size = SLAB_SLOT_SIZE(object_size);
+
+    /* Align the first slot. */
+    begin = (uintptr_t)buf_p;
+    begin = DIV_CEIL(begin, CONFIG_SLAB_ALIGNMENT) * CONFIG_SLAB_ALIGNMENT;
+    end = ((uintptr_t)buf_p + size);
+
+    if (begin > end) {
+        begin = end;
+    }
+
+    self_p->stats.number_of_objects = ((end - begin) / self_p->slot_size);
+    self_p->stats.used = 0;
+    self_p->stats.used_max = 0;
+    self_p->stats.number_of_allocs = 0;
+    self_p->stats.number_of_failures = 0;
+    self_p->begin_p = (void *)begin;
+    self_p->end_p = ((char *)self_p->begin_p
+                     + self_p->stats.number_of_objects * self_p->slot_size);
+    self_p->destructor = destructor;
+    self_p->arg_p = arg_p;
+    self_p->name_p = NULL;
+    self_p->registered_next_p = NULL;
+
+    /* Construct all objects and add them to the free list, lowest
+       address first. */
+    link_pp = &self_p->free_p;
+
+    for (object_p = self_p->begin_p;
+         object_p != self_p->end_p;
+         object_p += self_p->slot_size) {
+        if (constructor != NULL) {
+            constructor(object_p, arg_p);
+        }
+
+        *link_pp = object_p;
+        link_pp = object_link(self_p, object_p);
+    }
+
+    *link_pp = NULL;
+
+    return (0);
+}
+
+int slab_destroy(struct slab_t *self_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+
+    struct slab_t *slab_p;
+    struct slab_t **slab_pp;
+    char *object_p;
+
+    if (self_p->stats.used > 0) {
+        return (-EBUSY);
+    }
+
+    if (self_p->destructor != NULL) {
+        for (object_p = self_p->begin_p;
+             object_p != self_p->end_p;
+             object_p += self_p->slot_size) {
+            self_p->destructor(object_p, self_p->arg_p);
+        }
+    }
+
+    self_p->free_p = NULL;
+    self_p->stats.number_of_objects = 0;
+
+    /* Unregister. */
+    sys_lock();
+
+    for (slab_pp = &module.slabs_p;
+         (slab_p = *slab_pp) != NULL;
+         slab_pp = &slab_p->registered_next_p) {
+        if (slab_p == self_p) {
+            *slab_pp = self_p->registered_next_p;
+            break;
+        }
+    }
+
+    sys_unlock();
+
+    return (0);
+}
+
+void *slab_alloc(struct slab_t *self_p)
+{
+    ASSERTNRN(self_p != NULL, EINVAL);
+
+    void *object_p;
+
+    sys_lock();
+    object_p = slab_alloc_isr(self_p);
+    sys_unlock();
+
+    return (object_p);
+}
+
+void *slab_alloc_isr(struct slab_t *self_p)
+{
+    ASSERTNRN(self_p != NULL, EINVAL);
+
+    void *object_p;
+    void **link_pp;
+
+    object_p = self_p->free_p;
+
+    if (object_p == NULL) {
+        self_p->stats.number_of_failures++;
+
+        return (NULL);
+    }
+
+    link_pp = object_link(self_p, object_p);
+    self_p->free_p = *link_pp;
+    *link_pp = ALLOCATED;
+
+    self_p->stats.used++;
+    self_p->stats.number_of_allocs++;
+
+    if (self_p->stats.used > self_p->stats.used_max) {
+        self_p->stats.used_max = self_p->stats.used;
+    }
+
+    return (object_p);
+}
+
+int slab_free(struct slab_t *self_p, void *object_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(object_p != NULL, EINVAL);
+
+    int res;
+
+    sys_lock();
+    res = slab_free_isr(self_p, object_p);
+    sys_unlock();
+
+    return (res);
+}
+
+int slab_free_isr(struct slab_t *self_p, void *object_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(object_p != NULL, EINVAL);
+
+    void **link_pp;
+
+    /* The object must be an allocated object in this slab. */
+    if (((char *)object_p < (char *)self_p->begin_p)
+        || ((char *)object_p >= (char *)self_p->end_p)
+        || ((((char *)object_p - (char *)self_p->begin_p)
+             % self_p->slot_size) != 0)) {
+        return (-EINVAL);
+    }
+
+    link_pp = object_link(self_p, object_p);
+
+    if (*link_pp != ALLOCATED) {
+        return (-EINVAL);
+    }
+
+    *link_pp = self_p->free_p;
+    self_p->free_p = object_p;
+    self_p->stats.used--;
+
+    return (0);
+}
+
+int slab_register(struct slab_t *self_p, const char *name_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(name_p != NULL, EINVAL);
+
+    struct slab_t *slab_p;
+
+    self_p->name_p = name_p;
+
+    sys_lock();
+
+    for (slab_p = module.slabs_p;
+         slab_p != NULL;
+         slab_p = slab_p->registered_next_p) {
+        if (slab_p == self_p) {
+            break;
+        }
+    }
+
+    if (slab_p == NULL) {
+        self_p->registered_next_p = module.slabs_p;
+        module.slabs_p = self_p;
+    }
+
+    sys_unlock();
+
+    return (0);
+}
+
+int slab_get_stats(struct slab_t *self_p, struct slab_stats_t *stats_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(stats_p != NULL, EINVAL);
+
+    sys_lock();
+    *stats_p = self_p->stats;
+    sys_unlock();
+
+    return (0);
+}
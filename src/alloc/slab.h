@@ -0,0 +1,207 @@
+/**
+ * @section License
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014-2017, Erik Moqvist
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * This file is part of the Simba project.
+ */
+
+#ifndef __ALLOC_SLAB_H__
+#define __ALLOC_SLAB_H__
+
+#include "simba.h"
+
+/**
+ * Size of a slot holding an object of given size. A slot holds the
+ * object followed by the free list link, rounded up to
+ * ``CONFIG_SLAB_ALIGNMENT``.
+ */
+#define SLAB_SLOT_SIZE(object_size)                                     \
+    (DIV_CEIL(DIV_CEIL((object_size), sizeof(void *)) * sizeof(void *)  \
+              + sizeof(void *),                                         \
+              CONFIG_SLAB_ALIGNMENT) * CONFIG_SLAB_ALIGNMENT)
+
+/**
+ * Declare a slab memory buffer with given name, aligned for given
+ * number of objects of given size.
+ *
+ * @param[in] name The name of the buffer.
+ * @param[in] object_size Object size in bytes.
+ * @param[in] number_of_objects Number of objects.
+ */
+#define SLAB_BUFFER(name, object_size, number_of_objects)               \
+    uint8_t name[SLAB_SLOT_SIZE(object_size) * (number_of_objects)]     \
+    __attribute__ ((aligned (CONFIG_SLAB_ALIGNMENT)))
+
+/**
+ * Object constructor and destructor prototype.
+ *
+ * @param[in] object_p Object to construct or destruct.
+ * @param[in] arg_p Argument given to ``slab_init()``.
+ */
+typedef void (*slab_object_fn_t)(void *object_p, void *arg_p);
+
+/**
+ * Slab statistics.
+ */
+struct slab_stats_t {
+    /** Total number of objects. */
+    size_t number_of_objects;
+    /** Number of allocated objects. */
+    size_t used;
+    /** Highest number of allocated objects since the slab was
+        initialized. */
+    size_t used_max;
+    /** Number of allocations. */
+    uint32_t number_of_allocs;
+    /** Number of failed allocations. */
+    uint32_t number_of_failures;
+};
+
+/**
+ * A slab of fixed size objects.
+ */
+struct slab_t {
+    /** First slot, aligned. */
+    void *begin_p;
+    /** End of the last slot. */
+    void *end_p;
+    size_t slot_size;
+    /** First free object. */
+    void *free_p;
+    slab_object_fn_t destructor;
+    void *arg_p;
+    const char *name_p;
+    struct slab_t *registered_next_p;
+    struct slab_stats_t stats;
+};
+
+/**
+ * Initialize the slab module. This function must be called before
+ * calling any other function in this module.
+ *
+ * The module will only be initialized once even if this function is
+ * called multiple times.
+ *
+ * @return zero(0) or negative error code
+ */
+int slab_module_init(void);
+
+/**
+ * Initialize given slab, dividing given memory buffer into as many
+ * slots of given object size as fits. The slots are aligned to
+ * ``CONFIG_SLAB_ALIGNMENT``, typically the data cache line size, so
+ * an object never shares a cache line with another object.
+ *
+ * The constructor is called once for each object, here. Freed
+ * objects must be given back in their constructed state, so
+ * allocating an object does not construct it again. The destructor
+ * is called for each object by ``slab_destroy()``.
+ *
+ * @param[in] self_p Slab to initialize.
+ * @param[in] buf_p Memory buffer, preferably declared with
+ *                  ``SLAB_BUFFER()``.
+ * @param[in] size Size of the memory buffer.
+ * @param[in] object_size Object size in bytes.
+ * @param[in] constructor Object constructor, or NULL.
+ * @param[in] destructor Object destructor, or NULL.
+ * @param[in] arg_p Constructor and destructor argument.
+ *
+ * @return zero(0) or negative error code.
+ */
+int slab_init(struct slab_t *self_p,
+              void *buf_p,
+              size_t size,
+              size_t object_size,
+              slab_object_fn_t constructor,
+              slab_object_fn_t destructor,
+              void *arg_p);
+
+/**
+ * Destroy given slab, calling the destructor for each object. All
+ * objects must be free. The slab is unregistered.
+ *
+ * @param[in] self_p Slab to destroy.
+ *
+ * @return zero(0) or negative error code.
+ */
+int slab_destroy(struct slab_t *self_p);
+
+/**
+ * Allocate an object from given slab in constant time.
+ *
+ * @param[in] self_p Slab to allocate from.
+ *
+ * @return Pointer to allocated object, or NULL if all objects are
+ *         allocated.
+ */
+void *slab_alloc(struct slab_t *self_p);
+
+/**
+ * Same as ``slab_alloc()``, but may only be called from isr or with
+ * the system lock taken (see ``sys_lock()``).
+ */
+void *slab_alloc_isr(struct slab_t *self_p);
+
+/**
+ * Free given object, previously allocated from given slab, in
+ * constant time.
+ *
+ * @param[in] self_p Slab of given object.
+ * @param[in] object_p Object to free.
+ *
+ * @return zero(0) or negative error code.
+ */
+int slab_free(struct slab_t *self_p, void *object_p);
+
+/**
+ * Same as ``slab_free()``, but may only be called from isr or with
+ * the system lock taken (see ``sys_lock()``).
+ */
+int slab_free_isr(struct slab_t *self_p, void *object_p);
+
+/**
+ * Register given slab with given name, listing it in the
+ * `/alloc/slab/list` file system command. Registering a slab again
+ * only changes its name.
+ *
+ * @param[in] self_p Slab to register.
+ * @param[in] name_p Slab name.
+ *
+ * @return zero(0) or negative error code.
+ */
+int slab_register(struct slab_t *self_p, const char *name_p);
+
+/**
+ * Get statistics of given slab.
+ *
+ * @param[in] self_p Slab to get statistics of.
+ * @param[out] stats_p Slab statistics.
+ *
+ * @return zero(0) or negative error code.
+ */
+int slab_get_stats(struct slab_t *self_p, struct slab_stats_t *stats_p);
+
+#endif
@@ -61,4 +61,30 @@ static inline uint32_t bits_insert_32(uint32_t dst,
     return (dst);
 }
 
+/**
+ * Count the number of leading zero bits in given value, starting at
+ * the most significant bit.
+ *
+ * @param[in] value Value to count leading zeros in. Must not be zero.
+ *
+ * @return Number of leading zero bits, 0-31.
+ */
+static inline int bits_clz_32(uint32_t value)
+{
+    return (__builtin_clzl(value) - 8 * (sizeof(long) - sizeof(uint32_t)));
+}
+
+/**
+ * Count the number of trailing zero bits in given value, starting at
+ * the least significant bit.
+ *
+ * @param[in] value Value to count trailing zeros in. Must not be zero.
+ *
+ * @return Number of trailing zero bits, 0-31.
+ */
+static inline int bits_ctz_32(uint32_t value)
+{
+    return (__builtin_ctzl(value));
+}
+
 #endif
@@ -221,3 +221,76 @@ ssize_t circular_buffer_array_two(struct circular_buffer_t *self_p,
 
     return (size);
 }
+
+ssize_t circular_buffer_unused_array_one(struct circular_buffer_t *self_p,
+                                         void **buf_pp,
+                                         size_t size)
+{
+    size_t first_chunk_size;
+
+    if (self_p->writepos >= self_p->readpos) {
+        first_chunk_size = (self_p->size - self_p->writepos);
+
+        /* One byte is always unused. */
+        if (self_p->readpos == 0) {
+            first_chunk_size--;
+        }
+    } else {
+        first_chunk_size = (self_p->readpos - self_p->writepos - 1);
+    }
+
+    if (size > first_chunk_size) {
+        size = first_chunk_size;
+    }
+
+    if (size > 0) {
+        *buf_pp = &self_p->buf_p[self_p->writepos];
+    }
+
+    return (size);
+}
+
+ssize_t circular_buffer_unused_array_two(struct circular_buffer_t *self_p,
+                                         void **buf_pp,
+                                         size_t size)
+{
+    /* Return immediately if there is no second chunk. */
+    if ((self_p->writepos < self_p->readpos) || (self_p->readpos == 0)) {
+        return (0);
+    }
+
+    if (size > self_p->readpos - 1) {
+        size = (self_p->readpos - 1);
+    }
+
+    if (size > 0) {
+        *buf_pp = &self_p->buf_p[0];
+    }
+
+    return (size);
+}
+
+ssize_t circular_buffer_skip_back(struct circular_buffer_t *self_p,
+                                  size_t size)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+
+    size_t first_chunk_size;
+    size_t unused_size;
+
+    unused_size = circular_buffer_unused_size(self_p);
+
+    if (size > unused_size) {
+        size = unused_size;
+    }
+
+    first_chunk_size = (self_p->size - self_p->writepos);
+
+    if (first_chunk_size <= size) {
+        self_p->writepos = (size - first_chunk_size);
+    } else {
+        self_p->writepos += size;
+    }
+
+    return (size);
+}
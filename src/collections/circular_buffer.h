@@ -152,4 +152,51 @@ ssize_t circular_buffer_array_two(struct circular_buffer_t *self_p,
                                   void **buf_pp,
                                   size_t size);
 
+/**
+ * Get a pointer to the next unused byte in the buffer, for writing in
+ * place. Use `circular_buffer_unused_array_two()` to get the second
+ * array, if there is a wrap around. Call
+ * `circular_buffer_skip_back()` to make the bytes written in place
+ * available to the reader.
+ *
+ * @param[in] self_p Circular buffer.
+ * @param[out] buf_pp A pointer to the start of the array. Only valid
+ *                    if the return value is greater than zero(0).
+ * @param[in] size Number of bytes asked for.
+ *
+ * @return Number of bytes in array or negative error code.
+ */
+ssize_t circular_buffer_unused_array_one(struct circular_buffer_t *self_p,
+                                         void **buf_pp,
+                                         size_t size);
+
+/**
+ * Get a pointer to the next unused byte in the buffer, following a
+ * wrap around.
+ *
+ * @param[in] self_p Circular buffer.
+ * @param[out] buf_pp A pointer to the start of the array. Only valid
+ *                    if the return value is greater than zero(0).
+ * @param[in] size Number of bytes asked for.
+ *
+ * @return Number of bytes in array or negative error code.
+ */
+ssize_t circular_buffer_unused_array_two(struct circular_buffer_t *self_p,
+                                         void **buf_pp,
+                                         size_t size);
+
+/**
+ * Mark given number of unused bytes at the back of the buffer as
+ * written. Used after writing in place into the arrays of
+ * `circular_buffer_unused_array_one()` and
+ * `circular_buffer_unused_array_two()`.
+ *
+ * @param[in] self_p Circular buffer.
+ * @param[in] size Number of bytes to mark as written.
+ *
+ * @return Number of bytes marked as written or negative error code.
+ */
+ssize_t circular_buffer_skip_back(struct circular_buffer_t *self_p,
+                                  size_t size);
+
 #endif
@@ -878,6 +878,31 @@
 #    endif
 #endif
 
+/**
+ * Read-copy-update. Adds a per thread read-side state that is updated
+ * on every context switch. The bus finds its listeners in an RCU
+ * protected index if enabled, and takes a reader-writer lock
+ * otherwise.
+ */
+#ifndef CONFIG_RCU
+#    if defined(BOARD_ARDUINO_NANO) || defined(BOARD_ARDUINO_UNO) || defined(BOARD_ARDUINO_PRO_MICRO)
+#        define CONFIG_RCU                                  0
+#    else
+#        define CONFIG_RCU                                  1
+#    endif
+#endif
+
+/**
+ * Initialize the rcu module at system startup.
+ */
+#ifndef CONFIG_MODULE_INIT_RCU
+#    if defined(CONFIG_MINIMAL_SYSTEM) || (CONFIG_RCU == 0)
+#        define CONFIG_MODULE_INIT_RCU                      0
+#    else
+#        define CONFIG_MODULE_INIT_RCU                      1
+#    endif
+#endif
+
 /**
  * Initialize the module at system startup.
  */
@@ -889,6 +914,28 @@
 #    endif
 #endif
 
+/**
+ * Initialize the heap module at system startup.
+ */
+#ifndef CONFIG_MODULE_INIT_HEAP
+#    if defined(CONFIG_MINIMAL_SYSTEM)
+#        define CONFIG_MODULE_INIT_HEAP                     0
+#    else
+#        define CONFIG_MODULE_INIT_HEAP                     1
+#    endif
+#endif
+
+/**
+ * Initialize the slab module at system startup.
+ */
+#ifndef CONFIG_MODULE_INIT_SLAB
+#    if defined(CONFIG_MINIMAL_SYSTEM)
+#        define CONFIG_MODULE_INIT_SLAB                     0
+#    else
+#        define CONFIG_MODULE_INIT_SLAB                     1
+#    endif
+#endif
+
 /**
  * Initialize the fs module at system startup.
  */
@@ -1446,6 +1493,28 @@
 #    endif
 #endif
 
+/**
+ * Debug file system counters of reader-writer lock waits, per role.
+ */
+#ifndef CONFIG_RWLOCK_FS_COUNTERS
+#    if defined(BOARD_ARDUINO_NANO) || defined(BOARD_ARDUINO_UNO) || defined(BOARD_ARDUINO_PRO_MICRO) || defined(CONFIG_MINIMAL_SYSTEM)
+#        define CONFIG_RWLOCK_FS_COUNTERS                   0
+#    else
+#        define CONFIG_RWLOCK_FS_COUNTERS                   1
+#    endif
+#endif
+
+/**
+ * Debug file system command to list all registered slabs.
+ */
+#ifndef CONFIG_SLAB_FS_COMMAND_LIST
+#    if defined(BOARD_ARDUINO_NANO) || defined(BOARD_ARDUINO_UNO) || defined(BOARD_ARDUINO_PRO_MICRO) || defined(CONFIG_MINIMAL_SYSTEM)
+#        define CONFIG_SLAB_FS_COMMAND_LIST                 0
+#    else
+#        define CONFIG_SLAB_FS_COMMAND_LIST                 1
+#    endif
+#endif
+
 /**
  * Debug file system command to list all services.
  */
@@ -2146,6 +2215,45 @@
 #    endif
 #endif
 
+/**
+ * Lock and unlock mutexes with atomic compare-and-swap instead of
+ * taking the system lock, unless threads are waiting for the mutex.
+ */
+#ifndef CONFIG_MUTEX_FAST_PATH
+#    if defined(ARCH_LINUX)
+#        define CONFIG_MUTEX_FAST_PATH                      1
+#    else
+#        define CONFIG_MUTEX_FAST_PATH                      0
+#    endif
+#endif
+
+/**
+ * Priority inheritance in mutexes. A thread holding a mutex inherits
+ * the priority of the highest priority thread waiting for it, also
+ * through chains of held mutexes, until it is unlocked. Disabled on
+ * the small Arduino boards to save RAM in each thread and mutex.
+ */
+#ifndef CONFIG_MUTEX_PRIO_INHERIT
+#    if defined(BOARD_ARDUINO_NANO) || defined(BOARD_ARDUINO_UNO) || defined(BOARD_ARDUINO_PRO_MICRO)
+#        define CONFIG_MUTEX_PRIO_INHERIT                   0
+#    else
+#        define CONFIG_MUTEX_PRIO_INHERIT                   1
+#    endif
+#endif
+
+/**
+ * Take and give semaphores with atomic compare-and-swap instead of
+ * taking the system lock, unless threads are waiting for the
+ * semaphore.
+ */
+#ifndef CONFIG_SEM_FAST_PATH
+#    if defined(ARCH_LINUX)
+#        define CONFIG_SEM_FAST_PATH                        1
+#    else
+#        define CONFIG_SEM_FAST_PATH                        0
+#    endif
+#endif
+
 /**
  * Maximum number of bytes in the print output buffer.
  */
@@ -2167,6 +2275,35 @@
 #    define CONFIG_SYSTEM_TICK_FREQUENCY                  100
 #endif
 
+/**
+ * Use a hashed timing wheel instead of a sorted delta list for active
+ * timers. Starting and stopping a timer is constant time and each
+ * system tick only visits the timers hashed to the current slot.
+ */
+#ifndef CONFIG_TIMER_WHEEL
+#    if defined(ARCH_LINUX)
+#        define CONFIG_TIMER_WHEEL                          1
+#    else
+#        define CONFIG_TIMER_WHEEL                          0
+#    endif
+#endif
+
+/**
+ * Number of slots in the timing wheel. Must be a power of two.
+ */
+#ifndef CONFIG_TIMER_WHEEL_SIZE
+#    define CONFIG_TIMER_WHEEL_SIZE                       256
+#endif
+
+/**
+ * Stop the system tick when all threads are blocked and wake up when
+ * the first active timer expires, or when a thread is resumed. The
+ * tick count is caught up on wakeup. Only supported on Linux.
+ */
+#ifndef CONFIG_SYSTEM_TICKLESS
+#    define CONFIG_SYSTEM_TICKLESS                          0
+#endif
+
 /**
  * Use interrupts.
  */
@@ -2254,6 +2391,52 @@
 #    endif
 #endif
 
+/**
+ * Switch threads in user space with `swapcontext()` on the Linux
+ * port. Each Simba thread runs on its own `THRD_STACK()` buffer within
+ * a single pthread, instead of one pthread per thread with mutex and
+ * condition variable handoffs. Set to 0 to use a pthread per thread,
+ * which is easier to debug with gdb.
+ */
+#ifndef CONFIG_THRD_PORT_UCONTEXT
+#    define CONFIG_THRD_PORT_UCONTEXT                       0
+#endif
+
+/**
+ * Run threads on multiple cores. Each core has its own ready queue,
+ * threads may be restricted to a set of cores with
+ * `thrd_set_affinity()`, and idle cores steal ready threads from busy
+ * ones. The ready queues have a lock of their own, so threads yield
+ * and switch without the system lock. Only supported on Linux with
+ * `CONFIG_THRD_PORT_UCONTEXT`, where each core is a pthread.
+ */
+#ifndef CONFIG_THRD_SMP
+#    define CONFIG_THRD_SMP                                 0
+#endif
+
+/**
+ * Number of cores used by the scheduler if `CONFIG_THRD_SMP` is
+ * enabled, at most 32.
+ */
+#ifndef CONFIG_THRD_SMP_CORES
+#    define CONFIG_THRD_SMP_CORES                           2
+#endif
+
+/**
+ * Use a priority bitmap and one FIFO per group of eight priorities in
+ * thread priority lists, used by the scheduler ready queue and all
+ * synchronization primitive waiter lists. Push and pop are constant
+ * time, at the cost of a larger `struct thrd_prio_list_t`. A sorted
+ * linked list is used otherwise.
+ */
+#ifndef CONFIG_THRD_PRIO_LIST_BITMAP
+#    if defined(ARCH_LINUX)
+#        define CONFIG_THRD_PRIO_LIST_BITMAP                1
+#    else
+#        define CONFIG_THRD_PRIO_LIST_BITMAP                0
+#    endif
+#endif
+
 /**
  * Count the number of times each thread has been scheduled.
  */
@@ -2265,6 +2448,32 @@
 #    endif
 #endif
 
+/**
+ * Record per thread histograms of the scheduling latency, the run
+ * slice length and the time blocked, in microseconds. Reads a
+ * monotonic clock twice in each context switch.
+ */
+#ifndef CONFIG_THRD_HISTOGRAMS
+#    define CONFIG_THRD_HISTOGRAMS                          0
+#endif
+
+/**
+ * Record scheduler events, context switches, thread resumes, timer
+ * expiries and instrumented interrupt service routines, with
+ * timestamps in a trace ring buffer. See `thrd_trace_print()`.
+ */
+#ifndef CONFIG_THRD_TRACE
+#    define CONFIG_THRD_TRACE                               0
+#endif
+
+/**
+ * Number of entries in the trace ring buffer, a power of two. Older
+ * entries are overwritten when the buffer is full.
+ */
+#ifndef CONFIG_THRD_TRACE_LENGTH
+#    define CONFIG_THRD_TRACE_LENGTH                        256
+#endif
+
 /**
  * Enable the thread stack heap allocator.
  */
@@ -2392,6 +2601,88 @@
 #    endif
 #endif
 
+/**
+ * Number of first level size classes of the dynamic heap. The
+ * biggest buffer that can be allocated from the dynamic heap is
+ * 2^(CONFIG_HEAP_DYNAMIC_FL_MAX + 2) - 1 bytes. At most 30.
+ */
+#ifndef CONFIG_HEAP_DYNAMIC_FL_MAX
+#    if defined(ARCH_AVR)
+#        define CONFIG_HEAP_DYNAMIC_FL_MAX                 14
+#    elif defined(ARCH_LINUX)
+#        define CONFIG_HEAP_DYNAMIC_FL_MAX                 26
+#    else
+#        define CONFIG_HEAP_DYNAMIC_FL_MAX                 20
+#    endif
+#endif
+
+/**
+ * Record the backtrace of every allocated heap buffer, listed by the
+ * debug file system command `/alloc/heap/leaks`. Requires
+ * `CONFIG_HEAP_STATS`.
+ */
+#ifndef CONFIG_HEAP_LEAK_TRACKING
+#    define CONFIG_HEAP_LEAK_TRACKING                       0
+#endif
+
+/**
+ * Number of return addresses recorded per heap buffer when leak
+ * tracking is enabled.
+ */
+#ifndef CONFIG_HEAP_LEAK_TRACKING_DEPTH
+#    define CONFIG_HEAP_LEAK_TRACKING_DEPTH                 4
+#endif
+
+/**
+ * Alignment of slab slots in bytes, the data cache line size on
+ * CPUs with a data cache.
+ */
+#ifndef CONFIG_SLAB_ALIGNMENT
+#    if defined(ARCH_LINUX)
+#        define CONFIG_SLAB_ALIGNMENT                      64
+#    elif defined(ARCH_AVR)
+#        define CONFIG_SLAB_ALIGNMENT                       1
+#    else
+#        define CONFIG_SLAB_ALIGNMENT                       4
+#    endif
+#endif
+
+/**
+ * Per-thread caches of free fixed size heap buffers, called
+ * magazines. A thread attached to a heap with
+ * ``heap_magazines_attach()`` allocates and frees fixed size buffers
+ * without locking the heap, except when refilling or draining a
+ * magazine.
+ */
+#ifndef CONFIG_HEAP_MAGAZINES
+#    if defined(ARCH_LINUX)
+#        define CONFIG_HEAP_MAGAZINES                       1
+#    else
+#        define CONFIG_HEAP_MAGAZINES                       0
+#    endif
+#endif
+
+/**
+ * Maximum number of free buffers per fixed size in a magazine. Half
+ * of them are moved at a time when a magazine is refilled or
+ * drained.
+ */
+#ifndef CONFIG_HEAP_MAGAZINE_SIZE
+#    define CONFIG_HEAP_MAGAZINE_SIZE                      16
+#endif
+
+/**
+ * Heap usage statistics, and their debug file system commands and
+ * counters.
+ */
+#ifndef CONFIG_HEAP_STATS
+#    if defined(BOARD_ARDUINO_NANO) || defined(BOARD_ARDUINO_UNO) || defined(BOARD_ARDUINO_PRO_MICRO) || defined(CONFIG_MINIMAL_SYSTEM)
+#        define CONFIG_HEAP_STATS                           0
+#    else
+#        define CONFIG_HEAP_STATS                           1
+#    endif
+#endif
+
 /**
  * Size of the HTTP server request buffer. This buffer is used when
  * parsing received HTTP request headers.
@@ -2525,4 +2816,24 @@
 #    error "CONFIG_START_SHELL and CONFIG_START_SOAM cannot both be set to 1."
 #endif
 
+#if (CONFIG_SYSTEM_TICKLESS == 1) && !defined(ARCH_LINUX)
+#    error "CONFIG_SYSTEM_TICKLESS is only supported on Linux."
+#endif
+
+#if (CONFIG_THRD_SMP == 1) && (!defined(ARCH_LINUX) || (CONFIG_THRD_PORT_UCONTEXT == 0))
+#    error "CONFIG_THRD_SMP is only supported on Linux with CONFIG_THRD_PORT_UCONTEXT."
+#endif
+
+#if (CONFIG_THRD_SMP == 1) && (CONFIG_SYSTEM_TICKLESS == 1)
+#    error "CONFIG_THRD_SMP and CONFIG_SYSTEM_TICKLESS cannot both be set to 1."
+#endif
+
+#if (CONFIG_THRD_SMP == 1) && ((CONFIG_THRD_SMP_CORES < 1) || (CONFIG_THRD_SMP_CORES > 32))
+#    error "CONFIG_THRD_SMP_CORES must be in the range 1 to 32."
+#endif
+
+#if (CONFIG_THRD_TRACE == 1) && ((CONFIG_THRD_TRACE_LENGTH & (CONFIG_THRD_TRACE_LENGTH - 1)) != 0)
+#    error "CONFIG_THRD_TRACE_LENGTH must be a power of two."
+#endif
+
 #endif
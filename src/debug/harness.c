@@ -245,6 +245,7 @@ int harness_run(struct harness_testcase_t *testcases_p)
     };
 
     mutex_init(&module.mutex);
+    bus_init(&module.bus);
 
     total = 0;
     passed = 0;
@@ -274,6 +275,10 @@ int harness_run(struct harness_testcase_t *testcases_p)
                   sizeof(module.heap.buf),
                   &sizes[0]);
 
+#if CONFIG_HEAP_STATS == 1
+        heap_register(&module.heap.obj, "harness");
+#endif
+
         /* Mark current testcase as passed before its executed. */
         module.current_testcase_result = 0;
 
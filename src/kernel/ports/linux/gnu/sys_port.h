@@ -48,4 +48,20 @@ static inline uint16_t htons(uint16_t v)
 
 #define ntohs(v) htons(v)
 
+#if CONFIG_SYSTEM_TICKLESS == 1
+
+/**
+ * Called by the idle thread before it waits. The system tick is
+ * stopped until the first active timer expires.
+ */
+void sys_port_idle_enter(void);
+
+/**
+ * Called by the idle thread when it wakes up. The tick count is
+ * caught up and periodic ticking resumed.
+ */
+void sys_port_idle_exit(void);
+
+#endif
+
 #endif
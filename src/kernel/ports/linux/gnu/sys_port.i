@@ -31,16 +31,128 @@
 #include <pthread.h>
 #include <execinfo.h>
 
-static pthread_mutex_t mutex;
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 
 struct sys_port_t {
     pthread_t thrd;
     pthread_mutex_t mutex;
     pthread_cond_t cond;
+#if CONFIG_SYSTEM_TICKLESS == 1
+    int idle;
+    int wakeup;
+    struct timespec next_tick;
+#endif
 };
 
 static struct sys_port_t sys_port;
 
+#if CONFIG_SYSTEM_TICKLESS == 1
+
+#define TICK_PERIOD_NS (1000000000L / CONFIG_SYSTEM_TICK_FREQUENCY)
+
+static void timespec_add_ns(struct timespec *time_p, long long ns)
+{
+    ns += time_p->tv_nsec;
+    time_p->tv_sec += (ns / 1000000000L);
+    time_p->tv_nsec = (ns % 1000000000L);
+}
+
+static int timespec_before(struct timespec *left_p,
+                           struct timespec *right_p)
+{
+    return ((left_p->tv_sec < right_p->tv_sec)
+            || ((left_p->tv_sec == right_p->tv_sec)
+                && (left_p->tv_nsec < right_p->tv_nsec)));
+}
+
+/**
+ * Call the tick handler once for each tick period that has passed
+ * since the last tick. Called with sys_port.mutex taken.
+ */
+static void sys_port_catch_up(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    while (!timespec_before(&now, &sys_port.next_tick)) {
+        sys_tick_isr();
+        timespec_add_ns(&sys_port.next_tick, TICK_PERIOD_NS);
+    }
+}
+
+/**
+ * Tick periodically while threads are running. When the idle thread
+ * waits, sleep until the first active timer expires instead, and
+ * then catch up all ticks that have passed.
+ */
+static void *sys_port_ticker(void *arg)
+{
+    struct timespec deadline;
+    sys_tick_t ticks;
+
+    pthread_mutex_lock(&sys_port.mutex);
+
+    clock_gettime(CLOCK_MONOTONIC, &sys_port.next_tick);
+    timespec_add_ns(&sys_port.next_tick, TICK_PERIOD_NS);
+
+    while (1) {
+        ticks = 1;
+
+        if (sys_port.idle == 1) {
+            sys_lock();
+            ticks = timer_next_timeout_isr();
+            sys_unlock();
+
+            /* Sleep at most one second at a time. */
+            if (ticks > CONFIG_SYSTEM_TICK_FREQUENCY) {
+                ticks = CONFIG_SYSTEM_TICK_FREQUENCY;
+            } else if (ticks == 0) {
+                ticks = 1;
+            }
+        }
+
+        deadline = sys_port.next_tick;
+        timespec_add_ns(&deadline, (long long)(ticks - 1) * TICK_PERIOD_NS);
+
+        while (sys_port.wakeup == 0) {
+            if (pthread_cond_timedwait(&sys_port.cond,
+                                       &sys_port.mutex,
+                                       &deadline) != 0) {
+                break;
+            }
+        }
+
+        sys_port.wakeup = 0;
+        sys_port_catch_up();
+    }
+
+    return (NULL);
+}
+
+void sys_port_idle_enter(void)
+{
+    pthread_mutex_lock(&sys_port.mutex);
+    sys_port.idle = 1;
+    sys_port.wakeup = 1;
+    pthread_cond_signal(&sys_port.cond);
+    pthread_mutex_unlock(&sys_port.mutex);
+}
+
+void sys_port_idle_exit(void)
+{
+    /* Catch up here rather than in the ticker to have an up to date
+       tick count once the woken thread runs. */
+    pthread_mutex_lock(&sys_port.mutex);
+    sys_port.idle = 0;
+    sys_port.wakeup = 1;
+    sys_port_catch_up();
+    pthread_cond_signal(&sys_port.cond);
+    pthread_mutex_unlock(&sys_port.mutex);
+}
+
+#else
+
 static void *sys_port_ticker(void *arg)
 {
     struct timespec abstimeout;
@@ -66,6 +178,8 @@ static void *sys_port_ticker(void *arg)
     return (NULL);
 }
 
+#endif
+
 static void sys_port_stop(int error)
 {
     exit(error);
@@ -123,7 +237,18 @@ static void sys_port_unlock_isr(void)
 
 int sys_port_module_init(void)
 {
-    pthread_mutex_init(&mutex, NULL);
+#if CONFIG_SYSTEM_TICKLESS == 1
+    pthread_condattr_t attr;
+#endif
+
+#if CONFIG_SYSTEM_TICKLESS == 1
+    /* Initialized here as the idle thread may signal the ticker
+       before it has started. */
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&sys_port.mutex, NULL);
+    pthread_cond_init(&sys_port.cond, &attr);
+#endif
 
     /* Start sys tick thrd.*/
     if (pthread_create(&sys_port.thrd, NULL, sys_port_ticker, NULL)) {
@@ -33,10 +33,33 @@
 
 #include <pthread.h>
 
+#if CONFIG_THRD_PORT_UCONTEXT == 1
+#    include <ucontext.h>
+#endif
+
 #if CONFIG_PREEMPTIVE_SCHEDULER == 1
 #    error "This port does not support a preemptive scheduler."
 #endif
 
+#if CONFIG_THRD_PORT_UCONTEXT == 1
+
+/* Threads run on their THRD_STACK() buffer. Stack sizes are tuned
+   for the MCUs, so add room for the larger frames of the host and
+   its C library. */
+#define THRD_PORT_STACK_HEADROOM 32768
+
+#define THRD_PORT_STACK(name, size)                                     \
+    char name[sizeof(struct thrd_t) + (size) + THRD_PORT_STACK_HEADROOM] \
+    __attribute__ ((aligned (16)))
+
+struct thrd_port_t {
+    ucontext_t context;
+    void *(*main)(void *arg);
+    void *arg;
+};
+
+#else
+
 #define THRD_PORT_STACK(name, size) char name[sizeof(struct thrd_t) + (size)]
 
 struct thrd_port_t {
@@ -49,3 +72,5 @@ struct thrd_port_t {
 };
 
 #endif
+
+#endif
@@ -31,6 +31,7 @@
 struct thrd_port_idle_t {
     pthread_mutex_t mutex;
     pthread_cond_t cond;
+    int pending;
 };
 
 static struct thrd_t main_thrd;
@@ -46,11 +47,169 @@ static char *thrd_port_get_main_thrd_stack_top(void)
     return (NULL);
 }
 
-static struct thrd_port_idle_t idle = {
-    .mutex = PTHREAD_MUTEX_INITIALIZER,
-    .cond = PTHREAD_COND_INITIALIZER
+/* One idle thread per core. */
+static struct thrd_port_idle_t idle[SCHEDULER_CORES] = {
+    [0 ... SCHEDULER_CORES - 1] = {
+        .mutex = PTHREAD_MUTEX_INITIALIZER,
+        .cond = PTHREAD_COND_INITIALIZER,
+        .pending = 0
+    }
 };
 
+#if CONFIG_THRD_SMP == 1
+
+/* The core the calling pthread runs. Core zero is the main pthread. */
+static __thread int thrd_port_core = 0;
+
+/* Protects the scheduler state of all cores. */
+static pthread_mutex_t thrd_port_scheduler_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Not inlined as threads migrate between pthreads, and thereby
+   between thread local storage areas. */
+static __attribute__ ((noinline)) int thrd_port_get_core(void)
+{
+    return (thrd_port_core);
+}
+
+static void thrd_port_scheduler_lock(void)
+{
+    pthread_mutex_lock(&thrd_port_scheduler_mutex);
+}
+
+static void thrd_port_scheduler_unlock(void)
+{
+    pthread_mutex_unlock(&thrd_port_scheduler_mutex);
+}
+
+#endif
+
+/**
+ * Signal the idle thread of given core to wake up.
+ */
+static void thrd_port_idle_signal(int core)
+{
+    pthread_mutex_lock(&idle[core].mutex);
+    idle[core].pending = 1;
+    pthread_cond_signal(&idle[core].cond);
+    pthread_mutex_unlock(&idle[core].mutex);
+}
+
+/**
+ * Signal the idle threads of all cores to wake up.
+ */
+static void thrd_port_idle_signal_all(void)
+{
+    int i;
+
+    for (i = 0; i < SCHEDULER_CORES; i++) {
+        thrd_port_idle_signal(i);
+    }
+}
+
+#if CONFIG_THRD_PORT_UCONTEXT == 1
+
+static void thrd_port_main(void)
+{
+    struct thrd_port_t *port_p;
+
+    /* The scheduler sets the current thread before swapping. */
+    port_p = &thrd_self()->port;
+#if CONFIG_THRD_SMP == 1
+    thrd_port_scheduler_unlock();
+#else
+    sys_unlock();
+#endif
+    port_p->main(port_p->arg);
+
+    /* Thread termination. */
+    terminate();
+}
+
+static void thrd_port_swap(struct thrd_t *in_p,
+                           struct thrd_t *out_p)
+{
+    /* The lock held during the swap is owned by the pthread the
+       threads run in, so the 'in' thread releases it. That is the
+       scheduler lock with SMP, and the system lock otherwise. */
+    if (swapcontext(&out_p->port.context, &in_p->port.context) != 0) {
+        sys_panic("swapcontext");
+    }
+}
+
+static void thrd_port_init_main(struct thrd_port_t *port_p)
+{
+    port_p->main = NULL;
+    port_p->arg = NULL;
+}
+
+#if CONFIG_THRD_SMP == 1
+
+/**
+ * Switch to given thread without saving the current context.
+ */
+static void thrd_port_set_context(struct thrd_t *thrd_p)
+{
+    setcontext(&thrd_p->port.context);
+    sys_panic("setcontext");
+}
+
+static void *thrd_port_core_main(void *arg_p)
+{
+    thrd_port_core = (int)(intptr_t)arg_p;
+    scheduler_core_start();
+
+    return (NULL);
+}
+
+/**
+ * Start a pthread running the scheduler of given core.
+ */
+static int thrd_port_start_core(int core)
+{
+    pthread_t thrd;
+
+    if (pthread_create(&thrd,
+                       NULL,
+                       thrd_port_core_main,
+                       (void *)(intptr_t)core) != 0) {
+        return (-1);
+    }
+
+    pthread_detach(thrd);
+
+    return (0);
+}
+
+#endif
+
+static int thrd_port_spawn(struct thrd_t *thrd_p,
+                           void *(*main)(void *),
+                           void *arg_p,
+                           void *stack_p,
+                           size_t stack_size)
+{
+    struct thrd_port_t *port_p;
+
+    /* Initialize thrd port.*/
+    port_p = &thrd_p->port;
+    port_p->main = main;
+    port_p->arg = arg_p;
+
+    if (getcontext(&port_p->context) != 0) {
+        return (-1);
+    }
+
+    /* The stack is located just after the thread struct. */
+    port_p->context.uc_stack.ss_sp = &thrd_p[1];
+    port_p->context.uc_stack.ss_size = (stack_size - sizeof(*thrd_p));
+    port_p->context.uc_link = NULL;
+    makecontext(&port_p->context, thrd_port_main, 0);
+
+    return (0);
+}
+
+#else
+
 static void *thrd_port_main(void *arg_p)
 {
     struct thrd_port_t *port_p;
@@ -111,36 +270,55 @@ static int thrd_port_spawn(struct thrd_t *thrd_p,
     return (0);
 }
 
+#endif
+
 static void thrd_port_idle_wait(struct thrd_t *thrd_p)
 {
-    pthread_mutex_lock(&idle.mutex);
-    pthread_cond_wait(&idle.cond, &idle.mutex);
-    pthread_mutex_unlock(&idle.mutex);
+    struct thrd_port_idle_t *idle_p;
+
+    /* Idle threads are bound to their core. */
+    idle_p = &idle[SCHEDULER_CORE_ID()];
+
+#if CONFIG_SYSTEM_TICKLESS == 1
+    sys_port_idle_enter();
+#endif
+
+    pthread_mutex_lock(&idle_p->mutex);
+
+    while (idle_p->pending == 0) {
+        pthread_cond_wait(&idle_p->cond, &idle_p->mutex);
+    }
+
+    idle_p->pending = 0;
+    pthread_mutex_unlock(&idle_p->mutex);
+
+#if CONFIG_SYSTEM_TICKLESS == 1
+    sys_port_idle_exit();
+#endif
 
     /* Add this thread to the ready list and reschedule. */
-    sys_lock();
-    thrd_p->state = THRD_STATE_READY;
-    scheduler_ready_push(thrd_p);
-    thrd_reschedule();
-    sys_unlock();
+    thrd_yield();
 }
 
 static void thrd_port_on_suspend_timer_expired(struct thrd_t *thrd_p)
 {
-    /* Signal idle thrd.*/
-    pthread_mutex_lock(&idle.mutex);
-    pthread_cond_signal(&idle.cond);
-    pthread_mutex_unlock(&idle.mutex);
+    thrd_port_idle_signal_all();
 }
 
 static void thrd_port_tick(void)
 {
-    /* Signal idle thrd.*/
-    pthread_mutex_lock(&idle.mutex);
-    pthread_cond_signal(&idle.cond);
-    pthread_mutex_unlock(&idle.mutex);
+    thrd_port_idle_signal_all();
 }
 
+#if (CONFIG_SYSTEM_TICKLESS == 1) || (CONFIG_THRD_SMP == 1)
+
+static void thrd_port_idle_wakeup_isr(int core)
+{
+    thrd_port_idle_signal(core);
+}
+
+#endif
+
 static void thrd_port_cpu_usage_start(struct thrd_t *thrd_p)
 {
 }
@@ -475,9 +475,18 @@ int sys_start(void)
 #if CONFIG_MODULE_INIT_RWLOCK == 1
     rwlock_module_init();
 #endif
+#if CONFIG_MODULE_INIT_RCU == 1
+    rcu_module_init();
+#endif
 #if CONFIG_MODULE_INIT_FS == 1
     fs_module_init();
 #endif
+#if CONFIG_MODULE_INIT_HEAP == 1
+    heap_module_init();
+#endif
+#if CONFIG_MODULE_INIT_SLAB == 1
+    slab_module_init();
+#endif
 #if CONFIG_MODULE_INIT_STD == 1
     std_module_init();
 #endif
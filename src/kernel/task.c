@@ -0,0 +1,745 @@
+/**
+ * @section License
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017, Erik Moqvist
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+#define TASK_FLAG_WAITING                                0x01
+#define TASK_FLAG_DEADLINE                               0x02
+#define TASK_FLAG_TIMED_OUT                              0x04
+#define TASK_FLAG_GRANTED                                0x08
+#define TASK_FLAG_BUSY                                   0x10
+
+enum task_wait_type_t {
+    TASK_WAIT_TYPE_SLEEP = 0,
+    TASK_WAIT_TYPE_CHAN,
+    TASK_WAIT_TYPE_EVENT,
+    TASK_WAIT_TYPE_SEM
+};
+
+/**
+ * Current system tick, rounded down.
+ */
+static sys_tick_t now_isr(void)
+{
+    struct time_t now;
+
+    sys_uptime_isr(&now);
+
+    return ((sys_tick_t)now.seconds * CONFIG_SYSTEM_TICK_FREQUENCY
+            + (sys_tick_t)(((uint64_t)now.nanoseconds
+                            * CONFIG_SYSTEM_TICK_FREQUENCY) / 1000000000));
+}
+
+static int is_zero(const struct time_t *timeout_p)
+{
+    return ((timeout_p != NULL)
+            && (timeout_p->seconds == 0)
+            && (timeout_p->nanoseconds == 0));
+}
+
+/**
+ * Common part of all wait functions. Returns zero(0) when the wait
+ * is over, otherwise one(1).
+ */
+static int wait(struct task_t *self_p,
+                int ready,
+                int wait_type,
+                const struct time_t *timeout_p)
+{
+    struct time_t now;
+
+    if (ready) {
+        self_p->flags = 0;
+        self_p->res = 0;
+
+        return (0);
+    }
+
+    if (self_p->flags & TASK_FLAG_WAITING) {
+        if (self_p->flags & TASK_FLAG_TIMED_OUT) {
+            self_p->flags = 0;
+            self_p->res = -ETIMEDOUT;
+
+            return (0);
+        }
+
+        if (self_p->flags & TASK_FLAG_BUSY) {
+            self_p->flags = 0;
+            self_p->res = -EBUSY;
+
+            return (0);
+        }
+
+        return (1);
+    }
+
+    if (is_zero(timeout_p)) {
+        self_p->res = -ETIMEDOUT;
+
+        return (0);
+    }
+
+    self_p->flags = TASK_FLAG_WAITING;
+    self_p->wait_type = wait_type;
+
+    if (timeout_p != NULL) {
+        sys_uptime(&now);
+        self_p->deadline = (t2st(&now) + t2st(timeout_p));
+        self_p->flags |= TASK_FLAG_DEADLINE;
+    }
+
+    return (1);
+}
+
+static void list_append(struct task_scheduler_list_t *list_p,
+                        struct task_t *task_p)
+{
+    task_p->next_p = NULL;
+
+    if (list_p->head_p == NULL) {
+        list_p->head_p = task_p;
+    } else {
+        list_p->tail_p->next_p = task_p;
+    }
+
+    list_p->tail_p = task_p;
+}
+
+/**
+ * Returns true(1) if the object given task is waiting for is
+ * available.
+ */
+static int is_ready_isr(struct task_t *task_p)
+{
+    struct chan_t *chan_p;
+    struct sem_t *sem_p;
+
+    switch (task_p->wait_type) {
+
+    case TASK_WAIT_TYPE_CHAN:
+        chan_p = task_p->wait.chan.chan_p;
+
+        return (chan_p->size(chan_p) >= task_p->wait.chan.arg);
+
+    case TASK_WAIT_TYPE_EVENT:
+        return ((((struct event_t *)task_p->wait.chan.chan_p)->mask
+                 & task_p->wait.chan.arg) != 0);
+
+    case TASK_WAIT_TYPE_SEM:
+        sem_p = task_p->wait.sem.sem_p;
+
+        return (sem_p->count < sem_p->count_max);
+
+    default:
+        return (0);
+    }
+}
+
+/**
+ * Insert given task in the deadline list. Most tasks wait for about
+ * the same time, so the list is searched from the latest deadline.
+ */
+static void deadlines_insert(struct task_scheduler_t *self_p,
+                             struct task_t *task_p)
+{
+    struct task_t *prev_p;
+
+    prev_p = self_p->deadlines.tail_p;
+
+    while ((prev_p != NULL)
+           && ((int32_t)(task_p->deadline - prev_p->deadline) < 0)) {
+        prev_p = prev_p->deadlines.prev_p;
+    }
+
+    task_p->deadlines.prev_p = prev_p;
+
+    if (prev_p == NULL) {
+        task_p->deadlines.next_p = self_p->deadlines.head_p;
+        self_p->deadlines.head_p = task_p;
+    } else {
+        task_p->deadlines.next_p = prev_p->deadlines.next_p;
+        prev_p->deadlines.next_p = task_p;
+    }
+
+    if (task_p->deadlines.next_p == NULL) {
+        self_p->deadlines.tail_p = task_p;
+    } else {
+        task_p->deadlines.next_p->deadlines.prev_p = task_p;
+    }
+}
+
+static void deadlines_remove(struct task_scheduler_t *self_p,
+                             struct task_t *task_p)
+{
+    if (task_p->deadlines.prev_p == NULL) {
+        self_p->deadlines.head_p = task_p->deadlines.next_p;
+    } else {
+        task_p->deadlines.prev_p->deadlines.next_p = task_p->deadlines.next_p;
+    }
+
+    if (task_p->deadlines.next_p == NULL) {
+        self_p->deadlines.tail_p = task_p->deadlines.prev_p;
+    } else {
+        task_p->deadlines.next_p->deadlines.prev_p = task_p->deadlines.prev_p;
+    }
+}
+
+/**
+ * Move given waiting task to the ready list.
+ */
+static void make_ready_isr(struct task_scheduler_t *self_p,
+                           struct task_t *task_p)
+{
+    if (task_p->flags & TASK_FLAG_DEADLINE) {
+        deadlines_remove(self_p, task_p);
+    }
+
+    self_p->number_of_waiting--;
+    list_append(&self_p->ready, task_p);
+}
+
+/**
+ * Move the tasks waiting for given channel that are ready to the
+ * ready list, and remove given task from the channel waiters, if
+ * any. The first remaining waiter owns the poll set element of the
+ * channel.
+ */
+static void chan_update_isr(struct task_scheduler_t *self_p,
+                            struct chan_t *chan_p,
+                            struct task_t *removed_p)
+{
+    struct task_t *first_p;
+    struct task_t *task_p;
+    struct task_t *next_p;
+    struct task_scheduler_list_t waiters;
+
+    first_p = container_of(chan_p->poll_set_elem_p,
+                           struct task_t,
+                           wait.chan.elem);
+    waiters.head_p = NULL;
+    waiters.tail_p = NULL;
+
+    for (task_p = first_p; task_p != NULL; task_p = next_p) {
+        next_p = task_p->wait.chan.next_p;
+
+        if (task_p == removed_p) {
+            continue;
+        }
+
+        if (is_ready_isr(task_p)) {
+            make_ready_isr(self_p, task_p);
+            continue;
+        }
+
+        task_p->wait.chan.next_p = NULL;
+
+        if (waiters.head_p == NULL) {
+            waiters.head_p = task_p;
+        } else {
+            waiters.tail_p->wait.chan.next_p = task_p;
+        }
+
+        waiters.tail_p = task_p;
+    }
+
+    if (waiters.head_p != first_p) {
+        chan_poll_set_remove_isr(&self_p->poll_set, chan_p);
+
+        if (waiters.head_p != NULL) {
+            chan_poll_set_add_isr(&self_p->poll_set,
+                                  &waiters.head_p->wait.chan.elem,
+                                  chan_p,
+                                  CHAN_POLL_EDGE_TRIGGERED);
+        }
+    }
+}
+
+/**
+ * Register given task that just started waiting with the object it
+ * waits for, and in the deadline list.
+ */
+static void register_isr(struct task_scheduler_t *self_p,
+                         struct task_t *task_p)
+{
+    struct chan_t *chan_p;
+    struct chan_poll_set_elem_t *elem_p;
+    struct task_t *first_p;
+
+    self_p->number_of_waiting++;
+
+    if (task_p->flags & TASK_FLAG_DEADLINE) {
+        deadlines_insert(self_p, task_p);
+    }
+
+    switch (task_p->wait_type) {
+
+    case TASK_WAIT_TYPE_CHAN:
+    case TASK_WAIT_TYPE_EVENT:
+        chan_p = task_p->wait.chan.chan_p;
+        elem_p = chan_p->poll_set_elem_p;
+        task_p->wait.chan.next_p = NULL;
+
+        if (elem_p == NULL) {
+            chan_poll_set_add_isr(&self_p->poll_set,
+                                  &task_p->wait.chan.elem,
+                                  chan_p,
+                                  CHAN_POLL_EDGE_TRIGGERED);
+        } else if (elem_p->poll_set_p == &self_p->poll_set) {
+            first_p = container_of(elem_p, struct task_t, wait.chan.elem);
+            task_p->wait.chan.next_p = first_p->wait.chan.next_p;
+            first_p->wait.chan.next_p = task_p;
+        } else {
+            task_p->flags |= TASK_FLAG_BUSY;
+            make_ready_isr(self_p, task_p);
+            break;
+        }
+
+        /* Data may have been written after the task checked the
+           channel. */
+        if (is_ready_isr(task_p)) {
+            chan_update_isr(self_p, chan_p, NULL);
+        }
+
+        break;
+
+    case TASK_WAIT_TYPE_SEM:
+        task_p->next_p = self_p->sem_waiting_p;
+        self_p->sem_waiting_p = task_p;
+        break;
+
+    default:
+        break;
+    }
+}
+
+/**
+ * Remove given task from the list of tasks waiting for semaphores.
+ */
+static void sem_waiting_remove(struct task_scheduler_t *self_p,
+                               struct task_t *task_p)
+{
+    struct task_t **task_pp;
+
+    task_pp = &self_p->sem_waiting_p;
+
+    while (*task_pp != task_p) {
+        task_pp = &(*task_pp)->next_p;
+    }
+
+    *task_pp = task_p->next_p;
+}
+
+/**
+ * Move waiting tasks that are ready or have timed out to the ready
+ * list. Only tasks waiting for written channels, tasks waiting for
+ * semaphores and tasks with expired deadlines are looked at. Returns
+ * true(1) if any task has a deadline, and the earliest deadline in
+ * given tick.
+ */
+static int poll_waiting_isr(struct task_scheduler_t *self_p,
+                            sys_tick_t *deadline_p)
+{
+    struct chan_poll_set_elem_t *elem_p;
+    struct task_t *task_p;
+    struct task_t **task_pp;
+    sys_tick_t now;
+
+    /* Tasks waiting for channels that were written to. */
+    while ((elem_p = chan_poll_set_pop_isr(&self_p->poll_set)) != NULL) {
+        chan_update_isr(self_p, elem_p->chan_p, NULL);
+    }
+
+    task_pp = &self_p->sem_waiting_p;
+
+    while (*task_pp != NULL) {
+        task_p = *task_pp;
+
+        if (is_ready_isr(task_p)) {
+            *task_pp = task_p->next_p;
+            make_ready_isr(self_p, task_p);
+        } else {
+            task_pp = &task_p->next_p;
+        }
+    }
+
+    /* Expired deadlines. */
+    now = now_isr();
+
+    while ((task_p = self_p->deadlines.head_p) != NULL) {
+        if ((int32_t)(now - task_p->deadline) < 0) {
+            *deadline_p = task_p->deadline;
+
+            return (1);
+        }
+
+        switch (task_p->wait_type) {
+
+        case TASK_WAIT_TYPE_CHAN:
+        case TASK_WAIT_TYPE_EVENT:
+            chan_update_isr(self_p, task_p->wait.chan.chan_p, task_p);
+            break;
+
+        case TASK_WAIT_TYPE_SEM:
+            sem_waiting_remove(self_p, task_p);
+            break;
+
+        default:
+            break;
+        }
+
+        task_p->flags |= TASK_FLAG_TIMED_OUT;
+        make_ready_isr(self_p, task_p);
+    }
+
+    return (0);
+}
+
+/**
+ * Suspend the scheduler thread until a channel a task is waiting for
+ * is written to, a semaphore a task is waiting for may be available,
+ * or until given deadline.
+ */
+static void wait_isr(struct task_scheduler_t *self_p,
+                     int has_deadline,
+                     sys_tick_t deadline)
+{
+    struct task_t *task_p;
+    struct time_t timeout;
+    int is_ready;
+
+    is_ready = 0;
+
+    /* Register the scheduler thread as a waiter on all
+       semaphores. Written channels resume it through the poll
+       set. */
+    for (task_p = self_p->sem_waiting_p;
+         task_p != NULL;
+         task_p = task_p->next_p) {
+        task_p->wait.sem.elem.thrd_p = self_p->thrd_p;
+        is_ready |= sem_add_waiter_isr(task_p->wait.sem.sem_p,
+                                       &task_p->wait.sem.elem);
+    }
+
+    /* Do not suspend if a semaphore was given without the system
+       lock before the scheduler thread was registered. */
+    if (!is_ready) {
+        self_p->idle = 1;
+        self_p->poll_set.thrd_p = self_p->thrd_p;
+
+        if (has_deadline) {
+            st2t(deadline - now_isr(), &timeout);
+            thrd_suspend_isr(&timeout);
+        } else {
+            thrd_suspend_isr(NULL);
+        }
+
+        self_p->poll_set.thrd_p = NULL;
+        self_p->idle = 0;
+    }
+
+    for (task_p = self_p->sem_waiting_p;
+         task_p != NULL;
+         task_p = task_p->next_p) {
+        if (thrd_prio_list_remove_isr(&task_p->wait.sem.sem_p->waiters,
+                                      &task_p->wait.sem.elem) != 0) {
+            task_p->flags |= TASK_FLAG_GRANTED;
+        }
+    }
+
+    /* Resources given to the scheduler thread are given back, and
+       taken by the task when it is resumed. */
+    for (task_p = self_p->sem_waiting_p;
+         task_p != NULL;
+         task_p = task_p->next_p) {
+        if (task_p->flags & TASK_FLAG_GRANTED) {
+            task_p->flags &= ~TASK_FLAG_GRANTED;
+            sem_give_isr(task_p->wait.sem.sem_p, 1);
+        }
+    }
+}
+
+/**
+ * Run all currently ready tasks once.
+ */
+static void run_ready(struct task_scheduler_t *self_p)
+{
+    struct task_scheduler_list_t ready;
+    struct task_scheduler_list_t yielded;
+    struct task_t *task_p;
+    struct task_t *next_p;
+
+    sys_lock();
+    ready = self_p->ready;
+    self_p->ready.head_p = NULL;
+    sys_unlock();
+
+    yielded.head_p = NULL;
+
+    for (task_p = ready.head_p; task_p != NULL; task_p = next_p) {
+        next_p = task_p->next_p;
+
+        switch (task_p->main(task_p)) {
+
+        case TASK_YIELDED:
+            list_append(&yielded, task_p);
+            break;
+
+        case TASK_WAITING:
+            sys_lock();
+            register_isr(self_p, task_p);
+            sys_unlock();
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    if (yielded.head_p != NULL) {
+        sys_lock();
+
+        if (self_p->ready.head_p == NULL) {
+            self_p->ready = yielded;
+        } else {
+            self_p->ready.tail_p->next_p = yielded.head_p;
+            self_p->ready.tail_p = yielded.tail_p;
+        }
+
+        sys_unlock();
+    }
+}
+
+int task_scheduler_init(struct task_scheduler_t *self_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+
+    self_p->thrd_p = NULL;
+    self_p->idle = 0;
+    self_p->ready.head_p = NULL;
+    self_p->ready.tail_p = NULL;
+    self_p->number_of_waiting = 0;
+    self_p->deadlines.head_p = NULL;
+    self_p->deadlines.tail_p = NULL;
+    chan_poll_set_init(&self_p->poll_set);
+    self_p->sem_waiting_p = NULL;
+
+    return (0);
+}
+
+int task_scheduler_run(struct task_scheduler_t *self_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+
+    sys_tick_t deadline;
+    int has_deadline;
+
+    self_p->thrd_p = thrd_self();
+
+    while (1) {
+        sys_lock();
+        has_deadline = poll_waiting_isr(self_p, &deadline);
+
+        if (self_p->ready.head_p == NULL) {
+            if (self_p->number_of_waiting == 0) {
+                sys_unlock();
+                break;
+            }
+
+            wait_isr(self_p, has_deadline, deadline);
+            sys_unlock();
+
+            continue;
+        }
+
+        sys_unlock();
+
+        run_ready(self_p);
+
+        /* Let other threads with the same priority run. */
+        if (self_p->ready.head_p != NULL) {
+            thrd_yield();
+        }
+    }
+
+    return (0);
+}
+
+int task_spawn(struct task_scheduler_t *scheduler_p,
+               struct task_t *self_p,
+               task_main_t main)
+{
+    ASSERTN(scheduler_p != NULL, EINVAL);
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(main != NULL, EINVAL);
+
+    self_p->main = main;
+    self_p->line = 0;
+    self_p->flags = 0;
+    self_p->wait_type = TASK_WAIT_TYPE_SLEEP;
+    self_p->res = 0;
+
+    sys_lock();
+
+    list_append(&scheduler_p->ready, self_p);
+
+    if (scheduler_p->idle) {
+        thrd_resume_isr(scheduler_p->thrd_p, 0);
+    }
+
+    sys_unlock();
+
+    return (0);
+}
+
+int task_sleep(struct task_t *self_p,
+               const struct time_t *timeout_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(timeout_p != NULL, EINVAL);
+
+    int res;
+
+    res = wait(self_p, 0, TASK_WAIT_TYPE_SLEEP, timeout_p);
+
+    /* Sleeping until the timeout is not an error. */
+    if (res == 0) {
+        self_p->res = 0;
+    }
+
+    return (res);
+}
+
+int task_sem_take(struct task_t *self_p,
+                  struct sem_t *sem_p,
+                  const struct time_t *timeout_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(sem_p != NULL, EINVAL);
+
+    int ready;
+
+    self_p->wait.sem.sem_p = sem_p;
+
+    sys_lock();
+
+    ready = sem_try_take_isr(sem_p);
+
+    sys_unlock();
+
+    return (wait(self_p, ready, TASK_WAIT_TYPE_SEM, timeout_p));
+}
+
+static int chan_wait(struct task_t *self_p,
+                     struct chan_t *chan_p,
+                     int wait_type,
+                     uint32_t arg,
+                     int ready,
+                     const struct time_t *timeout_p)
+{
+    int res;
+
+    res = wait(self_p, ready, wait_type, timeout_p);
+
+    if (res == 1) {
+        self_p->wait.chan.chan_p = chan_p;
+        self_p->wait.chan.arg = arg;
+    }
+
+    return (res);
+}
+
+int task_chan_poll(struct task_t *self_p,
+                   void *chan_p,
+                   const struct time_t *timeout_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(chan_p != NULL, EINVAL);
+
+    return (chan_wait(self_p,
+                      chan_p,
+                      TASK_WAIT_TYPE_CHAN,
+                      1,
+                      chan_size(chan_p) > 0,
+                      timeout_p));
+}
+
+int task_queue_read(struct task_t *self_p,
+                    struct queue_t *queue_p,
+                    void *buf_p,
+                    size_t size,
+                    const struct time_t *timeout_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(queue_p != NULL, EINVAL);
+    ASSERTN(buf_p != NULL, EINVAL);
+    ASSERTN(size > 0, EINVAL);
+
+    int res;
+
+    res = chan_wait(self_p,
+                    &queue_p->base,
+                    TASK_WAIT_TYPE_CHAN,
+                    size,
+                    queue_size(queue_p) >= size,
+                    timeout_p);
+
+    if ((res == 0) && (self_p->res == 0)) {
+        /* Does not block since the data is available. */
+        self_p->res = queue_read(queue_p, buf_p, size);
+    }
+
+    return (res);
+}
+
+int task_event_read(struct task_t *self_p,
+                    struct event_t *event_p,
+                    uint32_t *mask_p,
+                    const struct time_t *timeout_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(event_p != NULL, EINVAL);
+    ASSERTN(mask_p != NULL, EINVAL);
+
+    int res;
+
+    res = chan_wait(self_p,
+                    &event_p->base,
+                    TASK_WAIT_TYPE_EVENT,
+                    *mask_p,
+                    (event_p->mask & *mask_p) != 0,
+                    timeout_p);
+
+    if ((res == 0) && (self_p->res == 0)) {
+        /* Does not block since at least one event is set. */
+        self_p->res = event_read(event_p, mask_p, sizeof(*mask_p));
+    }
+
+    return (res);
+}
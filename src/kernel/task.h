@@ -0,0 +1,304 @@
+/**
+ * @section License
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017, Erik Moqvist
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * This file is part of the Simba project.
+ */
+
+#ifndef __KERNEL_TASK_H__
+#define __KERNEL_TASK_H__
+
+#include "simba.h"
+
+/**
+ * Task main function return values. Returned by the task macros
+ * below, never explicitly by the application.
+ */
+#define TASK_EXITED                                         0
+#define TASK_YIELDED                                        1
+#define TASK_WAITING                                        2
+
+/**
+ * Start of the body of a task main function.
+ *
+ * @param[in] self_p Task.
+ */
+#define TASK_BEGIN(self_p)                      \
+    switch ((self_p)->line) {                   \
+    case 0:
+
+/**
+ * End of the body of a task main function. The task exits when
+ * reaching this point.
+ *
+ * @param[in] self_p Task.
+ */
+#define TASK_END(self_p)                        \
+    }                                           \
+    (self_p)->line = 0;                         \
+    return (TASK_EXITED)
+
+/**
+ * Exit given task.
+ *
+ * @param[in] self_p Task.
+ */
+#define TASK_EXIT(self_p)                       \
+    do {                                        \
+        (self_p)->line = 0;                     \
+        return (TASK_EXITED);                   \
+    } while (0)
+
+/**
+ * Let other ready tasks run before continuing.
+ *
+ * @param[in] self_p Task.
+ */
+#define TASK_YIELD(self_p)                      \
+    do {                                        \
+        (self_p)->line = __LINE__;              \
+        return (TASK_YIELDED);                  \
+    case __LINE__:;                             \
+    } while (0)
+
+/**
+ * Wait until given wait expression, one of the `task_*()` wait
+ * functions, evaluates to zero(0). The expression is evaluated again
+ * each time the task is resumed. The outcome of the wait is available
+ * with `task_get_result()`.
+ *
+ * @param[in] self_p Task.
+ * @param[in] wait Wait expression.
+ */
+#define TASK_AWAIT(self_p, wait)                \
+    do {                                        \
+        (self_p)->line = __LINE__;              \
+    case __LINE__:                              \
+        if ((wait) != 0) {                      \
+            return (TASK_WAITING);              \
+        }                                       \
+    } while (0)
+
+/**
+ * Sleep for given time.
+ */
+#define TASK_SLEEP(self_p, timeout_p)                           \
+    TASK_AWAIT(self_p, task_sleep(self_p, timeout_p))
+
+/**
+ * Take given semaphore, with an optional timeout.
+ */
+#define TASK_SEM_TAKE(self_p, sem_p, timeout_p)                 \
+    TASK_AWAIT(self_p, task_sem_take(self_p, sem_p, timeout_p))
+
+/**
+ * Wait for data in given channel, for example a socket, with an
+ * optional timeout.
+ */
+#define TASK_CHAN_POLL(self_p, chan_p, timeout_p)               \
+    TASK_AWAIT(self_p, task_chan_poll(self_p, chan_p, timeout_p))
+
+/**
+ * Read given number of bytes from given queue, with an optional
+ * timeout.
+ */
+#define TASK_QUEUE_READ(self_p, queue_p, buf_p, size, timeout_p)        \
+    TASK_AWAIT(self_p,                                                  \
+               task_queue_read(self_p, queue_p, buf_p, size, timeout_p))
+
+/**
+ * Read events from given event channel, with an optional timeout.
+ */
+#define TASK_EVENT_READ(self_p, event_p, mask_p, timeout_p)             \
+    TASK_AWAIT(self_p,                                                  \
+               task_event_read(self_p, event_p, mask_p, timeout_p))
+
+struct task_t;
+
+typedef int (*task_main_t)(struct task_t *self_p);
+
+/**
+ * A stackless task. The task state that must survive a yield or wait
+ * is stored by the application in a structure embedding the task,
+ * since local variables of the main function are lost.
+ */
+struct task_t {
+    struct task_t *next_p;
+    task_main_t main;
+    uint16_t line;
+    uint8_t flags;
+    uint8_t wait_type;
+    int res;
+    sys_tick_t deadline;
+    /* Waiting tasks with a deadline, earliest deadline first. */
+    struct {
+        struct task_t *next_p;
+        struct task_t *prev_p;
+    } deadlines;
+    union {
+        struct {
+            struct chan_t *chan_p;
+            uint32_t arg;
+            /* The first task waiting for the channel adds it to the
+               poll set of the scheduler, and the other tasks waiting
+               for it are linked from the first one. */
+            struct chan_poll_set_elem_t elem;
+            struct task_t *next_p;
+        } chan;
+        struct {
+            struct sem_t *sem_p;
+            struct thrd_prio_list_elem_t elem;
+        } sem;
+    } wait;
+};
+
+struct task_scheduler_list_t {
+    struct task_t *head_p;
+    struct task_t *tail_p;
+};
+
+/**
+ * Executes tasks in a single thread.
+ */
+struct task_scheduler_t {
+    struct thrd_t *thrd_p;
+    int idle;
+    struct task_scheduler_list_t ready;
+    int number_of_waiting;
+    struct task_scheduler_list_t deadlines;
+    /* Channels waited for by tasks. */
+    struct chan_poll_set_t poll_set;
+    /* Tasks waiting for a semaphore. */
+    struct task_t *sem_waiting_p;
+};
+
+/**
+ * Initialize given task scheduler.
+ *
+ * @param[out] self_p Scheduler to initialize.
+ *
+ * @return zero(0) or negative error code.
+ */
+int task_scheduler_init(struct task_scheduler_t *self_p);
+
+/**
+ * Execute tasks in the calling thread until all tasks have exited.
+ * Waiting tasks are resumed when data is written to the channel,
+ * semaphore or event they are waiting for, or when their timeout
+ * expires. The thread sleeps when all tasks are waiting.
+ *
+ * A channel or semaphore waited for by a task must not be read or
+ * taken by threads at the same time. A channel waited for by a task
+ * must not be in a poll set, or the wait fails with -EBUSY.
+ *
+ * Waiting tasks are only looked at when the channel they wait for is
+ * written to or their deadline expires, so the time spent per
+ * scheduler pass does not depend on the number of tasks waiting for
+ * channels or sleeping. Tasks waiting for semaphores are checked in
+ * every pass.
+ *
+ * @param[in] self_p Scheduler.
+ *
+ * @return zero(0) or negative error code.
+ */
+int task_scheduler_run(struct task_scheduler_t *self_p);
+
+/**
+ * Add given task to given scheduler. May be called from any thread,
+ * or from a task.
+ *
+ * @param[in] scheduler_p Scheduler to execute the task in.
+ * @param[out] self_p Task to initialize and start.
+ * @param[in] main Task main function.
+ *
+ * @return zero(0) or negative error code.
+ */
+int task_spawn(struct task_scheduler_t *scheduler_p,
+               struct task_t *self_p,
+               task_main_t main);
+
+/**
+ * Get the outcome of the last wait of given task.
+ *
+ * @param[in] self_p Task.
+ *
+ * @return Zero(0) or number of read bytes on success, -ETIMEDOUT if
+ *         the wait timed out, -EBUSY if the waited for channel is in
+ *         a poll set, or other negative error code.
+ */
+static inline int task_get_result(struct task_t *self_p)
+{
+    return (self_p->res);
+}
+
+/**
+ * Task wait function for `TASK_SLEEP()`.
+ *
+ * @return zero(0) when the wait is over, otherwise one(1).
+ */
+int task_sleep(struct task_t *self_p,
+               const struct time_t *timeout_p);
+
+/**
+ * Task wait function for `TASK_SEM_TAKE()`.
+ *
+ * @return zero(0) when the wait is over, otherwise one(1).
+ */
+int task_sem_take(struct task_t *self_p,
+                  struct sem_t *sem_p,
+                  const struct time_t *timeout_p);
+
+/**
+ * Task wait function for `TASK_CHAN_POLL()`.
+ *
+ * @return zero(0) when the wait is over, otherwise one(1).
+ */
+int task_chan_poll(struct task_t *self_p,
+                   void *chan_p,
+                   const struct time_t *timeout_p);
+
+/**
+ * Task wait function for `TASK_QUEUE_READ()`.
+ *
+ * @return zero(0) when the wait is over, otherwise one(1).
+ */
+int task_queue_read(struct task_t *self_p,
+                    struct queue_t *queue_p,
+                    void *buf_p,
+                    size_t size,
+                    const struct time_t *timeout_p);
+
+/**
+ * Task wait function for `TASK_EVENT_READ()`.
+ *
+ * @return zero(0) when the wait is over, otherwise one(1).
+ */
+int task_event_read(struct task_t *self_p,
+                    struct event_t *event_p,
+                    uint32_t *mask_p,
+                    const struct time_t *timeout_p);
+
+#endif
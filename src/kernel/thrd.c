@@ -43,11 +43,45 @@ enum thrd_state_t {
 #define THRD_STACK_LOW_MAGIC      0x1337
 #define THRD_FILL_PATTERN           0x19
 
+/* With SMP the ready queues, the current thread of each core and the
+   trace ring are protected by the scheduler lock instead of the
+   system lock. The system lock is taken before the scheduler lock
+   when both are needed. Without SMP the system lock protects
+   everything. */
+#if CONFIG_THRD_SMP == 1
+#    define SCHEDULER_CORES                 CONFIG_THRD_SMP_CORES
+#    define SCHEDULER_CORE_ID()             thrd_port_get_core()
+#    define SCHEDULER_LOCK()                thrd_port_scheduler_lock()
+#    define SCHEDULER_UNLOCK()              thrd_port_scheduler_unlock()
+#else
+#    define SCHEDULER_CORES                                     1
+#    define SCHEDULER_CORE_ID()                                 0
+#    define SCHEDULER_LOCK()
+#    define SCHEDULER_UNLOCK()
+#endif
+
+#define SCHEDULER_CORES_MASK (0xffffffffUL >> (32 - SCHEDULER_CORES))
+
+#if CONFIG_THRD_PRIO_LIST_BITMAP == 1
+/* Priority level of given thread priority, where level zero is the
+   highest priority. */
+#    define PRIO_LIST_LEVEL(prio) (((int)(prio) + 128) >> 3)
+
+/* Bitmap bit of given level. */
+#    define PRIO_LIST_LEVEL_BIT(level) (0x80000000UL >> (level))
+#endif
+
+/* Scheduler state of one core. */
+struct scheduler_core_t {
+    struct thrd_t *current_p;
+    struct thrd_t *idle_p;
+    struct thrd_prio_list_t ready;
+};
+
 struct module_t {
     int8_t initialized;
     struct {
-        struct thrd_t *current_p;
-        struct thrd_prio_list_t ready;
+        struct scheduler_core_t cores[SCHEDULER_CORES];
     } scheduler;
     struct thrd_t *threads_p;
 #if CONFIG_THRD_ENV == 1
@@ -57,9 +91,20 @@ struct module_t {
         struct mutex_t mutex;
     } env;
 #endif
+#if CONFIG_THRD_TRACE == 1
+    struct {
+        /* Total number of written entries. */
+        uint32_t head;
+        int8_t paused;
+        struct thrd_trace_entry_t entries[CONFIG_THRD_TRACE_LENGTH];
+    } trace;
+#endif
 #if CONFIG_THRD_FS_COMMANDS == 1
     struct fs_command_t cmd_list;
     struct fs_command_t cmd_set_log_mask;
+#    if CONFIG_THRD_TRACE == 1
+    struct fs_command_t cmd_trace;
+#    endif
 #endif
 #if CONFIG_MONITOR_THREAD == 1
     struct fs_command_t cmd_monitor_set_period_ms;
@@ -141,19 +186,36 @@ static const char *get_env(struct thrd_environment_t *env_p,
 /* Forward declarations for thrd_port. */
 static void scheduler_ready_push(struct thrd_t *thrd_p);
 
+#if CONFIG_THRD_SMP == 1
+static void scheduler_core_start(void);
+#endif
+
 static void thrd_reschedule(void);
 
 void terminate(void);
 
+#if CONFIG_THRD_TRACE == 1
+static void trace_write(int type, struct thrd_t *thrd_p, uintptr_t arg);
+#endif
+
 #include "thrd_port.i"
 
 #if CONFIG_MONITOR_THREAD == 1 && CONFIG_THRD_CPU_USAGE == 1
 #    include "thrd/thrd_monitor.i"
 #endif
 
+#if CONFIG_THRD_HISTOGRAMS == 1
+#    include "thrd/thrd_histograms.i"
+#endif
+
 /* Stacks. */
 static THRD_STACK(idle_thrd_stack, CONFIG_THRD_IDLE_STACK_SIZE);
 
+#if CONFIG_THRD_SMP == 1
+static THRD_STACK(idle_thrd_stacks[SCHEDULER_CORES - 1],
+                  CONFIG_THRD_IDLE_STACK_SIZE);
+#endif
+
 /**
  * The thread is terminated.
  */
@@ -162,6 +224,11 @@ void terminate(void)
 #if CONFIG_THRD_TERMINATE == 1
     struct thrd_t *thrd_p, *prev_p;
 
+#if CONFIG_HEAP_MAGAZINES == 1
+    /* Give cached heap buffers back to the heap. */
+    heap_magazines_detach();
+#endif
+
     /* Remove the thread from the global list of threads. */
     sys_lock();
 
@@ -185,6 +252,7 @@ void terminate(void)
 
     sem_give_isr(&thrd_self()->join_sem, 1);
     thrd_self()->state = THRD_STATE_TERMINATED;
+    SCHEDULER_LOCK();
     thrd_reschedule();
 
     /* Should never come here. */
@@ -208,14 +276,149 @@ static void on_suspend_timer_expired(void *arg_p)
     /* Push thread on scheduler ready queue. */
     thrd_p->err = -ETIMEDOUT;
     thrd_p->state = THRD_STATE_READY;
+    SCHEDULER_LOCK();
+#if CONFIG_THRD_TRACE == 1
+    trace_write(THRD_TRACE_TYPE_RESUME, thrd_p, -ETIMEDOUT);
+#endif
+#if CONFIG_THRD_HISTOGRAMS == 1
+    histograms_resume(thrd_p);
+#endif
     scheduler_ready_push(thrd_p);
+    SCHEDULER_UNLOCK();
 
     thrd_port_on_suspend_timer_expired(thrd_p);
 }
 
+#if (CONFIG_SYSTEM_TICKLESS == 1) || (CONFIG_THRD_SMP == 1)
+
+/**
+ * A core is idle when it runs its idle thread. A core without an idle
+ * thread is not started yet, and is neither idle nor busy.
+ */
+static int scheduler_core_is_idle(struct scheduler_core_t *core_p)
+{
+    return ((core_p->idle_p != NULL)
+            && (core_p->current_p == core_p->idle_p));
+}
+
+#endif
+
+#if CONFIG_THRD_SMP == 1
+
+static int scheduler_core_is_busy(struct scheduler_core_t *core_p,
+                                  struct thrd_t *thrd_p)
+{
+    return ((core_p->idle_p != NULL)
+            && (core_p->current_p != core_p->idle_p)
+            && (core_p->current_p != thrd_p));
+}
+
+/**
+ * Select the core to run given thread on. The core the thread last
+ * ran on is preferred, unless it is busy and another allowed core is
+ * idle.
+ */
+static int scheduler_select_core(struct thrd_t *thrd_p)
+{
+    int core;
+    int i;
+
+    core = thrd_p->core;
+
+    if ((thrd_p->affinity & (1UL << core)) == 0) {
+        core = bits_ctz_32(thrd_p->affinity);
+    }
+
+    if (scheduler_core_is_busy(&module.scheduler.cores[core], thrd_p)) {
+        for (i = 0; i < SCHEDULER_CORES; i++) {
+            if ((thrd_p->affinity & (1UL << i))
+                && scheduler_core_is_idle(&module.scheduler.cores[i])) {
+                core = i;
+                break;
+            }
+        }
+    }
+
+    thrd_p->core = core;
+
+    return (core);
+}
+
+/**
+ * Find the most important thread in given ready list that is allowed
+ * to run on given core, without modifying the list.
+ */
+static struct thrd_prio_list_elem_t *scheduler_find_allowed(
+    struct thrd_prio_list_t *ready_p,
+    int core)
+{
+    struct thrd_prio_list_elem_t *elem_p;
+#if CONFIG_THRD_PRIO_LIST_BITMAP == 1
+    struct thrd_prio_list_elem_t *tail_p;
+    uint32_t bitmap;
+    int level;
+
+    bitmap = ready_p->bitmap;
+
+    while (bitmap != 0) {
+        level = bits_clz_32(bitmap);
+        tail_p = ready_p->tails[level];
+        elem_p = tail_p;
+
+        do {
+            elem_p = elem_p->next_p;
+
+            if (elem_p->thrd_p->affinity & (1UL << core)) {
+                return (elem_p);
+            }
+        } while (elem_p != tail_p);
+
+        bitmap &= ~PRIO_LIST_LEVEL_BIT(level);
+    }
+#else
+    for (elem_p = ready_p->head_p; elem_p != NULL; elem_p = elem_p->next_p) {
+        if (elem_p->thrd_p->affinity & (1UL << core)) {
+            return (elem_p);
+        }
+    }
+#endif
+
+    return (NULL);
+}
+
+/**
+ * Steal the most important ready thread allowed to run on given
+ * core from another core. The order of the other threads in the
+ * victim's ready list is kept.
+ *
+ * @return Stolen thread or NULL if there is nothing to steal.
+ */
+static struct thrd_t *scheduler_steal(int core)
+{
+    int i;
+    struct thrd_prio_list_t *ready_p;
+    struct thrd_prio_list_elem_t *elem_p;
+
+    for (i = 1; i < SCHEDULER_CORES; i++) {
+        ready_p = &module.scheduler.cores[(core + i) % SCHEDULER_CORES].ready;
+        elem_p = scheduler_find_allowed(ready_p, core);
+
+        if (elem_p != NULL) {
+            thrd_prio_list_remove_isr(ready_p, elem_p);
+            elem_p->thrd_p->core = core;
+
+            return (elem_p->thrd_p);
+        }
+    }
+
+    return (NULL);
+}
+
+#endif
+
 /**
  * Push a thread on the list of threads that are ready to be
- * scheduled.
+ * scheduled. Must be called with the scheduler lock taken.
  *
  * @param[in] thrd_p Thread to push to the the ready list.
  *
@@ -223,27 +426,72 @@ static void on_suspend_timer_expired(void *arg_p)
  */
 static void scheduler_ready_push(struct thrd_t *thrd_p)
 {
-    thrd_prio_list_push_isr(&module.scheduler.ready, &thrd_p->scheduler.elem);
+    int core;
+    struct scheduler_core_t *core_p;
+
+#if CONFIG_THRD_SMP == 1
+    core = scheduler_select_core(thrd_p);
+#else
+    core = 0;
+#endif
+
+    core_p = &module.scheduler.cores[core];
+    thrd_prio_list_push_isr(&core_p->ready, &thrd_p->scheduler.elem);
+
+#if (CONFIG_SYSTEM_TICKLESS == 1) || (CONFIG_THRD_SMP == 1)
+    /* The system tick may be stopped, or the core is waiting for
+       work. Wake up the idle thread to let the pushed thread run. */
+    if (scheduler_core_is_idle(core_p) && (thrd_p != core_p->idle_p)) {
+        thrd_port_idle_wakeup_isr(core);
+    }
+#endif
 }
 
 /**
- * Pop the most important thread from the ready list.
+ * Pop the most important thread from the ready list of the current
+ * core. Must be called with the scheduler lock taken.
  *
  * @return Thread to swap to.
  */
 static struct thrd_t *scheduler_ready_pop(void)
 {
-    return (thrd_prio_list_pop_isr(&module.scheduler.ready)->thrd_p);
+    struct scheduler_core_t *core_p;
+    struct thrd_t *thrd_p;
+
+    core_p = &module.scheduler.cores[SCHEDULER_CORE_ID()];
+    thrd_p = thrd_prio_list_pop_isr(&core_p->ready)->thrd_p;
+
+#if CONFIG_THRD_SMP == 1
+    struct thrd_t *stolen_p;
+
+    /* Only the idle thread is ready. Try to steal work from another
+       core before idling. */
+    if (thrd_p == core_p->idle_p) {
+        stolen_p = scheduler_steal(SCHEDULER_CORE_ID());
+
+        if (stolen_p != NULL) {
+            thrd_prio_list_push_isr(&core_p->ready, &thrd_p->scheduler.elem);
+            thrd_p = stolen_p;
+        }
+    }
+#endif
+
+    return (thrd_p);
 }
 
 /**
- * Perform a rescheduling to let the currently most important thread
- * to run.
+ * Swap to the most important ready thread of the current core. Must
+ * be called with the scheduler lock taken, and with the system lock
+ * taken if `sys_locked` is one(1). The lock is released by the thread
+ * swapped to, which is the current thread if no other thread is
+ * ready.
  *
- * This function must be called with the system lock taken or from an
- * isr.
+ * With SMP the system lock is released during the swap, so that other
+ * cores may use kernel objects meanwhile, and taken again before
+ * returning. The scheduler lock keeps other cores from running the
+ * out thread before it is swapped out.
  */
-static void thrd_reschedule(void)
+static void scheduler_reschedule(int sys_locked)
 {
     struct thrd_t *in_p, *out_p;
 
@@ -257,16 +505,54 @@ static void thrd_reschedule(void)
     in_p->state = THRD_STATE_CURRENT;
 
     if (in_p != out_p) {
-        module.scheduler.current_p = in_p;
+        module.scheduler.cores[SCHEDULER_CORE_ID()].current_p = in_p;
         thrd_port_cpu_usage_stop(out_p);
         thrd_port_cpu_usage_start(in_p);
+#if CONFIG_THRD_TRACE == 1
+        trace_write(THRD_TRACE_TYPE_SWITCH, in_p, (uintptr_t)out_p);
+#endif
+#if CONFIG_THRD_HISTOGRAMS == 1
+        histograms_switch(in_p, out_p);
+#endif
+
+        if (sys_locked == 1) {
+#if CONFIG_RCU == 1
+            rcu_switch_isr(out_p);
+#endif
+#if CONFIG_THRD_SMP == 1
+            sys_unlock();
+#endif
+        }
+
         thrd_port_swap(in_p, out_p);
+        SCHEDULER_UNLOCK();
+
+#if CONFIG_THRD_SMP == 1
+        if (sys_locked == 1) {
+            sys_lock();
+        }
+#endif
 #if CONFIG_THRD_SCHEDULED == 1
         out_p->statistics.scheduled++;
 #endif
+    } else {
+        SCHEDULER_UNLOCK();
     }
 }
 
+/**
+ * Perform a rescheduling to let the currently most important thread
+ * to run.
+ *
+ * This function must be called with the system lock and the
+ * scheduler lock taken, or from an isr. The scheduler lock is
+ * released.
+ */
+static void thrd_reschedule(void)
+{
+    scheduler_reschedule(1);
+}
+
 #if CONFIG_PROFILE_STACK == 1
 
 static void thrd_fill_pattern(char *from_p, size_t size)
@@ -302,6 +588,395 @@ static int thrd_get_used_stack(struct thrd_t *thrd_p)
 
 #endif
 
+#if CONFIG_THRD_TRACE == 1
+
+#define TRACE_MASK (CONFIG_THRD_TRACE_LENGTH - 1)
+
+static const char * const FAR trace_type_fmt[] = {
+    "switch",
+    "resume",
+    "timer",
+    "isr-enter",
+    "isr-exit"
+};
+
+/**
+ * Format given number of microseconds as a decimal integer, as
+ * `std_fprintf()` has no 64 bit conversion.
+ */
+static char *trace_format_us(char *buf_p, size_t size, uint64_t value)
+{
+    unsigned long seconds;
+
+    seconds = (value / 1000000);
+
+    if (seconds > 0) {
+        std_snprintf(buf_p,
+                     size,
+                     FSTR("%lu%06lu"),
+                     seconds,
+                     (unsigned long)(value % 1000000));
+    } else {
+        std_snprintf(buf_p, size, FSTR("%lu"), (unsigned long)value);
+    }
+
+    return (buf_p);
+}
+
+/**
+ * Pause recording and get the number of entries and the index of the
+ * oldest entry.
+ */
+static uint32_t trace_pause(uint32_t *first_p)
+{
+    uint32_t head;
+
+    sys_lock();
+    SCHEDULER_LOCK();
+    module.trace.paused++;
+    head = module.trace.head;
+    SCHEDULER_UNLOCK();
+    sys_unlock();
+
+    if (head > CONFIG_THRD_TRACE_LENGTH) {
+        *first_p = (head - CONFIG_THRD_TRACE_LENGTH);
+    } else {
+        *first_p = 0;
+    }
+
+    return (head - *first_p);
+}
+
+static void trace_resume(void)
+{
+    sys_lock();
+    SCHEDULER_LOCK();
+    module.trace.paused--;
+    SCHEDULER_UNLOCK();
+    sys_unlock();
+}
+
+/**
+ * Get the thread list index of given thread, starting at one(1), or
+ * zero(0) if the thread is unknown. Entries may refer to threads
+ * that no longer exist.
+ */
+static int trace_thrd_index(struct thrd_t *thrd_p)
+{
+    struct thrd_t *curr_p;
+    int index;
+
+    index = 1;
+
+    for (curr_p = module.threads_p; curr_p != NULL; curr_p = curr_p->next_p) {
+        if (curr_p == thrd_p) {
+            return (index);
+        }
+
+        index++;
+    }
+
+    return (0);
+}
+
+static const char *trace_thrd_name(struct thrd_t *thrd_p)
+{
+    if ((thrd_p == NULL) || (trace_thrd_index(thrd_p) == 0)) {
+        return ("-");
+    }
+
+    return (thrd_p->name_p);
+}
+
+static void trace_print_run(void *chan_p,
+                            int *first_p,
+                            int core,
+                            struct thrd_t *thrd_p,
+                            uint64_t begin,
+                            uint64_t end)
+{
+    char ts[24];
+    char dur[24];
+
+    std_fprintf(chan_p,
+                OSTR("%s\r\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,"
+                     "\"tid\":%d,\"ts\":%s,\"dur\":%s}"),
+                (*first_p ? "" : ","),
+                trace_thrd_name(thrd_p),
+                core,
+                trace_thrd_index(thrd_p),
+                trace_format_us(&ts[0], sizeof(ts), begin),
+                trace_format_us(&dur[0], sizeof(dur), end - begin));
+    *first_p = 0;
+}
+
+/**
+ * Add an entry to the trace buffer. The ring has no lock of its own,
+ * and is not lock-free. It is protected by the system lock, and with
+ * SMP by the scheduler lock, so it must be called with the lock
+ * taken.
+ */
+static RAM_CODE void trace_write(int type,
+                                 struct thrd_t *thrd_p,
+                                 uintptr_t arg)
+{
+    struct thrd_trace_entry_t *entry_p;
+    struct time_t now;
+
+    if (module.trace.paused > 0) {
+        return;
+    }
+
+    sys_uptime_isr(&now);
+    entry_p = &module.trace.entries[module.trace.head & TRACE_MASK];
+    module.trace.head++;
+    entry_p->timestamp = ((uint64_t)now.seconds * 1000000
+                          + now.nanoseconds / 1000);
+    entry_p->type = type;
+    entry_p->core = SCHEDULER_CORE_ID();
+    entry_p->thrd_p = thrd_p;
+    entry_p->arg = arg;
+}
+
+RAM_CODE void thrd_trace_write_isr(int type,
+                                   struct thrd_t *thrd_p,
+                                   uintptr_t arg)
+{
+    SCHEDULER_LOCK();
+    trace_write(type, thrd_p, arg);
+    SCHEDULER_UNLOCK();
+}
+
+int thrd_trace_read(struct thrd_trace_entry_t *entries_p, int length)
+{
+    ASSERTN(entries_p != NULL, EINVAL);
+    ASSERTN(length >= 0, EINVAL);
+
+    uint32_t first;
+    uint32_t size;
+    int i;
+
+    size = trace_pause(&first);
+
+    /* Read the most recent entries. */
+    if (size > length) {
+        first += (size - length);
+        size = length;
+    }
+
+    for (i = 0; i < size; i++) {
+        entries_p[i] = module.trace.entries[(first + i) & TRACE_MASK];
+    }
+
+    trace_resume();
+
+    return (size);
+}
+
+int thrd_trace_clear(void)
+{
+    sys_lock();
+    SCHEDULER_LOCK();
+    module.trace.head = 0;
+    SCHEDULER_UNLOCK();
+    sys_unlock();
+
+    return (0);
+}
+
+int thrd_trace_print(void *chan_p)
+{
+    ASSERTN(chan_p != NULL, EINVAL);
+
+    struct thrd_trace_entry_t *entry_p;
+    uint32_t first;
+    uint32_t size;
+    uint32_t i;
+
+    size = trace_pause(&first);
+
+    std_fprintf(chan_p,
+                OSTR("      TIMESTAMP  CORE  TYPE                    THREAD"
+                     "                   ARG\r\n"));
+
+    for (i = 0; i < size; i++) {
+        entry_p = &module.trace.entries[(first + i) & TRACE_MASK];
+
+        std_fprintf(chan_p,
+                    OSTR("%8lu.%06lu %5d  %-9s  %20s  "),
+                    (unsigned long)(entry_p->timestamp / 1000000),
+                    (unsigned long)(entry_p->timestamp % 1000000),
+                    entry_p->core,
+                    trace_type_fmt[entry_p->type],
+                    trace_thrd_name(entry_p->thrd_p));
+
+        if (entry_p->type == THRD_TRACE_TYPE_SWITCH) {
+            std_fprintf(chan_p,
+                        OSTR("%20s\r\n"),
+                        trace_thrd_name((struct thrd_t *)entry_p->arg));
+        } else if (entry_p->type == THRD_TRACE_TYPE_TIMER) {
+            std_fprintf(chan_p,
+                        OSTR("%20lx\r\n"),
+                        (unsigned long)entry_p->arg);
+        } else {
+            std_fprintf(chan_p,
+                        OSTR("%20ld\r\n"),
+                        (long)entry_p->arg);
+        }
+    }
+
+    trace_resume();
+
+    return (0);
+}
+
+int thrd_trace_print_chrome(void *chan_p)
+{
+    ASSERTN(chan_p != NULL, EINVAL);
+
+    struct thrd_trace_entry_t *entry_p;
+    struct thrd_t *thrd_p;
+    struct thrd_t *running[SCHEDULER_CORES];
+    uint64_t started[SCHEDULER_CORES];
+    uint32_t first;
+    uint32_t size;
+    uint64_t begin;
+    uint64_t end;
+    uint32_t i;
+    int core;
+    int first_event;
+    char ts[24];
+
+    size = trace_pause(&first);
+
+    if (size > 0) {
+        begin = module.trace.entries[first & TRACE_MASK].timestamp;
+        end = module.trace.entries[(first + size - 1) & TRACE_MASK].timestamp;
+    } else {
+        begin = 0;
+        end = 0;
+    }
+
+    std_fprintf(chan_p, OSTR("{\"traceEvents\":["));
+    first_event = 1;
+
+    /* Name each core and its threads. Interrupts are thread zero. */
+    for (core = 0; core < SCHEDULER_CORES; core++) {
+        running[core] = NULL;
+        started[core] = begin;
+
+        std_fprintf(chan_p,
+                    OSTR("%s\r\n{\"name\":\"process_name\",\"ph\":\"M\","
+                         "\"pid\":%d,\"args\":{\"name\":\"core %d\"}}"
+                         ",\r\n{\"name\":\"thread_name\",\"ph\":\"M\","
+                         "\"pid\":%d,\"tid\":0,"
+                         "\"args\":{\"name\":\"interrupts\"}}"),
+                    (first_event ? "" : ","),
+                    core,
+                    core,
+                    core);
+        first_event = 0;
+
+        for (thrd_p = module.threads_p;
+             thrd_p != NULL;
+             thrd_p = thrd_p->next_p) {
+            std_fprintf(chan_p,
+                        OSTR(",\r\n{\"name\":\"thread_name\",\"ph\":\"M\","
+                             "\"pid\":%d,\"tid\":%d,"
+                             "\"args\":{\"name\":\"%s\"}}"),
+                        core,
+                        trace_thrd_index(thrd_p),
+                        thrd_p->name_p);
+        }
+    }
+
+    for (i = 0; i < size; i++) {
+        entry_p = &module.trace.entries[(first + i) & TRACE_MASK];
+        core = entry_p->core;
+
+        switch (entry_p->type) {
+
+        case THRD_TRACE_TYPE_SWITCH:
+            /* The switched out thread ran since the previous switch,
+               or since the oldest entry. */
+            thrd_p = running[core];
+
+            if (thrd_p == NULL) {
+                thrd_p = (struct thrd_t *)entry_p->arg;
+            }
+
+            trace_print_run(chan_p,
+                            &first_event,
+                            core,
+                            thrd_p,
+                            started[core],
+                            entry_p->timestamp);
+            running[core] = entry_p->thrd_p;
+            started[core] = entry_p->timestamp;
+            break;
+
+        case THRD_TRACE_TYPE_RESUME:
+            std_fprintf(chan_p,
+                        OSTR(",\r\n{\"name\":\"resume\",\"ph\":\"i\","
+                             "\"s\":\"t\",\"pid\":%d,\"tid\":%d,\"ts\":%s,"
+                             "\"args\":{\"err\":%ld}}"),
+                        core,
+                        trace_thrd_index(entry_p->thrd_p),
+                        trace_format_us(&ts[0],
+                                        sizeof(ts),
+                                        entry_p->timestamp),
+                        (long)entry_p->arg);
+            break;
+
+        case THRD_TRACE_TYPE_TIMER:
+            std_fprintf(chan_p,
+                        OSTR(",\r\n{\"name\":\"timer\",\"ph\":\"i\","
+                             "\"s\":\"t\",\"pid\":%d,\"tid\":0,\"ts\":%s,"
+                             "\"args\":{\"callback\":\"0x%lx\"}}"),
+                        core,
+                        trace_format_us(&ts[0],
+                                        sizeof(ts),
+                                        entry_p->timestamp),
+                        (unsigned long)entry_p->arg);
+            break;
+
+        default:
+            std_fprintf(chan_p,
+                        OSTR(",\r\n{\"name\":\"isr %lu\",\"ph\":\"%c\","
+                             "\"pid\":%d,\"tid\":0,\"ts\":%s}"),
+                        (unsigned long)entry_p->arg,
+                        (entry_p->type == THRD_TRACE_TYPE_ISR_ENTER
+                         ? 'B'
+                         : 'E'),
+                        core,
+                        trace_format_us(&ts[0],
+                                        sizeof(ts),
+                                        entry_p->timestamp));
+            break;
+        }
+    }
+
+    /* Threads still running at the newest entry. */
+    for (core = 0; core < SCHEDULER_CORES; core++) {
+        if (running[core] != NULL) {
+            trace_print_run(chan_p,
+                            &first_event,
+                            core,
+                            running[core],
+                            started[core],
+                            end);
+        }
+    }
+
+    std_fprintf(chan_p, OSTR("\r\n]}\r\n"));
+
+    trace_resume();
+
+    return (0);
+}
+
+#endif
+
 #if CONFIG_THRD_FS_COMMANDS == 1
 
 static char * const FAR state_fmt[] = {
@@ -404,6 +1079,30 @@ static int cmd_set_log_mask_cb(int argc,
     return (0);
 }
 
+#    if CONFIG_THRD_TRACE == 1
+
+static int cmd_trace_cb(int argc,
+                        const char *argv[],
+                        void *chout_p,
+                        void *chin_p,
+                        void *arg_p,
+                        void *call_arg_p)
+{
+    if ((argc == 1) || ((argc == 2) && (strcmp(argv[1], "print") == 0))) {
+        return (thrd_trace_print(chout_p));
+    } else if ((argc == 2) && (strcmp(argv[1], "chrome") == 0)) {
+        return (thrd_trace_print_chrome(chout_p));
+    } else if ((argc == 2) && (strcmp(argv[1], "clear") == 0)) {
+        return (thrd_trace_clear());
+    }
+
+    std_fprintf(chout_p, OSTR("Usage: trace [print|chrome|clear]\r\n"));
+
+    return (-EINVAL);
+}
+
+#    endif
+
 #endif
 
 static void *idle_thrd(void *arg_p)
@@ -421,9 +1120,31 @@ static void *idle_thrd(void *arg_p)
     return (NULL);
 }
 
+#if CONFIG_THRD_SMP == 1
+
+/**
+ * Called by the port in the context of a core other than core zero
+ * to start scheduling threads on it. Never returns.
+ */
+static void scheduler_core_start(void)
+{
+    struct thrd_t *thrd_p;
+
+    SCHEDULER_LOCK();
+    thrd_p = scheduler_ready_pop();
+    thrd_p->state = THRD_STATE_CURRENT;
+    module.scheduler.cores[SCHEDULER_CORE_ID()].current_p = thrd_p;
+
+    /* The thread releases the scheduler lock. */
+    thrd_port_set_context(thrd_p);
+}
+
+#endif
+
 int thrd_module_init(void)
 {
     struct thrd_t *thrd_p;
+    int i;
 
     /* Return immediately if the module is already initialized. */
     if (module.initialized == 1) {
@@ -432,13 +1153,18 @@ int thrd_module_init(void)
 
     module.initialized = 1;
 
-    thrd_prio_list_init(&module.scheduler.ready);
+    for (i = 0; i < SCHEDULER_CORES; i++) {
+        thrd_prio_list_init(&module.scheduler.cores[i].ready);
+    }
 
 #if CONFIG_THRD_STACK_HEAP == 1
     heap_init(&stack_heap,
               &stack_heap_buffer[0],
               sizeof(stack_heap_buffer),
               &stack_heap_fixed_buffer_sizes[0]);
+#    if CONFIG_HEAP_STATS == 1
+    heap_register(&stack_heap, "thrd_stack");
+#    endif
 #endif
 
 #if CONFIG_THRD_ENV == 1
@@ -477,25 +1203,77 @@ int thrd_module_init(void)
     thrd_p->statistics.scheduled = 0;
 #endif
 
+#if CONFIG_THRD_HISTOGRAMS == 1
+    histograms_init(thrd_p);
+#endif
+
 #if CONFIG_THRD_ENV == 1
     thrd_p->env.variables_p = NULL;
     thrd_p->env.number_of_variables = 0;
     thrd_p->env.max_number_of_variables = 0;
 #endif
 
+#if CONFIG_MUTEX_PRIO_INHERIT == 1
+    thrd_p->mutex.prio = thrd_p->prio;
+    thrd_p->mutex.waiting_for_p = NULL;
+    thrd_p->mutex.elem_p = NULL;
+    thrd_p->mutex.held_p = NULL;
+#endif
+
+#if CONFIG_RCU == 1
+    thrd_p->rcu.nesting = 0;
+    thrd_p->rcu.state = 0;
+    thrd_p->rcu.next_p = NULL;
+#endif
+
+#if CONFIG_HEAP_MAGAZINES == 1
+    thrd_p->heap.heap_p = NULL;
+    thrd_p->heap.generation = 0;
+    thrd_p->heap.magazines_p = NULL;
+#endif
+
 #if CONFIG_PANIC_ASSERT == 1
     thrd_p->stack_low_magic = THRD_STACK_LOW_MAGIC;
 #endif
 
+#if CONFIG_THRD_SMP == 1
+    thrd_p->affinity = SCHEDULER_CORES_MASK;
+    thrd_p->core = 0;
+#endif
+
 #if CONFIG_PROFILE_STACK == 1
     thrd_fill_pattern((char *)(thrd_p + 1), &dummy - (char *)(thrd_p + 2));
 #endif
 
-    module.scheduler.current_p = thrd_p;
+    module.scheduler.cores[0].current_p = thrd_p;
     module.threads_p = thrd_p;
 
     thrd_port_init_main(&thrd_p->port);
-    thrd_spawn(idle_thrd, NULL, 127, idle_thrd_stack, sizeof(idle_thrd_stack));
+
+    thrd_p = thrd_spawn(idle_thrd,
+                        NULL,
+                        127,
+                        idle_thrd_stack,
+                        sizeof(idle_thrd_stack));
+    module.scheduler.cores[0].idle_p = thrd_p;
+
+#if CONFIG_THRD_SMP == 1
+    /* One idle thread per core, bound to its core. The other cores
+       have no idle thread yet, so they are not selected for any
+       thread until their idle thread is set, and the affinity moves
+       each idle thread to its own core. */
+    thrd_set_affinity(thrd_p, 0x1);
+
+    for (i = 1; i < SCHEDULER_CORES; i++) {
+        thrd_p = thrd_spawn(idle_thrd,
+                            NULL,
+                            127,
+                            idle_thrd_stacks[i - 1],
+                            sizeof(idle_thrd_stacks[i - 1]));
+        thrd_set_affinity(thrd_p, (1UL << i));
+        module.scheduler.cores[i].idle_p = thrd_p;
+    }
+#endif
 
 #if CONFIG_MONITOR_THREAD == 1
     thrd_spawn(monitor_thrd,
@@ -518,6 +1296,14 @@ int thrd_module_init(void)
                     NULL);
     fs_command_register(&module.cmd_set_log_mask);
 
+#    if CONFIG_THRD_TRACE == 1
+    fs_command_init(&module.cmd_trace,
+                    CSTR("/kernel/thrd/trace"),
+                    cmd_trace_cb,
+                    NULL);
+    fs_command_register(&module.cmd_trace);
+#    endif
+
 #    if CONFIG_MONITOR_THREAD == 1
     fs_command_init(&module.cmd_monitor_set_period_ms,
                     CSTR("/kernel/thrd/monitor/set_period_ms"),
@@ -533,6 +1319,18 @@ int thrd_module_init(void)
 #    endif
 #endif
 
+#if CONFIG_THRD_HISTOGRAMS == 1
+    histograms_module_init();
+#endif
+
+#if CONFIG_THRD_SMP == 1
+    for (i = 1; i < SCHEDULER_CORES; i++) {
+        if (thrd_port_start_core(i) != 0) {
+            return (-1);
+        }
+    }
+#endif
+
     return (0);
 }
 
@@ -572,16 +1370,44 @@ struct thrd_t *thrd_spawn(void *(*main)(void *),
     thrd_p->statistics.scheduled = 0;
 #endif
 
+#if CONFIG_THRD_HISTOGRAMS == 1
+    histograms_init(thrd_p);
+#endif
+
 #if CONFIG_THRD_ENV == 1
     thrd_p->env.variables_p = NULL;
     thrd_p->env.number_of_variables = 0;
     thrd_p->env.max_number_of_variables = 0;
 #endif
 
+#if CONFIG_MUTEX_PRIO_INHERIT == 1
+    thrd_p->mutex.prio = thrd_p->prio;
+    thrd_p->mutex.waiting_for_p = NULL;
+    thrd_p->mutex.elem_p = NULL;
+    thrd_p->mutex.held_p = NULL;
+#endif
+
+#if CONFIG_RCU == 1
+    thrd_p->rcu.nesting = 0;
+    thrd_p->rcu.state = 0;
+    thrd_p->rcu.next_p = NULL;
+#endif
+
+#if CONFIG_HEAP_MAGAZINES == 1
+    thrd_p->heap.heap_p = NULL;
+    thrd_p->heap.generation = 0;
+    thrd_p->heap.magazines_p = NULL;
+#endif
+
 #if CONFIG_PANIC_ASSERT == 1
     thrd_p->stack_low_magic = THRD_STACK_LOW_MAGIC;
 #endif
 
+#if CONFIG_THRD_SMP == 1
+    thrd_p->affinity = SCHEDULER_CORES_MASK;
+    thrd_p->core = SCHEDULER_CORE_ID();
+#endif
+
 #if CONFIG_PROFILE_STACK == 1
     thrd_fill_pattern((char *)(thrd_p + 1), thrd_p->stack_size);
 #endif
@@ -592,7 +1418,9 @@ struct thrd_t *thrd_spawn(void *(*main)(void *),
     res = thrd_port_spawn(thrd_p, main, arg_p, stack_p, stack_size);
 
     sys_lock();
+    SCHEDULER_LOCK();
     scheduler_ready_push(thrd_p);
+    SCHEDULER_UNLOCK();
     sys_unlock();
 
     return (res == 0 ? thrd_p : NULL);
@@ -625,10 +1453,35 @@ int thrd_resume(struct thrd_t *thrd_p, int err)
 int thrd_yield(void)
 {
     int res;
+#if CONFIG_THRD_SMP == 1
+    struct thrd_t *thrd_p;
+
+    thrd_p = thrd_self();
 
+#    if CONFIG_RCU == 1
+    /* The system lock is only needed to update the RCU state of a
+       thread switched out in or right after a read-side critical
+       section. */
+    if ((thrd_p->rcu.nesting != 0)
+        || (__atomic_load_n(&thrd_p->rcu.state, __ATOMIC_RELAXED) != 0)) {
+        sys_lock();
+        res = thrd_yield_isr();
+        sys_unlock();
+
+        return (res);
+    }
+#    endif
+
+    SCHEDULER_LOCK();
+    thrd_p->state = THRD_STATE_READY;
+    scheduler_ready_push(thrd_p);
+    scheduler_reschedule(0);
+    res = 0;
+#else
     sys_lock();
     res = thrd_yield_isr();
     sys_unlock();
+#endif
 
     return (res);
 }
@@ -638,9 +1491,27 @@ int thrd_join(struct thrd_t *thrd_p)
     ASSERTN(thrd_p != NULL, EINVAL);
 
 #if CONFIG_THRD_TERMINATE == 1
+#    if CONFIG_THRD_SMP == 1
+    int running;
+#    endif
+
     sem_take(&thrd_p->join_sem, NULL);
     sem_give(&thrd_p->join_sem, 1);
 
+#    if CONFIG_THRD_SMP == 1
+    /* The terminated thread runs on its stack until it is switched
+       out, possibly on another core. */
+    do {
+        SCHEDULER_LOCK();
+        running = (module.scheduler.cores[thrd_p->core].current_p == thrd_p);
+        SCHEDULER_UNLOCK();
+
+        if (running == 1) {
+            thrd_yield();
+        }
+    } while (running == 1);
+#    endif
+
     return (0);
 #else
     return (-1);
@@ -677,7 +1548,7 @@ int thrd_sleep_us(long microseconds)
 
 struct thrd_t *thrd_self(void)
 {
-    return (module.scheduler.current_p);
+    return (module.scheduler.cores[SCHEDULER_CORE_ID()].current_p);
 }
 
 int thrd_set_name(const char *name_p)
@@ -723,21 +1594,121 @@ int thrd_set_log_mask(struct thrd_t *thrd_p, int mask)
 
 int thrd_get_log_mask(void)
 {
-    return (module.scheduler.current_p->log_mask);
+    return (thrd_self()->log_mask);
 }
 
 int thrd_set_prio(struct thrd_t *thrd_p, int prio)
 {
     ASSERTN(thrd_p != NULL, EINVAL);
 
+    int res;
+
+    sys_lock();
+    res = thrd_set_prio_isr(thrd_p, prio);
+    sys_unlock();
+
+    return (res);
+}
+
+int thrd_set_prio_isr(struct thrd_t *thrd_p, int prio)
+{
+    ASSERTN(thrd_p != NULL, EINVAL);
+
+#if CONFIG_MUTEX_PRIO_INHERIT == 1
+    /* Keeps any priority inherited from waiters of held mutexes. */
+    mutex_set_prio_isr(thrd_p, prio);
+#else
+    thrd_set_effective_prio_isr(thrd_p, prio);
+#endif
+
+    return (0);
+}
+
+int thrd_set_effective_prio_isr(struct thrd_t *thrd_p, int prio)
+{
+    ASSERTN(thrd_p != NULL, EINVAL);
+
+    struct thrd_prio_list_t *ready_p;
+
+    if (thrd_p->prio == prio) {
+        return (0);
+    }
+
+    SCHEDULER_LOCK();
+
+    if (thrd_p->state == THRD_STATE_READY) {
+#if CONFIG_THRD_SMP == 1
+        ready_p = &module.scheduler.cores[thrd_p->core].ready;
+#else
+        ready_p = &module.scheduler.cores[0].ready;
+#endif
+
+        if (thrd_prio_list_remove_isr(ready_p,
+                                      &thrd_p->scheduler.elem) == 0) {
+            thrd_p->prio = prio;
+            thrd_prio_list_push_isr(ready_p, &thrd_p->scheduler.elem);
+            SCHEDULER_UNLOCK();
+
+            return (0);
+        }
+    }
+
     thrd_p->prio = prio;
+    SCHEDULER_UNLOCK();
 
     return (0);
 }
 
 int thrd_get_prio(void)
 {
-    return (module.scheduler.current_p->prio);
+    return (thrd_self()->prio);
+}
+
+int thrd_set_affinity(struct thrd_t *thrd_p, uint32_t mask)
+{
+    ASSERTN(thrd_p != NULL, EINVAL);
+
+    mask &= SCHEDULER_CORES_MASK;
+
+    if (mask == 0) {
+        return (-EINVAL);
+    }
+
+#if CONFIG_THRD_SMP == 1
+    sys_lock();
+    SCHEDULER_LOCK();
+
+    thrd_p->affinity = mask;
+
+    /* Move a ready thread to an allowed core. */
+    if ((thrd_p->state == THRD_STATE_READY)
+        && ((mask & (1UL << thrd_p->core)) == 0)) {
+        if (thrd_prio_list_remove_isr(
+                &module.scheduler.cores[thrd_p->core].ready,
+                &thrd_p->scheduler.elem) == 0) {
+            scheduler_ready_push(thrd_p);
+        }
+    }
+
+    SCHEDULER_UNLOCK();
+    sys_unlock();
+#endif
+
+    return (0);
+}
+
+int thrd_get_core(void)
+{
+    return (SCHEDULER_CORE_ID());
+}
+
+struct thrd_t *thrd_get_current_isr(int core)
+{
+    if ((core < 0) || (core >= SCHEDULER_CORES)) {
+        return (NULL);
+    }
+
+    return (module.scheduler.cores[core].current_p);
 }
 
 int thrd_init_global_env(struct thrd_environment_variable_t *variables_p,
@@ -794,9 +1765,9 @@ int thrd_init_env(struct thrd_environment_variable_t *variables_p,
                   int length)
 {
 #if CONFIG_THRD_ENV == 1
-    module.scheduler.current_p->env.variables_p = variables_p;
-    module.scheduler.current_p->env.number_of_variables = 0;
-    module.scheduler.current_p->env.max_number_of_variables = length;
+    thrd_self()->env.variables_p = variables_p;
+    thrd_self()->env.number_of_variables = 0;
+    thrd_self()->env.max_number_of_variables = length;
 
     return (0);
 #else
@@ -809,7 +1780,7 @@ int thrd_set_env(const char *name_p, const char *value_p)
     ASSERTN(name_p != NULL, EINVAL);
 
 #if CONFIG_THRD_ENV == 1
-    return (set_env(&module.scheduler.current_p->env, name_p, value_p));
+    return (set_env(&thrd_self()->env, name_p, value_p));
 #else
     return (-1);
 #endif
@@ -822,7 +1793,7 @@ const char *thrd_get_env(const char *name_p)
 #if CONFIG_THRD_ENV == 1
     const char *value_p;
 
-    value_p = get_env(&module.scheduler.current_p->env, name_p);
+    value_p = get_env(&thrd_self()->env, name_p);
 
     if (value_p != NULL) {
         return (value_p);
@@ -850,6 +1821,8 @@ int thrd_suspend_isr(const struct time_t *timeout_p)
 
     thrd_p = thrd_self();
 
+    SCHEDULER_LOCK();
+
     /* Immediatly return if the thread is already resumed. */
     if (thrd_p->state == THRD_STATE_RESUMED) {
         thrd_p->state = THRD_STATE_READY;
@@ -859,6 +1832,10 @@ int thrd_suspend_isr(const struct time_t *timeout_p)
 
         if (timeout_p != NULL) {
             if ((timeout_p->seconds <= 0) && (timeout_p->nanoseconds <= 0)) {
+                /* The thread keeps running. */
+                thrd_p->state = THRD_STATE_CURRENT;
+                SCHEDULER_UNLOCK();
+
                 return (-ETIMEDOUT);
             } else {
                 PANIC_ASSERT(thrd_p->timer_p == NULL);
@@ -885,8 +1862,16 @@ int thrd_resume_isr(struct thrd_t *thrd_p, int err)
     res = 0;
     thrd_p->err = err;
 
+    SCHEDULER_LOCK();
+
     if (thrd_p->state == THRD_STATE_SUSPENDED) {
         thrd_p->state = THRD_STATE_READY;
+#if CONFIG_THRD_TRACE == 1
+        trace_write(THRD_TRACE_TYPE_RESUME, thrd_p, err);
+#endif
+#if CONFIG_THRD_HISTOGRAMS == 1
+        histograms_resume(thrd_p);
+#endif
 
         if (thrd_p->timer_p != NULL) {
             err = timer_stop_isr(thrd_p->timer_p);
@@ -901,13 +1886,16 @@ int thrd_resume_isr(struct thrd_t *thrd_p, int err)
         res = -1;
     }
 
+    SCHEDULER_UNLOCK();
+
     return (res);
 }
 
 int thrd_yield_isr(void)
 {
-    module.scheduler.current_p->state = THRD_STATE_READY;
-    scheduler_ready_push(module.scheduler.current_p);
+    SCHEDULER_LOCK();
+    thrd_self()->state = THRD_STATE_READY;
+    scheduler_ready_push(thrd_self());
     thrd_reschedule();
 
     return (0);
@@ -941,6 +1929,137 @@ const void *thrd_get_top_of_stack(struct thrd_t *thrd_p)
     return (thrd_port_get_top_of_stack(thrd_p));
 }
 
+#if CONFIG_THRD_PRIO_LIST_BITMAP == 1
+
+int thrd_prio_list_init(struct thrd_prio_list_t *self_p)
+{
+    int i;
+
+    self_p->bitmap = 0;
+
+    for (i = 0; i < THRD_PRIO_LIST_LEVELS; i++) {
+        self_p->tails[i] = NULL;
+    }
+
+    return (0);
+}
+
+RAM_CODE void thrd_prio_list_push_isr(struct thrd_prio_list_t *self_p,
+                                      struct thrd_prio_list_elem_t *elem_p)
+{
+    struct thrd_prio_list_elem_t *tail_p;
+    struct thrd_prio_list_elem_t *prev_p;
+    int level;
+    int prio;
+
+    prio = elem_p->thrd_p->prio;
+    elem_p->prio = prio;
+    level = PRIO_LIST_LEVEL(prio);
+    tail_p = self_p->tails[level];
+
+    if (tail_p == NULL) {
+        /* Empty level. */
+        elem_p->next_p = elem_p;
+        self_p->tails[level] = elem_p;
+        self_p->bitmap |= PRIO_LIST_LEVEL_BIT(level);
+    } else if (prio >= tail_p->prio) {
+        /* Append to the level FIFO, the common case. */
+        elem_p->next_p = tail_p->next_p;
+        tail_p->next_p = elem_p;
+        self_p->tails[level] = elem_p;
+    } else {
+        /* Insert before the first element with lower priority. There
+           is always one since the tail element has lower
+           priority. */
+        prev_p = tail_p;
+
+        while (prev_p->next_p->prio <= prio) {
+            prev_p = prev_p->next_p;
+        }
+
+        elem_p->next_p = prev_p->next_p;
+        prev_p->next_p = elem_p;
+    }
+}
+
+RAM_CODE struct thrd_prio_list_elem_t *thrd_prio_list_pop_isr(
+    struct thrd_prio_list_t *self_p)
+{
+    struct thrd_prio_list_elem_t *tail_p;
+    struct thrd_prio_list_elem_t *elem_p;
+    int level;
+
+    if (self_p->bitmap == 0) {
+        return (NULL);
+    }
+
+    level = bits_clz_32(self_p->bitmap);
+    tail_p = self_p->tails[level];
+    elem_p = tail_p->next_p;
+
+    if (elem_p == tail_p) {
+        self_p->tails[level] = NULL;
+        self_p->bitmap &= ~PRIO_LIST_LEVEL_BIT(level);
+    } else {
+        tail_p->next_p = elem_p->next_p;
+    }
+
+    return (elem_p);
+}
+
+RAM_CODE struct thrd_prio_list_elem_t *thrd_prio_list_peek_isr(
+    struct thrd_prio_list_t *self_p)
+{
+    if (self_p->bitmap == 0) {
+        return (NULL);
+    }
+
+    return (self_p->tails[bits_clz_32(self_p->bitmap)]->next_p);
+}
+
+RAM_CODE int thrd_prio_list_remove_isr(struct thrd_prio_list_t *self_p,
+                                       struct thrd_prio_list_elem_t *elem_p)
+{
+    struct thrd_prio_list_elem_t *tail_p;
+    struct thrd_prio_list_elem_t *prev_p;
+    int level;
+
+    level = PRIO_LIST_LEVEL(elem_p->prio);
+    tail_p = self_p->tails[level];
+
+    if (tail_p == NULL) {
+        return (-1);
+    }
+
+    prev_p = tail_p;
+
+    do {
+        if (prev_p->next_p == elem_p) {
+            if (elem_p == tail_p) {
+                if (prev_p == elem_p) {
+                    /* Last element in the level. */
+                    self_p->tails[level] = NULL;
+                    self_p->bitmap &= ~PRIO_LIST_LEVEL_BIT(level);
+
+                    return (0);
+                }
+
+                self_p->tails[level] = prev_p;
+            }
+
+            prev_p->next_p = elem_p->next_p;
+
+            return (0);
+        }
+
+        prev_p = prev_p->next_p;
+    } while (prev_p != tail_p);
+
+    return (-1);
+}
+
+#else
+
 int thrd_prio_list_init(struct thrd_prio_list_t *self_p)
 {
     self_p->head_p = NULL;
@@ -1005,6 +2124,12 @@ RAM_CODE struct thrd_prio_list_elem_t *thrd_prio_list_pop_isr(
     return (elem_p);
 }
 
+RAM_CODE struct thrd_prio_list_elem_t *thrd_prio_list_peek_isr(
+    struct thrd_prio_list_t *self_p)
+{
+    return (self_p->head_p);
+}
+
 RAM_CODE int thrd_prio_list_remove_isr(struct thrd_prio_list_t *self_p,
                                        struct thrd_prio_list_elem_t *elem_p)
 {
@@ -1031,3 +2156,5 @@ RAM_CODE int thrd_prio_list_remove_isr(struct thrd_prio_list_t *self_p,
 
     return (-1);
 }
+
+#endif
@@ -70,6 +70,37 @@
     } while (0)
 
 
+/**
+ * Trace entry types.
+ */
+#define THRD_TRACE_TYPE_SWITCH                              0
+#define THRD_TRACE_TYPE_RESUME                              1
+#define THRD_TRACE_TYPE_TIMER                               2
+#define THRD_TRACE_TYPE_ISR_ENTER                           3
+#define THRD_TRACE_TYPE_ISR_EXIT                            4
+
+/**
+ * Record entry to and exit from an interrupt service routine with
+ * given identifier in the trace buffer. Does nothing unless
+ * `CONFIG_THRD_TRACE` is enabled.
+ */
+#if CONFIG_THRD_TRACE == 1
+#    define THRD_TRACE_ISR_ENTER(id)                                    \
+    thrd_trace_write_isr(THRD_TRACE_TYPE_ISR_ENTER, NULL, (id))
+#    define THRD_TRACE_ISR_EXIT(id)                                     \
+    thrd_trace_write_isr(THRD_TRACE_TYPE_ISR_EXIT, NULL, (id))
+#else
+#    define THRD_TRACE_ISR_ENTER(id)
+#    define THRD_TRACE_ISR_EXIT(id)
+#endif
+
+/**
+ * Number of bins in each thread histogram. Bin zero counts times of
+ * zero microseconds, and bin N counts times from 2^(N-1) up to 2^N
+ * microseconds. The last bin also counts all longer times.
+ */
+#define THRD_HISTOGRAM_BINS                                20
+
 /**
  * A thread environment variable.
  */
@@ -111,6 +142,18 @@ struct thrd_t {
 #endif
 #if CONFIG_THRD_SCHEDULED == 1
         uint32_t scheduled;
+#endif
+#if CONFIG_THRD_HISTOGRAMS == 1
+        struct {
+            /* Time of the last state change in microseconds. */
+            uint32_t timestamp;
+            /** Time from ready until running. */
+            uint32_t latency[THRD_HISTOGRAM_BINS];
+            /** Time running before switched out. */
+            uint32_t run[THRD_HISTOGRAM_BINS];
+            /** Time suspended before resumed. */
+            uint32_t blocked[THRD_HISTOGRAM_BINS];
+        } histograms;
 #endif
     } statistics;
 #if CONFIG_THRD_ENV == 1
@@ -120,6 +163,40 @@ struct thrd_t {
 #if CONFIG_PANIC_ASSERT == 1
     uint16_t stack_low_magic;
 #endif
+#if CONFIG_THRD_SMP == 1
+    uint32_t affinity;
+    int8_t core;
+#endif
+#if CONFIG_MUTEX_PRIO_INHERIT == 1
+    struct {
+        /* Priority without inheritance. */
+        int8_t prio;
+        /* Mutex the thread waits for, and its wait list element. */
+        struct mutex_t *waiting_for_p;
+        struct thrd_prio_list_elem_t *elem_p;
+        /* List of held mutexes. */
+        struct mutex_t *held_p;
+    } mutex;
+#endif
+#if CONFIG_RCU == 1
+    struct {
+        /* Read-side critical section nesting depth. */
+        int8_t nesting;
+        int8_t state;
+        /* Next thread switched out in a read-side critical
+           section. */
+        struct thrd_t *next_p;
+    } rcu;
+#endif
+#if CONFIG_HEAP_MAGAZINES == 1
+    struct {
+        /* Attached heap and its generation when attached. */
+        struct heap_t *heap_p;
+        uint32_t generation;
+        /* Fixed size buffer caches, allocated from the heap. */
+        struct heap_magazines_t *magazines_p;
+    } heap;
+#endif
 };
 
 /**
@@ -286,6 +363,16 @@ int thrd_get_log_mask(void);
  */
 int thrd_set_prio(struct thrd_t *thrd_p, int prio);
 
+/**
+ * Set the priority of given thread with the system lock taken.
+ *
+ * @param[in] thrd_p Thread to set the priority for.
+ * @param[in] prio Priority.
+ *
+ * @return zero(0) or negative error code.
+ */
+int thrd_set_prio_isr(struct thrd_t *thrd_p, int prio);
+
 /**
  * Get the priority of the current thread.
  *
@@ -293,6 +380,49 @@ int thrd_set_prio(struct thrd_t *thrd_p, int prio);
  */
 int thrd_get_prio(void);
 
+/**
+ * Set the priority given thread is scheduled with, without changing
+ * the priority set with `thrd_set_prio()`. A thread in the ready
+ * queue is moved to its new position. Used by mutex priority
+ * inheritance. Must be called with the system lock taken.
+ *
+ * @param[in] thrd_p Thread to set the effective priority for.
+ * @param[in] prio Effective priority.
+ *
+ * @return zero(0) or negative error code.
+ */
+int thrd_set_effective_prio_isr(struct thrd_t *thrd_p, int prio);
+
+/**
+ * Set the cores given thread may run on. Bit N in the mask
+ * represents core N. A thread currently running on a core not in the
+ * mask is moved the next time it is scheduled. Without
+ * `CONFIG_THRD_SMP` there is only core 0.
+ *
+ * @param[in] thrd_p Thread to set the affinity for.
+ * @param[in] mask Core mask. At least one existing core must be set.
+ *
+ * @return zero(0) or negative error code.
+ */
+int thrd_set_affinity(struct thrd_t *thrd_p, uint32_t mask);
+
+/**
+ * Get the core the current thread is running on.
+ *
+ * @return Core number, always zero(0) without `CONFIG_THRD_SMP`.
+ */
+int thrd_get_core(void);
+
+/**
+ * Get the thread currently running on given core. Must be called
+ * from isr or with the system lock taken.
+ *
+ * @param[in] core Core number.
+ *
+ * @return The running thread, or NULL if there is no such core.
+ */
+struct thrd_t *thrd_get_current_isr(int core);
+
 /**
  * Initialize the global environment variables storage. These
  * variables are shared among all threads.
@@ -428,16 +558,110 @@ const void *thrd_get_bottom_of_stack(struct thrd_t *thrd_p);
  */
 const void *thrd_get_top_of_stack(struct thrd_t *thrd_p);
 
+#if CONFIG_THRD_HISTOGRAMS == 1
+
+/**
+ * Print the histograms of given thread.
+ *
+ * @param[in] thrd_p Thread to print the histograms of.
+ * @param[in] chan_p Output channel.
+ *
+ * @return zero(0) or negative error code.
+ */
+int thrd_histograms_print(struct thrd_t *thrd_p, void *chan_p);
+
+/**
+ * Clear the histograms of given thread.
+ *
+ * @param[in] thrd_p Thread to clear the histograms of.
+ *
+ * @return zero(0) or negative error code.
+ */
+int thrd_histograms_clear(struct thrd_t *thrd_p);
+
+#endif
+
+#if CONFIG_THRD_TRACE == 1
+
+/**
+ * A trace entry.
+ */
+struct thrd_trace_entry_t {
+    /** Time since startup in microseconds. 64 bits, so it does not
+        wrap. */
+    uint64_t timestamp;
+    uint8_t type;
+    int8_t core;
+    /** Thread switched in or resumed. */
+    struct thrd_t *thrd_p;
+    /** Thread switched out, resume error code, expired timer
+        callback or interrupt identifier. */
+    uintptr_t arg;
+};
+
+/**
+ * Add an entry to the trace buffer. May only be called from isr or
+ * with the system lock taken, which protects the buffer. With SMP the
+ * scheduler lock is also taken.
+ *
+ * @param[in] type Entry type.
+ * @param[in] thrd_p Thread, or NULL.
+ * @param[in] arg Entry type specific argument.
+ *
+ * @return void.
+ */
+void thrd_trace_write_isr(int type, struct thrd_t *thrd_p, uintptr_t arg);
+
+/**
+ * Read entries from the trace buffer, oldest first. Recording is
+ * paused while reading.
+ *
+ * @param[out] entries_p Entries read.
+ * @param[in] length Maximum number of entries to read.
+ *
+ * @return Number of read entries.
+ */
+int thrd_trace_read(struct thrd_trace_entry_t *entries_p, int length);
+
+/**
+ * Remove all entries from the trace buffer.
+ *
+ * @return zero(0) or negative error code.
+ */
+int thrd_trace_clear(void);
+
+/**
+ * Print the trace buffer, oldest entry first, as a table.
+ *
+ * @param[in] chan_p Output channel.
+ *
+ * @return zero(0) or negative error code.
+ */
+int thrd_trace_print(void *chan_p);
+
+/**
+ * Print the trace buffer in the Chrome trace event JSON format, which
+ * can be loaded into trace viewers like chrome://tracing and
+ * Perfetto. Each thread run is a complete event, and resumes, timer
+ * expiries and interrupts are instant and duration events.
+ *
+ * @param[in] chan_p Output channel.
+ *
+ * @return zero(0) or negative error code.
+ */
+int thrd_trace_print_chrome(void *chan_p);
+
+#endif
+
 /**
  * Initialize given prio list.
  */
 int thrd_prio_list_init(struct thrd_prio_list_t *self_p);
 
 /**
- * Push given element on given priority list. The priority list is a
- * linked list with the highest priority thread first. The pushed
- * element is added _after_ any already pushed elements with the same
- * thread priority.
+ * Push given element on given priority list. The highest priority
+ * thread is popped first. The pushed element is added _after_ any
+ * already pushed elements with the same thread priority.
  *
  * @param[in] self_p Priority list to push on.
  * @param[in] elem_p Element to push.
@@ -457,6 +681,18 @@ void thrd_prio_list_push_isr(struct thrd_prio_list_t *self_p,
 struct thrd_prio_list_elem_t *thrd_prio_list_pop_isr(
     struct thrd_prio_list_t *self_p);
 
+/**
+ * Get the element with the highest priority in given priority list
+ * without removing it.
+ *
+ * @param[in] self_p Priority list to peek into.
+ *
+ * @return Element with the highest priority, or NULL if the list is
+ *         empty.
+ */
+struct thrd_prio_list_elem_t *thrd_prio_list_peek_isr(
+    struct thrd_prio_list_t *self_p);
+
 /**
  * Remove given element from given priority list.
  *
@@ -0,0 +1,265 @@
+/**
+ * @section License
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014-2017, Erik Moqvist
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * This file is part of the Simba project.
+ */
+
+#if CONFIG_THRD_FS_COMMANDS == 1
+
+#define LATENCY_COUNTER_INIT(bin)                                       \
+    fs_counter_init(&histograms.latency_counters[bin],                  \
+                    CSTR("/kernel/thrd/latency/" #bin),                 \
+                    0);                                                 \
+    fs_counter_register(&histograms.latency_counters[bin])
+
+struct histograms_t {
+    struct fs_command_t cmd_histograms;
+    /* Scheduling latency of all threads. */
+    struct fs_counter_t latency_counters[THRD_HISTOGRAM_BINS];
+};
+
+static struct histograms_t histograms;
+
+#endif
+
+/**
+ * Monotonic time in microseconds, wrapping at 2^32. time_micros() is
+ * not used as it wraps every second on Linux and is not implemented
+ * by all ports.
+ */
+static uint32_t histograms_now(void)
+{
+#if defined(ARCH_LINUX)
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint32_t)now.tv_sec * 1000000UL + now.tv_nsec / 1000);
+#else
+    struct time_t now;
+
+    sys_uptime_isr(&now);
+
+    return ((uint32_t)now.seconds * 1000000UL + now.nanoseconds / 1000);
+#endif
+}
+
+/**
+ * Histogram bin of given time in microseconds.
+ */
+static int histograms_bin(uint32_t elapsed)
+{
+    int bin;
+
+    if (elapsed == 0) {
+        return (0);
+    }
+
+    bin = (32 - bits_clz_32(elapsed));
+
+    if (bin >= THRD_HISTOGRAM_BINS) {
+        bin = (THRD_HISTOGRAM_BINS - 1);
+    }
+
+    return (bin);
+}
+
+static void histograms_reset(struct thrd_t *thrd_p)
+{
+    memset(&thrd_p->statistics.histograms.latency[0],
+           0,
+           sizeof(thrd_p->statistics.histograms.latency));
+    memset(&thrd_p->statistics.histograms.run[0],
+           0,
+           sizeof(thrd_p->statistics.histograms.run));
+    memset(&thrd_p->statistics.histograms.blocked[0],
+           0,
+           sizeof(thrd_p->statistics.histograms.blocked));
+}
+
+static void histograms_init(struct thrd_t *thrd_p)
+{
+    histograms_reset(thrd_p);
+    thrd_p->statistics.histograms.timestamp = histograms_now();
+}
+
+/**
+ * Update the histograms when switching from given out thread to
+ * given in thread.
+ */
+static void histograms_switch(struct thrd_t *in_p, struct thrd_t *out_p)
+{
+    uint32_t now;
+    int bin;
+
+    now = histograms_now();
+
+    bin = histograms_bin(now - out_p->statistics.histograms.timestamp);
+    out_p->statistics.histograms.run[bin]++;
+    out_p->statistics.histograms.timestamp = now;
+
+    bin = histograms_bin(now - in_p->statistics.histograms.timestamp);
+    in_p->statistics.histograms.latency[bin]++;
+    in_p->statistics.histograms.timestamp = now;
+
+#if CONFIG_THRD_FS_COMMANDS == 1
+    histograms.latency_counters[bin].value++;
+#endif
+}
+
+/**
+ * Update the histograms when given suspended thread is resumed.
+ */
+static void histograms_resume(struct thrd_t *thrd_p)
+{
+    uint32_t now;
+    int bin;
+
+    now = histograms_now();
+    bin = histograms_bin(now - thrd_p->statistics.histograms.timestamp);
+    thrd_p->statistics.histograms.blocked[bin]++;
+    thrd_p->statistics.histograms.timestamp = now;
+}
+
+#if CONFIG_THRD_FS_COMMANDS == 1
+
+static int cmd_histograms_cb(int argc,
+                             const char *argv[],
+                             void *chout_p,
+                             void *chin_p,
+                             void *arg_p,
+                             void *call_arg_p)
+{
+    struct thrd_t *thrd_p;
+
+    if (argc == 1) {
+        for (thrd_p = module.threads_p;
+             thrd_p != NULL;
+             thrd_p = thrd_p->next_p) {
+            thrd_histograms_print(thrd_p, chout_p);
+        }
+    } else if (argc == 2) {
+        thrd_p = thrd_get_by_name(argv[1]);
+
+        if (thrd_p == NULL) {
+            return (-ESRCH);
+        }
+
+        thrd_histograms_print(thrd_p, chout_p);
+    } else {
+        std_fprintf(chout_p, OSTR("Usage: histograms [<thread name>]\r\n"));
+
+        return (-EINVAL);
+    }
+
+    return (0);
+}
+
+#endif
+
+static void histograms_module_init(void)
+{
+#if CONFIG_THRD_FS_COMMANDS == 1
+    fs_command_init(&histograms.cmd_histograms,
+                    CSTR("/kernel/thrd/histograms"),
+                    cmd_histograms_cb,
+                    NULL);
+    fs_command_register(&histograms.cmd_histograms);
+
+    LATENCY_COUNTER_INIT(0);
+    LATENCY_COUNTER_INIT(1);
+    LATENCY_COUNTER_INIT(2);
+    LATENCY_COUNTER_INIT(3);
+    LATENCY_COUNTER_INIT(4);
+    LATENCY_COUNTER_INIT(5);
+    LATENCY_COUNTER_INIT(6);
+    LATENCY_COUNTER_INIT(7);
+    LATENCY_COUNTER_INIT(8);
+    LATENCY_COUNTER_INIT(9);
+    LATENCY_COUNTER_INIT(10);
+    LATENCY_COUNTER_INIT(11);
+    LATENCY_COUNTER_INIT(12);
+    LATENCY_COUNTER_INIT(13);
+    LATENCY_COUNTER_INIT(14);
+    LATENCY_COUNTER_INIT(15);
+    LATENCY_COUNTER_INIT(16);
+    LATENCY_COUNTER_INIT(17);
+    LATENCY_COUNTER_INIT(18);
+    LATENCY_COUNTER_INIT(19);
+#endif
+}
+
+int thrd_histograms_print(struct thrd_t *thrd_p, void *chan_p)
+{
+    ASSERTN(thrd_p != NULL, EINVAL);
+    ASSERTN(chan_p != NULL, EINVAL);
+
+    int i;
+    unsigned long lower;
+    unsigned long upper;
+
+    std_fprintf(chan_p,
+                OSTR("%s\r\n"
+                     "               RANGE-US      LATENCY          RUN"
+                     "      BLOCKED\r\n"),
+                thrd_p->name_p);
+
+    for (i = 0; i < THRD_HISTOGRAM_BINS; i++) {
+        if (i == 0) {
+            lower = 0;
+            upper = 0;
+        } else {
+            lower = (1UL << (i - 1));
+            upper = ((1UL << i) - 1);
+        }
+
+        if (i == THRD_HISTOGRAM_BINS - 1) {
+            std_fprintf(chan_p, OSTR("%15lu-       "), lower);
+        } else {
+            std_fprintf(chan_p, OSTR("%15lu-%-7lu"), lower, upper);
+        }
+
+        std_fprintf(chan_p,
+                    OSTR("%12lu %12lu %12lu\r\n"),
+                    (unsigned long)thrd_p->statistics.histograms.latency[i],
+                    (unsigned long)thrd_p->statistics.histograms.run[i],
+                    (unsigned long)thrd_p->statistics.histograms.blocked[i]);
+    }
+
+    return (0);
+}
+
+int thrd_histograms_clear(struct thrd_t *thrd_p)
+{
+    ASSERTN(thrd_p != NULL, EINVAL);
+
+    sys_lock();
+    histograms_reset(thrd_p);
+    sys_unlock();
+
+    return (0);
+}
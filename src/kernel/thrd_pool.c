@@ -0,0 +1,278 @@
+/**
+ * @section License
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017, Erik Moqvist
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+enum thrd_pool_job_state_t {
+    THRD_POOL_JOB_STATE_IDLE = 0,
+    THRD_POOL_JOB_STATE_QUEUED,
+    THRD_POOL_JOB_STATE_EXECUTING,
+    THRD_POOL_JOB_STATE_DONE
+};
+
+/**
+ * Insert given job in the queue after all jobs with the same or
+ * higher priority.
+ */
+static void queue_insert_isr(struct thrd_pool_t *self_p,
+                             struct thrd_pool_job_t *job_p)
+{
+    struct thrd_pool_job_t **job_pp;
+
+    job_pp = &self_p->head_p;
+
+    while ((*job_pp != NULL) && ((*job_pp)->prio <= job_p->prio)) {
+        job_pp = &(*job_pp)->next_p;
+    }
+
+    job_p->next_p = *job_pp;
+    *job_pp = job_p;
+    self_p->length++;
+}
+
+static struct thrd_pool_job_t *queue_pop_isr(struct thrd_pool_t *self_p)
+{
+    struct thrd_pool_job_t *job_p;
+
+    job_p = self_p->head_p;
+    self_p->head_p = job_p->next_p;
+    self_p->length--;
+
+    return (job_p);
+}
+
+static void *worker_main(void *arg_p)
+{
+    struct thrd_pool_t *self_p;
+    struct thrd_pool_job_t *job_p;
+    struct thrd_prio_list_elem_t elem;
+    struct thrd_prio_list_elem_t *elem_p;
+    void *res_p;
+
+    thrd_set_name("thrd_pool");
+
+    self_p = arg_p;
+    elem.thrd_p = thrd_self();
+
+    while (1) {
+        sys_lock();
+
+        while (self_p->head_p == NULL) {
+            thrd_prio_list_push_isr(&self_p->workers, &elem);
+            thrd_suspend_isr(NULL);
+        }
+
+        job_p = queue_pop_isr(self_p);
+        job_p->state = THRD_POOL_JOB_STATE_EXECUTING;
+
+        /* There is space in the queue for a waiting writer. */
+        elem_p = thrd_prio_list_pop_isr(&self_p->writers);
+
+        if (elem_p != NULL) {
+            thrd_resume_isr(elem_p->thrd_p, 0);
+        }
+
+        sys_unlock();
+
+        thrd_set_prio(thrd_self(), job_p->prio);
+        res_p = job_p->main(job_p->arg_p);
+
+        sys_lock();
+        job_p->res_p = res_p;
+        job_p->state = THRD_POOL_JOB_STATE_DONE;
+
+        if (job_p->waiter_p != NULL) {
+            thrd_resume_isr(job_p->waiter_p, 0);
+            job_p->waiter_p = NULL;
+        }
+
+        sys_unlock();
+    }
+
+    return (NULL);
+}
+
+int thrd_pool_init(struct thrd_pool_t *self_p,
+                   void *stacks_p,
+                   size_t stack_size,
+                   int number_of_workers,
+                   size_t length_max)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(stacks_p != NULL, EINVAL);
+    ASSERTN(number_of_workers > 0, EINVAL);
+    ASSERTN(length_max > 0, EINVAL);
+
+    int i;
+
+    self_p->head_p = NULL;
+    self_p->length = 0;
+    self_p->length_max = length_max;
+    thrd_prio_list_init(&self_p->workers);
+    thrd_prio_list_init(&self_p->writers);
+
+    for (i = 0; i < number_of_workers; i++) {
+        if (thrd_spawn(worker_main,
+                       self_p,
+                       0,
+                       (char *)stacks_p + i * stack_size,
+                       stack_size) == NULL) {
+            return (-1);
+        }
+    }
+
+    return (0);
+}
+
+int thrd_pool_job_init(struct thrd_pool_job_t *job_p,
+                       void *(*main)(void *arg_p),
+                       void *arg_p,
+                       int prio)
+{
+    ASSERTN(job_p != NULL, EINVAL);
+    ASSERTN(main != NULL, EINVAL);
+
+    job_p->main = main;
+    job_p->arg_p = arg_p;
+    job_p->prio = prio;
+    job_p->state = THRD_POOL_JOB_STATE_IDLE;
+    job_p->res_p = NULL;
+    job_p->waiter_p = NULL;
+    job_p->next_p = NULL;
+
+    return (0);
+}
+
+int thrd_pool_submit(struct thrd_pool_t *self_p,
+                     struct thrd_pool_job_t *job_p,
+                     const struct time_t *timeout_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(job_p != NULL, EINVAL);
+
+    int err;
+    struct thrd_prio_list_elem_t elem;
+    struct thrd_prio_list_elem_t *elem_p;
+
+    err = 0;
+
+    sys_lock();
+
+    if ((job_p->state == THRD_POOL_JOB_STATE_QUEUED)
+        || (job_p->state == THRD_POOL_JOB_STATE_EXECUTING)) {
+        err = -EBUSY;
+    }
+
+    /* Wait for space in the queue. */
+    while ((err == 0) && (self_p->length == self_p->length_max)) {
+        if ((timeout_p != NULL)
+            && (timeout_p->seconds == 0)
+            && (timeout_p->nanoseconds == 0)) {
+            err = -ETIMEDOUT;
+        } else {
+            elem.thrd_p = thrd_self();
+            thrd_prio_list_push_isr(&self_p->writers, &elem);
+            err = thrd_suspend_isr(timeout_p);
+
+            if (err == -ETIMEDOUT) {
+                thrd_prio_list_remove_isr(&self_p->writers, &elem);
+            }
+        }
+    }
+
+    if (err == 0) {
+        job_p->state = THRD_POOL_JOB_STATE_QUEUED;
+        job_p->res_p = NULL;
+        queue_insert_isr(self_p, job_p);
+
+        /* Wake up an idle worker, already at the job priority. */
+        elem_p = thrd_prio_list_pop_isr(&self_p->workers);
+
+        if (elem_p != NULL) {
+            thrd_set_prio_isr(elem_p->thrd_p, job_p->prio);
+            thrd_resume_isr(elem_p->thrd_p, 0);
+        }
+    }
+
+    sys_unlock();
+
+    return (err);
+}
+
+int thrd_pool_job_wait(struct thrd_pool_job_t *job_p,
+                       const struct time_t *timeout_p)
+{
+    ASSERTN(job_p != NULL, EINVAL);
+
+    int err;
+
+    err = 0;
+
+    sys_lock();
+
+    /* A job that was never submitted will never be done. */
+    if (job_p->state == THRD_POOL_JOB_STATE_IDLE) {
+        err = -EINVAL;
+    } else if (job_p->state != THRD_POOL_JOB_STATE_DONE) {
+        if (job_p->waiter_p != NULL) {
+            /* Only one thread may wait for a job. */
+            err = -EBUSY;
+        } else if ((timeout_p != NULL)
+            && (timeout_p->seconds == 0)
+            && (timeout_p->nanoseconds == 0)) {
+            err = -ETIMEDOUT;
+        } else {
+            job_p->waiter_p = thrd_self();
+            err = thrd_suspend_isr(timeout_p);
+
+            if (err == -ETIMEDOUT) {
+                job_p->waiter_p = NULL;
+            }
+        }
+    }
+
+    sys_unlock();
+
+    return (err);
+}
+
+int thrd_pool_job_is_done(struct thrd_pool_job_t *job_p)
+{
+    ASSERTN(job_p != NULL, EINVAL);
+
+    return (job_p->state == THRD_POOL_JOB_STATE_DONE);
+}
+
+size_t thrd_pool_length(struct thrd_pool_t *self_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+
+    return (self_p->length);
+}
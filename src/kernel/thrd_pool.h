@@ -0,0 +1,151 @@
+/**
+ * @section License
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017, Erik Moqvist
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * This file is part of the Simba project.
+ */
+
+#ifndef __KERNEL_THRD_POOL_H__
+#define __KERNEL_THRD_POOL_H__
+
+#include "simba.h"
+
+/**
+ * A job executed by a worker thread in a thread pool.
+ */
+struct thrd_pool_job_t {
+    void *(*main)(void *arg_p);
+    void *arg_p;
+    int prio;
+    int8_t state;
+    /** Return value of the main function, valid once the job is
+        done. */
+    void *res_p;
+    struct thrd_t *waiter_p;
+    struct thrd_pool_job_t *next_p;
+};
+
+/**
+ * A pool of worker threads executing jobs from a shared queue.
+ */
+struct thrd_pool_t {
+    struct thrd_pool_job_t *head_p;
+    size_t length;
+    size_t length_max;
+    struct thrd_prio_list_t workers;
+    struct thrd_prio_list_t writers;
+};
+
+/**
+ * Initialize given thread pool and spawn its worker threads. The
+ * workers share the job queue, and each executes one job at a time.
+ *
+ * @param[in] self_p Thread pool to initialize.
+ * @param[in] stacks_p Worker thread stacks, an array of
+ *                     `number_of_workers` stacks created with
+ *                     `THRD_STACK()`.
+ * @param[in] stack_size Size of each stack in number of bytes.
+ * @param[in] number_of_workers Number of worker threads.
+ * @param[in] length_max Maximum number of jobs waiting in the queue.
+ *
+ * @return zero(0) or negative error code.
+ */
+int thrd_pool_init(struct thrd_pool_t *self_p,
+                   void *stacks_p,
+                   size_t stack_size,
+                   int number_of_workers,
+                   size_t length_max);
+
+/**
+ * Initialize given job.
+ *
+ * @param[in] job_p Job to initialize.
+ * @param[in] main Job main function, called by a worker thread.
+ * @param[in] arg_p Argument passed to the main function.
+ * @param[in] prio Job priority, with the same range and meaning as
+ *                 thread priorities. Queued jobs are executed in
+ *                 priority order, and the worker thread executes the
+ *                 job with this priority.
+ *
+ * @return zero(0) or negative error code.
+ */
+int thrd_pool_job_init(struct thrd_pool_job_t *job_p,
+                       void *(*main)(void *arg_p),
+                       void *arg_p,
+                       int prio);
+
+/**
+ * Add given job to the queue of given thread pool. Waits for space
+ * in the queue if it is full. A job may be submitted again once it
+ * is done.
+ *
+ * @param[in] self_p Thread pool.
+ * @param[in] job_p Job to submit.
+ * @param[in] timeout_p Time to wait for space in the queue, or NULL
+ *                      to wait forever.
+ *
+ * @return zero(0), -ETIMEDOUT if the queue is still full after given
+ *         timeout, -EBUSY if the job is already queued or executing,
+ *         or other negative error code.
+ */
+int thrd_pool_submit(struct thrd_pool_t *self_p,
+                     struct thrd_pool_job_t *job_p,
+                     const struct time_t *timeout_p);
+
+/**
+ * Wait for given job to be done. Only one thread may wait for a job
+ * at a time.
+ *
+ * @param[in] job_p Job to wait for.
+ * @param[in] timeout_p Time to wait, or NULL to wait forever.
+ *
+ * @return zero(0), -ETIMEDOUT if the job is not done within given
+ *         timeout, -EINVAL if the job has not been submitted, -EBUSY
+ *         if another thread is already waiting for the job, or other
+ *         negative error code.
+ */
+int thrd_pool_job_wait(struct thrd_pool_job_t *job_p,
+                       const struct time_t *timeout_p);
+
+/**
+ * Check if given job is done.
+ *
+ * @param[in] job_p Job to check.
+ *
+ * @return true(1) if the job is done, otherwise false(0).
+ */
+int thrd_pool_job_is_done(struct thrd_pool_job_t *job_p);
+
+/**
+ * Get the number of jobs waiting in the queue of given thread pool.
+ *
+ * @param[in] self_p Thread pool.
+ *
+ * @return Number of queued jobs.
+ */
+size_t thrd_pool_length(struct thrd_pool_t *self_p);
+
+#endif
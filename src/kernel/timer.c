@@ -30,6 +30,180 @@
 
 #include "simba.h"
 
+#if CONFIG_TIMER_WHEEL == 1
+
+#if (CONFIG_TIMER_WHEEL_SIZE & (CONFIG_TIMER_WHEEL_SIZE - 1)) != 0
+#    error "CONFIG_TIMER_WHEEL_SIZE must be a power of two."
+#endif
+
+#define SLOT_MASK (CONFIG_TIMER_WHEEL_SIZE - 1)
+
+struct module_t {
+    sys_tick_t tick;           /* Current wheel tick. */
+    struct timer_t *slots[CONFIG_TIMER_WHEEL_SIZE]; /* Timers hashed
+                                                       by expiry
+                                                       tick. */
+    struct timer_t *expired_p; /* Timers of the slot being
+                                  processed. */
+    int number_of_timers;      /* Number of active timers. */
+    sys_tick_t next;           /* No active timer expires before
+                                  this tick, which is always after
+                                  the current tick. */
+};
+
+static struct module_t module = {
+    .next = 1
+};
+
+/**
+ * Add given timer first in given list.
+ */
+static void RAM_CODE link_isr(struct timer_t **head_pp,
+                              struct timer_t *timer_p)
+{
+    timer_p->next_p = *head_pp;
+
+    if (timer_p->next_p != NULL) {
+        timer_p->next_p->prev_next_pp = &timer_p->next_p;
+    }
+
+    timer_p->prev_next_pp = head_pp;
+    *head_pp = timer_p;
+}
+
+/**
+ * Remove given timer from the list it is in.
+ */
+static void RAM_CODE unlink_isr(struct timer_t *timer_p)
+{
+    *timer_p->prev_next_pp = timer_p->next_p;
+
+    if (timer_p->next_p != NULL) {
+        timer_p->next_p->prev_next_pp = timer_p->prev_next_pp;
+    }
+
+    timer_p->prev_next_pp = NULL;
+}
+
+/**
+ * Insert given timer in the wheel slot of its expiry tick, given
+ * number of ticks from now.
+ */
+static void RAM_CODE timer_insert_isr(struct timer_t *timer_p,
+                                      sys_tick_t ticks)
+{
+    timer_p->expiry = (module.tick + ticks);
+    link_isr(&module.slots[timer_p->expiry & SLOT_MASK], timer_p);
+    module.number_of_timers++;
+
+    if (ticks < (sys_tick_t)(module.next - module.tick)) {
+        module.next = timer_p->expiry;
+    }
+}
+
+/**
+ * Remove given timer from the wheel.
+ */
+static int RAM_CODE timer_remove_isr(struct timer_t *timer_p)
+{
+    if (timer_p->prev_next_pp == NULL) {
+        return (0);
+    }
+
+    unlink_isr(timer_p);
+    module.number_of_timers--;
+
+    return (1);
+}
+
+void RAM_CODE timer_tick_isr(void)
+{
+    struct timer_t *timer_p;
+    struct timer_t **slot_pp;
+
+    sys_lock_isr();
+
+    module.tick++;
+    slot_pp = &module.slots[module.tick & SLOT_MASK];
+
+    /* Keep the earliest expiry after the current tick. Timers
+       expiring this tick are fired below. */
+    if (module.next == module.tick) {
+        module.next++;
+    }
+
+    if (*slot_pp != NULL) {
+        /* Move all timers in the slot to the expired list. Callbacks
+           may stop any of them, or start timers in this slot. */
+        module.expired_p = *slot_pp;
+        module.expired_p->prev_next_pp = &module.expired_p;
+        *slot_pp = NULL;
+
+        while (module.expired_p != NULL) {
+            timer_p = module.expired_p;
+            unlink_isr(timer_p);
+
+            /* Expires in a later revolution of the wheel. */
+            if (timer_p->expiry != module.tick) {
+                link_isr(slot_pp, timer_p);
+                continue;
+            }
+
+            module.number_of_timers--;
+
+#if CONFIG_THRD_TRACE == 1
+            thrd_trace_write_isr(THRD_TRACE_TYPE_TIMER,
+                                 NULL,
+                                 (uintptr_t)timer_p->callback);
+#endif
+            timer_p->callback(timer_p->arg_p);
+
+            /* Re-set periodic timers. */
+            if (timer_p->flags & TIMER_PERIODIC) {
+                timer_insert_isr(timer_p, timer_p->timeout);
+            }
+        }
+    }
+
+    sys_unlock_isr();
+}
+
+sys_tick_t timer_next_timeout_isr(void)
+{
+    struct timer_t *timer_p;
+    sys_tick_t ticks;
+
+    if (module.number_of_timers == 0) {
+        return (SYS_TICK_MAX);
+    }
+
+    /* Search from the earliest possible expiry. It is the first
+       expiry unless that timer was stopped or has expired, so most
+       searches end in the first slot. */
+    for (ticks = (module.next - module.tick);
+         ticks <= CONFIG_TIMER_WHEEL_SIZE;
+         ticks++) {
+        timer_p = module.slots[(module.tick + ticks) & SLOT_MASK];
+
+        while (timer_p != NULL) {
+            if ((timer_p->expiry - module.tick) == ticks) {
+                module.next = timer_p->expiry;
+
+                return (ticks);
+            }
+
+            timer_p = timer_p->next_p;
+        }
+    }
+
+    /* All timers expire in later revolutions of the wheel. */
+    module.next = (module.tick + ticks);
+
+    return (CONFIG_TIMER_WHEEL_SIZE);
+}
+
+#else
+
 struct module_t {
     struct timer_t *head_p;    /* List of timers sorted by expiry
                                   tick. */
@@ -45,13 +219,17 @@ static struct module_t module = {
 };
 
 /**
- * Insert given timer in the list of active timers.
+ * Insert given timer in the list of active timers, given number of
+ * ticks from now.
  */
-static void RAM_CODE timer_insert_isr(struct timer_t *timer_p)
+static void RAM_CODE timer_insert_isr(struct timer_t *timer_p,
+                                      sys_tick_t ticks)
 {
     struct timer_t *elem_p;
     struct timer_t *prev_p;
 
+    timer_p->delta = ticks;
+
     /* Find element preceeding this timer. */
     elem_p = module.head_p;
     prev_p = NULL;
@@ -83,7 +261,7 @@ static void RAM_CODE timer_insert_isr(struct timer_t *timer_p)
 /**
  * Remove given timer from the list of active timers.
  */
-static int timer_remove_isr(struct timer_t *timer_p)
+static int RAM_CODE timer_remove_isr(struct timer_t *timer_p)
 {
     struct timer_t *elem_p;
     struct timer_t *prev_p;
@@ -116,11 +294,6 @@ static int timer_remove_isr(struct timer_t *timer_p)
     return (0);
 }
 
-int timer_module_init(void)
-{
-    return (0);
-}
-
 void RAM_CODE timer_tick_isr(void)
 {
     struct timer_t *timer_p;
@@ -135,12 +308,16 @@ void RAM_CODE timer_tick_isr(void)
         while (module.head_p->delta == 0) {
             timer_p = module.head_p;
             module.head_p = timer_p->next_p;
+#if CONFIG_THRD_TRACE == 1
+            thrd_trace_write_isr(THRD_TRACE_TYPE_TIMER,
+                                 NULL,
+                                 (uintptr_t)timer_p->callback);
+#endif
             timer_p->callback(timer_p->arg_p);
 
             /* Re-set periodic timers. */
             if (timer_p->flags & TIMER_PERIODIC) {
-                timer_p->delta = timer_p->timeout;
-                timer_insert_isr(timer_p);
+                timer_insert_isr(timer_p, timer_p->timeout);
             }
         }
     }
@@ -148,6 +325,22 @@ void RAM_CODE timer_tick_isr(void)
     sys_unlock_isr();
 }
 
+sys_tick_t timer_next_timeout_isr(void)
+{
+    if (module.head_p == &module.tail_timer) {
+        return (SYS_TICK_MAX);
+    }
+
+    return (module.head_p->delta);
+}
+
+#endif
+
+int timer_module_init(void)
+{
+    return (0);
+}
+
 int timer_init(struct timer_t *self_p,
                const struct time_t *timeout_p,
                timer_callback_t callback,
@@ -167,6 +360,9 @@ int timer_init(struct timer_t *self_p,
     self_p->flags = flags;
     self_p->callback = callback;
     self_p->arg_p = arg_p;
+#if CONFIG_TIMER_WHEEL == 1
+    self_p->prev_next_pp = NULL;
+#endif
 
     return (0);
 }
@@ -187,9 +383,7 @@ int RAM_CODE timer_start_isr(struct timer_t *self_p)
     /* Must wait at least two ticks to ensure the timer does not
        expire early since it may be started close to the next tick
        occurs. */
-    self_p->delta = (self_p->timeout + 1);
-
-    timer_insert_isr(self_p);
+    timer_insert_isr(self_p, self_p->timeout + 1);
 
     return (0);
 }
@@ -207,7 +401,7 @@ int timer_stop(struct timer_t *self_p)
     return (res);
 }
 
-int timer_stop_isr(struct timer_t *self_p)
+int RAM_CODE timer_stop_isr(struct timer_t *self_p)
 {
     return (timer_remove_isr(self_p));
 }
@@ -48,7 +48,12 @@ typedef void (*timer_callback_t)(void *arg_p);
 /* Timer. */
 struct timer_t {
     struct timer_t *next_p;
+#if CONFIG_TIMER_WHEEL == 1
+    struct timer_t **prev_next_pp; /* NULL if not active. */
+    sys_tick_t expiry;
+#else
     sys_tick_t delta;
+#endif
     sys_tick_t timeout;
     int flags;
     timer_callback_t callback;
@@ -126,4 +131,19 @@ int timer_stop(struct timer_t *self_p);
  */
 int timer_stop_isr(struct timer_t *self_p);
 
+/**
+ * Get the number of system ticks until the first active timer
+ * expires. Used by tickless idle to decide how long the system tick
+ * may be stopped.
+ *
+ * This function may only be called from an isr or with the system
+ * lock taken (see `sys_lock()`).
+ *
+ * @return Number of ticks, or `SYS_TICK_MAX` if no timer is
+ *         active. With `CONFIG_TIMER_WHEEL` the wheel size is
+ *         returned if no timer expires within one revolution of the
+ *         wheel.
+ */
+sys_tick_t timer_next_timeout_isr(void);
+
 #endif
@@ -165,10 +165,41 @@ typedef int32_t s32_t;
 struct thrd_prio_list_elem_t {
     struct thrd_prio_list_elem_t *next_p;
     struct thrd_t *thrd_p;
+#if CONFIG_THRD_PRIO_LIST_BITMAP == 1
+    int8_t prio;
+#endif
+};
+
+#if CONFIG_THRD_PRIO_LIST_BITMAP == 1
+
+/**
+ * Number of FIFOs in a priority list, eight thread priorities per
+ * FIFO.
+ */
+#    define THRD_PRIO_LIST_LEVELS 32
+
+/**
+ * A priority list with one circular FIFO per level and a bitmap of
+ * non-empty levels. The most significant bit is the highest priority
+ * level.
+ */
+struct thrd_prio_list_t {
+    uint32_t bitmap;
+    struct thrd_prio_list_elem_t *tails[THRD_PRIO_LIST_LEVELS];
 };
 
+#    define THRD_PRIO_LIST_INIT_STRUCT          \
+    { .bitmap = 0, .tails = { NULL, } }
+
+#else
+
 struct thrd_prio_list_t {
     struct thrd_prio_list_elem_t *head_p;
 };
 
+#    define THRD_PRIO_LIST_INIT_STRUCT          \
+    { .head_p = NULL }
+
+#endif
+
 #endif
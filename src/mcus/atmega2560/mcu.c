@@ -186,10 +186,8 @@ struct spi_device_t spi_device[SPI_DEVICE_MAX] = {
         .mosi_p = &pin_device[10],
         .miso_p = &pin_device[11],
         .mutex = {
-            .is_locked = 0,
-            .waiters = {
-                .head_p = NULL
-            }
+            .owner_p = NULL,
+            .waiters = THRD_PRIO_LIST_INIT_STRUCT
         }
     }
 };
@@ -105,10 +105,8 @@ struct spi_device_t spi_device[SPI_DEVICE_MAX] = {
         .miso_p = &pin_device[12],
         .sck_p = &pin_device[13],
         .mutex = {
-            .is_locked = 0,
-            .waiters = {
-                .head_p = NULL
-            }
+            .owner_p = NULL,
+            .waiters = THRD_PRIO_LIST_INIT_STRUCT
         }
     }
 };
@@ -141,10 +141,8 @@ struct spi_device_t spi_device[SPI_DEVICE_MAX] = {
             .cpu = ESP32_CPU_INTR_SPI_NUM
         },
         .mutex = {
-            .is_locked = 0,
-            .waiters = {
-                .head_p = NULL
-            }
+            .owner_p = NULL,
+            .waiters = THRD_PRIO_LIST_INIT_STRUCT
         }
     },
     {
@@ -164,10 +162,8 @@ struct spi_device_t spi_device[SPI_DEVICE_MAX] = {
             .cpu = ESP32_CPU_INTR_SPI_NUM
         },
         .mutex = {
-            .is_locked = 0,
-            .waiters = {
-                .head_p = NULL
-            }
+            .owner_p = NULL,
+            .waiters = THRD_PRIO_LIST_INIT_STRUCT
         }
     },
     {
@@ -188,10 +184,8 @@ struct spi_device_t spi_device[SPI_DEVICE_MAX] = {
             .cpu = ESP32_CPU_INTR_SPI_NUM
         },
         .mutex = {
-            .is_locked = 0,
-            .waiters = {
-                .head_p = NULL
-            }
+            .owner_p = NULL,
+            .waiters = THRD_PRIO_LIST_INIT_STRUCT
         }
     }
 };
@@ -210,10 +204,8 @@ struct spi_device_t spi_device[SPI_DEVICE_MAX] = {
 struct flash_device_t flash_device[FLASH_DEVICE_MAX] = {
     {
         .mutex = {
-            .is_locked = 0,
-            .waiters = {
-                .head_p = NULL
-            }
+            .owner_p = NULL,
+            .waiters = THRD_PRIO_LIST_INIT_STRUCT
         }
     }
 };
@@ -81,10 +81,8 @@ struct spi_device_t spi_device[SPI_DEVICE_MAX] = {
         .drv_p = NULL,
         .regs_p = ESP8266_SPI0,
         .mutex = {
-            .is_locked = 0,
-            .waiters = {
-                .head_p = NULL
-            }
+            .owner_p = NULL,
+            .waiters = THRD_PRIO_LIST_INIT_STRUCT
         }
     }
 };
@@ -92,10 +90,8 @@ struct spi_device_t spi_device[SPI_DEVICE_MAX] = {
 struct flash_device_t flash_device[FLASH_DEVICE_MAX] = {
     {
         .mutex = {
-            .is_locked = 0,
-            .waiters = {
-                .head_p = NULL
-            }
+            .owner_p = NULL,
+            .waiters = THRD_PRIO_LIST_INIT_STRUCT
         }
     }
 };
@@ -38,22 +38,22 @@ struct adc_device_t adc_device[ADC_DEVICE_MAX];
 struct dac_device_t dac_device[DAC_DEVICE_MAX];
 
 struct flash_device_t flash_device[FLASH_DEVICE_MAX] = {
-    { .mutex = { .is_locked = 0, .waiters = { .head_p = NULL } } },
-    { .mutex = { .is_locked = 0, .waiters = { .head_p = NULL } } },
-    { .mutex = { .is_locked = 0, .waiters = { .head_p = NULL } } },
-    { .mutex = { .is_locked = 0, .waiters = { .head_p = NULL } } },
-    { .mutex = { .is_locked = 0, .waiters = { .head_p = NULL } } },
-    { .mutex = { .is_locked = 0, .waiters = { .head_p = NULL } } },
-    { .mutex = { .is_locked = 0, .waiters = { .head_p = NULL } } },
-    { .mutex = { .is_locked = 0, .waiters = { .head_p = NULL } } },
-    { .mutex = { .is_locked = 0, .waiters = { .head_p = NULL } } },
-    { .mutex = { .is_locked = 0, .waiters = { .head_p = NULL } } },
-    { .mutex = { .is_locked = 0, .waiters = { .head_p = NULL } } },
-    { .mutex = { .is_locked = 0, .waiters = { .head_p = NULL } } },
-    { .mutex = { .is_locked = 0, .waiters = { .head_p = NULL } } },
-    { .mutex = { .is_locked = 0, .waiters = { .head_p = NULL } } },
-    { .mutex = { .is_locked = 0, .waiters = { .head_p = NULL } } },
-    { .mutex = { .is_locked = 0, .waiters = { .head_p = NULL } } }
+    { .mutex = { .owner_p = NULL, .waiters = THRD_PRIO_LIST_INIT_STRUCT } },
+    { .mutex = { .owner_p = NULL, .waiters = THRD_PRIO_LIST_INIT_STRUCT } },
+    { .mutex = { .owner_p = NULL, .waiters = THRD_PRIO_LIST_INIT_STRUCT } },
+    { .mutex = { .owner_p = NULL, .waiters = THRD_PRIO_LIST_INIT_STRUCT } },
+    { .mutex = { .owner_p = NULL, .waiters = THRD_PRIO_LIST_INIT_STRUCT } },
+    { .mutex = { .owner_p = NULL, .waiters = THRD_PRIO_LIST_INIT_STRUCT } },
+    { .mutex = { .owner_p = NULL, .waiters = THRD_PRIO_LIST_INIT_STRUCT } },
+    { .mutex = { .owner_p = NULL, .waiters = THRD_PRIO_LIST_INIT_STRUCT } },
+    { .mutex = { .owner_p = NULL, .waiters = THRD_PRIO_LIST_INIT_STRUCT } },
+    { .mutex = { .owner_p = NULL, .waiters = THRD_PRIO_LIST_INIT_STRUCT } },
+    { .mutex = { .owner_p = NULL, .waiters = THRD_PRIO_LIST_INIT_STRUCT } },
+    { .mutex = { .owner_p = NULL, .waiters = THRD_PRIO_LIST_INIT_STRUCT } },
+    { .mutex = { .owner_p = NULL, .waiters = THRD_PRIO_LIST_INIT_STRUCT } },
+    { .mutex = { .owner_p = NULL, .waiters = THRD_PRIO_LIST_INIT_STRUCT } },
+    { .mutex = { .owner_p = NULL, .waiters = THRD_PRIO_LIST_INIT_STRUCT } },
+    { .mutex = { .owner_p = NULL, .waiters = THRD_PRIO_LIST_INIT_STRUCT } }
 };
 
 struct i2c_device_t i2c_device[I2C_DEVICE_MAX];
@@ -62,10 +62,8 @@ struct spi_device_t spi_device[SPI_DEVICE_MAX] = {
     {
         .drv_p = NULL,
         .mutex = {
-            .is_locked = 0,
-            .waiters = {
-                .head_p = NULL
-            }
+            .owner_p = NULL,
+            .waiters = THRD_PRIO_LIST_INIT_STRUCT
         }
     }
 };
@@ -152,9 +152,8 @@ struct spi_device_t spi_device[SPI_DEVICE_MAX] = {
         .sck_p = &pin_device[27],
         .id = PERIPHERAL_ID_SPI0,
         .mutex = {
-            .is_locked = 0,
-            .waiters = {
-                .head_p = NULL }
+            .owner_p = NULL,
+            .waiters = THRD_PRIO_LIST_INIT_STRUCT
         }
     }
 };
@@ -357,10 +356,8 @@ struct flash_device_t flash_device[FLASH_DEVICE_MAX] = {
             }
         },
         .mutex = {
-            .is_locked = 0,
-            .waiters = {
-                .head_p = NULL
-            }
+            .owner_p = NULL,
+            .waiters = THRD_PRIO_LIST_INIT_STRUCT
         }
     }
 };
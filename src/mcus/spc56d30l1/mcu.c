@@ -118,9 +118,7 @@ struct flash_device_t flash_device[FLASH_DEVICE_MAX] = {
         .sem = {
             .count = 0,
             .count_max = 1,
-            .waiters = {
-                .head_p = NULL
-            }
+            .waiters = THRD_PRIO_LIST_INIT_STRUCT
         }
     },
     {
@@ -132,9 +130,7 @@ struct flash_device_t flash_device[FLASH_DEVICE_MAX] = {
         .sem = {
             .count = 0,
             .count_max = 1,
-            .waiters = {
-                .head_p = NULL
-            }
+            .waiters = THRD_PRIO_LIST_INIT_STRUCT
         }
     }
 };
@@ -117,10 +117,8 @@ struct flash_device_t flash_device[FLASH_DEVICE_MAX] = {
         .sector_sizes_p = cflash_sector_sizes,
         .program_size = 2,
         .mutex = {
-            .is_locked = 0,
-            .waiters = {
-                .head_p = NULL
-            }
+            .owner_p = NULL,
+            .waiters = THRD_PRIO_LIST_INIT_STRUCT
         }
     },
     {
@@ -130,10 +128,8 @@ struct flash_device_t flash_device[FLASH_DEVICE_MAX] = {
         .sector_sizes_p = dflash_sector_sizes,
         .program_size = 1,
         .mutex = {
-            .is_locked = 0,
-            .waiters = {
-                .head_p = NULL
-            }
+            .owner_p = NULL,
+            .waiters = THRD_PRIO_LIST_INIT_STRUCT
         }
     }
 };
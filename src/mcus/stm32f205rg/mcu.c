@@ -103,10 +103,8 @@ struct uart_device_t uart_device[UART_DEVICE_MAX] = {
 struct flash_device_t flash_device[FLASH_DEVICE_MAX] = {
     {
         .mutex = {
-            .is_locked = 0,
-            .waiters = {
-                .head_p = NULL
-            }
+            .owner_p = NULL,
+            .waiters = THRD_PRIO_LIST_INIT_STRUCT
         }
     }
 };
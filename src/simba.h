@@ -98,14 +98,20 @@ extern "C" {
 #include "kernel/thrd.h"
 
 #include "sync/mutex.h"
+#include "sync/rcu.h"
 #include "sync/cond.h"
 #include "sync/queue.h"
+#include "sync/ring.h"
 #include "sync/event.h"
+#include "sync/event_group.h"
 #include "sync/rwlock.h"
 #include "sync/bus.h"
+#include "kernel/thrd_pool.h"
+#include "kernel/task.h"
 
 #include "alloc/heap.h"
 #include "alloc/circular_heap.h"
+#include "alloc/slab.h"
 
 #if CONFIG_FAT16 == 1
 #    include "filesystems/fat16.h"
@@ -32,7 +32,7 @@
 ifeq ($(TYPE),suite)
   INC += $(SIMBA_ROOT)/tst/stubs
 
-  ALLOC_SRC += heap.c
+  ALLOC_SRC += heap.c slab.c
   COLLECTIONS_SRC += circular_buffer.c binary_tree.c
   DEBUG_SRC += log.c harness.c
   DRIVERS_SRC += storage/flash.c network/uart.c
@@ -45,7 +45,7 @@ ifeq ($(TYPE),suite)
   OAM_SRC += console.c settings.c nvm.c
   FILESYSTEMS_SRC += fs.c
   SPIFFS_SRC +=
-  SYNC_SRC += chan.c queue.c rwlock.c sem.c mutex.c bus.c event.c
+  SYNC_SRC += chan.c queue.c rwlock.c sem.c mutex.c bus.c event.c rcu.c
   TEXT_SRC += std.c
   SCIENCE_SRC +=
 
@@ -82,7 +82,8 @@ INC += $(SIMBA_ROOT)/3pp/compat
 
 # Alloc package.
 ALLOC_SRC ?= circular_heap.c \
-	     heap.c
+	     heap.c \
+	     slab.c
 
 SRC += $(ALLOC_SRC:%=$(SIMBA_ROOT)/src/alloc/%)
 
@@ -318,7 +319,9 @@ INC += $(SIMBA_ROOT)/src/kernel/ports/$(ARCH)/$(TOOLCHAIN)
 KERNEL_SRC_TMP = \
 	errno.c \
 	sys.c \
+	task.c \
 	thrd.c \
+	thrd_pool.c \
 	time.c \
 	timer.c
 
@@ -386,8 +389,11 @@ SYNC_SRC ?= bus.c \
 	    chan.c \
 	    cond.c \
 	    event.c \
+	    event_group.c \
 	    mutex.c \
 	    queue.c \
+	    ring.c \
+	    rcu.c \
 	    rwlock.c \
 	    sem.c
 
@@ -30,106 +30,765 @@
 
 #include "simba.h"
 
-int bus_module_init()
+/**
+ * Shared message header, followed by the message data. The reference
+ * count is protected by the system lock rather than the heap mutex,
+ * as it is updated once per listener.
+ */
+union message_header_t {
+    int count;
+    long long align;
+};
+
+static union message_header_t *message_header(void *buf_p)
 {
-    return (0);
+    return (&((union message_header_t *)buf_p)[-1]);
 }
 
-int bus_init(struct bus_t *self_p)
+/**
+ * Release one reference to given shared message, and free it if it
+ * was the last one.
+ */
+static int message_release(struct bus_t *self_p, void *buf_p)
 {
-    ASSERTN(self_p != NULL, EINVAL);
+    union message_header_t *header_p;
+    int count;
 
-    binary_tree_init(&self_p->listeners);
-    rwlock_init(&self_p->rwlock);
+    header_p = message_header(buf_p);
 
-    return (0);
+    sys_lock();
+    header_p->count--;
+    count = header_p->count;
+    sys_unlock();
+
+    if (count == 0) {
+        heap_free(self_p->heap_p, header_p);
+    }
+
+    return (count);
 }
 
-int bus_listener_init(struct bus_listener_t *self_p,
-                      int id,
-                      void *chan_p)
+typedef void (*deliver_fn_t)(struct bus_t *self_p,
+                             struct bus_listener_t *listener_p,
+                             const void *buf_p,
+                             size_t size);
+
+/**
+ * Listener index operation with the bus mutex taken.
+ */
+typedef int (*update_fn_t)(struct bus_index_t *index_p,
+                           int i,
+                           struct bus_listener_t *listener_p);
+
+/**
+ * Listener of given binary tree node in index i.
+ */
+static struct bus_listener_t *node_to_listener(
+    struct binary_tree_node_t *node_p,
+    int i)
 {
-    ASSERTN(self_p != NULL, EINVAL);
-    ASSERTN(chan_p != NULL, EINVAL);
+    if (node_p == NULL) {
+        return (NULL);
+    }
 
-    self_p->base.key = id;
-    self_p->id = id;
-    self_p->chan_p = chan_p;
-    self_p->next_p = NULL;
+    /* The links of index i are preceded by i links in the
+       listener. */
+    return ((struct bus_listener_t *)
+            &((struct bus_listener_links_t *)node_p)[-i]);
+}
 
-    return (0);
+/*
+ * The range listeners are stored in an AVL tree ordered by the lowest
+ * id of the range, where each node also holds the highest id in its
+ * subtree. Listeners with the same lowest id are ordered by address.
+ */
+
+static int range_height(struct bus_listener_t *node_p, int i)
+{
+    return (node_p ? node_p->links[i].range.height : 0);
 }
 
-int bus_attach(struct bus_t *self_p,
-               struct bus_listener_t *listener_p)
+static int range_less(struct bus_listener_t *node_p,
+                      struct bus_listener_t *other_p)
 {
-    ASSERTN(self_p != NULL, EINVAL);
-    ASSERTN(listener_p != NULL, EINVAL);
+    if (node_p->id != other_p->id) {
+        return (node_p->id < other_p->id);
+    }
 
-    struct bus_listener_t *head_p;
+    return ((uintptr_t)node_p < (uintptr_t)other_p);
+}
 
-    rwlock_writer_take(&self_p->rwlock);
+static void range_recalc(struct bus_listener_t *node_p, int i)
+{
+    struct bus_listener_links_t *links_p;
 
-    /* Try to insert the node into the tree. It fails if there already
-     * is a node with the same key (id).*/
-    if (binary_tree_insert(&self_p->listeners, &listener_p->base) != 0) {
-        head_p = (struct bus_listener_t *)binary_tree_search(
-            &self_p->listeners, listener_p->id);
+    links_p = &node_p->links[i];
+    links_p->range.height = (1 + MAX(range_height(links_p->range.left_p, i),
+                                     range_height(links_p->range.right_p, i)));
+    links_p->range.max = node_p->id_max;
 
-        listener_p->next_p = head_p->next_p;
-        head_p->next_p = listener_p;
+    if ((links_p->range.left_p != NULL)
+        && (links_p->range.left_p->links[i].range.max > links_p->range.max)) {
+        links_p->range.max = links_p->range.left_p->links[i].range.max;
     }
 
-    rwlock_writer_give(&self_p->rwlock);
+    if ((links_p->range.right_p != NULL)
+        && (links_p->range.right_p->links[i].range.max > links_p->range.max)) {
+        links_p->range.max = links_p->range.right_p->links[i].range.max;
+    }
+}
 
-    return (0);
+static struct bus_listener_t *range_rotate_right(
+    struct bus_listener_t *node_p,
+    int i)
+{
+    struct bus_listener_t *left_p = node_p->links[i].range.left_p;
+
+    node_p->links[i].range.left_p = left_p->links[i].range.right_p;
+    left_p->links[i].range.right_p = node_p;
+
+    range_recalc(node_p, i);
+    range_recalc(left_p, i);
+
+    return (left_p);
 }
 
-int bus_detach(struct bus_t *self_p,
-               struct bus_listener_t *listener_p)
+static struct bus_listener_t *range_rotate_left(
+    struct bus_listener_t *node_p,
+    int i)
 {
-    ASSERTN(self_p != NULL, EINVAL);
-    ASSERTN(listener_p != NULL, EINVAL);
+    struct bus_listener_t *right_p = node_p->links[i].range.right_p;
 
-    int res = 0;
-    struct bus_listener_t *head_p, *curr_p, *prev_p;
+    node_p->links[i].range.right_p = right_p->links[i].range.left_p;
+    right_p->links[i].range.left_p = node_p;
 
-    rwlock_writer_take(&self_p->rwlock);
+    range_recalc(node_p, i);
+    range_recalc(right_p, i);
+
+    return (right_p);
+}
+
+static struct bus_listener_t *range_balance(struct bus_listener_t *node_p,
+                                            int i)
+{
+    struct bus_listener_links_t *links_p;
+    struct bus_listener_links_t *child_p;
+
+    links_p = &node_p->links[i];
+    range_recalc(node_p, i);
+
+    if ((range_height(links_p->range.left_p, i)
+         - range_height(links_p->range.right_p, i)) == 2) {
+        child_p = &links_p->range.left_p->links[i];
+
+        if (range_height(child_p->range.right_p, i)
+            > range_height(child_p->range.left_p, i)) {
+            links_p->range.left_p = range_rotate_left(links_p->range.left_p,
+                                                      i);
+        }
+
+        return (range_rotate_right(node_p, i));
+    } else if ((range_height(links_p->range.right_p, i)
+                - range_height(links_p->range.left_p, i)) == 2) {
+        child_p = &links_p->range.right_p->links[i];
+
+        if (range_height(child_p->range.left_p, i)
+            > range_height(child_p->range.right_p, i)) {
+            links_p->range.right_p = range_rotate_right(links_p->range.right_p,
+                                                        i);
+        }
+
+        return (range_rotate_left(node_p, i));
+    }
+
+    return (node_p);
+}
+
+static struct bus_listener_t *range_insert(struct bus_listener_t *root_p,
+                                           struct bus_listener_t *node_p,
+                                           int i)
+{
+    if (root_p == NULL) {
+        node_p->links[i].range.left_p = NULL;
+        node_p->links[i].range.right_p = NULL;
+        range_recalc(node_p, i);
+
+        return (node_p);
+    }
+
+    if (range_less(node_p, root_p)) {
+        root_p->links[i].range.left_p = range_insert(
+            root_p->links[i].range.left_p,
+            node_p,
+            i);
+    } else {
+        root_p->links[i].range.right_p = range_insert(
+            root_p->links[i].range.right_p,
+            node_p,
+            i);
+    }
+
+    return (range_balance(root_p, i));
+}
 
-    head_p = (struct bus_listener_t *)binary_tree_search(
-        &self_p->listeners, listener_p->id);
+static struct bus_listener_t *range_find_min(struct bus_listener_t *node_p,
+                                             int i)
+{
+    while (node_p->links[i].range.left_p != NULL) {
+        node_p = node_p->links[i].range.left_p;
+    }
+
+    return (node_p);
+}
+
+static struct bus_listener_t *range_delete_min(struct bus_listener_t *node_p,
+                                               int i)
+{
+    if (node_p->links[i].range.left_p == NULL) {
+        return (node_p->links[i].range.right_p);
+    }
+
+    node_p->links[i].range.left_p = range_delete_min(
+        node_p->links[i].range.left_p,
+        i);
+
+    return (range_balance(node_p, i));
+}
+
+static int range_delete(struct bus_listener_t **root_pp,
+                        struct bus_listener_t *node_p,
+                        int i)
+{
+    int res;
+    struct bus_listener_t *root_p = *root_pp;
+    struct bus_listener_t *m_p;
+
+    if (root_p == NULL) {
+        return (-1);
+    }
+
+    if (root_p == node_p) {
+        if (node_p->links[i].range.right_p == NULL) {
+            *root_pp = node_p->links[i].range.left_p;
+        } else {
+            m_p = range_find_min(node_p->links[i].range.right_p, i);
+            m_p->links[i].range.right_p = range_delete_min(
+                node_p->links[i].range.right_p,
+                i);
+            m_p->links[i].range.left_p = node_p->links[i].range.left_p;
+            *root_pp = range_balance(m_p, i);
+        }
+
+        return (0);
+    }
+
+    if (range_less(node_p, root_p)) {
+        res = range_delete(&root_p->links[i].range.left_p, node_p, i);
+    } else {
+        res = range_delete(&root_p->links[i].range.right_p, node_p, i);
+    }
+
+    *root_pp = range_balance(root_p, i);
+
+    return (res);
+}
+
+/**
+ * Deliver given message to all range listeners in given subtree
+ * including given id. Subtrees without such listeners are skipped
+ * using the highest id of the subtree.
+ */
+static int range_dispatch(struct bus_t *self_p,
+                          struct bus_listener_t *node_p,
+                          int i,
+                          int id,
+                          deliver_fn_t deliver,
+                          const void *buf_p,
+                          size_t size)
+{
+    int number_of_receivers;
+
+    number_of_receivers = 0;
+
+    while ((node_p != NULL) && (id <= node_p->links[i].range.max)) {
+        number_of_receivers += range_dispatch(self_p,
+                                              node_p->links[i].range.left_p,
+                                              i,
+                                              id,
+                                              deliver,
+                                              buf_p,
+                                              size);
+
+        /* All ranges in the right subtree start after given id. */
+        if (id < node_p->id) {
+            break;
+        }
+
+        if (id <= node_p->id_max) {
+            deliver(self_p, node_p, buf_p, size);
+            number_of_receivers++;
+        }
+
+        node_p = node_p->links[i].range.right_p;
+    }
+
+    return (number_of_receivers);
+}
+
+/**
+ * Deliver given message to all listeners of given id in the
+ * published index. Must be called between `read_lock()` and
+ * `read_unlock()`.
+ */
+static int dispatch(struct bus_t *self_p,
+                    int id,
+                    deliver_fn_t deliver,
+                    const void *buf_p,
+                    size_t size)
+{
+    int number_of_receivers;
+    struct bus_index_t *index_p;
+    struct bus_listener_t *curr_p;
+    int i;
+
+    number_of_receivers = 0;
+#if CONFIG_RCU == 1
+    index_p = RCU_DEREFERENCE(self_p->index_p);
+#else
+    index_p = &self_p->indexes[0];
+#endif
+    i = (index_p - &self_p->indexes[0]);
+    curr_p = node_to_listener(binary_tree_search(&index_p->listeners, id), i);
+
+    while (curr_p != NULL) {
+        deliver(self_p, curr_p, buf_p, size);
+        number_of_receivers++;
+        curr_p = curr_p->links[i].next_p;
+    }
+
+    number_of_receivers += range_dispatch(self_p,
+                                          index_p->ranges_p,
+                                          i,
+                                          id,
+                                          deliver,
+                                          buf_p,
+                                          size);
+
+    for (curr_p = index_p->masks_p;
+         curr_p != NULL;
+         curr_p = curr_p->links[i].next_p) {
+        if ((id & curr_p->mask) == curr_p->id) {
+            deliver(self_p, curr_p, buf_p, size);
+            number_of_receivers++;
+        }
+    }
+
+    return (number_of_receivers);
+}
+
+static void deliver_copy(struct bus_t *self_p,
+                         struct bus_listener_t *listener_p,
+                         const void *buf_p,
+                         size_t size)
+{
+    ((struct chan_t *)listener_p->chan_p)->write(listener_p->chan_p,
+                                                 buf_p,
+                                                 size);
+}
+
+static void deliver_shared(struct bus_t *self_p,
+                           struct bus_listener_t *listener_p,
+                           const void *buf_p,
+                           size_t size)
+{
+    const struct bus_message_t *message_p;
+    struct chan_t *chan_p;
+
+    message_p = buf_p;
+    chan_p = listener_p->chan_p;
+
+    /* One reference per listener, taken before the listener can
+       release it. */
+    sys_lock();
+    message_header(message_p->buf_p)->count++;
+    sys_unlock();
+
+    if (chan_p->write(chan_p, buf_p, size) != size) {
+        message_release(self_p, message_p->buf_p);
+    }
+}
+
+/**
+ * Write given shared message to all its listeners. Must be called
+ * between `read_lock()` and `read_unlock()`.
+ */
+static int write_message(struct bus_t *self_p,
+                         const struct bus_message_t *message_p)
+{
+    int number_of_receivers;
+
+    number_of_receivers = dispatch(self_p,
+                                   message_p->id,
+                                   deliver_shared,
+                                   message_p,
+                                   sizeof(*message_p));
+
+    /* Release the reference of the writer. */
+    message_release(self_p, message_p->buf_p);
+
+    return (number_of_receivers);
+}
+
+/**
+ * Attach given listener to given index with the bus mutex taken.
+ */
+static int attach_index(struct bus_index_t *index_p,
+                        int i,
+                        struct bus_listener_t *listener_p)
+{
+    struct bus_listener_t *head_p;
+
+    switch (listener_p->type) {
+
+    case BUS_LISTENER_TYPE_RANGE:
+        index_p->ranges_p = range_insert(index_p->ranges_p, listener_p, i);
+        break;
+
+    case BUS_LISTENER_TYPE_MASK:
+        listener_p->links[i].next_p = index_p->masks_p;
+        index_p->masks_p = listener_p;
+        break;
+
+    default:
+        listener_p->links[i].next_p = NULL;
+
+        /* Try to insert the node into the tree. It fails if there
+         * already is a node with the same key (id).*/
+        if (binary_tree_insert(&index_p->listeners,
+                               &listener_p->links[i].base) != 0) {
+            head_p = node_to_listener(
+                binary_tree_search(&index_p->listeners, listener_p->id),
+                i);
+
+            listener_p->links[i].next_p = head_p->links[i].next_p;
+            head_p->links[i].next_p = listener_p;
+        }
+
+        break;
+    }
+
+    return (0);
+}
+
+/**
+ * Detach given id listener from given index with the bus mutex
+ * taken.
+ */
+static int detach_id(struct bus_index_t *index_p,
+                     int i,
+                     struct bus_listener_t *listener_p)
+{
+    int res = 0;
+    struct bus_listener_t *head_p, *curr_p, *prev_p, *next_p;
+
+    head_p = node_to_listener(binary_tree_search(&index_p->listeners,
+                                                 listener_p->id),
+                              i);
 
     if (head_p == NULL) {
         res = -1;
     } else if (head_p == listener_p) {
-        res = binary_tree_delete(&self_p->listeners, listener_p->id);
+        res = binary_tree_delete(&index_p->listeners, listener_p->id);
+
+        next_p = listener_p->links[i].next_p;
 
-        if (listener_p->next_p != NULL) {
-            (void)binary_tree_insert(&self_p->listeners,
-                                     &listener_p->next_p->base);
+        if (next_p != NULL) {
+            (void)binary_tree_insert(&index_p->listeners,
+                                     &next_p->links[i].base);
         }
     } else {
-        curr_p = head_p->next_p;
+        curr_p = head_p->links[i].next_p;
         prev_p = head_p;
         res = -1;
 
         while (curr_p != NULL) {
             if (curr_p == listener_p) {
-                prev_p->next_p = listener_p->next_p;
+                prev_p->links[i].next_p = listener_p->links[i].next_p;
                 res = 0;
                 break;
             }
 
             prev_p = curr_p;
-            curr_p = curr_p->next_p;
+            curr_p = curr_p->links[i].next_p;
         }
     }
 
+    return (res);
+}
+
+/**
+ * Detach given mask listener from given index with the bus mutex
+ * taken.
+ */
+static int detach_mask(struct bus_index_t *index_p,
+                       int i,
+                       struct bus_listener_t *listener_p)
+{
+    struct bus_listener_t **curr_pp;
+
+    curr_pp = &index_p->masks_p;
+
+    while (*curr_pp != NULL) {
+        if (*curr_pp == listener_p) {
+            *curr_pp = listener_p->links[i].next_p;
+
+            return (0);
+        }
+
+        curr_pp = &(*curr_pp)->links[i].next_p;
+    }
+
+    return (-1);
+}
+
+/**
+ * Detach given listener from given index with the bus mutex taken.
+ */
+static int detach_index(struct bus_index_t *index_p,
+                        int i,
+                        struct bus_listener_t *listener_p)
+{
+    int res;
+
+    switch (listener_p->type) {
+
+    case BUS_LISTENER_TYPE_RANGE:
+        res = range_delete(&index_p->ranges_p, listener_p, i);
+        break;
+
+    case BUS_LISTENER_TYPE_MASK:
+        res = detach_mask(index_p, i, listener_p);
+        break;
+
+    default:
+        res = detach_id(index_p, i, listener_p);
+        break;
+    }
+
+    return (res);
+}
+
+#if CONFIG_RCU == 1
+
+/**
+ * Enter a read-side critical section, in which the published index
+ * may be searched.
+ */
+static void read_lock(struct bus_t *self_p)
+{
+    rcu_read_lock();
+}
+
+static void read_unlock(struct bus_t *self_p)
+{
+    rcu_read_unlock();
+}
+
+/**
+ * Apply given operation to both indexes. The index readers do not
+ * use is updated and published first, and the other one when no
+ * reader uses it anymore.
+ */
+static int update(struct bus_t *self_p,
+                  update_fn_t update_fn,
+                  struct bus_listener_t *listener_p)
+{
+    int res;
+    int i;
+
+    mutex_lock(&self_p->mutex);
+
+    i = (self_p->index_p == &self_p->indexes[0]);
+    res = update_fn(&self_p->indexes[i], i, listener_p);
+
+    /* Both indexes are equal, so the operation fails on both or
+       none of them. */
+    if (res == 0) {
+        RCU_ASSIGN(self_p->index_p, &self_p->indexes[i]);
+        rcu_synchronize();
+        (void)update_fn(&self_p->indexes[1 - i], 1 - i, listener_p);
+    }
+
+    mutex_unlock(&self_p->mutex);
+
+    return (res);
+}
+
+#else
+
+/**
+ * Take the reader lock, so the index may be searched.
+ */
+static void read_lock(struct bus_t *self_p)
+{
+    rwlock_reader_take(&self_p->rwlock);
+}
+
+static void read_unlock(struct bus_t *self_p)
+{
+    rwlock_reader_give(&self_p->rwlock);
+}
+
+/**
+ * Apply given operation to the index with the writer lock taken.
+ */
+static int update(struct bus_t *self_p,
+                  update_fn_t update_fn,
+                  struct bus_listener_t *listener_p)
+{
+    int res;
+
+    rwlock_writer_take(&self_p->rwlock);
+    res = update_fn(&self_p->indexes[0], 0, listener_p);
     rwlock_writer_give(&self_p->rwlock);
 
     return (res);
 }
 
+#endif
+
+int bus_module_init()
+{
+#if CONFIG_RCU == 1
+    return (rcu_module_init());
+#else
+    return (rwlock_module_init());
+#endif
+}
+
+int bus_init(struct bus_t *self_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+
+    int i;
+
+    for (i = 0; i < membersof(self_p->indexes); i++) {
+        binary_tree_init(&self_p->indexes[i].listeners);
+        self_p->indexes[i].ranges_p = NULL;
+        self_p->indexes[i].masks_p = NULL;
+    }
+
+#if CONFIG_RCU == 1
+    mutex_init(&self_p->mutex);
+    self_p->index_p = &self_p->indexes[0];
+#else
+    rwlock_init(&self_p->rwlock);
+#endif
+    self_p->heap_p = NULL;
+
+    return (0);
+}
+
+int bus_set_heap(struct bus_t *self_p, struct heap_t *heap_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(heap_p != NULL, EINVAL);
+
+    self_p->heap_p = heap_p;
+
+    return (0);
+}
+
+int bus_listener_init(struct bus_listener_t *self_p,
+                      int id,
+                      void *chan_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(chan_p != NULL, EINVAL);
+
+    int i;
+
+    for (i = 0; i < membersof(self_p->links); i++) {
+        self_p->links[i].base.key = id;
+    }
+
+    self_p->id = id;
+    self_p->chan_p = chan_p;
+    self_p->type = BUS_LISTENER_TYPE_ID;
+
+    return (0);
+}
+
+int bus_listener_init_range(struct bus_listener_t *self_p,
+                            int id_min,
+                            int id_max,
+                            void *chan_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(id_min <= id_max, EINVAL);
+    ASSERTN(chan_p != NULL, EINVAL);
+
+    self_p->id = id_min;
+    self_p->id_max = id_max;
+    self_p->chan_p = chan_p;
+    self_p->type = BUS_LISTENER_TYPE_RANGE;
+
+    return (0);
+}
+
+int bus_listener_init_mask(struct bus_listener_t *self_p,
+                           int id,
+                           int mask,
+                           void *chan_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(chan_p != NULL, EINVAL);
+
+    unsigned int ignored;
+
+    ignored = ~(unsigned int)mask;
+
+    /* Only low bits ignored? Then it is a range. */
+    if ((ignored & (ignored + 1)) == 0) {
+        self_p->id = (int)((unsigned int)id & (unsigned int)mask);
+        self_p->id_max = (int)((unsigned int)self_p->id | ignored);
+
+        /* The range wraps to negative ids if the sign bit is
+           ignored. */
+        if (self_p->id <= self_p->id_max) {
+            self_p->chan_p = chan_p;
+            self_p->type = BUS_LISTENER_TYPE_RANGE;
+
+            return (0);
+        }
+    }
+
+    self_p->id = (id & mask);
+    self_p->mask = mask;
+    self_p->chan_p = chan_p;
+    self_p->type = BUS_LISTENER_TYPE_MASK;
+
+    return (0);
+}
+
+int bus_attach(struct bus_t *self_p,
+               struct bus_listener_t *listener_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(listener_p != NULL, EINVAL);
+
+    return (update(self_p, attach_index, listener_p));
+}
+
+int bus_detach(struct bus_t *self_p,
+               struct bus_listener_t *listener_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(listener_p != NULL, EINVAL);
+
+    return (update(self_p, detach_index, listener_p));
+}
+
 int bus_write(struct bus_t *self_p,
               int id,
               const void *buf_p,
@@ -140,23 +799,80 @@ int bus_write(struct bus_t *self_p,
     ASSERTN(size > 0, EINVAL);
 
     int number_of_receivers;
-    struct bus_listener_t *curr_p;
 
-    rwlock_reader_take(&self_p->rwlock);
+    read_lock(self_p);
+    number_of_receivers = dispatch(self_p, id, deliver_copy, buf_p, size);
+    read_unlock(self_p);
+
+    return (number_of_receivers);
+}
+
+void *bus_message_alloc(struct bus_t *self_p, size_t size)
+{
+    ASSERTNRN(self_p != NULL, EINVAL);
+    ASSERTNRN(self_p->heap_p != NULL, EINVAL);
+
+    union message_header_t *header_p;
+
+    header_p = heap_alloc(self_p->heap_p, sizeof(*header_p) + size);
+
+    if (header_p == NULL) {
+        return (NULL);
+    }
+
+    header_p->count = 1;
+
+    return (&header_p[1]);
+}
+
+int bus_message_free(struct bus_t *self_p, void *buf_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(self_p->heap_p != NULL, EINVAL);
+    ASSERTN(buf_p != NULL, EINVAL);
+
+    return (message_release(self_p, buf_p));
+}
+
+int bus_write_message(struct bus_t *self_p,
+                      int id,
+                      void *buf_p,
+                      size_t size)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(self_p->heap_p != NULL, EINVAL);
+    ASSERTN(buf_p != NULL, EINVAL);
+
+    struct bus_message_t message;
+
+    message.id = id;
+    message.buf_p = buf_p;
+    message.size = size;
+
+    return (bus_write_messages(self_p, &message, 1));
+}
+
+int bus_write_messages(struct bus_t *self_p,
+                       const struct bus_message_t *messages_p,
+                       int length)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(self_p->heap_p != NULL, EINVAL);
+    ASSERTN(messages_p != NULL, EINVAL);
+    ASSERTN(length >= 0, EINVAL);
+
+    int number_of_receivers;
+    int i;
 
-    curr_p = (struct bus_listener_t *)binary_tree_search(
-        &self_p->listeners, id);
     number_of_receivers = 0;
 
-    while (curr_p != NULL) {
-        ((struct chan_t *)curr_p->chan_p)->write(curr_p->chan_p,
-                                                 buf_p,
-                                                 size);
-        number_of_receivers++;
-        curr_p = curr_p->next_p;
+    read_lock(self_p);
+
+    for (i = 0; i < length; i++) {
+        number_of_receivers += write_message(self_p, &messages_p[i]);
     }
 
-    rwlock_reader_give(&self_p->rwlock);
+    read_unlock(self_p);
 
     return (number_of_receivers);
 }
@@ -33,16 +33,82 @@
 
 #include "simba.h"
 
+/* Listener types. */
+#define BUS_LISTENER_TYPE_ID                                0
+#define BUS_LISTENER_TYPE_RANGE                             1
+#define BUS_LISTENER_TYPE_MASK                              2
+
+/* Number of listener indexes. Two with RCU, where writers use one
+   of them while the other is updated. */
+#if CONFIG_RCU == 1
+#    define BUS_INDEXES_MAX                                 2
+#else
+#    define BUS_INDEXES_MAX                                 1
+#endif
+
+struct bus_listener_t;
+
+/**
+ * Links of a listener in one of the listener indexes of a bus.
+ */
+struct bus_listener_links_t {
+    struct binary_tree_node_t base;
+    struct bus_listener_t *next_p;
+    struct {
+        struct bus_listener_t *left_p;
+        struct bus_listener_t *right_p;
+        int height;
+        /* Highest id in this subtree. */
+        int max;
+    } range;
+};
+
+struct bus_index_t {
+    struct binary_tree_t listeners;
+    /* Interval tree of range listeners. */
+    struct bus_listener_t *ranges_p;
+    /* List of mask listeners. */
+    struct bus_listener_t *masks_p;
+};
+
 struct bus_t {
+#if CONFIG_RCU == 1
+    /* Serializes attach and detach. */
+    struct mutex_t mutex;
+    /* Writers search the published index without locking. Attach
+       and detach update the other index, publish it, wait for a
+       grace period and then update the first index. */
+    struct bus_index_t indexes[BUS_INDEXES_MAX];
+    struct bus_index_t *index_p;
+#else
+    /* Writers take the reader lock, attach and detach the writer
+       lock. */
     struct rwlock_t rwlock;
-    struct binary_tree_t listeners;
+    struct bus_index_t indexes[BUS_INDEXES_MAX];
+#endif
+    struct heap_t *heap_p;
 };
 
 struct bus_listener_t {
-    struct binary_tree_node_t base;
+    /* Links in the indexes, first in the struct so the listener
+       can be found from a binary tree node. */
+    struct bus_listener_links_t links[BUS_INDEXES_MAX];
     int id;
     void *chan_p;
-    struct bus_listener_t *next_p;
+    int type;
+    int id_max;
+    int mask;
+};
+
+/**
+ * A shared message. Written by `bus_write_message()` and
+ * `bus_write_messages()` to the listener channels instead of the
+ * message data.
+ */
+struct bus_message_t {
+    int id;
+    void *buf_p;
+    size_t size;
 };
 
 /**
@@ -65,6 +131,17 @@ int bus_module_init(void);
  */
 int bus_init(struct bus_t *self_p);
 
+/**
+ * Set the heap shared messages are allocated from. Must be called
+ * before `bus_message_alloc()` is called.
+ *
+ * @param[in] self_p Bus to set the heap of.
+ * @param[in] heap_p Heap to allocate shared messages from.
+ *
+ * @return zero(0) or negative error code.
+ */
+int bus_set_heap(struct bus_t *self_p, struct heap_t *heap_p);
+
 /**
  * Initialize given listener to receive messages with given id, after
  * the listener is attached to the bus. A listener can only receive
@@ -81,10 +158,54 @@ int bus_listener_init(struct bus_listener_t *self_p,
                       int id,
                       void *chan_p);
 
+/**
+ * Initialize given listener to receive messages with ids in given
+ * range, after the listener is attached to the bus. Finding the range
+ * listeners of a message is O(log n + m), where n is the number of
+ * attached range listeners and m the number of matching listeners.
+ *
+ * @param[in] self_p Listener to initialize.
+ * @param[in] id_min Lowest message id to receive.
+ * @param[in] id_max Highest message id to receive.
+ * @param[in] chan_p Channel to receive messages on.
+ *
+ * @return zero(0) or negative error code.
+ */
+int bus_listener_init_range(struct bus_listener_t *self_p,
+                            int id_min,
+                            int id_max,
+                            void *chan_p);
+
+/**
+ * Initialize given listener to receive messages with ids that equals
+ * given id in all bits set in given mask, that is, ``(message id &
+ * mask) == (id & mask)``, after the listener is attached to the bus.
+ *
+ * A mask with all bits set above a number of unset bits, for example
+ * 0xffffff00, selects a range of ids, and is attached as a range
+ * listener. Other mask listeners are matched one by one on every
+ * write, so prefer ranges when possible.
+ *
+ * @param[in] self_p Listener to initialize.
+ * @param[in] id Message id to compare with.
+ * @param[in] mask Bits to compare.
+ * @param[in] chan_p Channel to receive messages on.
+ *
+ * @return zero(0) or negative error code.
+ */
+int bus_listener_init_mask(struct bus_listener_t *self_p,
+                           int id,
+                           int mask,
+                           void *chan_p);
+
 /**
  * Attach given listener to given bus. Messages written to the bus
- * will be written to all listeners initialized with the written
- * message id.
+ * will be written to all listeners whose id, range or mask matches
+ * the written message id.
+ *
+ * Waits for writes in progress to finish, including writes blocked
+ * on a full listener channel, but never for writes started after
+ * this call.
  *
  * @param[in] self_p Bus to attach the listener to.
  * @param[in] listener_p Listener to attach to the bus.
@@ -98,6 +219,8 @@ int bus_attach(struct bus_t *self_p,
  * Detatch given listener from given bus. A detached listener will not
  * receive any messages from the bus.
  *
+ * Waits for writes in progress to finish, like `bus_attach()`.
+ *
  * @param[in] self_p Bus to detach listener from.
  * @param[in] listener_p Listener to detach from the bus.
  *
@@ -124,4 +247,65 @@ int bus_write(struct bus_t *self_p,
               const void *buf_p,
               size_t size);
 
+/**
+ * Allocate a shared message buffer of given size from the bus heap.
+ *
+ * @param[in] self_p Bus to allocate the message for.
+ * @param[in] size Message size in bytes.
+ *
+ * @return Message buffer, or NULL if no memory could be allocated.
+ */
+void *bus_message_alloc(struct bus_t *self_p, size_t size);
+
+/**
+ * Release given shared message. Each listener that reads a
+ * `struct bus_message_t` from its channel must release the message
+ * when done with it. The buffer is freed when the last reference is
+ * released.
+ *
+ * @param[in] self_p Bus of the message.
+ * @param[in] buf_p Message buffer to release.
+ *
+ * @return Number of references left, or negative error code.
+ */
+int bus_message_free(struct bus_t *self_p, void *buf_p);
+
+/**
+ * Write given shared message to given bus without copying the
+ * message data. Each listener receives a `struct bus_message_t`
+ * referring to the same buffer and must release it with
+ * `bus_message_free()`. The reference of the writer is released by
+ * this function, so the buffer is freed if there are no listeners.
+ *
+ * @param[in] self_p Bus to write the message to.
+ * @param[in] id Message identity.
+ * @param[in] buf_p Message buffer allocated with
+ *                  `bus_message_alloc()`.
+ * @param[in] size Number of bytes in the message.
+ *
+ * @return Number of listeners that received the message, or negative
+ *         error code.
+ */
+int bus_write_message(struct bus_t *self_p,
+                      int id,
+                      void *buf_p,
+                      size_t size);
+
+/**
+ * Write given shared messages to given bus in a single read-side
+ * critical section, looking up the listeners of all messages in the
+ * same published index. Same as calling `bus_write_message()` for
+ * each message.
+ *
+ * @param[in] self_p Bus to write the messages to.
+ * @param[in] messages_p Messages to write.
+ * @param[in] length Number of messages.
+ *
+ * @return Total number of received messages, or negative error
+ *         code.
+ */
+int bus_write_messages(struct bus_t *self_p,
+                       const struct bus_message_t *messages_p,
+                       int length);
+
 #endif
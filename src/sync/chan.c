@@ -38,6 +38,61 @@ static const struct chan_t null = {
     .control = chan_control_null
 };
 
+/**
+ * Append given poll set element to the ready list of its poll set.
+ */
+static void poll_set_append_isr(struct chan_poll_set_elem_t *elem_p)
+{
+    struct chan_poll_set_t *poll_set_p;
+
+    poll_set_p = elem_p->poll_set_p;
+    elem_p->ready = 1;
+    elem_p->next_p = NULL;
+
+    if (poll_set_p->ready.head_p == NULL) {
+        poll_set_p->ready.head_p = elem_p;
+    } else {
+        poll_set_p->ready.tail_p->next_p = elem_p;
+    }
+
+    poll_set_p->ready.tail_p = elem_p;
+}
+
+struct chan_poll_set_elem_t *chan_poll_set_pop_isr(
+    struct chan_poll_set_t *self_p)
+{
+    struct chan_poll_set_elem_t *elem_p;
+
+    elem_p = self_p->ready.head_p;
+
+    if (elem_p != NULL) {
+        self_p->ready.head_p = elem_p->next_p;
+        elem_p->ready = 0;
+    }
+
+    return (elem_p);
+}
+
+/**
+ * The channel of given poll set element has data. Make it ready and
+ * resume the waiting thread.
+ */
+static void poll_set_ready_isr(struct chan_poll_set_elem_t *elem_p)
+{
+    struct chan_poll_set_t *poll_set_p;
+
+    poll_set_p = elem_p->poll_set_p;
+
+    if (elem_p->ready == 0) {
+        poll_set_append_isr(elem_p);
+    }
+
+    if (poll_set_p->thrd_p != NULL) {
+        thrd_resume_isr(poll_set_p->thrd_p, 0);
+        poll_set_p->thrd_p = NULL;
+    }
+}
+
 int chan_module_init(void)
 {
     return (0);
@@ -60,8 +115,10 @@ int chan_init(struct chan_t *self_p,
     self_p->control = chan_control_null;
     self_p->write_filter_cb = NULL;
     self_p->write_filter_isr_cb = NULL;
+    self_p->read_timeout = NULL;
     self_p->reader_p = NULL;
     self_p->list_p = NULL;
+    self_p->poll_set_elem_p = NULL;
 
     return (0);
 }
@@ -146,6 +203,16 @@ int chan_set_control_cb(struct chan_t *self_p,
     return (0);
 }
 
+int chan_set_read_timeout_cb(struct chan_t *self_p,
+                             chan_read_timeout_fn_t read_timeout_cb)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+
+    self_p->read_timeout = read_timeout_cb;
+
+    return (0);
+}
+
 ssize_t chan_read(void *self_p,
                   void *buf_p,
                   size_t size)
@@ -158,6 +225,31 @@ ssize_t chan_read(void *self_p,
     return (((struct chan_t *)self_p)->read(self_p, buf_p, size));
 }
 
+ssize_t chan_read_timeout(void *v_self_p,
+                          void *buf_p,
+                          size_t size,
+                          const struct time_t *timeout_p)
+{
+    ASSERTN(v_self_p != NULL, EINVAL);
+    ASSERTN(((struct chan_t *)v_self_p)->read != NULL, EINVAL);
+    ASSERTN(buf_p != NULL, EINVAL);
+    ASSERTN(size > 0, EINVAL);
+
+    struct chan_t *self_p;
+
+    self_p = v_self_p;
+
+    if (self_p->read_timeout != NULL) {
+        return (self_p->read_timeout(self_p, buf_p, size, timeout_p));
+    }
+
+    if (chan_poll(self_p, timeout_p) == NULL) {
+        return (-ETIMEDOUT);
+    }
+
+    return (self_p->read(self_p, buf_p, size));
+}
+
 ssize_t chan_write(void *v_self_p,
                    const void *buf_p,
                    size_t size)
@@ -346,6 +438,179 @@ void *chan_poll(void *chan_p, const struct time_t *timeout_p)
     return (chan_list_poll(&list, timeout_p));
 }
 
+int chan_poll_set_init(struct chan_poll_set_t *self_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+
+    self_p->ready.head_p = NULL;
+    self_p->ready.tail_p = NULL;
+    self_p->thrd_p = NULL;
+
+    return (0);
+}
+
+int chan_poll_set_add(struct chan_poll_set_t *self_p,
+                      struct chan_poll_set_elem_t *elem_p,
+                      void *v_chan_p,
+                      int mode)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(elem_p != NULL, EINVAL);
+    ASSERTN(v_chan_p != NULL, EINVAL);
+    ASSERTN((mode == CHAN_POLL_LEVEL_TRIGGERED)
+            || (mode == CHAN_POLL_EDGE_TRIGGERED), EINVAL);
+
+    struct chan_t *chan_p;
+    int res;
+
+    chan_p = v_chan_p;
+
+    sys_lock();
+
+    res = chan_poll_set_add_isr(self_p, elem_p, chan_p, mode);
+
+    /* Data may already be available. */
+    if ((res == 0) && (chan_p->size(chan_p) > 0)) {
+        poll_set_ready_isr(elem_p);
+    }
+
+    sys_unlock();
+
+    return (res);
+}
+
+int chan_poll_set_add_isr(struct chan_poll_set_t *self_p,
+                          struct chan_poll_set_elem_t *elem_p,
+                          void *v_chan_p,
+                          int mode)
+{
+    struct chan_t *chan_p;
+
+    chan_p = v_chan_p;
+
+    if (chan_p->poll_set_elem_p != NULL) {
+        return (-EBUSY);
+    }
+
+    elem_p->next_p = NULL;
+    elem_p->chan_p = chan_p;
+    elem_p->poll_set_p = self_p;
+    elem_p->mode = mode;
+    elem_p->ready = 0;
+    chan_p->poll_set_elem_p = elem_p;
+
+    return (0);
+}
+
+int chan_poll_set_remove(struct chan_poll_set_t *self_p, void *chan_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(chan_p != NULL, EINVAL);
+
+    int res;
+
+    sys_lock();
+    res = chan_poll_set_remove_isr(self_p, chan_p);
+    sys_unlock();
+
+    return (res);
+}
+
+int chan_poll_set_remove_isr(struct chan_poll_set_t *self_p, void *v_chan_p)
+{
+    struct chan_t *chan_p;
+    struct chan_poll_set_elem_t *elem_p;
+    struct chan_poll_set_elem_t *prev_p;
+    struct chan_poll_set_elem_t *curr_p;
+
+    chan_p = v_chan_p;
+    elem_p = chan_p->poll_set_elem_p;
+
+    if ((elem_p == NULL) || (elem_p->poll_set_p != self_p)) {
+        return (-ENOENT);
+    }
+
+    /* Remove the element from the ready list. */
+    if (elem_p->ready == 1) {
+        prev_p = NULL;
+        curr_p = self_p->ready.head_p;
+
+        while (curr_p != elem_p) {
+            prev_p = curr_p;
+            curr_p = curr_p->next_p;
+        }
+
+        if (prev_p == NULL) {
+            self_p->ready.head_p = elem_p->next_p;
+        } else {
+            prev_p->next_p = elem_p->next_p;
+        }
+
+        if (self_p->ready.tail_p == elem_p) {
+            self_p->ready.tail_p = prev_p;
+        }
+
+        elem_p->ready = 0;
+    }
+
+    elem_p->poll_set_p = NULL;
+    chan_p->poll_set_elem_p = NULL;
+
+    return (0);
+}
+
+void *chan_poll_set_wait(struct chan_poll_set_t *self_p,
+                         const struct time_t *timeout_p)
+{
+    ASSERTNRN(self_p != NULL, EINVAL);
+
+    struct chan_poll_set_elem_t *elem_p;
+    struct chan_t *chan_p;
+
+    chan_p = NULL;
+
+    sys_lock();
+
+    while (1) {
+        elem_p = chan_poll_set_pop_isr(self_p);
+
+        if (elem_p != NULL) {
+            chan_p = elem_p->chan_p;
+
+            if (elem_p->mode == CHAN_POLL_EDGE_TRIGGERED) {
+                break;
+            }
+
+            /* A level triggered channel stays in the ready list as
+               long as it has data. */
+            if (chan_p->size(chan_p) > 0) {
+                poll_set_append_isr(elem_p);
+                break;
+            }
+
+            chan_p = NULL;
+        } else {
+            /* Do not wait if the timeout is zero. */
+            if ((timeout_p != NULL)
+                && (timeout_p->seconds == 0)
+                && (timeout_p->nanoseconds == 0)) {
+                break;
+            }
+
+            self_p->thrd_p = thrd_self();
+
+            if (thrd_suspend_isr(timeout_p) == -ETIMEDOUT) {
+                self_p->thrd_p = NULL;
+                break;
+            }
+        }
+    }
+
+    sys_unlock();
+
+    return (chan_p);
+}
+
 void *chan_null(void)
 {
     return ((void *)&null);
@@ -382,6 +647,11 @@ RAM_CODE int chan_is_polled_isr(struct chan_t *self_p)
     struct chan_t *chan_p;
     struct chan_list_t *list_p;
 
+    /* Make the channel ready in its poll set. */
+    if (self_p->poll_set_elem_p != NULL) {
+        poll_set_ready_isr(self_p->poll_set_elem_p);
+    }
+
     list_p = self_p->list_p;
 
     /* Already resumed? */
@@ -64,6 +64,18 @@
  */
 #define CHAN_CONTROL_BLOCKING_READ                          6
 
+/**
+ * Level triggered polling. A channel is returned by
+ * `chan_poll_set_wait()` as long as it has data ready to be read.
+ */
+#define CHAN_POLL_LEVEL_TRIGGERED                           0
+
+/**
+ * Edge triggered polling. A channel is returned by
+ * `chan_poll_set_wait()` once after one or more writes to it.
+ */
+#define CHAN_POLL_EDGE_TRIGGERED                            1
+
 /**
  * Channel read function callback type.
  *
@@ -77,6 +89,21 @@ typedef ssize_t (*chan_read_fn_t)(void *self_p,
                                   void *buf_p,
                                   size_t size);
 
+/**
+ * Channel read with timeout function callback type.
+ *
+ * @param[in] self_p Channel to read from.
+ * @param[out] buf_p Buffer to read into.
+ * @param[in] size Number of bytes to read.
+ * @param[in] timeout_p Read timeout, or NULL to wait forever.
+ *
+ * @return Number of read bytes, -ETIMEDOUT or negative error code.
+ */
+typedef ssize_t (*chan_read_timeout_fn_t)(void *self_p,
+                                          void *buf_p,
+                                          size_t size,
+                                          const struct time_t *timeout_p);
+
 /**
  * Channel write function callback type.
  *
@@ -134,6 +161,30 @@ struct chan_list_t {
     size_t len;
 };
 
+/**
+ * A channel in a poll set.
+ */
+struct chan_poll_set_elem_t {
+    struct chan_poll_set_elem_t *next_p;
+    struct chan_t *chan_p;
+    struct chan_poll_set_t *poll_set_p;
+    int mode;
+    int ready;
+};
+
+/**
+ * A set of channels to poll, with a list of channels ready to be
+ * read.
+ */
+struct chan_poll_set_t {
+    struct {
+        struct chan_poll_set_elem_t *head_p;
+        struct chan_poll_set_elem_t *tail_p;
+    } ready;
+    /* Thread waiting for a channel to become ready. */
+    struct thrd_t *thrd_p;
+};
+
 /**
  * Channel datastructure.
  */
@@ -145,10 +196,13 @@ struct chan_t {
     chan_write_filter_fn_t write_filter_cb;
     chan_write_fn_t write_isr;
     chan_write_filter_fn_t write_filter_isr_cb;
+    chan_read_timeout_fn_t read_timeout;
     /* Reader thread waiting for data. */
     struct thrd_t *reader_p;
     /* Used by the reader when polling channels. */
     struct chan_list_t *list_p;
+    /* Poll set element, if added to a poll set. */
+    struct chan_poll_set_elem_t *poll_set_elem_p;
 };
 
 /**
@@ -248,6 +302,23 @@ int chan_set_write_filter_isr_cb(struct chan_t *self_p,
 int chan_set_control_cb(struct chan_t *self_p,
                         chan_control_fn_t control_cb);
 
+/**
+ * Set read with timeout function callback. Channels without it are
+ * polled before they are read in `chan_read_timeout()`.
+ *
+ * Queues and events set it. Rings, event groups, sockets and the
+ * driver channels, for example CAN and USB CDC, still use the poll
+ * and read fallback, which may block in the read after the poll
+ * returned.
+ *
+ * @param[in] self_p Initialized driver object.
+ * @param[in] read_timeout_cb Read with timeout function to set.
+ *
+ * @return zero(0) or negative error code.
+ */
+int chan_set_read_timeout_cb(struct chan_t *self_p,
+                             chan_read_timeout_fn_t read_timeout_cb);
+
 /**
  * Read data from given channel. The behaviour of this function
  * depends on the channel implementation. Often, the calling thread
@@ -263,6 +334,25 @@ ssize_t chan_read(void *self_p,
                   void *buf_p,
                   size_t size);
 
+/**
+ * Same as `chan_read()`, but give up if no data is available within
+ * given time. Channels without a read with timeout callback wait for
+ * data with `chan_poll()` and then read, and may block after the
+ * first byte if more than is available is requested.
+ *
+ * @param[in] self_p Channel to read from.
+ * @param[out] buf_p Buffer to read into.
+ * @param[in] size Number of bytes to read.
+ * @param[in] timeout_p Read timeout. Set to NULL to wait forever.
+ *
+ * @return Number of read bytes, -ETIMEDOUT if nothing was read
+ *         before the timeout, or negative error code.
+ */
+ssize_t chan_read_timeout(void *self_p,
+                          void *buf_p,
+                          size_t size,
+                          const struct time_t *timeout_p);
+
 /**
  * Write data to given channel. The behaviour of this function depends
  * on the channel implementation. Some channel implementations blocks
@@ -420,6 +510,101 @@ void *chan_list_poll(struct chan_list_t *self_p,
  */
 void *chan_poll(void *chan_p, const struct time_t *timeout_p);
 
+/**
+ * Initialize given poll set. A poll set is used to wait for data on
+ * many channels at the same time. Channels are added to the set once,
+ * and are then put in a ready list by the writers, so the time to
+ * wait for and get a ready channel does not depend on the number of
+ * channels in the set.
+ *
+ * @param[in] self_p Poll set to initialize.
+ *
+ * @return zero(0) or negative error code.
+ */
+int chan_poll_set_init(struct chan_poll_set_t *self_p);
+
+/**
+ * Add given channel to given poll set. A channel can only be in one
+ * poll set at a time.
+ *
+ * @param[in] self_p Poll set.
+ * @param[in] elem_p Element to use for the channel. Owned by the poll
+ *                   set until the channel is removed.
+ * @param[in] chan_p Channel to add.
+ * @param[in] mode `CHAN_POLL_LEVEL_TRIGGERED` or
+ *                 `CHAN_POLL_EDGE_TRIGGERED`.
+ *
+ * @return zero(0) or negative error code.
+ */
+int chan_poll_set_add(struct chan_poll_set_t *self_p,
+                      struct chan_poll_set_elem_t *elem_p,
+                      void *chan_p,
+                      int mode);
+
+/**
+ * Remove given channel from given poll set.
+ *
+ * @param[in] self_p Poll set.
+ * @param[in] chan_p Channel to remove.
+ *
+ * @return zero(0) or negative error code.
+ */
+int chan_poll_set_remove(struct chan_poll_set_t *self_p, void *chan_p);
+
+/**
+ * Add given channel to given poll set with the system lock
+ * taken. Unlike `chan_poll_set_add()`, the channel is not made ready
+ * if it already has data.
+ *
+ * @param[in] self_p Poll set.
+ * @param[in] elem_p Element to use for the channel.
+ * @param[in] chan_p Channel to add.
+ * @param[in] mode `CHAN_POLL_LEVEL_TRIGGERED` or
+ *                 `CHAN_POLL_EDGE_TRIGGERED`.
+ *
+ * @return zero(0) or negative error code.
+ */
+int chan_poll_set_add_isr(struct chan_poll_set_t *self_p,
+                          struct chan_poll_set_elem_t *elem_p,
+                          void *chan_p,
+                          int mode);
+
+/**
+ * Remove given channel from given poll set with the system lock
+ * taken.
+ *
+ * @param[in] self_p Poll set.
+ * @param[in] chan_p Channel to remove.
+ *
+ * @return zero(0) or negative error code.
+ */
+int chan_poll_set_remove_isr(struct chan_poll_set_t *self_p, void *chan_p);
+
+/**
+ * Remove the first element from the ready list of given poll set
+ * with the system lock taken. Unlike `chan_poll_set_wait()`, a level
+ * triggered channel is not put back in the ready list.
+ *
+ * @param[in] self_p Poll set.
+ *
+ * @return Ready element, or NULL if no channel is ready.
+ */
+struct chan_poll_set_elem_t *chan_poll_set_pop_isr(
+    struct chan_poll_set_t *self_p);
+
+/**
+ * Wait for a channel in given poll set to become ready to be read. At
+ * most one thread may wait on a poll set.
+ *
+ * @param[in] self_p Poll set to wait on.
+ * @param[in] timeout_p Time to wait for a ready channel before a
+ *                      timeout occurs. Set to NULL to wait forever.
+ *
+ * @return Ready channel or NULL on timeout.
+ */
+void *chan_poll_set_wait(struct chan_poll_set_t *self_p,
+                         const struct time_t *timeout_p);
+
 /**
  * Get a reference to the null channel. This channel will ignore all
  * written data but return that it was successfully written.
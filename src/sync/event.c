@@ -38,6 +38,8 @@ int event_init(struct event_t *self_p)
               (ssize_t (*)(void *, void *, size_t))event_read,
               (ssize_t (*)(void *, const void *, size_t))event_write,
               (size_t (*)(void *))event_size);
+    chan_set_read_timeout_cb(&self_p->base,
+                             (chan_read_timeout_fn_t)event_read_timeout);
 
     self_p->mask = 0;
     self_p->reader_mask = 0;
@@ -48,6 +50,14 @@ int event_init(struct event_t *self_p)
 ssize_t event_read(struct event_t *self_p,
                    void *buf_p,
                    size_t size)
+{
+    return (event_read_timeout(self_p, buf_p, size, NULL));
+}
+
+ssize_t event_read_timeout(struct event_t *self_p,
+                           void *buf_p,
+                           size_t size,
+                           const struct time_t *timeout_p)
 {
     ASSERTN(self_p != NULL, EINVAL);
     ASSERTN(buf_p != NULL, EINVAL);
@@ -67,7 +77,14 @@ ssize_t event_read(struct event_t *self_p,
     } else {
         self_p->reader_mask = *mask_p;
         self_p->base.reader_p = thrd_self();
-        thrd_suspend_isr(NULL);
+
+        if (thrd_suspend_isr(timeout_p) == -ETIMEDOUT) {
+            self_p->base.reader_p = NULL;
+            sys_unlock();
+
+            return (-ETIMEDOUT);
+        }
+
         *mask_p = (self_p->mask & *mask_p);
     }
 
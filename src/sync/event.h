@@ -69,6 +69,24 @@ ssize_t event_read(struct event_t *self_p,
                    void *buf_p,
                    size_t size);
 
+/**
+ * Same as `event_read()`, but give up if no event in the mask is
+ * written within given time.
+ *
+ * @param[in] self_p Event channel object.
+ * @param[in, out] buf_p The mask of events to wait for. When the
+ *                       function returns the mask contains the events
+ *                       that have occured.
+ * @param[in] size Size to read (always sizeof(mask)).
+ * @param[in] timeout_p Read timeout. Set to NULL to wait forever.
+ *
+ * @return sizeof(mask), -ETIMEDOUT on timeout or negative error code.
+ */
+ssize_t event_read_timeout(struct event_t *self_p,
+                           void *buf_p,
+                           size_t size,
+                           const struct time_t *timeout_p);
+
 /**
  * Write given event(s) to given event channel.
  *
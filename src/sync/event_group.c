@@ -0,0 +1,240 @@
+/**
+ * @section License
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017, Erik Moqvist
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+static int is_satisfied(uint32_t mask, uint32_t wait_mask, int flags)
+{
+    if (flags & EVENT_GROUP_WAIT_ALL) {
+        return ((mask & wait_mask) == wait_mask);
+    } else {
+        return ((mask & wait_mask) != 0);
+    }
+}
+
+/**
+ * Append given waiter to the list of waiters, so waiters satisfied by
+ * the same write are resumed in the order they started to wait.
+ */
+static void add_waiter_isr(struct event_group_t *self_p,
+                           struct event_group_waiter_t *waiter_p)
+{
+    struct event_group_waiter_t **curr_pp;
+
+    curr_pp = &self_p->waiters_p;
+
+    while (*curr_pp != NULL) {
+        curr_pp = &(*curr_pp)->next_p;
+    }
+
+    waiter_p->next_p = NULL;
+    *curr_pp = waiter_p;
+}
+
+/**
+ * Remove given waiter from the list of waiters.
+ */
+static int remove_waiter_isr(struct event_group_t *self_p,
+                             struct event_group_waiter_t *waiter_p)
+{
+    struct event_group_waiter_t **curr_pp;
+
+    for (curr_pp = &self_p->waiters_p;
+         *curr_pp != NULL;
+         curr_pp = &(*curr_pp)->next_p) {
+        if (*curr_pp == waiter_p) {
+            *curr_pp = waiter_p->next_p;
+
+            return (0);
+        }
+    }
+
+    return (-1);
+}
+
+int event_group_init(struct event_group_t *self_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+
+    chan_init(&self_p->base,
+              (chan_read_fn_t)event_group_read,
+              (chan_write_fn_t)event_group_write,
+              (chan_size_fn_t)event_group_size);
+    chan_set_write_isr_cb(&self_p->base,
+                          (chan_write_fn_t)event_group_write_isr);
+
+    self_p->mask = 0;
+    self_p->waiters_p = NULL;
+
+    return (0);
+}
+
+int event_group_wait(struct event_group_t *self_p,
+                     uint32_t *mask_p,
+                     int flags,
+                     const struct time_t *timeout_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(mask_p != NULL, EINVAL);
+
+    int res;
+    struct event_group_waiter_t waiter;
+
+    res = 0;
+
+    sys_lock();
+
+    if (is_satisfied(self_p->mask, *mask_p, flags)) {
+        *mask_p &= self_p->mask;
+
+        if (flags & EVENT_GROUP_CLEAR) {
+            self_p->mask &= ~(*mask_p);
+        }
+    } else if ((timeout_p != NULL)
+               && (timeout_p->seconds == 0)
+               && (timeout_p->nanoseconds == 0)) {
+        res = -ETIMEDOUT;
+    } else {
+        waiter.thrd_p = thrd_self();
+        waiter.mask = *mask_p;
+        waiter.flags = flags;
+        add_waiter_isr(self_p, &waiter);
+
+        res = thrd_suspend_isr(timeout_p);
+
+        /* The writer removes the waiter when the wait is
+           satisfied. */
+        if (res == 0) {
+            *mask_p = waiter.mask;
+        } else {
+            remove_waiter_isr(self_p, &waiter);
+        }
+    }
+
+    sys_unlock();
+
+    return (res);
+}
+
+ssize_t event_group_read(struct event_group_t *self_p,
+                         void *buf_p,
+                         size_t size)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(buf_p != NULL, EINVAL);
+    ASSERTN(size == sizeof(uint32_t), EINVAL);
+
+    int res;
+
+    res = event_group_wait(self_p,
+                           buf_p,
+                           EVENT_GROUP_WAIT_ANY | EVENT_GROUP_CLEAR,
+                           NULL);
+
+    if (res != 0) {
+        return (res);
+    }
+
+    return (size);
+}
+
+ssize_t event_group_write(struct event_group_t *self_p,
+                          const void *buf_p,
+                          size_t size)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(buf_p != NULL, EINVAL);
+    ASSERTN(size == sizeof(uint32_t), EINVAL);
+
+    sys_lock();
+    size = event_group_write_isr(self_p, buf_p, size);
+    sys_unlock();
+
+    return (size);
+}
+
+ssize_t event_group_write_isr(struct event_group_t *self_p,
+                              const void *buf_p,
+                              size_t size)
+{
+    struct event_group_waiter_t **curr_pp;
+    struct event_group_waiter_t *waiter_p;
+    uint32_t clear_mask;
+
+    if (chan_is_polled_isr(&self_p->base)) {
+        thrd_resume_isr(self_p->base.reader_p, 0);
+        self_p->base.reader_p = NULL;
+    }
+
+    self_p->mask |= *(uint32_t *)buf_p;
+    clear_mask = 0;
+    curr_pp = &self_p->waiters_p;
+
+    /* Resume all satisfied waiters in one pass. Events are cleared
+       after the pass, so all waiters see the same events. */
+    while (*curr_pp != NULL) {
+        waiter_p = *curr_pp;
+
+        if (is_satisfied(self_p->mask, waiter_p->mask, waiter_p->flags)) {
+            *curr_pp = waiter_p->next_p;
+            waiter_p->mask &= self_p->mask;
+
+            if (waiter_p->flags & EVENT_GROUP_CLEAR) {
+                clear_mask |= waiter_p->mask;
+            }
+
+            thrd_resume_isr(waiter_p->thrd_p, 0);
+        } else {
+            curr_pp = &waiter_p->next_p;
+        }
+    }
+
+    self_p->mask &= ~clear_mask;
+
+    return (size);
+}
+
+ssize_t event_group_size(struct event_group_t *self_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+
+    return (self_p->mask != 0);
+}
+
+int event_group_clear(struct event_group_t *self_p, uint32_t mask)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+
+    sys_lock();
+    self_p->mask &= ~mask;
+    sys_unlock();
+
+    return (0);
+}
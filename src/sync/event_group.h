@@ -0,0 +1,162 @@
+/**
+ * @section License
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017, Erik Moqvist
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * This file is part of the Simba project.
+ */
+
+#ifndef __SYNC_EVENT_GROUP_H__
+#define __SYNC_EVENT_GROUP_H__
+
+#include "simba.h"
+
+/**
+ * Wait for at least one of the events in the mask.
+ */
+#define EVENT_GROUP_WAIT_ANY                                0x0
+
+/**
+ * Wait for all events in the mask.
+ */
+#define EVENT_GROUP_WAIT_ALL                                0x1
+
+/**
+ * Clear the waited for events when the wait is satisfied.
+ */
+#define EVENT_GROUP_CLEAR                                   0x2
+
+/**
+ * A thread waiting for events.
+ */
+struct event_group_waiter_t {
+    struct event_group_waiter_t *next_p;
+    struct thrd_t *thrd_p;
+    uint32_t mask;
+    int flags;
+};
+
+/**
+ * Event group channel.
+ */
+struct event_group_t {
+    struct chan_t base;
+    /* Events that occured. */
+    uint32_t mask;
+    /* Threads waiting for events. */
+    struct event_group_waiter_t *waiters_p;
+};
+
+/**
+ * Initialize given event group.
+ *
+ * @param[in] self_p Event group to initialize.
+ *
+ * @return zero(0) or negative error code
+ */
+int event_group_init(struct event_group_t *self_p);
+
+/**
+ * Wait for events in given event group. Any number of threads may
+ * wait for events at the same time, each with its own mask and
+ * flags. Waiters satisfied by the same write are resumed in the order
+ * they started to wait.
+ *
+ * @param[in] self_p Event group.
+ * @param[in, out] mask_p The mask of events to wait for. When the
+ *                        function returns the mask contains the
+ *                        events in the mask that have occured.
+ * @param[in] flags `EVENT_GROUP_WAIT_ANY` or `EVENT_GROUP_WAIT_ALL`,
+ *                  optionally or:ed with `EVENT_GROUP_CLEAR`.
+ * @param[in] timeout_p Time to wait for the events before a timeout
+ *                      occurs. Set to NULL to wait forever.
+ *
+ * @return zero(0) or negative error code. -ETIMEDOUT on timeout, or
+ *         the error code given to `thrd_resume()` if the waiting
+ *         thread was resumed by other means than a write.
+ */
+int event_group_wait(struct event_group_t *self_p,
+                     uint32_t *mask_p,
+                     int flags,
+                     const struct time_t *timeout_p);
+
+/**
+ * Wait for at least one of the events in given mask, and clear the
+ * read events. Same as `event_read()` for event channels.
+ *
+ * @param[in] self_p Event group.
+ * @param[in, out] buf_p The mask of events to wait for. When the
+ *                       function returns the mask contains the events
+ *                       that have occured.
+ * @param[in] size Size to read (always sizeof(mask)).
+ *
+ * @return sizeof(mask) or negative error code.
+ */
+ssize_t event_group_read(struct event_group_t *self_p,
+                         void *buf_p,
+                         size_t size);
+
+/**
+ * Write given event(s) to given event group. All waiting threads with
+ * satisfied waits are resumed.
+ *
+ * @param[in] self_p Event group.
+ * @param[in] buf_p The mask of events to write.
+ * @param[in] size Must always be sizeof(mask).
+ *
+ * @return sizeof(mask) or negative error code.
+ */
+ssize_t event_group_write(struct event_group_t *self_p,
+                          const void *buf_p,
+                          size_t size);
+
+/**
+ * Same as `event_group_write()` but from isr or with the system lock
+ * taken (see `sys_lock()`).
+ */
+ssize_t event_group_write_isr(struct event_group_t *self_p,
+                              const void *buf_p,
+                              size_t size);
+
+/**
+ * Checks if there are events active in given event group.
+ *
+ * @param[in] self_p Event group.
+ *
+ * @return one(1) is at least one event is active, otherwise zero(0).
+ */
+ssize_t event_group_size(struct event_group_t *self_p);
+
+/**
+ * Clear given events in given event group.
+ *
+ * @param[in] self_p Event group.
+ * @param[in] mask The mask of events to clear.
+ *
+ * @return zero(0) or negative error code.
+ */
+int event_group_clear(struct event_group_t *self_p, uint32_t mask);
+
+#endif
@@ -30,6 +30,333 @@
 
 #include "simba.h"
 
+/*
+ * The owner is set with compare-and-swap. A thread that fails to lock
+ * the mutex sets the waiters flag before it checks the owner again,
+ * and a thread that unlocks the mutex clears the owner before it
+ * checks the waiters flag, so at least one of them sees the other.
+ * Everything else is done with the system lock taken.
+ */
+
+static struct thrd_t *owner_load(struct mutex_t *self_p)
+{
+#if CONFIG_MUTEX_FAST_PATH == 1
+    return (__atomic_load_n(&self_p->owner_p, __ATOMIC_SEQ_CST));
+#else
+    return (self_p->owner_p);
+#endif
+}
+
+static void owner_store(struct mutex_t *self_p, struct thrd_t *thrd_p)
+{
+#if CONFIG_MUTEX_FAST_PATH == 1
+    __atomic_store_n(&self_p->owner_p, thrd_p, __ATOMIC_SEQ_CST);
+#else
+    self_p->owner_p = thrd_p;
+#endif
+}
+
+/**
+ * Set the owner of given mutex to given thread if it is unlocked.
+ *
+ * @return true(1) if the owner was set, otherwise false(0).
+ */
+static int owner_take(struct mutex_t *self_p, struct thrd_t *thrd_p)
+{
+#if CONFIG_MUTEX_FAST_PATH == 1
+    struct thrd_t *expected_p;
+
+    expected_p = NULL;
+
+    return (__atomic_compare_exchange_n(&self_p->owner_p,
+                                        &expected_p,
+                                        thrd_p,
+                                        0,
+                                        __ATOMIC_SEQ_CST,
+                                        __ATOMIC_RELAXED));
+#else
+    if (self_p->owner_p != NULL) {
+        return (0);
+    }
+
+    self_p->owner_p = thrd_p;
+
+    return (1);
+#endif
+}
+
+static int has_waiters_load(struct mutex_t *self_p)
+{
+#if CONFIG_MUTEX_FAST_PATH == 1
+    return (__atomic_load_n(&self_p->has_waiters, __ATOMIC_SEQ_CST));
+#else
+    return (self_p->has_waiters);
+#endif
+}
+
+static void has_waiters_store(struct mutex_t *self_p, int has_waiters)
+{
+#if CONFIG_MUTEX_FAST_PATH == 1
+    __atomic_store_n(&self_p->has_waiters, has_waiters, __ATOMIC_SEQ_CST);
+#else
+    self_p->has_waiters = has_waiters;
+#endif
+}
+
+#if CONFIG_MUTEX_PRIO_INHERIT == 1
+
+/**
+ * Set the effective priority of given thread. A thread waiting for a
+ * mutex is moved to its new position in the wait list.
+ */
+static void set_prio(struct thrd_t *thrd_p, int prio)
+{
+    struct mutex_t *mutex_p;
+
+    mutex_p = thrd_p->mutex.waiting_for_p;
+
+    if (mutex_p != NULL) {
+        thrd_prio_list_remove_isr(&mutex_p->waiters, thrd_p->mutex.elem_p);
+        thrd_p->prio = prio;
+        thrd_prio_list_push_isr(&mutex_p->waiters, thrd_p->mutex.elem_p);
+    } else {
+        thrd_set_effective_prio_isr(thrd_p, prio);
+    }
+}
+
+/**
+ * Boost the holder of given mutex to given priority, and then the
+ * holder of the mutex that holder waits for, and so on.
+ */
+static void inherit_prio(struct mutex_t *self_p, int prio)
+{
+    struct thrd_t *holder_p;
+
+    holder_p = self_p->holder_p;
+
+    while ((holder_p != NULL) && (prio < holder_p->prio)) {
+        set_prio(holder_p, prio);
+
+        if (holder_p->mutex.waiting_for_p == NULL) {
+            break;
+        }
+
+        holder_p = holder_p->mutex.waiting_for_p->holder_p;
+    }
+}
+
+/**
+ * Priority of given thread given its own priority and the waiters of
+ * all mutexes it holds.
+ */
+static int held_prio(struct thrd_t *thrd_p)
+{
+    struct mutex_t *mutex_p;
+    struct thrd_prio_list_elem_t *elem_p;
+    int prio;
+
+    prio = thrd_p->mutex.prio;
+    mutex_p = thrd_p->mutex.held_p;
+
+    while (mutex_p != NULL) {
+        elem_p = thrd_prio_list_peek_isr(&mutex_p->waiters);
+
+        if ((elem_p != NULL) && (elem_p->thrd_p->prio < prio)) {
+            prio = elem_p->thrd_p->prio;
+        }
+
+        mutex_p = mutex_p->next_p;
+    }
+
+    return (prio);
+}
+
+/**
+ * Drop priorities inherited from a waiter that stopped waiting for
+ * given mutex, along the chain of holders. Also updates the chain
+ * when the priority of a waiter changed.
+ */
+static void disinherit_prio(struct mutex_t *self_p)
+{
+    struct thrd_t *holder_p;
+    int prio;
+
+    holder_p = self_p->holder_p;
+
+    while (holder_p != NULL) {
+        prio = held_prio(holder_p);
+
+        if (prio == holder_p->prio) {
+            break;
+        }
+
+        set_prio(holder_p, prio);
+
+        if (holder_p->mutex.waiting_for_p == NULL) {
+            break;
+        }
+
+        holder_p = holder_p->mutex.waiting_for_p->holder_p;
+    }
+}
+
+/**
+ * Remove given mutex from the held list of its holder, which drops
+ * the priority inherited through it.
+ */
+static void detach_holder(struct mutex_t *self_p)
+{
+    struct thrd_t *holder_p;
+    struct mutex_t **mutex_pp;
+
+    holder_p = self_p->holder_p;
+
+    if (holder_p == NULL) {
+        return;
+    }
+
+    mutex_pp = &holder_p->mutex.held_p;
+
+    while (*mutex_pp != self_p) {
+        mutex_pp = &(*mutex_pp)->next_p;
+    }
+
+    *mutex_pp = self_p->next_p;
+    self_p->next_p = NULL;
+    self_p->holder_p = NULL;
+
+    set_prio(holder_p, held_prio(holder_p));
+}
+
+/**
+ * Add given mutex to the held list of given thread, which then
+ * inherits the priority of the waiters.
+ */
+static void attach_holder(struct mutex_t *self_p, struct thrd_t *thrd_p)
+{
+    if (self_p->holder_p == thrd_p) {
+        return;
+    }
+
+    detach_holder(self_p);
+
+    self_p->holder_p = thrd_p;
+    self_p->next_p = thrd_p->mutex.held_p;
+    thrd_p->mutex.held_p = self_p;
+}
+
+#endif
+
+/**
+ * Hand over given unlocked mutex to the first waiter, if any. Called
+ * with the system lock taken.
+ */
+static void wake_isr(struct mutex_t *self_p)
+{
+    struct thrd_prio_list_elem_t *elem_p;
+    struct thrd_t *owner_p;
+
+#if CONFIG_MUTEX_PRIO_INHERIT == 1
+    /* Drop the priority inherited through this mutex. */
+    detach_holder(self_p);
+#endif
+
+    elem_p = thrd_prio_list_peek_isr(&self_p->waiters);
+
+    if (elem_p == NULL) {
+        has_waiters_store(self_p, 0);
+
+        return;
+    }
+
+    if (owner_take(self_p, elem_p->thrd_p)) {
+        thrd_prio_list_remove_isr(&self_p->waiters, elem_p);
+
+        if (thrd_prio_list_peek_isr(&self_p->waiters) == NULL) {
+            has_waiters_store(self_p, 0);
+        }
+
+#if CONFIG_MUTEX_PRIO_INHERIT == 1
+        /* The new owner inherits the priority of the remaining
+           waiters. */
+        elem_p->thrd_p->mutex.waiting_for_p = NULL;
+        elem_p->thrd_p->mutex.elem_p = NULL;
+
+        if (self_p->has_waiters == 1) {
+            attach_holder(self_p, elem_p->thrd_p);
+        }
+
+        elem_p->thrd_p->prio = held_prio(elem_p->thrd_p);
+#endif
+        thrd_resume_isr(elem_p->thrd_p, 0);
+    } else {
+        /* Locked by another thread without the system lock. That
+           thread wakes the waiters when unlocking the mutex, as the
+           waiters flag is set. */
+        owner_p = owner_load(self_p);
+
+#if CONFIG_MUTEX_PRIO_INHERIT == 1
+        if (owner_p != NULL) {
+            attach_holder(self_p, owner_p);
+            inherit_prio(self_p, elem_p->thrd_p->prio);
+        }
+#else
+        (void)owner_p;
+#endif
+    }
+}
+
+/**
+ * Lock given mutex with the system lock taken, waiting at most given
+ * time.
+ */
+static int lock_isr(struct mutex_t *self_p, const struct time_t *timeout_p)
+{
+    struct thrd_prio_list_elem_t elem;
+    struct thrd_t *owner_p;
+    int res;
+
+    elem.thrd_p = thrd_self();
+
+    while (1) {
+        if (owner_take(self_p, elem.thrd_p)) {
+            return (0);
+        }
+
+        /* Set the waiters flag before checking the owner again, as
+           the owner may have unlocked the mutex without the system
+           lock. */
+        has_waiters_store(self_p, 1);
+        owner_p = owner_load(self_p);
+
+        if (owner_p != NULL) {
+            break;
+        }
+    }
+
+    thrd_prio_list_push_isr(&self_p->waiters, &elem);
+#if CONFIG_MUTEX_PRIO_INHERIT == 1
+    attach_holder(self_p, owner_p);
+    elem.thrd_p->mutex.waiting_for_p = self_p;
+    elem.thrd_p->mutex.elem_p = &elem;
+    inherit_prio(self_p, elem.thrd_p->prio);
+#endif
+    res = thrd_suspend_isr(timeout_p);
+
+    /* The lock is handed over by the unlocker, unless the wait timed
+       out. */
+    if (res == -ETIMEDOUT) {
+        thrd_prio_list_remove_isr(&self_p->waiters, &elem);
+#if CONFIG_MUTEX_PRIO_INHERIT == 1
+        elem.thrd_p->mutex.waiting_for_p = NULL;
+        elem.thrd_p->mutex.elem_p = NULL;
+        disinherit_prio(self_p);
+#endif
+    }
+
+    return (res);
+}
+
 int mutex_module_init(void)
 {
     return (0);
@@ -37,8 +364,13 @@ int mutex_module_init(void)
 
 int mutex_init(struct mutex_t *self_p)
 {
-    self_p->is_locked = 0;
+    self_p->owner_p = NULL;
+    self_p->has_waiters = 0;
     thrd_prio_list_init(&self_p->waiters);
+#if CONFIG_MUTEX_PRIO_INHERIT == 1
+    self_p->holder_p = NULL;
+    self_p->next_p = NULL;
+#endif
 
     return (0);
 }
@@ -47,6 +379,12 @@ int mutex_lock(struct mutex_t *self_p)
 {
     int res;
 
+#if CONFIG_MUTEX_FAST_PATH == 1
+    if (owner_take(self_p, thrd_self())) {
+        return (0);
+    }
+#endif
+
     sys_lock();
     res = mutex_lock_isr(self_p);
     sys_unlock();
@@ -58,6 +396,27 @@ int mutex_unlock(struct mutex_t *self_p)
 {
     int res;
 
+#if CONFIG_MUTEX_FAST_PATH == 1
+    struct thrd_t *owner_p;
+
+    owner_p = thrd_self();
+
+    if (__atomic_compare_exchange_n(&self_p->owner_p,
+                                    &owner_p,
+                                    NULL,
+                                    0,
+                                    __ATOMIC_SEQ_CST,
+                                    __ATOMIC_RELAXED)) {
+        if (has_waiters_load(self_p) == 1) {
+            sys_lock();
+            wake_isr(self_p);
+            sys_unlock();
+        }
+
+        return (0);
+    }
+#endif
+
     sys_lock();
     res = mutex_unlock_isr(self_p);
     sys_unlock();
@@ -65,32 +424,59 @@ int mutex_unlock(struct mutex_t *self_p)
     return (res);
 }
 
-int mutex_lock_isr(struct mutex_t *self_p)
+int mutex_lock_timeout(struct mutex_t *self_p,
+                       const struct time_t *timeout_p)
 {
-    struct thrd_prio_list_elem_t elem;
+    int res;
 
-    if (self_p->is_locked == 1) {
-        elem.thrd_p = thrd_self();
-        thrd_prio_list_push_isr(&self_p->waiters, &elem);
-        thrd_suspend_isr(NULL);
-    } else {
-        self_p->is_locked = 1;
+#if CONFIG_MUTEX_FAST_PATH == 1
+    if (owner_take(self_p, thrd_self())) {
+        return (0);
     }
+#endif
+
+    sys_lock();
+    res = lock_isr(self_p, timeout_p);
+    sys_unlock();
+
+    return (res);
+}
+
+int mutex_lock_isr(struct mutex_t *self_p)
+{
+    lock_isr(self_p, NULL);
 
     return (0);
 }
 
 int mutex_unlock_isr(struct mutex_t *self_p)
 {
-    struct thrd_prio_list_elem_t *elem_p;
-
-    elem_p = thrd_prio_list_pop_isr(&self_p->waiters);
+    owner_store(self_p, NULL);
 
-    if (elem_p != NULL) {
-        thrd_resume_isr(elem_p->thrd_p, 0);
-    } else {
-        self_p->is_locked = 0;
+    if (has_waiters_load(self_p) == 1) {
+        wake_isr(self_p);
     }
 
     return (0);
 }
+
+#if CONFIG_MUTEX_PRIO_INHERIT == 1
+
+void mutex_set_prio_isr(struct thrd_t *thrd_p, int prio)
+{
+    thrd_p->mutex.prio = prio;
+    prio = held_prio(thrd_p);
+
+    if (prio == thrd_p->prio) {
+        return;
+    }
+
+    set_prio(thrd_p, prio);
+
+    /* The holders this thread waits for inherit the new priority. */
+    if (thrd_p->mutex.waiting_for_p != NULL) {
+        disinherit_prio(thrd_p->mutex.waiting_for_p);
+    }
+}
+
+#endif
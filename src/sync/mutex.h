@@ -34,10 +34,18 @@
 #include "simba.h"
 
 struct mutex_t {
-    /** Mutex lock state. */
-    int8_t is_locked;
+    /** Thread holding the lock, or NULL if unlocked. */
+    struct thrd_t *owner_p;
+    /** Set when threads may be waiting for the lock. */
+    int8_t has_waiters;
     /** Wait list. */
     struct thrd_prio_list_t waiters;
+#if CONFIG_MUTEX_PRIO_INHERIT == 1
+    /** Thread inheriting the priority of the waiters. */
+    struct thrd_t *holder_p;
+    /** Next mutex with waiters held by the holder. */
+    struct mutex_t *next_p;
+#endif
 };
 
 /**
@@ -69,6 +77,18 @@ int mutex_init(struct mutex_t *self_p);
  */
 int mutex_lock(struct mutex_t *self_p);
 
+/**
+ * Lock given mutex, or give up after given timeout.
+ *
+ * @param[in] self_p Mutex to lock.
+ * @param[in] timeout_p Time to wait for the mutex before a timeout
+ *                      occurs. Set to NULL to wait forever.
+ *
+ * @return zero(0) or negative error code. -ETIMEDOUT on timeout.
+ */
+int mutex_lock_timeout(struct mutex_t *self_p,
+                       const struct time_t *timeout_p);
+
 /**
  * Unlock given mutex.
  *
@@ -96,4 +116,20 @@ int mutex_lock_isr(struct mutex_t *self_p);
  */
 int mutex_unlock_isr(struct mutex_t *self_p);
 
+#if CONFIG_MUTEX_PRIO_INHERIT == 1
+
+/**
+ * Set the own priority of given thread, keeping any priority
+ * inherited from waiters of mutexes it holds. A thread waiting for a
+ * mutex is moved to its new position in the wait list, and the
+ * holders it waits for inherit its new priority. Called by
+ * `thrd_set_prio_isr()` with the system lock taken.
+ *
+ * @param[in] thrd_p Thread to set the priority of.
+ * @param[in] prio New own priority.
+ */
+void mutex_set_prio_isr(struct thrd_t *thrd_p, int prio);
+
+#endif
+
 #endif
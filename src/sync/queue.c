@@ -81,6 +81,8 @@ int queue_init(struct queue_t *self_p,
               (chan_size_fn_t)queue_size);
     chan_set_write_isr_cb(&self_p->base, (chan_write_fn_t)queue_write_isr);
     chan_set_control_cb(&self_p->base, (chan_control_fn_t)control);
+    chan_set_read_timeout_cb(&self_p->base,
+                             (chan_read_timeout_fn_t)queue_read_timeout);
 
     thrd_prio_list_init(&self_p->writers);
 
@@ -152,6 +154,14 @@ RAM_CODE int queue_stop_isr(struct queue_t *self_p)
 }
 
 ssize_t queue_read(struct queue_t *self_p, void *buf_p, size_t size)
+{
+    return (queue_read_timeout(self_p, buf_p, size, NULL));
+}
+
+ssize_t queue_read_timeout(struct queue_t *self_p,
+                           void *buf_p,
+                           size_t size,
+                           const struct time_t *timeout_p)
 {
     ASSERTN(self_p != NULL, EINVAL);
     ASSERTN(buf_p != NULL, EINVAL);
@@ -211,7 +221,18 @@ ssize_t queue_read(struct queue_t *self_p, void *buf_p, size_t size)
             self_p->reader.size = size;
             self_p->reader.left = left;
 
-            size = thrd_suspend_isr(NULL);
+            size = thrd_suspend_isr(timeout_p);
+
+            /* Return what was read before the timeout, if
+               anything. */
+            if (size == -ETIMEDOUT) {
+                self_p->base.reader_p = NULL;
+                size = (self_p->reader.size - self_p->reader.left);
+
+                if (size == 0) {
+                    size = -ETIMEDOUT;
+                }
+            }
         }
     }
 
@@ -223,6 +244,14 @@ ssize_t queue_read(struct queue_t *self_p, void *buf_p, size_t size)
 ssize_t queue_write(struct queue_t *self_p,
                     const void *buf_p,
                     size_t size)
+{
+    return (queue_write_timeout(self_p, buf_p, size, NULL));
+}
+
+ssize_t queue_write_timeout(struct queue_t *self_p,
+                            const void *buf_p,
+                            size_t size,
+                            const struct time_t *timeout_p)
 {
     ASSERTN(self_p != NULL, EINVAL);
     ASSERTN(buf_p != NULL, EINVAL);
@@ -257,7 +286,27 @@ ssize_t queue_write(struct queue_t *self_p,
                                         (struct thrd_prio_list_elem_t *)&elem);
             }
 
-            res = thrd_suspend_isr(NULL);
+            res = thrd_suspend_isr(timeout_p);
+
+            /* Leave the writers and return what was read by the
+               reader before the timeout, if anything. */
+            if (res == -ETIMEDOUT) {
+                if (self_p->writer_p == &elem) {
+                    self_p->writer_p =
+                        (struct queue_writer_elem_t *)thrd_prio_list_pop_isr(
+                            &self_p->writers);
+                } else {
+                    thrd_prio_list_remove_isr(
+                        &self_p->writers,
+                        (struct thrd_prio_list_elem_t *)&elem);
+                }
+
+                res = (size - elem.left);
+
+                if (res == 0) {
+                    res = -ETIMEDOUT;
+                }
+            }
         }
     }
 
@@ -381,3 +430,143 @@ ssize_t queue_ignore(struct queue_t *self_p,
 
     return (size - left);
 }
+
+ssize_t queue_write_reserve(struct queue_t *self_p,
+                            struct queue_view_t *view_p,
+                            size_t size)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(view_p != NULL, EINVAL);
+    ASSERTN(self_p->buf_p != NULL, EINVAL);
+
+    ssize_t res;
+
+    view_p->arrays[0].buf_p = NULL;
+    view_p->arrays[1].buf_p = NULL;
+
+    sys_lock();
+
+    /* Write is not possible to a stopped queue. */
+    if (self_p->state == QUEUE_STATE_STOPPED) {
+        res = -1;
+    } else {
+        view_p->arrays[0].size = circular_buffer_unused_array_one(
+            &self_p->buffer,
+            &view_p->arrays[0].buf_p,
+            size);
+        view_p->arrays[1].size = circular_buffer_unused_array_two(
+            &self_p->buffer,
+            &view_p->arrays[1].buf_p,
+            size - view_p->arrays[0].size);
+        res = (view_p->arrays[0].size + view_p->arrays[1].size);
+    }
+
+    sys_unlock();
+
+    return (res);
+}
+
+ssize_t queue_write_commit(struct queue_t *self_p,
+                           size_t size)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(self_p->buf_p != NULL, EINVAL);
+
+    size_t n;
+
+    sys_lock();
+
+    size = circular_buffer_skip_back(&self_p->buffer, size);
+
+    /* Resume any polling thread. */
+    if (chan_is_polled_isr(&self_p->base)) {
+        thrd_resume_isr(self_p->base.reader_p, 0);
+        self_p->base.reader_p = NULL;
+    }
+
+    /* Copy data to the reader, if one is present. The buffer is empty
+       when the reader waits, so the order of the data is kept. */
+    if (self_p->base.reader_p != NULL) {
+        n = circular_buffer_read(&self_p->buffer,
+                                 self_p->reader.buf_p,
+                                 self_p->reader.left);
+        self_p->reader.buf_p += n;
+        self_p->reader.left -= n;
+
+        /* Read buffer full. */
+        if (self_p->reader.left == 0) {
+            /* Wake the reader. */
+            thrd_resume_isr(self_p->base.reader_p, self_p->reader.size);
+            self_p->base.reader_p = NULL;
+        }
+    }
+
+    sys_unlock();
+
+    return (size);
+}
+
+ssize_t queue_read_peek(struct queue_t *self_p,
+                        struct queue_view_t *view_p,
+                        size_t size)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(view_p != NULL, EINVAL);
+    ASSERTN(self_p->buf_p != NULL, EINVAL);
+
+    view_p->arrays[0].buf_p = NULL;
+    view_p->arrays[1].buf_p = NULL;
+
+    sys_lock();
+    view_p->arrays[0].size = circular_buffer_array_one(
+        &self_p->buffer,
+        &view_p->arrays[0].buf_p,
+        size);
+    view_p->arrays[1].size = circular_buffer_array_two(
+        &self_p->buffer,
+        &view_p->arrays[1].buf_p,
+        size - view_p->arrays[0].size);
+    sys_unlock();
+
+    return (view_p->arrays[0].size + view_p->arrays[1].size);
+}
+
+ssize_t queue_read_release(struct queue_t *self_p,
+                           size_t size)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(self_p->buf_p != NULL, EINVAL);
+
+    size_t n;
+
+    sys_lock();
+
+    size = circular_buffer_skip_front(&self_p->buffer, size);
+
+    /* Move data from the writers to the released space. */
+    while (self_p->writer_p != NULL) {
+        n = circular_buffer_write(&self_p->buffer,
+                                  self_p->writer_p->buf_p,
+                                  self_p->writer_p->left);
+        self_p->writer_p->buf_p += n;
+        self_p->writer_p->left -= n;
+
+        /* Queue buffer full. */
+        if (self_p->writer_p->left > 0) {
+            break;
+        }
+
+        /* Wake the writer. */
+        thrd_resume_isr(self_p->writer_p->base.thrd_p,
+                        self_p->writer_p->size);
+
+        /* More writers waiting? */
+        self_p->writer_p =
+            (struct queue_writer_elem_t *)thrd_prio_list_pop_isr(
+                &self_p->writers);
+    }
+
+    sys_unlock();
+
+    return (size);
+}
@@ -43,12 +43,13 @@
             .write = (chan_write_fn_t)queue_write,      \
             .size = (chan_size_fn_t)queue_size,         \
             .control = chan_control_null,               \
+            .read_timeout =                             \
+                (chan_read_timeout_fn_t)queue_read_timeout, \
             .reader_p = NULL,                           \
-            .list_p = NULL                              \
-        },                                              \
-        .writers = {                                    \
-            .head_p = NULL,                             \
+            .list_p = NULL,                             \
+            .poll_set_elem_p = NULL                     \
         },                                              \
+        .writers = THRD_PRIO_LIST_INIT_STRUCT,          \
         .writer_p = NULL,                               \
         .buf_p = _buf,                                  \
         .buffer = {                                     \
@@ -76,6 +77,17 @@ enum queue_state_t {
     QUEUE_STATE_STOPPED,
 };
 
+/**
+ * A view of up to two arrays in the queue buffer, for in place
+ * access. The second array follows a wrap around of the first array.
+ */
+struct queue_view_t {
+    struct {
+        void *buf_p;
+        size_t size;
+    } arrays[2];
+};
+
 /* Queue. */
 struct queue_t {
     struct chan_t base;
@@ -150,6 +162,23 @@ ssize_t queue_read(struct queue_t *self_p,
                    void *buf_p,
                    size_t size);
 
+/**
+ * Same as `queue_read()`, but give up after given timeout.
+ *
+ * @param[in] self_p Queue to read from.
+ * @param[out] buf_p Buffer to read into.
+ * @param[in] size Number of bytes to read.
+ * @param[in] timeout_p Read timeout. Set to NULL to wait forever.
+ *
+ * @return Number of bytes read, which is less than size on timeout,
+ *         -ETIMEDOUT if no bytes were read before the timeout, or
+ *         negative error code.
+ */
+ssize_t queue_read_timeout(struct queue_t *self_p,
+                           void *buf_p,
+                           size_t size,
+                           const struct time_t *timeout_p);
+
 /**
  * Write bytes to given queue. Blocks until size bytes has been
  * written.
@@ -164,6 +193,23 @@ ssize_t queue_write(struct queue_t *self_p,
                     const void *buf_p,
                     size_t size);
 
+/**
+ * Same as `queue_write()`, but give up after given timeout.
+ *
+ * @param[in] self_p Queue to write to.
+ * @param[in] buf_p Buffer to write from.
+ * @param[in] size Number of bytes to write.
+ * @param[in] timeout_p Write timeout. Set to NULL to wait forever.
+ *
+ * @return Number of bytes written, which is less than size on
+ *         timeout, -ETIMEDOUT if no bytes were written before the
+ *         timeout, or negative error code.
+ */
+ssize_t queue_write_timeout(struct queue_t *self_p,
+                            const void *buf_p,
+                            size_t size,
+                            const struct time_t *timeout_p);
+
 /**
  * Write bytes to given queue from isr or with the system lock
  * taken (see `sys_lock()`). May write less than size bytes.
@@ -218,4 +264,71 @@ ssize_t queue_unused_size_isr(struct queue_t *self_p);
 ssize_t queue_ignore(struct queue_t *self_p,
                      size_t size);
 
+/**
+ * Reserve up to given number of bytes in the queue buffer, for the
+ * caller to write into in place. The reserved bytes are given as one
+ * or two arrays in given view. A caller that requires one contiguous
+ * array should only write into the first array. Does not block.
+ *
+ * The reserved bytes are made available to the reader by
+ * `queue_write_commit()`. No other writes to the queue are allowed
+ * between reserve and commit.
+ *
+ * @param[in] self_p Queue to reserve bytes in. Must have a buffer.
+ * @param[out] view_p Arrays of reserved bytes.
+ * @param[in] size Number of bytes to reserve.
+ *
+ * @return Number of reserved bytes, possibly less than given size, or
+ *         negative error code.
+ */
+ssize_t queue_write_reserve(struct queue_t *self_p,
+                            struct queue_view_t *view_p,
+                            size_t size);
+
+/**
+ * Commit given number of bytes written in place after
+ * `queue_write_reserve()`. Resumes a waiting reader.
+ *
+ * @param[in] self_p Queue to commit bytes in.
+ * @param[in] size Number of bytes to commit, at most the number of
+ *                 reserved bytes.
+ *
+ * @return Number of committed bytes or negative error code.
+ */
+ssize_t queue_write_commit(struct queue_t *self_p,
+                           size_t size);
+
+/**
+ * Get a view of up to given number of bytes in the queue buffer, for
+ * the caller to read and parse in place. The bytes are given as one
+ * or two arrays in given view. Data of writers waiting for space in
+ * the buffer is not part of the view. Does not block.
+ *
+ * The bytes are removed from the queue by `queue_read_release()`.
+ *
+ * @param[in] self_p Queue to peek into. Must have a buffer.
+ * @param[out] view_p Arrays of peeked bytes.
+ * @param[in] size Number of bytes to peek.
+ *
+ * @return Number of peeked bytes, possibly less than given size, or
+ *         negative error code.
+ */
+ssize_t queue_read_peek(struct queue_t *self_p,
+                        struct queue_view_t *view_p,
+                        size_t size);
+
+/**
+ * Remove given number of bytes at the front of the queue buffer after
+ * `queue_read_peek()`. Data of blocked writers is moved into the
+ * released space, and writers whose data fits are resumed.
+ *
+ * @param[in] self_p Queue to release bytes in.
+ * @param[in] size Number of bytes to release, at most the number of
+ *                 peeked bytes.
+ *
+ * @return Number of released bytes or negative error code.
+ */
+ssize_t queue_read_release(struct queue_t *self_p,
+                           size_t size);
+
 #endif
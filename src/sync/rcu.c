@@ -0,0 +1,213 @@
+/**
+ * @section License
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017, Erik Moqvist
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+#if CONFIG_RCU == 1
+
+/* Thread states. */
+#define STATE_IDLE                                          0
+/* Switched out in a read-side critical section. */
+#define STATE_PREEMPTED                                     1
+/* Switched out in a read-side critical section entered before the
+   current grace period started. */
+#define STATE_WAITED_FOR                                    2
+
+struct module_t {
+    int8_t initialized;
+    /* Serializes grace periods. */
+    struct mutex_t mutex;
+    /* Threads switched out in read-side critical sections. */
+    struct thrd_t *preempted_p;
+    /* Number of threads the current grace period waits for. */
+    int pending;
+    /* Thread waiting for the current grace period to end. */
+    struct thrd_t *waiter_p;
+};
+
+static struct module_t module;
+
+static void preempted_remove(struct thrd_t *thrd_p)
+{
+    struct thrd_t **curr_pp;
+
+    curr_pp = &module.preempted_p;
+
+    while (*curr_pp != thrd_p) {
+        curr_pp = &(*curr_pp)->rcu.next_p;
+    }
+
+    *curr_pp = thrd_p->rcu.next_p;
+    thrd_p->rcu.next_p = NULL;
+}
+
+/**
+ * Given thread is outside any read-side critical section. Resume the
+ * waiting writer if it was the last thread the grace period waited
+ * for.
+ */
+static void quiescent_isr(struct thrd_t *thrd_p)
+{
+    if (thrd_p->rcu.state == STATE_IDLE) {
+        return;
+    }
+
+    preempted_remove(thrd_p);
+
+    if (thrd_p->rcu.state == STATE_WAITED_FOR) {
+        module.pending--;
+
+        if ((module.pending == 0) && (module.waiter_p != NULL)) {
+            thrd_resume_isr(module.waiter_p, 0);
+            module.waiter_p = NULL;
+        }
+    }
+
+    __atomic_store_n(&thrd_p->rcu.state, STATE_IDLE, __ATOMIC_RELAXED);
+}
+
+int rcu_module_init(void)
+{
+    /* Return immediately if the module is already initialized. */
+    if (module.initialized == 1) {
+        return (0);
+    }
+
+    module.initialized = 1;
+
+    mutex_init(&module.mutex);
+    module.preempted_p = NULL;
+    module.pending = 0;
+    module.waiter_p = NULL;
+
+    return (0);
+}
+
+int rcu_synchronize(void)
+{
+    struct thrd_t *thrd_p;
+#if CONFIG_THRD_SMP == 1
+    int core;
+#endif
+
+    ASSERTN(thrd_self()->rcu.nesting == 0, EINVAL);
+
+    mutex_lock(&module.mutex);
+    sys_lock();
+
+    /* Order the published pointers before the reader state. */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    /* Readers switched out in a critical section may still use
+       replaced data. All other threads dereference published
+       pointers after this point. */
+    for (thrd_p = module.preempted_p;
+         thrd_p != NULL;
+         thrd_p = thrd_p->rcu.next_p) {
+        thrd_p->rcu.state = STATE_WAITED_FOR;
+        module.pending++;
+    }
+
+#if CONFIG_THRD_SMP == 1
+    /* So may readers running on other cores. */
+    for (core = 0; core < CONFIG_THRD_SMP_CORES; core++) {
+        thrd_p = thrd_get_current_isr(core);
+
+        if ((thrd_p != NULL)
+            && (thrd_p != thrd_self())
+            && (thrd_p->rcu.nesting > 0)
+            && (thrd_p->rcu.state == STATE_IDLE)) {
+            thrd_p->rcu.state = STATE_WAITED_FOR;
+            thrd_p->rcu.next_p = module.preempted_p;
+            module.preempted_p = thrd_p;
+            module.pending++;
+        }
+    }
+
+    /* A reader that left its critical section before it saw the new
+       state will not take the slow path in rcu_read_unlock(). */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    for (core = 0; core < CONFIG_THRD_SMP_CORES; core++) {
+        thrd_p = thrd_get_current_isr(core);
+
+        if ((thrd_p != NULL)
+            && (thrd_p != thrd_self())
+            && (thrd_p->rcu.nesting == 0)
+            && (thrd_p->rcu.state == STATE_WAITED_FOR)) {
+            quiescent_isr(thrd_p);
+        }
+    }
+#endif
+
+    /* Wait for them to be switched out outside a critical
+       section. */
+    if (module.pending > 0) {
+        module.waiter_p = thrd_self();
+        thrd_suspend_isr(NULL);
+    }
+
+    sys_unlock();
+    mutex_unlock(&module.mutex);
+
+    return (0);
+}
+
+void rcu_read_unlock_slow(void)
+{
+    struct thrd_t *thrd_p;
+
+    thrd_p = thrd_self();
+
+    sys_lock();
+
+    /* The thread may have been switched out after it left the
+       critical section, ending it already. */
+    if (thrd_p->rcu.nesting == 0) {
+        quiescent_isr(thrd_p);
+    }
+
+    sys_unlock();
+}
+
+void rcu_switch_isr(struct thrd_t *thrd_p)
+{
+    if (thrd_p->rcu.nesting > 0) {
+        if (thrd_p->rcu.state == STATE_IDLE) {
+            thrd_p->rcu.state = STATE_PREEMPTED;
+            thrd_p->rcu.next_p = module.preempted_p;
+            module.preempted_p = thrd_p;
+        }
+    } else {
+        quiescent_isr(thrd_p);
+    }
+}
+
+#endif
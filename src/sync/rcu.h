@@ -0,0 +1,146 @@
+/**
+ * @section License
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017, Erik Moqvist
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * This file is part of the Simba project.
+ */
+
+#ifndef __SYNC_RCU_H__
+#define __SYNC_RCU_H__
+
+#include "simba.h"
+
+#if CONFIG_RCU == 1
+
+/**
+ * Read given pointer published with `RCU_ASSIGN()`. Must be called
+ * in a read-side critical section, and the pointed to data may only
+ * be used until the critical section ends.
+ */
+#define RCU_DEREFERENCE(pointer)                        \
+    __atomic_load_n(&(pointer), __ATOMIC_ACQUIRE)
+
+/**
+ * Publish given value in given pointer. All writes to the pointed to
+ * data before the assignment are visible to readers that dereference
+ * the new value.
+ */
+#define RCU_ASSIGN(pointer, value)                              \
+    __atomic_store_n(&(pointer), (value), __ATOMIC_RELEASE)
+
+/**
+ * Initialize the rcu module. This function must be called before
+ * calling any other function in this module.
+ *
+ * The module will only be initialized once even if this function is
+ * called multiple times.
+ *
+ * @return zero(0) or negative error code
+ */
+int rcu_module_init(void);
+
+/**
+ * Report the end of a read-side critical section to waiting
+ * writers. Called by `rcu_read_unlock()`.
+ */
+void rcu_read_unlock_slow(void);
+
+/**
+ * Enter a read-side critical section. Critical sections may be
+ * nested. Readers never wait for writers, and only update the
+ * current thread, so this is much cheaper than taking a lock. A
+ * thread may block in a read-side critical section, but it delays
+ * `rcu_synchronize()` until the critical section ends.
+ */
+static inline void rcu_read_lock(void)
+{
+    thrd_self()->rcu.nesting++;
+#if CONFIG_THRD_SMP == 1
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#else
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
+/**
+ * Leave a read-side critical section. A thread that was switched out
+ * in the critical section reports the end of it to a waiting
+ * `rcu_synchronize()` when the outermost critical section ends. Must
+ * not be called with the system lock taken.
+ */
+static inline void rcu_read_unlock(void)
+{
+    struct thrd_t *thrd_p;
+
+    thrd_p = thrd_self();
+#if CONFIG_THRD_SMP == 1
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+#else
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+#endif
+    thrd_p->rcu.nesting--;
+#if CONFIG_THRD_SMP == 1
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#else
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+#endif
+
+    /* Slow path if switched out in the critical section or waited
+       for by a writer. */
+    if ((thrd_p->rcu.nesting == 0)
+        && (__atomic_load_n(&thrd_p->rcu.state, __ATOMIC_RELAXED) != 0)) {
+        rcu_read_unlock_slow();
+    }
+}
+
+/**
+ * Wait for a grace period, that is, until all read-side critical
+ * sections that were entered before this call have ended. Data
+ * replaced with `RCU_ASSIGN()` before this call may be freed or
+ * reused when it returns.
+ *
+ * A thread ends its critical sections as seen by this function when
+ * it is switched out by the scheduler outside a critical section, or
+ * when it leaves a critical section it was switched out in, so only
+ * readers that block or are preempted report to writers.
+ *
+ * Must not be called in a read-side critical section.
+ *
+ * @return zero(0) or negative error code.
+ */
+int rcu_synchronize(void);
+
+/**
+ * Called by the scheduler when given thread is switched out. Must be
+ * called with the system lock taken.
+ *
+ * @param[in] thrd_p Thread that is switched out.
+ */
+void rcu_switch_isr(struct thrd_t *thrd_p);
+
+#endif
+
+#endif
@@ -0,0 +1,301 @@
+/**
+ * @section License
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017, Erik Moqvist
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+/* The producer publishes data by storing the head index, and the
+   consumer frees space by storing the tail index. */
+#define LOAD_ACQUIRE(value_p) __atomic_load_n(value_p, __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(value_p, value)                   \
+    __atomic_store_n(value_p, value, __ATOMIC_RELEASE)
+#define FENCE() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+static int control(struct ring_t *self_p, int operation)
+{
+    int res;
+
+    res = 0;
+
+    switch (operation) {
+
+    case CHAN_CONTROL_NON_BLOCKING_READ:
+        self_p->flags |= RING_FLAGS_NON_BLOCKING_READ;
+        break;
+
+    case CHAN_CONTROL_BLOCKING_READ:
+        self_p->flags &= ~RING_FLAGS_NON_BLOCKING_READ;
+        break;
+
+    default:
+        res = -EINVAL;
+        break;
+    }
+
+    return (res);
+}
+
+/**
+ * Copy up to given number of bytes from the ring. Only called by the
+ * consumer.
+ */
+static size_t copy_out(struct ring_t *self_p, char *buf_p, size_t size)
+{
+    size_t head;
+    size_t tail;
+    size_t offset;
+    size_t n;
+    size_t first;
+
+    tail = self_p->tail;
+    head = LOAD_ACQUIRE(&self_p->head);
+
+    /* Order the previous tail store before loading the head once
+       more. A producer that does not find the ring empty after
+       publishing data does not notify a poll set. */
+    if (head == tail) {
+        FENCE();
+        head = LOAD_ACQUIRE(&self_p->head);
+    }
+
+    n = MIN(size, head - tail);
+
+    if (n == 0) {
+        return (0);
+    }
+
+    offset = (tail & self_p->mask);
+    first = MIN(n, self_p->mask + 1 - offset);
+    memcpy(buf_p, &self_p->buf_p[offset], first);
+    memcpy(&buf_p[first], &self_p->buf_p[0], n - first);
+
+    STORE_RELEASE(&self_p->tail, tail + n);
+
+    return (n);
+}
+
+/**
+ * Copy up to given number of bytes to the ring. Only called by the
+ * producer.
+ */
+static size_t copy_in(struct ring_t *self_p,
+                      const char *buf_p,
+                      size_t size)
+{
+    size_t head;
+    size_t tail;
+    size_t offset;
+    size_t n;
+    size_t first;
+
+    head = self_p->head;
+    tail = LOAD_ACQUIRE(&self_p->tail);
+    n = MIN(size, self_p->mask + 1 - (head - tail));
+
+    if (n == 0) {
+        return (0);
+    }
+
+    offset = (head & self_p->mask);
+    first = MIN(n, self_p->mask + 1 - offset);
+    memcpy(&self_p->buf_p[offset], buf_p, first);
+    memcpy(&self_p->buf_p[0], &buf_p[first], n - first);
+
+    STORE_RELEASE(&self_p->head, head + n);
+
+    return (n);
+}
+
+/**
+ * Check if the reader has to be notified of data written after given
+ * head index. A poll set is only notified when the ring goes from
+ * empty to non-empty. A level triggered channel stays ready as long
+ * as it has data, and an edge triggered channel is ready once per
+ * transition. Data must be published and fenced by the caller.
+ */
+static int is_reader_notified(struct ring_t *self_p, size_t head)
+{
+    if (self_p->base.reader_p != NULL) {
+        return (1);
+    }
+
+    if (self_p->base.poll_set_elem_p == NULL) {
+        return (0);
+    }
+
+    return (LOAD_ACQUIRE(&self_p->tail) == head);
+}
+
+/**
+ * Resume the reader, if waiting or polling. The reader only waits
+ * when the ring is empty.
+ */
+static void resume_reader_isr(struct ring_t *self_p)
+{
+    if (chan_is_polled_isr(&self_p->base)
+        || (self_p->base.reader_p != NULL)) {
+        thrd_resume_isr(self_p->base.reader_p, 0);
+        self_p->base.reader_p = NULL;
+    }
+}
+
+int ring_init(struct ring_t *self_p,
+              void *buf_p,
+              size_t size)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(buf_p != NULL, EINVAL);
+
+    /* The indices are masked with size - 1. */
+    if ((size == 0) || ((size & (size - 1)) != 0)) {
+        return (-EINVAL);
+    }
+
+    chan_init(&self_p->base,
+              (chan_read_fn_t)ring_read,
+              (chan_write_fn_t)ring_write,
+              (chan_size_fn_t)ring_size);
+    chan_set_write_isr_cb(&self_p->base, (chan_write_fn_t)ring_write_isr);
+    chan_set_control_cb(&self_p->base, (chan_control_fn_t)control);
+
+    self_p->buf_p = buf_p;
+    self_p->mask = (size - 1);
+    self_p->head = 0;
+    self_p->tail = 0;
+    self_p->flags = 0;
+
+    return (0);
+}
+
+ssize_t ring_read(struct ring_t *self_p,
+                  void *buf_p,
+                  size_t size)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(buf_p != NULL, EINVAL);
+
+    size_t left;
+    char *c_buf_p;
+
+    left = size;
+    c_buf_p = buf_p;
+
+    while (1) {
+        left -= copy_out(self_p, c_buf_p, left);
+        c_buf_p = ((char *)buf_p + size - left);
+
+        if (left == 0) {
+            break;
+        }
+
+        if (self_p->flags & RING_FLAGS_NON_BLOCKING_READ) {
+            size = (size - left);
+
+            if (size == 0) {
+                size = -EAGAIN;
+            }
+
+            break;
+        }
+
+        /* Register as reader before checking for data once more, as
+           the producer checks for a reader after publishing its
+           data. */
+        sys_lock();
+        self_p->base.reader_p = thrd_self();
+        FENCE();
+
+        if (LOAD_ACQUIRE(&self_p->head) == self_p->tail) {
+            thrd_suspend_isr(NULL);
+        }
+
+        self_p->base.reader_p = NULL;
+        sys_unlock();
+    }
+
+    return (size);
+}
+
+ssize_t ring_write(struct ring_t *self_p,
+                   const void *buf_p,
+                   size_t size)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN(buf_p != NULL, EINVAL);
+
+    size_t head;
+
+    head = self_p->head;
+    size = copy_in(self_p, buf_p, size);
+    FENCE();
+
+    if ((size > 0) && is_reader_notified(self_p, head)) {
+        sys_lock();
+        resume_reader_isr(self_p);
+        sys_unlock();
+    }
+
+    return (size);
+}
+
+RAM_CODE ssize_t ring_write_isr(struct ring_t *self_p,
+                                const void *buf_p,
+                                size_t size)
+{
+    size_t head;
+
+    head = self_p->head;
+    size = copy_in(self_p, buf_p, size);
+
+    /* The reader registers with the system lock taken, so a fence is
+       only needed for a poll set reader, that reads without it. */
+    if (self_p->base.poll_set_elem_p != NULL) {
+        FENCE();
+    }
+
+    if ((size > 0) && is_reader_notified(self_p, head)) {
+        resume_reader_isr(self_p);
+    }
+
+    return (size);
+}
+
+RAM_CODE ssize_t ring_size(struct ring_t *self_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+
+    return (LOAD_ACQUIRE(&self_p->head) - LOAD_ACQUIRE(&self_p->tail));
+}
+
+ssize_t ring_unused_size(struct ring_t *self_p)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+
+    return (self_p->mask + 1 - ring_size(self_p));
+}
@@ -0,0 +1,128 @@
+/**
+ * @section License
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017, Erik Moqvist
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * This file is part of the Simba project.
+ */
+
+#ifndef __SYNC_RING_H__
+#define __SYNC_RING_H__
+
+#include "simba.h"
+
+#define RING_FLAGS_NON_BLOCKING_READ                      0x1
+
+/**
+ * A single producer single consumer ring buffer channel.
+ */
+struct ring_t {
+    struct chan_t base;
+    char *buf_p;
+    size_t mask;
+    /* Written by the producer only. */
+    size_t head;
+    /* Written by the consumer only. */
+    size_t tail;
+    int flags;
+};
+
+/**
+ * Initialize given ring channel. There must be at most one producer
+ * and one consumer of the ring. Neither the producer nor the consumer
+ * takes the system lock to transfer data. The system lock is only
+ * taken by a consumer that has to wait for data, and by a producer
+ * that resumes it, which happens when the ring goes from empty to
+ * non-empty. A ring in a poll set is likewise made ready when it goes
+ * from empty to non-empty, so in edge triggered mode the reader must
+ * read until the ring is empty.
+ *
+ * @param[in] self_p Ring to initialize.
+ * @param[in] buf_p Buffer.
+ * @param[in] size Size of buffer. Must be a power of two. The ring
+ *                 stores at most size bytes.
+ *
+ * @return zero(0) or negative error code
+ */
+int ring_init(struct ring_t *self_p,
+              void *buf_p,
+              size_t size);
+
+/**
+ * Read from given ring. Blocks until size bytes has been read, unless
+ * the non-blocking read control operation has been performed on the
+ * channel. Only one thread may read from a ring.
+ *
+ * @param[in] self_p Ring to read from.
+ * @param[out] buf_p Buffer to read into.
+ * @param[in] size Number of bytes to read.
+ *
+ * @return Number of bytes read or negative error code.
+ */
+ssize_t ring_read(struct ring_t *self_p,
+                  void *buf_p,
+                  size_t size);
+
+/**
+ * Write bytes to given ring from a thread. Never blocks, and writes
+ * less than size bytes if the ring is full.
+ *
+ * @param[in] self_p Ring to write to.
+ * @param[in] buf_p Buffer to write from.
+ * @param[in] size Number of bytes to write.
+ *
+ * @return Number of bytes written or negative error code.
+ */
+ssize_t ring_write(struct ring_t *self_p,
+                   const void *buf_p,
+                   size_t size);
+
+/**
+ * Same as `ring_write()` but from isr or with the system lock taken
+ * (see `sys_lock()`).
+ */
+ssize_t ring_write_isr(struct ring_t *self_p,
+                       const void *buf_p,
+                       size_t size);
+
+/**
+ * Get the number of bytes currently stored in the ring.
+ *
+ * @param[in] self_p Ring.
+ *
+ * @return Number of bytes in given ring.
+ */
+ssize_t ring_size(struct ring_t *self_p);
+
+/**
+ * Get the number of unused bytes in the ring.
+ *
+ * @param[in] self_p Ring.
+ *
+ * @return Number of unused bytes in given ring.
+ */
+ssize_t ring_unused_size(struct ring_t *self_p);
+
+#endif
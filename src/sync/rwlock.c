@@ -33,11 +33,171 @@
 struct rwlock_elem_t {
     struct thrd_t *thrd_p;
     volatile struct rwlock_elem_t *next_p;
-    volatile struct rwlock_elem_t *prev_p;
 };
 
+#if CONFIG_RWLOCK_FS_COUNTERS == 1
+
+struct counters_t {
+    struct fs_counter_t waits;
+    struct fs_counter_t wait_time_us;
+    struct fs_counter_t timeouts;
+};
+
+struct module_t {
+    int8_t initialized;
+    struct counters_t reader;
+    struct counters_t writer;
+};
+
+static struct module_t module;
+
+static void counters_init(struct counters_t *self_p,
+                          far_string_t waits_path_p,
+                          far_string_t wait_time_us_path_p,
+                          far_string_t timeouts_path_p)
+{
+    fs_counter_init(&self_p->waits, waits_path_p, 0);
+    fs_counter_register(&self_p->waits);
+    fs_counter_init(&self_p->wait_time_us, wait_time_us_path_p, 0);
+    fs_counter_register(&self_p->wait_time_us);
+    fs_counter_init(&self_p->timeouts, timeouts_path_p, 0);
+    fs_counter_register(&self_p->timeouts);
+}
+
+/**
+ * Count a wait that started at given time and ended with given
+ * result.
+ */
+static void counters_update_isr(struct counters_t *self_p,
+                                struct time_t *start_p,
+                                int res)
+{
+    struct time_t now;
+
+    sys_uptime_isr(&now);
+    time_subtract(&now, &now, start_p);
+
+    fs_counter_increment(&self_p->waits, 1);
+    fs_counter_increment(&self_p->wait_time_us,
+                         (1000000ull * now.seconds
+                          + now.nanoseconds / 1000));
+
+    if (res == -ETIMEDOUT) {
+        fs_counter_increment(&self_p->timeouts, 1);
+    }
+}
+
+#endif
+
+/**
+ * Append given element to given list of waiting threads.
+ */
+static void append_elem(volatile struct rwlock_elem_t *volatile *list_pp,
+                        struct rwlock_elem_t *elem_p)
+{
+    while (*list_pp != NULL) {
+        list_pp = &(*list_pp)->next_p;
+    }
+
+    elem_p->next_p = NULL;
+    *list_pp = elem_p;
+}
+
+/**
+ * Remove given element from given list of waiting threads.
+ */
+static void remove_elem(volatile struct rwlock_elem_t *volatile *list_pp,
+                        struct rwlock_elem_t *elem_p)
+{
+    while (*list_pp != elem_p) {
+        list_pp = &(*list_pp)->next_p;
+    }
+
+    *list_pp = elem_p->next_p;
+}
+
+/**
+ * Hand over the lock to the first waiting writer, if any.
+ *
+ * @return true(1) if a writer was resumed, otherwise false(0).
+ */
+static int resume_writer_isr(struct rwlock_t *self_p)
+{
+    volatile struct rwlock_elem_t *elem_p;
+
+    elem_p = self_p->writers_p;
+
+    if (elem_p == NULL) {
+        return (0);
+    }
+
+    self_p->writers_p = elem_p->next_p;
+    self_p->number_of_writers = 1;
+    thrd_resume_isr(elem_p->thrd_p, 0);
+
+    return (1);
+}
+
+/**
+ * Hand over the lock to all waiting readers.
+ *
+ * @return Number of resumed readers.
+ */
+static int resume_readers_isr(struct rwlock_t *self_p)
+{
+    volatile struct rwlock_elem_t *elem_p;
+    int number_of_readers;
+
+    number_of_readers = 0;
+    elem_p = self_p->readers_p;
+    self_p->readers_p = NULL;
+
+    while (elem_p != NULL) {
+        number_of_readers++;
+        thrd_resume_isr(elem_p->thrd_p, 0);
+        elem_p = elem_p->next_p;
+    }
+
+    self_p->number_of_readers += number_of_readers;
+
+    return (number_of_readers);
+}
+
+/**
+ * Returns true(1) if a new reader has to wait for the lock.
+ */
+static int reader_must_wait(struct rwlock_t *self_p)
+{
+    if (self_p->number_of_writers > 0) {
+        return (1);
+    }
+
+    return ((self_p->policy != RWLOCK_POLICY_READER_PREFERRING)
+            && (self_p->writers_p != NULL));
+}
+
 int rwlock_module_init(void)
 {
+#if CONFIG_RWLOCK_FS_COUNTERS == 1
+    /* Return immediately if the module is already initialized. */
+    if (module.initialized == 1) {
+        return (0);
+    }
+
+    module.initialized = 1;
+
+    fs_module_init();
+
+    counters_init(&module.reader,
+                  FSTR("/sync/rwlock/reader/waits"),
+                  FSTR("/sync/rwlock/reader/wait_time_us"),
+                  FSTR("/sync/rwlock/reader/timeouts"));
+    counters_init(&module.writer,
+                  FSTR("/sync/rwlock/writer/waits"),
+                  FSTR("/sync/rwlock/writer/wait_time_us"),
+                  FSTR("/sync/rwlock/writer/timeouts"));
+#endif
+
     return (0);
 }
 
@@ -49,29 +209,62 @@ int rwlock_init(struct rwlock_t *self_p)
     self_p->number_of_writers = 0;
     self_p->readers_p = NULL;
     self_p->writers_p = NULL;
+    self_p->policy = RWLOCK_POLICY_WRITER_PREFERRING;
+
+    return (0);
+}
+
+int rwlock_set_policy(struct rwlock_t *self_p, int policy)
+{
+    ASSERTN(self_p != NULL, EINVAL);
+    ASSERTN((policy == RWLOCK_POLICY_READER_PREFERRING)
+            || (policy == RWLOCK_POLICY_WRITER_PREFERRING)
+            || (policy == RWLOCK_POLICY_PHASE_FAIR), EINVAL);
+
+    self_p->policy = policy;
 
     return (0);
 }
 
 int rwlock_reader_take(struct rwlock_t *self_p)
+{
+    return (rwlock_reader_take_timeout(self_p, NULL));
+}
+
+int rwlock_reader_take_timeout(struct rwlock_t *self_p,
+                               const struct time_t *timeout_p)
 {
     ASSERTN(self_p != NULL, EINVAL);
 
     struct rwlock_elem_t elem;
     int res = 0;
+#if CONFIG_RWLOCK_FS_COUNTERS == 1
+    struct time_t start;
+#endif
 
     sys_lock();
 
-    self_p->number_of_readers++;
-
-    /* Wait if the lock is taken by a writer. */
-    if (self_p->number_of_writers > 0) {
+    if (reader_must_wait(self_p)) {
         elem.thrd_p = thrd_self();
-        elem.next_p = self_p->readers_p;
-        elem.prev_p = NULL;
-        self_p->readers_p = &elem;
+        append_elem(&self_p->readers_p, &elem);
+
+#if CONFIG_RWLOCK_FS_COUNTERS == 1
+        sys_uptime_isr(&start);
+#endif
 
-        thrd_suspend_isr(NULL);
+        /* The lock is handed over by the giver, unless the wait
+           timed out. */
+        res = thrd_suspend_isr(timeout_p);
+
+#if CONFIG_RWLOCK_FS_COUNTERS == 1
+        counters_update_isr(&module.reader, &start, res);
+#endif
+
+        if (res == -ETIMEDOUT) {
+            remove_elem(&self_p->readers_p, &elem);
+        }
+    } else {
+        self_p->number_of_readers++;
     }
 
     sys_unlock();
@@ -94,45 +287,64 @@ int rwlock_reader_give_isr(struct rwlock_t *self_p)
 {
     ASSERTN(self_p != NULL, EINVAL);
 
-    volatile struct rwlock_elem_t *elem_p;
-
     self_p->number_of_readers--;
 
-    if ((self_p->number_of_writers > 0)
-        && (self_p->number_of_readers == 0)) {
-        elem_p = self_p->writers_p;
-        self_p->writers_p = elem_p->next_p;
-
-        if (self_p->writers_p != NULL) {
-            self_p->writers_p->prev_p = NULL;
-        }
-
-        thrd_resume_isr(elem_p->thrd_p, 0);
+    if (self_p->number_of_readers == 0) {
+        resume_writer_isr(self_p);
     }
 
     return (0);
 }
 
 int rwlock_writer_take(struct rwlock_t *self_p)
+{
+    return (rwlock_writer_take_timeout(self_p, NULL));
+}
+
+int rwlock_writer_take_timeout(struct rwlock_t *self_p,
+                               const struct time_t *timeout_p)
 {
     ASSERTN(self_p != NULL, EINVAL);
 
     struct rwlock_elem_t elem;
     int res = 0;
+#if CONFIG_RWLOCK_FS_COUNTERS == 1
+    struct time_t start;
+#endif
 
     sys_lock();
 
-    self_p->number_of_writers++;
-
-    /* Wait if the lock is taken by a reader or another writer. */
+    /* Wait if the lock is taken, or if other writers are waiting. */
     if ((self_p->number_of_readers > 0)
-        || (self_p->number_of_writers > 1)) {
+        || (self_p->number_of_writers > 0)
+        || (self_p->writers_p != NULL)) {
         elem.thrd_p = thrd_self();
-        elem.next_p = self_p->writers_p;
-        elem.prev_p = NULL;
-        self_p->writers_p = &elem;
+        append_elem(&self_p->writers_p, &elem);
+
+#if CONFIG_RWLOCK_FS_COUNTERS == 1
+        sys_uptime_isr(&start);
+#endif
+
+        /* The lock is handed over by the giver, unless the wait
+           timed out. */
+        res = thrd_suspend_isr(timeout_p);
 
-        thrd_suspend_isr(NULL);
+#if CONFIG_RWLOCK_FS_COUNTERS == 1
+        counters_update_isr(&module.writer, &start, res);
+#endif
+
+        if (res == -ETIMEDOUT) {
+            remove_elem(&self_p->writers_p, &elem);
+
+            /* Readers waiting only for waiting writers may take the
+               lock. */
+            if ((self_p->number_of_writers == 0)
+                && (self_p->writers_p == NULL)) {
+                resume_readers_isr(self_p);
+            }
+        }
+    } else {
+        self_p->number_of_writers = 1;
     }
 
     sys_unlock();
@@ -153,33 +365,16 @@ int rwlock_writer_give(struct rwlock_t *self_p)
 
 int rwlock_writer_give_isr(struct rwlock_t *self_p)
 {
-    volatile struct rwlock_elem_t *elem_p;
-
-    self_p->number_of_writers--;
-
-    if (self_p->number_of_writers > 0) {
-        elem_p = self_p->writers_p;
-        self_p->writers_p = elem_p->next_p;
+    self_p->number_of_writers = 0;
 
-        if (self_p->writers_p != NULL) {
-            self_p->writers_p->prev_p = NULL;
+    if (self_p->policy == RWLOCK_POLICY_WRITER_PREFERRING) {
+        if (resume_writer_isr(self_p) == 0) {
+            resume_readers_isr(self_p);
+        }
+    } else {
+        if (resume_readers_isr(self_p) == 0) {
+            resume_writer_isr(self_p);
         }
-
-        thrd_resume_isr(elem_p->thrd_p, 0);
-    } else if (self_p->number_of_readers > 0) {
-        elem_p = self_p->readers_p;
-
-        do {
-            self_p->readers_p = elem_p->next_p;
-
-            if (self_p->readers_p != NULL) {
-                self_p->readers_p->prev_p = NULL;
-            }
-
-            thrd_resume_isr(elem_p->thrd_p, 0);
-
-            elem_p = elem_p->next_p;
-        } while (elem_p != NULL);
     }
 
     return (0);
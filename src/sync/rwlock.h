@@ -33,11 +33,36 @@
 
 #include "simba.h"
 
+/**
+ * Waiting readers take the lock before waiting writers. Writers may
+ * starve as long as there are readers.
+ */
+#define RWLOCK_POLICY_READER_PREFERRING                     0
+
+/**
+ * New readers wait while a writer is waiting, and waiting writers
+ * take the lock before waiting readers. Readers may starve as long
+ * as there are writers. This is the default policy.
+ */
+#define RWLOCK_POLICY_WRITER_PREFERRING                     1
+
+/**
+ * Readers and writers take turns. New readers wait while a writer is
+ * waiting, and all waiting readers take the lock when a writer gives
+ * it. Waiting writers take the lock in the order they arrived.
+ * Neither readers nor writers starve.
+ */
+#define RWLOCK_POLICY_PHASE_FAIR                            2
+
 struct rwlock_t {
+    /* Number of readers that have the lock. */
     int number_of_readers;
+    /* Number of writers that have the lock, zero or one. */
     int number_of_writers;
     volatile struct rwlock_elem_t *readers_p;
+    /* Waiting writers in the order they arrived. */
     volatile struct rwlock_elem_t *writers_p;
+    int policy;
 };
 
 /**
@@ -60,6 +85,20 @@ int rwlock_module_init(void);
  */
 int rwlock_init(struct rwlock_t *self_p);
 
+/**
+ * Set the policy deciding which of waiting readers and writers that
+ * take given reader-writer lock next. Should be called before the
+ * lock is used.
+ *
+ * @param[in] self_p Reader-writer lock.
+ * @param[in] policy One of ``RWLOCK_POLICY_READER_PREFERRING``,
+ *                   ``RWLOCK_POLICY_WRITER_PREFERRING`` and
+ *                   ``RWLOCK_POLICY_PHASE_FAIR``.
+ *
+ * @return zero(0) or negative error code.
+ */
+int rwlock_set_policy(struct rwlock_t *self_p, int policy);
+
 /**
  * Take given reader-writer lock. Multiple threads can have the reader
  * lock at the same time.
@@ -70,6 +109,19 @@ int rwlock_init(struct rwlock_t *self_p);
  */
 int rwlock_reader_take(struct rwlock_t *self_p);
 
+/**
+ * Take given reader-writer lock as a reader, or give up after given
+ * timeout.
+ *
+ * @param[in] self_p Reader-writer lock to take.
+ * @param[in] timeout_p Time to wait for the lock before a timeout
+ *                      occurs. Set to NULL to wait forever.
+ *
+ * @return zero(0) or negative error code. -ETIMEDOUT on timeout.
+ */
+int rwlock_reader_take_timeout(struct rwlock_t *self_p,
+                               const struct time_t *timeout_p);
+
 /**
  * Give given reader-writer lock.
  *
@@ -99,6 +151,19 @@ int rwlock_reader_give_isr(struct rwlock_t *self_p);
  */
 int rwlock_writer_take(struct rwlock_t *self_p);
 
+/**
+ * Take given reader-writer lock as a writer, or give up after given
+ * timeout.
+ *
+ * @param[in] self_p Reader-writer lock to take.
+ * @param[in] timeout_p Time to wait for the lock before a timeout
+ *                      occurs. Set to NULL to wait forever.
+ *
+ * @return zero(0) or negative error code. -ETIMEDOUT on timeout.
+ */
+int rwlock_writer_take_timeout(struct rwlock_t *self_p,
+                               const struct time_t *timeout_p);
+
 /**
  * Give given reader-writer lock.
  *
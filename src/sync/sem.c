@@ -30,6 +30,119 @@
 
 #include "simba.h"
 
+/*
+ * The count is updated with compare-and-swap. A thread that fails to
+ * take the semaphore sets the waiters flag before it checks the count
+ * again, and a thread that gives the semaphore updates the count
+ * before it checks the waiters flag, so at least one of them sees the
+ * other. The wait list is only accessed with the system lock taken.
+ */
+
+static int count_load(struct sem_t *self_p)
+{
+#if CONFIG_SEM_FAST_PATH == 1
+    return (__atomic_load_n(&self_p->count, __ATOMIC_SEQ_CST));
+#else
+    return (self_p->count);
+#endif
+}
+
+/**
+ * Replace given expected count with given new count.
+ *
+ * @return true(1) if the count was replaced, otherwise false(0).
+ */
+static int count_cas(struct sem_t *self_p, int *count_p, int count)
+{
+#if CONFIG_SEM_FAST_PATH == 1
+    return (__atomic_compare_exchange_n(&self_p->count,
+                                        count_p,
+                                        count,
+                                        0,
+                                        __ATOMIC_SEQ_CST,
+                                        __ATOMIC_SEQ_CST));
+#else
+    self_p->count = count;
+
+    return (1);
+#endif
+}
+
+static int has_waiters_load(struct sem_t *self_p)
+{
+#if CONFIG_SEM_FAST_PATH == 1
+    return (__atomic_load_n(&self_p->has_waiters, __ATOMIC_SEQ_CST));
+#else
+    return (self_p->has_waiters);
+#endif
+}
+
+static void has_waiters_store(struct sem_t *self_p, int has_waiters)
+{
+#if CONFIG_SEM_FAST_PATH == 1
+    __atomic_store_n(&self_p->has_waiters, has_waiters, __ATOMIC_SEQ_CST);
+#else
+    self_p->has_waiters = has_waiters;
+#endif
+}
+
+/**
+ * Take a resource if one is available.
+ */
+static int try_take(struct sem_t *self_p)
+{
+    int count;
+
+    count = count_load(self_p);
+
+    while (count < self_p->count_max) {
+        if (count_cas(self_p, &count, count + 1)) {
+            return (1);
+        }
+    }
+
+    return (0);
+}
+
+/**
+ * Give given number of resources back.
+ */
+static void put(struct sem_t *self_p, int count)
+{
+    int old_count;
+    int new_count;
+
+    old_count = count_load(self_p);
+
+    do {
+        new_count = (old_count - count);
+
+        if (new_count < 0) {
+            new_count = 0;
+        }
+    } while (!count_cas(self_p, &old_count, new_count));
+}
+
+/**
+ * Hand over available resources to the waiters. Called with the
+ * system lock taken.
+ */
+static void wake_isr(struct sem_t *self_p)
+{
+    struct thrd_prio_list_elem_t *elem_p;
+
+    while ((elem_p = thrd_prio_list_peek_isr(&self_p->waiters)) != NULL) {
+        if (!try_take(self_p)) {
+            return;
+        }
+
+        thrd_prio_list_remove_isr(&self_p->waiters, elem_p);
+        thrd_resume_isr(elem_p->thrd_p, 0);
+    }
+
+    has_waiters_store(self_p, 0);
+}
+
 int sem_module_init(void)
 {
     return (0);
@@ -45,6 +158,7 @@ int sem_init(struct sem_t *self_p,
 
     self_p->count = count;
     self_p->count_max = count_max;
+    self_p->has_waiters = 0;
 
     thrd_prio_list_init(&self_p->waiters);
 
@@ -59,18 +173,30 @@ int sem_take(struct sem_t *self_p,
     int err = 0;
     struct thrd_prio_list_elem_t elem;
 
+#if CONFIG_SEM_FAST_PATH == 1
+    if (try_take(self_p)) {
+        return (0);
+    }
+#endif
+
+    elem.thrd_p = thrd_self();
+
     sys_lock();
 
-    if (self_p->count == self_p->count_max) {
-        elem.thrd_p = thrd_self();
-        thrd_prio_list_push_isr(&self_p->waiters, &elem);
-        err = thrd_suspend_isr(timeout_p);
+    while (!try_take(self_p)) {
+        if (sem_add_waiter_isr(self_p, &elem) == 0) {
+            err = thrd_suspend_isr(timeout_p);
+
+            if (err == -ETIMEDOUT) {
+                thrd_prio_list_remove_isr(&self_p->waiters, &elem);
+            }
 
-        if (err == -ETIMEDOUT) {
-            thrd_prio_list_remove_isr(&self_p->waiters, &elem);
+            break;
         }
-    } else {
-        self_p->count++;
+
+        /* A resource was given without the system lock before the
+           waiters flag was set. */
+        thrd_prio_list_remove_isr(&self_p->waiters, &elem);
     }
 
     sys_unlock();
@@ -84,9 +210,21 @@ int sem_give(struct sem_t *self_p,
     ASSERTN(self_p != NULL, EINVAL);
     ASSERTN(count >= 0, EINVAL);
 
+#if CONFIG_SEM_FAST_PATH == 1
+    put(self_p, count);
+
+    if (has_waiters_load(self_p) == 0) {
+        return (0);
+    }
+
+    sys_lock();
+    wake_isr(self_p);
+    sys_unlock();
+#else
     sys_lock();
     sem_give_isr(self_p, count);
     sys_unlock();
+#endif
 
     return (0);
 }
@@ -94,19 +232,25 @@ int sem_give(struct sem_t *self_p,
 int sem_give_isr(struct sem_t *self_p,
                  int count)
 {
-    struct thrd_prio_list_elem_t *elem_p;
-
-    self_p->count -= count;
-
-    if (self_p->count < 0) {
-        self_p->count = 0;
-    }
+    put(self_p, count);
 
-    while ((self_p->count < self_p->count_max)
-           && ((elem_p = thrd_prio_list_pop_isr(&self_p->waiters)) != NULL)) {
-        self_p->count++;
-        thrd_resume_isr(elem_p->thrd_p, 0);
+    if (has_waiters_load(self_p) == 1) {
+        wake_isr(self_p);
     }
 
     return (0);
 }
+
+int sem_try_take_isr(struct sem_t *self_p)
+{
+    return (try_take(self_p));
+}
+
+int sem_add_waiter_isr(struct sem_t *self_p,
+                       struct thrd_prio_list_elem_t *elem_p)
+{
+    has_waiters_store(self_p, 1);
+    thrd_prio_list_push_isr(&self_p->waiters, elem_p);
+
+    return (count_load(self_p) < self_p->count_max);
+}
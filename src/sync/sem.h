@@ -46,13 +46,16 @@
 #define SEM_INIT_DECL(name, _count, _count_max)         \
     struct sem_t name = { .count = _count,              \
                           .count_max = _count_max,      \
-                          .head_p = NULL }
+                          .has_waiters = 0,             \
+                          .waiters = THRD_PRIO_LIST_INIT_STRUCT }
 
 struct sem_t {
     /** Number of used resources. */
     int count;
     /** Maximum number of resources. */
     int count_max;
+    /** Set when threads may be waiting for the semaphore. */
+    int8_t has_waiters;
     /** Wait list. */
     struct thrd_prio_list_t waiters;
 };
@@ -129,4 +132,29 @@ int sem_give(struct sem_t *self_p,
 int sem_give_isr(struct sem_t *self_p,
                  int count);
 
+/**
+ * Take given semaphore from isr or with the system lock taken, if a
+ * resource is available. Never waits.
+ *
+ * @param[in] self_p Semaphore to take.
+ *
+ * @return true(1) if the semaphore was taken, otherwise false(0).
+ */
+int sem_try_take_isr(struct sem_t *self_p);
+
+/**
+ * Add given element to the wait list of given semaphore with the
+ * system lock taken. The thread of the element is resumed by
+ * `sem_give()` when a resource is given. A resource given without
+ * the system lock just before this call may not wake the thread, so
+ * the caller should not suspend if this function returns true(1).
+ *
+ * @param[in] self_p Semaphore to wait for.
+ * @param[in] elem_p Wait list element of the waiting thread.
+ *
+ * @return true(1) if a resource is available, otherwise false(0).
+ */
+int sem_add_waiter_isr(struct sem_t *self_p,
+                       struct thrd_prio_list_elem_t *elem_p);
+
 #endif
@@ -30,7 +30,131 @@
 
 #include "simba.h"
 
+#define STRESS_ITERATIONS                               100000
+#define STRESS_BUFFERS_MAX                                  64
+#define STRESS_SIZE_MAX                                     96
+
 static char buffer[256];
+static char stress_buffer[2048];
+static uint32_t seed = 1;
+
+struct stress_buffer_t {
+    uint8_t *buf_p;
+    size_t size;
+    uint8_t pattern;
+};
+
+static uint32_t random_next(void)
+{
+    seed = (1103515245 * seed + 12345);
+
+    return (seed >> 16);
+}
+
+/**
+ * Check that given buffer still contains its pattern, and free it.
+ */
+static int stress_free(struct circular_heap_t *circular_heap_p,
+                       struct stress_buffer_t *buffer_p)
+{
+    size_t i;
+
+    for (i = 0; i < buffer_p->size; i++) {
+        BTASSERTI(buffer_p->buf_p[i], ==, buffer_p->pattern);
+    }
+
+    BTASSERT(circular_heap_free(circular_heap_p, buffer_p->buf_p) == 0);
+
+    return (0);
+}
+
+/**
+ * Index of the buffer to free next. The oldest buffer is first.
+ */
+static int stress_pick(int free_order, int length)
+{
+    if (free_order == CIRCULAR_HEAP_FREE_ORDER_ANY) {
+        return (random_next() % length);
+    }
+
+    return (0);
+}
+
+/**
+ * Allocate and free buffers of random sizes, freeing the oldest
+ * buffer or a random buffer.
+ */
+static int stress(int free_order)
+{
+    struct circular_heap_t circular_heap;
+    struct stress_buffer_t buffers[STRESS_BUFFERS_MAX];
+    int length;
+    int number_of_allocs;
+    int number_of_failures;
+    int i;
+    int j;
+
+    BTASSERT(circular_heap_init(&circular_heap,
+                                stress_buffer,
+                                sizeof(stress_buffer)) == 0);
+    BTASSERT(circular_heap_set_free_order(&circular_heap,
+                                          free_order) == 0);
+
+    length = 0;
+    number_of_allocs = 0;
+    number_of_failures = 0;
+
+    for (i = 0; i < STRESS_ITERATIONS; i++) {
+        if ((length < STRESS_BUFFERS_MAX) && ((random_next() % 2) == 0)) {
+            buffers[length].size = ((random_next() % STRESS_SIZE_MAX) + 1);
+            buffers[length].buf_p = circular_heap_alloc(&circular_heap,
+                                                        buffers[length].size);
+
+            if (buffers[length].buf_p == NULL) {
+                number_of_failures++;
+                continue;
+            }
+
+            BTASSERT((void *)buffers[length].buf_p
+                     > (void *)&stress_buffer[0]);
+            BTASSERT((void *)(buffers[length].buf_p + buffers[length].size)
+                     <= (void *)&stress_buffer[sizeof(stress_buffer)]);
+            buffers[length].pattern = (uint8_t)i;
+            memset(buffers[length].buf_p,
+                   buffers[length].pattern,
+                   buffers[length].size);
+            length++;
+            number_of_allocs++;
+        } else if (length > 0) {
+            j = stress_pick(free_order, length);
+            BTASSERT(stress_free(&circular_heap, &buffers[j]) == 0);
+            length--;
+            memmove(&buffers[j],
+                    &buffers[j + 1],
+                    sizeof(buffers[0]) * (length - j));
+        }
+    }
+
+    std_printf(OSTR("%d allocations and %d failures\r\n"),
+               number_of_allocs,
+               number_of_failures);
+
+    BTASSERT(number_of_allocs > STRESS_ITERATIONS / 4);
+
+    /* All memory is reclaimed when all buffers are freed. */
+    while (length > 0) {
+        j = stress_pick(free_order, length);
+        BTASSERT(stress_free(&circular_heap, &buffers[j]) == 0);
+        length--;
+        memmove(&buffers[j],
+                &buffers[j + 1],
+                sizeof(buffers[0]) * (length - j));
+    }
+
+    BTASSERT(circular_heap.free_p == circular_heap.alloc_p);
+
+    return (0);
+}
 
 static int test_alloc_free(void)
 {
@@ -84,10 +208,87 @@ static int test_alloc_free(void)
     return (0);
 }
 
+static int test_free_any_order(void)
+{
+    struct circular_heap_t circular_heap;
+    void *bufs[16];
+    int number_of_buffers;
+    int i;
+
+    BTASSERT(circular_heap_init(&circular_heap,
+                                buffer,
+                                sizeof(buffer)) == 0);
+    BTASSERT(circular_heap_set_free_order(&circular_heap,
+                                          CIRCULAR_HEAP_FREE_ORDER_ANY) == 0);
+
+    /* Allocate all memory. */
+    number_of_buffers = 0;
+
+    while (1) {
+        bufs[number_of_buffers] = circular_heap_alloc(&circular_heap, 28);
+
+        if (bufs[number_of_buffers] == NULL) {
+            break;
+        }
+
+        number_of_buffers++;
+    }
+
+    BTASSERT(number_of_buffers > 4);
+
+    /* Freeing newer buffers does not make any memory available. */
+    BTASSERT(circular_heap_free(&circular_heap, bufs[2]) == 0);
+    BTASSERT(circular_heap_free(&circular_heap, bufs[1]) == 0);
+    BTASSERT(circular_heap_alloc(&circular_heap, 28) == NULL);
+    BTASSERT(circular_heap.free_p == &buffer[0]);
+
+    /* Double free. */
+    BTASSERT(circular_heap_free(&circular_heap, bufs[1]) == -EINVAL);
+
+    /* Freeing the oldest buffer makes the memory of the three oldest
+       buffers available. */
+    BTASSERT(circular_heap_free(&circular_heap, bufs[0]) == 0);
+    BTASSERT(circular_heap.free_p == bufs[3] - sizeof(size_t));
+
+    /* The allocation wraps around to the beginning. */
+    bufs[0] = circular_heap_alloc(&circular_heap, 28);
+    BTASSERT(bufs[0] != NULL);
+    bufs[1] = circular_heap_alloc(&circular_heap, 28);
+    BTASSERT(bufs[1] != NULL);
+    BTASSERT(bufs[0] < bufs[1]);
+    BTASSERT(bufs[1] < bufs[3]);
+
+    /* Free the newest buffers before the oldest. */
+    BTASSERT(circular_heap_free(&circular_heap, bufs[1]) == 0);
+    BTASSERT(circular_heap_free(&circular_heap, bufs[0]) == 0);
+
+    for (i = number_of_buffers - 1; i >= 3; i--) {
+        BTASSERT(circular_heap_free(&circular_heap, bufs[i]) == 0);
+    }
+
+    /* All memory is free. */
+    BTASSERT(circular_heap.free_p == circular_heap.alloc_p);
+
+    return (0);
+}
+
+static int test_stress_allocation_order(void)
+{
+    return (stress(CIRCULAR_HEAP_FREE_ORDER_ALLOCATION));
+}
+
+static int test_stress_any_order(void)
+{
+    return (stress(CIRCULAR_HEAP_FREE_ORDER_ANY));
+}
+
 int main()
 {
     struct harness_testcase_t testcases[] = {
         { test_alloc_free, "test_alloc_free" },
+        { test_free_any_order, "test_free_any_order" },
+        { test_stress_allocation_order, "test_stress_allocation_order" },
+        { test_stress_any_order, "test_stress_any_order" },
         { NULL, NULL }
     };
 
@@ -30,7 +30,22 @@
 
 #include "simba.h"
 
+#define FRAGMENTATION_ITERATIONS                        200000
+#define FRAGMENTATION_SIZE_MIN                             520
+#define FRAGMENTATION_SIZE_MAX                            2560
+
 static char buffer[2048];
+static char fragmentation_buffer[65536];
+static uint32_t seed = 1;
+static struct queue_t qout;
+static char qoutbuf[1024];
+
+static uint32_t random_next(void)
+{
+    seed = (1103515245 * seed + 12345);
+
+    return (seed >> 16);
+}
 
 static int test_alloc_free(void)
 {
@@ -138,13 +153,32 @@ static int test_big_buffer(void)
     return (0);
 }
 
+/**
+ * Size of the header of each buffer, given that fixed size buffers
+ * are allocated next to each other.
+ */
+static size_t header_size(void)
+{
+    struct heap_t heap;
+    char *buf_0_p;
+    char *buf_1_p;
+    size_t sizes[8] = { 16, 32, 64, 128, 256, 512, 512, 512 };
+
+    heap_init(&heap, buffer, sizeof(buffer), sizes);
+    buf_0_p = heap_alloc(&heap, 1);
+    buf_1_p = heap_alloc(&heap, 1);
+
+    return (buf_1_p - buf_0_p - 16);
+}
+
 static int test_out_of_memory(void)
 {
     struct heap_t heap;
     void *buf_p;
     size_t sizes[8] = { 16, 32, 64, 128, 256, 512, 512, 512 };
 
-    BTASSERT(heap_init(&heap, buffer, 40, sizes) == 0);
+    /* Room for one 16 bytes buffer. */
+    BTASSERT(heap_init(&heap, buffer, header_size() + 16, sizes) == 0);
 
     buf_p = heap_alloc(&heap, 1);
     BTASSERT(buf_p != NULL);
@@ -159,6 +193,359 @@ static int test_out_of_memory(void)
     return (0);
 }
 
+static int test_split_and_merge(void)
+{
+    struct heap_t heap;
+    char *buffers[4];
+    size_t sizes[8] = { 16, 16, 16, 16, 16, 16, 16, 16 };
+    size_t size;
+
+    size = header_size();
+    BTASSERT(heap_init(&heap, buffer, sizeof(buffer), sizes) == 0);
+
+    buffers[0] = heap_alloc(&heap, 1000);
+    BTASSERT(buffers[0] != NULL);
+    buffers[1] = heap_alloc(&heap, 600);
+    BTASSERT(buffers[1] != NULL);
+
+    /* Both new buffers are taken from the free block of the first
+       buffer. */
+    BTASSERT(heap_free(&heap, buffers[0]) == 0);
+    buffers[2] = heap_alloc(&heap, 600);
+    BTASSERT(buffers[2] == buffers[0]);
+    memset(buffers[2], -1, 600);
+    buffers[3] = heap_alloc(&heap, 300);
+    BTASSERT(buffers[3] > buffers[2]);
+    BTASSERT(buffers[3] < buffers[0] + 1000);
+    memset(buffers[3], -1, 300);
+
+    /* Free blocks are merged into one block. */
+    BTASSERT(heap_free(&heap, buffers[2]) == 0);
+    BTASSERT(heap_free(&heap, buffers[3]) == 0);
+    buffers[0] = heap_alloc(&heap, 1000);
+    BTASSERT(buffers[0] == buffers[2]);
+    BTASSERT(heap_free(&heap, buffers[0]) == 0);
+
+    /* The lowest block is given back to the unallocated memory when
+       freed. */
+    BTASSERT(heap_free(&heap, buffers[1]) == 0);
+    BTASSERT(heap.dynamic.begin_p == heap.dynamic.end_p);
+
+    /* Almost all memory in one buffer. */
+    buffers[0] = heap_alloc(&heap, sizeof(buffer) - size - 16);
+    BTASSERT(buffers[0] != NULL);
+    BTASSERT(heap_free(&heap, buffers[0]) == 0);
+
+    return (0);
+}
+
+/**
+ * Allocate and free buffers of random sizes for a long time. Memory
+ * must not be lost to fragmentation.
+ */
+static int test_fragmentation(void)
+{
+    struct heap_t heap;
+    void *buffers[32];
+    void **buffers_p;
+    size_t sizes[8] = { 16, 32, 64, 128, 256, 512, 512, 512 };
+    size_t size;
+    struct time_t start;
+    struct time_t stop;
+    struct time_t diff;
+    int i;
+    int failures;
+
+    BTASSERT(heap_init(&heap,
+                       fragmentation_buffer,
+                       sizeof(fragmentation_buffer),
+                       sizes) == 0);
+
+    memset(&buffers[0], 0, sizeof(buffers));
+    failures = 0;
+
+    time_get(&start);
+
+    for (i = 0; i < FRAGMENTATION_ITERATIONS; i++) {
+        buffers_p = &buffers[random_next() % membersof(buffers)];
+
+        if (*buffers_p == NULL) {
+            size = (FRAGMENTATION_SIZE_MIN
+                    + (random_next() % (FRAGMENTATION_SIZE_MAX
+                                        - FRAGMENTATION_SIZE_MIN)));
+            *buffers_p = heap_alloc(&heap, size);
+
+            if (*buffers_p == NULL) {
+                failures++;
+            } else {
+                memset(*buffers_p, i, size);
+            }
+        } else {
+            BTASSERT(heap_free(&heap, *buffers_p) == 0);
+            *buffers_p = NULL;
+        }
+    }
+
+    time_get(&stop);
+    time_subtract(&diff, &stop, &start);
+
+    std_printf(OSTR("%d allocations and frees of %d-%d bytes in "
+                    "%lu ms, %d failed.\r\n"),
+               FRAGMENTATION_ITERATIONS,
+               FRAGMENTATION_SIZE_MIN,
+               FRAGMENTATION_SIZE_MAX,
+               (unsigned long)(1000 * diff.seconds
+                               + diff.nanoseconds / 1000000),
+               failures);
+
+    BTASSERTI(failures, ==, 0);
+
+    for (i = 0; i < membersof(buffers); i++) {
+        if (buffers[i] != NULL) {
+            BTASSERT(heap_free(&heap, buffers[i]) == 0);
+        }
+    }
+
+    /* All memory is available again. */
+    BTASSERT(heap.dynamic.begin_p == heap.dynamic.end_p);
+    buffers[0] = heap_alloc(&heap,
+                            sizeof(fragmentation_buffer) - header_size() - 16);
+    BTASSERT(buffers[0] != NULL);
+    BTASSERT(heap_free(&heap, buffers[0]) == 0);
+
+    return (0);
+}
+
+/**
+ * Call given file system command and read its output into given
+ * buffer.
+ */
+static ssize_t call(const char *command_p, char *buf_p, size_t size)
+{
+    char command[64];
+    ssize_t res;
+
+    strcpy(&command[0], command_p);
+
+    if (fs_call(&command[0], NULL, &qout, NULL) != 0) {
+        return (-1);
+    }
+
+    res = queue_read(&qout, buf_p, queue_size(&qout));
+
+    if ((res < 0) || (res >= size)) {
+        return (-1);
+    }
+
+    buf_p[res] = '\0';
+
+    return (res);
+}
+
+static int test_stats(void)
+{
+    /* Registered heaps stay in the registry after this function
+       returns. */
+    static struct heap_t heap;
+    struct heap_stats_t stats;
+    void *buffers[4];
+    size_t sizes[8] = { 16, 32, 64, 128, 256, 512, 512, 512 };
+    char output[1024];
+    char address[16];
+
+    BTASSERT(queue_init(&qout, &qoutbuf[0], sizeof(qoutbuf)) == 0);
+    BTASSERT(heap_init(&heap, buffer, sizeof(buffer), sizes) == 0);
+    BTASSERT(heap_register(&heap, "test") == 0);
+
+    BTASSERT(heap_get_stats(&heap, &stats) == 0);
+    BTASSERTI(stats.used, ==, 0);
+    BTASSERTI(stats.number_of_buffers, ==, 0);
+    BTASSERTI(stats.free, ==, sizeof(buffer));
+    BTASSERTI(stats.fragmentation, ==, 0);
+
+    buffers[0] = heap_alloc(&heap, 10);
+    BTASSERT(buffers[0] != NULL);
+    buffers[1] = heap_alloc(&heap, 600);
+    BTASSERT(buffers[1] != NULL);
+    buffers[2] = heap_alloc(&heap, 800);
+    BTASSERT(buffers[2] != NULL);
+    BTASSERT(heap_alloc(&heap, 2000) == NULL);
+
+    BTASSERT(heap_get_stats(&heap, &stats) == 0);
+    BTASSERTI(stats.used, ==, 16 + 600 + 800);
+    BTASSERTI(stats.used_max, ==, 16 + 600 + 800);
+    BTASSERTI(stats.number_of_buffers, ==, 3);
+    BTASSERTI(stats.number_of_failures, ==, 1);
+
+    /* A free block between two allocated buffers fragments the
+       free memory. */
+    BTASSERT(heap_free(&heap, buffers[1]) == 0);
+    BTASSERT(heap_get_stats(&heap, &stats) == 0);
+    BTASSERTI(stats.used, ==, 16 + 800);
+    BTASSERTI(stats.used_max, ==, 16 + 600 + 800);
+    BTASSERTI(stats.number_of_buffers, ==, 2);
+    BTASSERTI(stats.largest_free, >=, 600);
+    BTASSERTI(stats.largest_free, <, stats.free);
+    BTASSERTI(stats.fragmentation, >, 0);
+
+    /* Counters of all heaps. */
+    BTASSERT(call("/alloc/heap/allocs", &output[0], sizeof(output)) == 18);
+    BTASSERT(strcmp(&output[0], "0000000000000000\r\n") != 0);
+    BTASSERT(call("/alloc/heap/frees", &output[0], sizeof(output)) == 18);
+    BTASSERT(strcmp(&output[0], "0000000000000000\r\n") != 0);
+    BTASSERT(call("/alloc/heap/failures", &output[0], sizeof(output)) == 18);
+    BTASSERT(strcmp(&output[0], "0000000000000000\r\n") != 0);
+
+    /* Commands. */
+    BTASSERT(call("/alloc/heap/list", &output[0], sizeof(output)) > 0);
+    std_printf(FSTR("%s"), &output[0]);
+    BTASSERT(strstr(&output[0], "harness") != NULL);
+    BTASSERT(strstr(&output[0],
+                    "                test       2048        816"
+                    "       1416          2") != NULL);
+
+    BTASSERT(call("/alloc/heap/sizes", &output[0], sizeof(output)) > 0);
+    std_printf(FSTR("%s"), &output[0]);
+    BTASSERT(strstr(&output[0],
+                    "test\r\n"
+                    "                SIZE     ALLOCS\r\n"
+                    "                  16          1\r\n"
+                    "      512-      1023          2\r\n") != NULL);
+
+    /* Allocated buffers are listed with their backtraces. */
+    buffers[3] = heap_alloc(&heap, 20);
+    BTASSERT(buffers[3] != NULL);
+    BTASSERT(call("/alloc/heap/leaks", &output[0], sizeof(output)) > 0);
+    std_printf(FSTR("%s"), &output[0]);
+    std_snprintf(&address[0],
+                 sizeof(address),
+                 FSTR("0x%08lx"),
+                 (unsigned long)(uintptr_t)buffers[3]);
+    BTASSERT(strstr(&output[0], &address[0]) != NULL);
+    BTASSERT(strstr(&output[0], " 32 bytes, count 1\r\n    : 0x") != NULL);
+
+    BTASSERT(heap_free(&heap, buffers[0]) == 0);
+    BTASSERT(heap_free(&heap, buffers[2]) == 0);
+    BTASSERT(heap_free(&heap, buffers[3]) == 0);
+    BTASSERT(heap_get_stats(&heap, &stats) == 0);
+    BTASSERTI(stats.used, ==, 0);
+    BTASSERTI(stats.number_of_buffers, ==, 0);
+
+    /* A reinitialized heap is unregistered. */
+    BTASSERT(heap_init(&heap, buffer, sizeof(buffer), sizes) == 0);
+    BTASSERT(call("/alloc/heap/list", &output[0], sizeof(output)) > 0);
+    BTASSERT(strstr(&output[0], "harness") != NULL);
+    BTASSERT(strstr(&output[0], "   test ") == NULL);
+
+    return (0);
+}
+
+#if CONFIG_HEAP_MAGAZINES == 1
+
+/**
+ * Value of given heap counter.
+ */
+static long counter_value(const char *path_p)
+{
+    char output[32];
+    long value;
+
+    if (call(path_p, &output[0], sizeof(output)) != 18) {
+        return (-1);
+    }
+
+    if (std_strtolb(&output[0], &value, 16) == NULL) {
+        return (-1);
+    }
+
+    return (value);
+}
+
+static int test_magazines(void)
+{
+    struct heap_t heap;
+    struct heap_stats_t stats;
+    void *buffers[2 * CONFIG_HEAP_MAGAZINE_SIZE];
+    void *buf_p;
+    size_t sizes[8] = { 16, 32, 64, 128, 256, 512, 512, 512 };
+    int i;
+    long allocs;
+    long frees;
+
+    BTASSERT(heap_init(&heap,
+                       fragmentation_buffer,
+                       sizeof(fragmentation_buffer),
+                       sizes) == 0);
+    BTASSERT(heap_magazines_attach(&heap) == 0);
+
+    /* A freed buffer is cached in the magazine of its size and
+       reused. */
+    buf_p = heap_alloc(&heap, 10);
+    BTASSERT(buf_p != NULL);
+    BTASSERT(heap_free(&heap, buf_p) == 0);
+    BTASSERT(heap_free(&heap, buf_p) == -1);
+    BTASSERT(heap_alloc(&heap, 16) == buf_p);
+    BTASSERT(heap_share(&heap, buf_p, 1) == 0);
+    BTASSERT(heap_free(&heap, buf_p) == 1);
+    BTASSERT(heap_free(&heap, buf_p) == 0);
+
+    /* Dynamic buffers bypass the magazines. */
+    buf_p = heap_alloc(&heap, 1000);
+    BTASSERT(buf_p != NULL);
+    BTASSERT(heap_free(&heap, buf_p) == 0);
+
+    /* More buffers than fit in a magazine are refilled from and
+       drained to the heap. */
+    allocs = counter_value("/alloc/heap/allocs");
+    frees = counter_value("/alloc/heap/frees");
+
+    for (i = 0; i < membersof(buffers); i++) {
+        buffers[i] = heap_alloc(&heap, 32);
+        BTASSERT(buffers[i] != NULL);
+    }
+
+    for (i = 0; i < membersof(buffers); i++) {
+        BTASSERT(heap_free(&heap, buffers[i]) == 0);
+    }
+
+    /* Each allocation and free is counted once, not per refill or
+       drain. */
+    BTASSERTI(counter_value("/alloc/heap/allocs") - allocs,
+              ==,
+              membersof(buffers));
+    BTASSERTI(counter_value("/alloc/heap/frees") - frees,
+              ==,
+              membersof(buffers));
+    BTASSERTI(heap.fixed[0].number_of_allocs, ==, 2);
+    BTASSERTI(heap.fixed[1].number_of_allocs, ==, membersof(buffers));
+
+    /* Cached buffers are allocated from the heap's point of view. */
+    BTASSERT(heap_get_stats(&heap, &stats) == 0);
+    BTASSERT(stats.used > 0);
+
+    BTASSERT(heap_magazines_detach() == 0);
+    BTASSERT(heap_get_stats(&heap, &stats) == 0);
+    BTASSERTI(stats.used, ==, 0);
+    BTASSERTI(stats.number_of_buffers, ==, 0);
+
+    /* Magazines of a heap initialized again are not used. */
+    BTASSERT(heap_magazines_attach(&heap) == 0);
+    BTASSERT(heap_init(&heap,
+                       fragmentation_buffer,
+                       sizeof(fragmentation_buffer),
+                       sizes) == 0);
+    buf_p = heap_alloc(&heap, 10);
+    BTASSERT(buf_p != NULL);
+    BTASSERT(heap_free(&heap, buf_p) == 0);
+    BTASSERT(heap_magazines_detach() == 0);
+    BTASSERT(heap_get_stats(&heap, &stats) == 0);
+    BTASSERTI(stats.used, ==, 0);
+
+    return (0);
+}
+
+#endif
+
 int main()
 {
     struct harness_testcase_t testcases[] = {
@@ -167,6 +554,12 @@ int main()
         { test_share, "test_share" },
         { test_big_buffer, "test_big_buffer" },
         { test_out_of_memory, "test_out_of_memory" },
+        { test_split_and_merge, "test_split_and_merge" },
+        { test_fragmentation, "test_fragmentation" },
+        { test_stats, "test_stats" },
+#if CONFIG_HEAP_MAGAZINES == 1
+        { test_magazines, "test_magazines" },
+#endif
         { NULL, NULL }
     };
 
@@ -0,0 +1,313 @@
+/**
+ * @section License
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014-2017, Erik Moqvist
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+#define MAGIC                                           0x5a5a
+
+struct object_t {
+    int magic;
+    int value;
+    char name[12];
+};
+
+static SLAB_BUFFER(buffer, sizeof(struct object_t), 4);
+static int number_of_constructs;
+static int number_of_destructs;
+static struct queue_t qout;
+static char qoutbuf[512];
+
+static void object_construct(void *object_p, void *arg_p)
+{
+    struct object_t *obj_p;
+
+    obj_p = object_p;
+    obj_p->magic = (int)(uintptr_t)arg_p;
+    obj_p->value = 0;
+    number_of_constructs++;
+}
+
+static void object_destruct(void *object_p, void *arg_p)
+{
+    struct object_t *obj_p;
+
+    obj_p = object_p;
+
+    if (obj_p->magic == (int)(uintptr_t)arg_p) {
+        number_of_destructs++;
+    }
+}
+
+static ssize_t call(const char *command_p, char *buf_p, size_t size)
+{
+    char command[64];
+    ssize_t res;
+
+    strcpy(&command[0], command_p);
+
+    if (fs_call(&command[0], NULL, &qout, NULL) != 0) {
+        return (-1);
+    }
+
+    res = queue_read(&qout, buf_p, queue_size(&qout));
+
+    if ((res < 0) || (res >= size)) {
+        return (-1);
+    }
+
+    buf_p[res] = '\0';
+
+    return (res);
+}
+
+static int test_alloc_free(void)
+{
+    struct slab_t slab;
+    struct object_t *objects[4];
+    int i;
+
+    BTASSERT(slab_init(&slab,
+                       &buffer[0],
+                       sizeof(buffer),
+                       sizeof(struct object_t),
+                       NULL,
+                       NULL,
+                       NULL) == 0);
+
+    /* All objects are cache line aligned. */
+    for (i = 0; i < membersof(objects); i++) {
+        objects[i] = slab_alloc(&slab);
+        BTASSERT(objects[i] != NULL);
+        BTASSERTI((uintptr_t)objects[i] % CONFIG_SLAB_ALIGNMENT, ==, 0);
+    }
+
+    BTASSERTI((char *)objects[1] - (char *)objects[0],
+              ==,
+              SLAB_SLOT_SIZE(sizeof(struct object_t)));
+    BTASSERT(slab_alloc(&slab) == NULL);
+
+    /* The most recently freed object is allocated first. */
+    BTASSERT(slab_free(&slab, objects[2]) == 0);
+    BTASSERT(slab_free(&slab, objects[0]) == 0);
+    BTASSERT(slab_alloc(&slab) == objects[0]);
+    BTASSERT(slab_alloc(&slab) == objects[2]);
+    BTASSERT(slab_alloc(&slab) == NULL);
+
+    for (i = 0; i < membersof(objects); i++) {
+        BTASSERT(slab_free(&slab, objects[i]) == 0);
+    }
+
+    return (0);
+}
+
+static int test_bad_free(void)
+{
+    struct slab_t slab;
+    struct object_t *object_p;
+    struct object_t object;
+
+    BTASSERT(slab_init(&slab,
+                       &buffer[0],
+                       sizeof(buffer),
+                       sizeof(struct object_t),
+                       NULL,
+                       NULL,
+                       NULL) == 0);
+
+    object_p = slab_alloc(&slab);
+    BTASSERT(object_p != NULL);
+
+    /* Not an object in the slab. */
+    BTASSERT(slab_free(&slab, &object) == -EINVAL);
+    BTASSERT(slab_free(&slab, &object_p->value) == -EINVAL);
+
+    /* Double free. */
+    BTASSERT(slab_free(&slab, object_p) == 0);
+    BTASSERT(slab_free(&slab, object_p) == -EINVAL);
+
+    /* Free but never allocated. */
+    BTASSERT(slab_free(&slab, &buffer[SLAB_SLOT_SIZE(sizeof(*object_p))])
+             == -EINVAL);
+
+    return (0);
+}
+
+static int test_unaligned_buffer(void)
+{
+    struct slab_t slab;
+    struct slab_stats_t stats;
+    void *object_p;
+
+    BTASSERT(slab_init(&slab,
+                       &buffer[1],
+                       sizeof(buffer) - 1,
+                       sizeof(struct object_t),
+                       NULL,
+                       NULL,
+                       NULL) == 0);
+    BTASSERT(slab_get_stats(&slab, &stats) == 0);
+
+    if (CONFIG_SLAB_ALIGNMENT > 1) {
+        BTASSERTI(stats.number_of_objects, ==, 3);
+    } else {
+        BTASSERTI(stats.number_of_objects, ==, 4);
+    }
+
+    object_p = slab_alloc(&slab);
+    BTASSERT(object_p != NULL);
+    BTASSERTI((uintptr_t)object_p % CONFIG_SLAB_ALIGNMENT, ==, 0);
+    BTASSERT(slab_free(&slab, object_p) == 0);
+
+    /* Too small for a single object. */
+    BTASSERT(slab_init(&slab,
+                       &buffer[1],
+                       sizeof(struct object_t),
+                       sizeof(struct object_t),
+                       NULL,
+                       NULL,
+                       NULL) == 0);
+    BTASSERT(slab_alloc(&slab) == NULL);
+
+    return (0);
+}
+
+static int test_constructor_destructor(void)
+{
+    struct slab_t slab;
+    struct object_t *object_p;
+
+    number_of_constructs = 0;
+    number_of_destructs = 0;
+
+    /* All objects are constructed once. */
+    BTASSERT(slab_init(&slab,
+                       &buffer[0],
+                       sizeof(buffer),
+                       sizeof(struct object_t),
+                       object_construct,
+                       object_destruct,
+                       (void *)MAGIC) == 0);
+    BTASSERTI(number_of_constructs, ==, 4);
+
+    object_p = slab_alloc(&slab);
+    BTASSERT(object_p != NULL);
+    BTASSERTI(object_p->magic, ==, MAGIC);
+    BTASSERTI(object_p->value, ==, 0);
+
+    /* Freed objects keep their state. */
+    object_p->value = 5;
+    BTASSERT(slab_free(&slab, object_p) == 0);
+    BTASSERT(slab_alloc(&slab) == object_p);
+    BTASSERTI(object_p->magic, ==, MAGIC);
+    BTASSERTI(object_p->value, ==, 5);
+    BTASSERTI(number_of_constructs, ==, 4);
+
+    /* All objects must be free when destroyed. */
+    BTASSERT(slab_destroy(&slab) == -EBUSY);
+    BTASSERTI(number_of_destructs, ==, 0);
+    BTASSERT(slab_free(&slab, object_p) == 0);
+    BTASSERT(slab_destroy(&slab) == 0);
+    BTASSERTI(number_of_destructs, ==, 4);
+
+    return (0);
+}
+
+static int test_stats(void)
+{
+    struct slab_t slab;
+    struct slab_stats_t stats;
+    void *objects[4];
+    char output[512];
+    int i;
+
+    BTASSERT(queue_init(&qout, &qoutbuf[0], sizeof(qoutbuf)) == 0);
+    BTASSERT(slab_init(&slab,
+                       &buffer[0],
+                       sizeof(buffer),
+                       sizeof(struct object_t),
+                       NULL,
+                       NULL,
+                       NULL) == 0);
+    BTASSERT(slab_register(&slab, "objects") == 0);
+
+    for (i = 0; i < 3; i++) {
+        objects[i] = slab_alloc(&slab);
+        BTASSERT(objects[i] != NULL);
+    }
+
+    BTASSERT(slab_free(&slab, objects[1]) == 0);
+    objects[1] = slab_alloc(&slab);
+    BTASSERT(objects[1] != NULL);
+    objects[3] = slab_alloc(&slab);
+    BTASSERT(objects[3] != NULL);
+    BTASSERT(slab_alloc(&slab) == NULL);
+    BTASSERT(slab_free(&slab, objects[0]) == 0);
+
+    BTASSERT(slab_get_stats(&slab, &stats) == 0);
+    BTASSERTI(stats.number_of_objects, ==, 4);
+    BTASSERTI(stats.used, ==, 3);
+    BTASSERTI(stats.used_max, ==, 4);
+    BTASSERTI(stats.number_of_allocs, ==, 5);
+    BTASSERTI(stats.number_of_failures, ==, 1);
+
+    BTASSERT(call("/alloc/slab/list", &output[0], sizeof(output)) > 0);
+    std_printf(FSTR("%s"), &output[0]);
+    BTASSERT(strstr(&output[0],
+                    "             objects ") != NULL);
+    BTASSERT(strstr(&output[0],
+                    "          4          3          4          5"
+                    "          1\r\n") != NULL);
+
+    for (i = 1; i < membersof(objects); i++) {
+        BTASSERT(slab_free(&slab, objects[i]) == 0);
+    }
+
+    BTASSERT(slab_destroy(&slab) == 0);
+
+    return (0);
+}
+
+int main()
+{
+    struct harness_testcase_t testcases[] = {
+        { test_alloc_free, "test_alloc_free" },
+        { test_bad_free, "test_bad_free" },
+        { test_unaligned_buffer, "test_unaligned_buffer" },
+        { test_constructor_destructor, "test_constructor_destructor" },
+        { test_stats, "test_stats" },
+        { NULL, NULL }
+    };
+
+    sys_start();
+
+    harness_run(testcases);
+
+    return (0);
+}
@@ -187,12 +187,58 @@ int test_array(void)
     return (0);
 }
 
+int test_unused_array(void)
+{
+    struct circular_buffer_t foo;
+    uint8_t foobuf[8];
+    void *buf_p;
+    char buf[8];
+
+    BTASSERT(circular_buffer_init(&foo, &foobuf[0], sizeof(foobuf)) == 0);
+
+    /* Seven bytes fits in the empty buffer. */
+    BTASSERT(circular_buffer_unused_array_one(&foo, &buf_p, 8) == 7);
+    BTASSERT(buf_p == &foobuf[0]);
+    BTASSERT(circular_buffer_unused_array_two(&foo, &buf_p, 8) == 0);
+    BTASSERT(circular_buffer_unused_array_one(&foo, &buf_p, 0) == 0);
+
+    /* Write three bytes in place. */
+    BTASSERT(circular_buffer_unused_array_one(&foo, &buf_p, 3) == 3);
+    memcpy(buf_p, "123", 3);
+    BTASSERT(circular_buffer_skip_back(&foo, 3) == 3);
+    BTASSERT(circular_buffer_used_size(&foo) == 3);
+    BTASSERT(circular_buffer_read(&foo, &buf[0], 2) == 2);
+    BTASSERT(memcmp(&buf[0], "12", 2) == 0);
+
+    /* Five bytes at the end and one byte at the beginning of the
+       buffer are unused. */
+    BTASSERT(circular_buffer_unused_array_one(&foo, &buf_p, 8) == 5);
+    BTASSERT(buf_p == &foobuf[3]);
+    memcpy(buf_p, "45678", 5);
+    BTASSERT(circular_buffer_unused_array_two(&foo, &buf_p, 8) == 1);
+    BTASSERT(buf_p == &foobuf[0]);
+    memcpy(buf_p, "9", 1);
+    BTASSERT(circular_buffer_skip_back(&foo, 8) == 6);
+    BTASSERT(circular_buffer_unused_size(&foo) == 0);
+    BTASSERT(circular_buffer_unused_array_one(&foo, &buf_p, 8) == 0);
+    BTASSERT(circular_buffer_read(&foo, &buf[0], 8) == 7);
+    BTASSERT(memcmp(&buf[0], "3456789", 7) == 0);
+
+    /* Wrapped write position. */
+    BTASSERT(circular_buffer_unused_array_one(&foo, &buf_p, 8) == 7);
+    BTASSERT(buf_p == &foobuf[1]);
+    BTASSERT(circular_buffer_unused_array_two(&foo, &buf_p, 8) == 0);
+
+    return (0);
+}
+
 int main()
 {
     struct harness_testcase_t testcases[] = {
         { test_read_write, "test_read_write" },
         { test_skip, "test_skip" },
         { test_array, "test_array" },
+        { test_unused_array, "test_unused_array" },
         { NULL, NULL }
     };
 
@@ -0,0 +1,365 @@
+/**
+ * @section License
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017, Erik Moqvist
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+#define UNCONTENDED_ITERATIONS                          200000
+#define CONTENDED_DURATION_MS                             1000
+
+static struct sem_t sem;
+static struct mutex_t mutex;
+static int sem_counter = 0;
+static int mutex_counter = 0;
+static volatile int stop;
+static THRD_STACK(worker_0_stack, 1024);
+static THRD_STACK(worker_1_stack, 1024);
+static THRD_STACK(worker_2_stack, 1024);
+
+/* The heap benchmark measures the magazines, and needs more memory
+   than small boards have. */
+#if CONFIG_HEAP_MAGAZINES == 1
+static struct heap_t heap;
+static char heap_buffer[262144];
+static int heap_worker_stacks_used = 0;
+
+/* A stack can not be reused after its thread has terminated, so each
+   benchmark run uses new stacks. */
+static THRD_STACK(heap_worker_stacks[4 + 8 + 16], 1024);
+#endif
+
+struct worker_t {
+    int sem_counter;
+    int mutex_counter;
+    char *name_p;
+    void *stack_p;
+    struct thrd_t *thrd_p;
+};
+
+#if CONFIG_HEAP_MAGAZINES == 1
+
+struct heap_worker_t {
+    long long ops;
+    int failures;
+    struct thrd_t *thrd_p;
+};
+
+static struct heap_worker_t heap_workers[16];
+
+#endif
+
+static struct worker_t workers[3] = {
+    {
+        .name_p = "worker_0",
+        .stack_p = worker_0_stack
+    },
+    {
+        .name_p = "worker_1",
+        .stack_p = worker_1_stack
+    },
+    {
+        .name_p = "worker_2",
+        .stack_p = worker_2_stack
+    }
+};
+
+/**
+ * Number of operations per second given the number of operations
+ * and the elapsed time.
+ */
+static long ops_per_second(long long ops,
+                           struct time_t *start_p,
+                           struct time_t *stop_p)
+{
+    struct time_t diff;
+    long long elapsed_us;
+
+    time_subtract(&diff, stop_p, start_p);
+    elapsed_us = (1000000ll * diff.seconds + diff.nanoseconds / 1000);
+
+    if (elapsed_us == 0) {
+        elapsed_us = 1;
+    }
+
+    return ((long)((1000000ll * ops) / elapsed_us));
+}
+
+/**
+ * The stress test worker, but stopping when told to.
+ */
+static void *worker_main(void *arg_p)
+{
+    int sem_count;
+    int mutex_count;
+    struct worker_t *worker_p;
+
+    worker_p = arg_p;
+    thrd_set_name(worker_p->name_p);
+
+    while (stop == 0) {
+        /* Semaphore. */
+        sem_take(&sem, NULL);
+        sem_count = sem_counter;
+        sem_count++;
+        sem_counter = sem_count;
+        worker_p->sem_counter++;
+        thrd_yield();
+        sem_give(&sem, 1);
+
+        /* Mutex. */
+        mutex_lock(&mutex);
+        mutex_count = mutex_counter;
+        mutex_count++;
+        mutex_counter = mutex_count;
+        worker_p->mutex_counter++;
+        mutex_unlock(&mutex);
+
+        thrd_yield();
+    }
+
+    return (NULL);
+}
+
+#if CONFIG_HEAP_MAGAZINES == 1
+
+/**
+ * Allocate and free fixed size buffers of a few sizes until told to
+ * stop.
+ */
+static void *heap_worker_main(void *arg_p)
+{
+    struct heap_worker_t *worker_p;
+    void *buffers[8];
+    int i;
+
+    worker_p = arg_p;
+    thrd_set_name("heap_worker");
+
+    if (heap_magazines_attach(&heap) != 0) {
+        worker_p->failures++;
+    }
+
+    while (stop == 0) {
+        for (i = 0; i < membersof(buffers); i++) {
+            buffers[i] = heap_alloc(&heap, 16 << (i % 4));
+
+            if (buffers[i] == NULL) {
+                worker_p->failures++;
+            }
+        }
+
+        for (i = 0; i < membersof(buffers); i++) {
+            if (buffers[i] != NULL) {
+                heap_free(&heap, buffers[i]);
+            }
+        }
+
+        worker_p->ops += (2 * membersof(buffers));
+        thrd_yield();
+    }
+
+    return (NULL);
+}
+
+/**
+ * Allocate and free heap buffers in given number of threads at the
+ * same time.
+ */
+static int heap_contended(int number_of_workers)
+{
+    struct time_t start;
+    struct time_t stop_time;
+    int i;
+    long long ops;
+    void *stack_p;
+    size_t sizes[8] = { 16, 32, 64, 128, 256, 512, 512, 512 };
+
+    BTASSERT(heap_init(&heap, heap_buffer, sizeof(heap_buffer), sizes) == 0);
+    stop = 0;
+
+    time_get(&start);
+
+    for (i = 0; i < number_of_workers; i++) {
+        heap_workers[i].ops = 0;
+        heap_workers[i].failures = 0;
+        stack_p = heap_worker_stacks[heap_worker_stacks_used++];
+        heap_workers[i].thrd_p = thrd_spawn(heap_worker_main,
+                                            &heap_workers[i],
+                                            90,
+                                            stack_p,
+                                            sizeof(heap_worker_stacks[0]));
+        BTASSERT(heap_workers[i].thrd_p != NULL);
+    }
+
+    thrd_sleep_ms(CONTENDED_DURATION_MS);
+    stop = 1;
+
+    for (i = 0; i < number_of_workers; i++) {
+        BTASSERT(thrd_join(heap_workers[i].thrd_p) == 0);
+    }
+
+    time_get(&stop_time);
+
+    ops = 0;
+
+    for (i = 0; i < number_of_workers; i++) {
+        BTASSERTI(heap_workers[i].failures, ==, 0);
+        ops += heap_workers[i].ops;
+    }
+
+    std_printf(OSTR("%2d workers: heap_alloc() + heap_free(): %ld ops/s\r\n"),
+               number_of_workers,
+               ops_per_second(ops, &start, &stop_time));
+
+    return (0);
+}
+
+#endif
+
+static int test_uncontended(void)
+{
+    struct time_t start;
+    struct time_t stop;
+    int i;
+
+    BTASSERT(sem_init(&sem, 0, 1) == 0);
+    BTASSERT(mutex_init(&mutex) == 0);
+
+    time_get(&start);
+
+    for (i = 0; i < UNCONTENDED_ITERATIONS; i++) {
+        sem_take(&sem, NULL);
+        sem_give(&sem, 1);
+    }
+
+    time_get(&stop);
+
+    std_printf(OSTR("sem_take() + sem_give():        %ld ops/s\r\n"),
+               ops_per_second(UNCONTENDED_ITERATIONS, &start, &stop));
+
+    time_get(&start);
+
+    for (i = 0; i < UNCONTENDED_ITERATIONS; i++) {
+        mutex_lock(&mutex);
+        mutex_unlock(&mutex);
+    }
+
+    time_get(&stop);
+
+    std_printf(OSTR("mutex_lock() + mutex_unlock(): %ld ops/s\r\n"),
+               ops_per_second(UNCONTENDED_ITERATIONS, &start, &stop));
+
+    BTASSERTI(sem.count, ==, 0);
+
+    return (0);
+}
+
+static int test_contended(void)
+{
+    struct time_t start;
+    struct time_t stop_time;
+    int i;
+    long long sem_ops;
+    long long mutex_ops;
+
+    BTASSERT(sem_init(&sem, 0, 1) == 0);
+    BTASSERT(mutex_init(&mutex) == 0);
+    stop = 0;
+
+    time_get(&start);
+
+    for (i = 0; i < membersof(workers); i++) {
+        workers[i].thrd_p = thrd_spawn(worker_main,
+                                       &workers[i],
+                                       90,
+                                       workers[i].stack_p,
+                                       sizeof(worker_0_stack));
+        BTASSERT(workers[i].thrd_p != NULL);
+    }
+
+    thrd_sleep_ms(CONTENDED_DURATION_MS);
+    stop = 1;
+
+    for (i = 0; i < membersof(workers); i++) {
+        BTASSERT(thrd_join(workers[i].thrd_p) == 0);
+    }
+
+    time_get(&stop_time);
+
+    sem_ops = 0;
+    mutex_ops = 0;
+
+    for (i = 0; i < membersof(workers); i++) {
+        sem_ops += workers[i].sem_counter;
+        mutex_ops += workers[i].mutex_counter;
+    }
+
+    BTASSERTI(sem_counter, ==, sem_ops);
+    BTASSERTI(mutex_counter, ==, mutex_ops);
+
+    std_printf(OSTR("%d workers:\r\n"
+                    "  sem_take() + sem_give():        %ld ops/s\r\n"
+                    "  mutex_lock() + mutex_unlock(): %ld ops/s\r\n"),
+               membersof(workers),
+               ops_per_second(sem_ops, &start, &stop_time),
+               ops_per_second(mutex_ops, &start, &stop_time));
+
+    return (0);
+}
+
+#if CONFIG_HEAP_MAGAZINES == 1
+
+static int test_heap_contended(void)
+{
+    BTASSERT(heap_contended(4) == 0);
+    BTASSERT(heap_contended(8) == 0);
+    BTASSERT(heap_contended(16) == 0);
+
+    return (0);
+}
+
+#endif
+
+int main()
+{
+    struct harness_testcase_t testcases[] = {
+        { test_uncontended, "test_uncontended" },
+        { test_contended, "test_contended" },
+#if CONFIG_HEAP_MAGAZINES == 1
+        { test_heap_contended, "test_heap_contended" },
+#endif
+        { NULL, NULL }
+    };
+
+    sys_start();
+
+    harness_run(testcases);
+
+    return (0);
+}
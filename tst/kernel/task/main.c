@@ -0,0 +1,608 @@
+/**
+ * @section License
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017, Erik Moqvist
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+#define NUMBER_OF_BENCHMARK_TASKS                       10000
+#define NUMBER_OF_BENCHMARK_YIELDS                        100
+#define NUMBER_OF_THRD_YIELDS                            1000
+#define NUMBER_OF_ACTIVE_TASKS                             10
+#define NUMBER_OF_ACTIVE_YIELDS                        100000
+
+struct letter_task_t {
+    struct task_t task;
+    char letter;
+};
+
+struct reader_task_t {
+    struct task_t task;
+    struct time_t timeout;
+    uint32_t mask;
+    int res;
+    char buf[4];
+};
+
+struct benchmark_task_t {
+    struct task_t task;
+    int count;
+};
+
+static struct task_scheduler_t scheduler;
+static char order[16];
+static int order_index;
+static struct queue_t queue[2];
+static char queue_buf[2][8];
+static struct event_t event;
+static struct sem_t sem;
+static struct letter_task_t letter_tasks[3];
+static struct reader_task_t reader_tasks[3];
+static struct benchmark_task_t benchmark_tasks[NUMBER_OF_BENCHMARK_TASKS];
+static struct benchmark_task_t active_tasks[NUMBER_OF_ACTIVE_TASKS];
+static int benchmark_done;
+static char blocked_byte;
+static struct sem_t blocked_sem;
+static struct time_t active_stop;
+static THRD_STACK(queue_writer_stack, 1024);
+static THRD_STACK(event_writer_stack, 1024);
+static THRD_STACK(sem_giver_stack, 1024);
+static THRD_STACK(spawner_stack, 1024);
+static THRD_STACK(yielder_stack, 1024);
+static THRD_STACK(blocked_writer_stack, 1024);
+
+static void reset_order(void)
+{
+    order_index = 0;
+    memset(&order[0], 0, sizeof(order));
+}
+
+static int letter_main(struct task_t *task_p)
+{
+    struct letter_task_t *self_p;
+
+    self_p = container_of(task_p, struct letter_task_t, task);
+
+    TASK_BEGIN(task_p);
+
+    order[order_index++] = self_p->letter;
+    TASK_YIELD(task_p);
+    order[order_index++] = self_p->letter;
+
+    TASK_END(task_p);
+}
+
+static int sleep_main(struct task_t *task_p)
+{
+    struct reader_task_t *self_p;
+
+    self_p = container_of(task_p, struct reader_task_t, task);
+
+    TASK_BEGIN(task_p);
+
+    TASK_SLEEP(task_p, &self_p->timeout);
+    self_p->res = task_get_result(task_p);
+    order[order_index++] = 's';
+
+    TASK_END(task_p);
+}
+
+static int queue_reader_main(struct task_t *task_p)
+{
+    struct reader_task_t *self_p;
+
+    self_p = container_of(task_p, struct reader_task_t, task);
+
+    TASK_BEGIN(task_p);
+
+    TASK_QUEUE_READ(task_p,
+                    &queue[self_p->mask],
+                    &self_p->buf[0],
+                    sizeof(self_p->buf),
+                    (self_p->timeout.seconds == -1 ? NULL : &self_p->timeout));
+    self_p->res = task_get_result(task_p);
+
+    TASK_END(task_p);
+}
+
+static int event_reader_main(struct task_t *task_p)
+{
+    struct reader_task_t *self_p;
+
+    self_p = container_of(task_p, struct reader_task_t, task);
+
+    TASK_BEGIN(task_p);
+
+    TASK_EVENT_READ(task_p, &event, &self_p->mask, NULL);
+    self_p->res = task_get_result(task_p);
+
+    TASK_END(task_p);
+}
+
+static int sem_taker_main(struct task_t *task_p)
+{
+    struct reader_task_t *self_p;
+
+    self_p = container_of(task_p, struct reader_task_t, task);
+
+    TASK_BEGIN(task_p);
+
+    TASK_SEM_TAKE(task_p,
+                  &sem,
+                  (self_p->timeout.seconds == -1 ? NULL : &self_p->timeout));
+    self_p->res = task_get_result(task_p);
+
+    if (self_p->res == 0) {
+        order[order_index++] = 't';
+        sem_give(&sem, 1);
+    }
+
+    TASK_END(task_p);
+}
+
+static int benchmark_main(struct task_t *task_p)
+{
+    struct benchmark_task_t *self_p;
+
+    self_p = container_of(task_p, struct benchmark_task_t, task);
+
+    TASK_BEGIN(task_p);
+
+    for (self_p->count = 0;
+         self_p->count < NUMBER_OF_BENCHMARK_YIELDS;
+         self_p->count++) {
+        TASK_YIELD(task_p);
+    }
+
+    benchmark_done++;
+
+    TASK_END(task_p);
+}
+
+static int blocked_main(struct task_t *task_p)
+{
+    TASK_BEGIN(task_p);
+
+    TASK_QUEUE_READ(task_p, &queue[0], &blocked_byte, 1, NULL);
+
+    TASK_END(task_p);
+}
+
+static int active_main(struct task_t *task_p)
+{
+    struct benchmark_task_t *self_p;
+
+    self_p = container_of(task_p, struct benchmark_task_t, task);
+
+    TASK_BEGIN(task_p);
+
+    for (self_p->count = 0;
+         self_p->count < NUMBER_OF_ACTIVE_YIELDS;
+         self_p->count++) {
+        TASK_YIELD(task_p);
+    }
+
+    benchmark_done++;
+
+    /* Let the writer release the blocked tasks. */
+    if (benchmark_done == NUMBER_OF_ACTIVE_TASKS) {
+        time_get(&active_stop);
+        sem_give(&blocked_sem, 1);
+    }
+
+    TASK_END(task_p);
+}
+
+static void *blocked_writer_main(void *arg_p)
+{
+    char buf[100];
+    int i;
+
+    memset(&buf[0], 0, sizeof(buf));
+    sem_take(&blocked_sem, NULL);
+
+    for (i = 0; i < NUMBER_OF_BENCHMARK_TASKS; i += sizeof(buf)) {
+        queue_write(&queue[0], &buf[0], sizeof(buf));
+    }
+
+    return (NULL);
+}
+
+static void *queue_writer_main(void *arg_p)
+{
+    thrd_sleep_ms(30);
+    queue_write(&queue[0], "ab", 2);
+    thrd_sleep_ms(10);
+    queue_write(&queue[0], "cd", 2);
+
+    return (NULL);
+}
+
+static void *event_writer_main(void *arg_p)
+{
+    uint32_t mask;
+
+    thrd_sleep_ms(20);
+    mask = 0x1;
+    event_write(&event, &mask, sizeof(mask));
+    thrd_sleep_ms(20);
+    mask = 0x6;
+    event_write(&event, &mask, sizeof(mask));
+
+    return (NULL);
+}
+
+static void *sem_giver_main(void *arg_p)
+{
+    thrd_sleep_ms(30);
+    sem_give(&sem, 1);
+
+    return (NULL);
+}
+
+static void *spawner_main(void *arg_p)
+{
+    thrd_sleep_ms(20);
+    task_spawn(&scheduler, &letter_tasks[0].task, letter_main);
+
+    return (NULL);
+}
+
+static void *yielder_main(void *arg_p)
+{
+    int i;
+
+    for (i = 0; i < NUMBER_OF_THRD_YIELDS; i++) {
+        thrd_yield();
+    }
+
+    return (NULL);
+}
+
+static int test_init(void)
+{
+    BTASSERT(task_scheduler_init(&scheduler) == 0);
+
+    /* Nothing to run. */
+    BTASSERT(task_scheduler_run(&scheduler) == 0);
+
+    return (0);
+}
+
+static int test_yield(void)
+{
+    int i;
+
+    reset_order();
+
+    for (i = 0; i < membersof(letter_tasks); i++) {
+        letter_tasks[i].letter = ('A' + i);
+        BTASSERT(task_spawn(&scheduler,
+                            &letter_tasks[i].task,
+                            letter_main) == 0);
+    }
+
+    BTASSERT(task_scheduler_run(&scheduler) == 0);
+    BTASSERT(strcmp(&order[0], "ABCABC") == 0);
+
+    return (0);
+}
+
+static int test_sleep(void)
+{
+    struct time_t start;
+    struct time_t stop;
+    struct time_t diff;
+
+    reset_order();
+    reader_tasks[0].timeout.seconds = 0;
+    reader_tasks[0].timeout.nanoseconds = 50000000;
+    reader_tasks[0].res = -1;
+
+    time_get(&start);
+    BTASSERT(task_spawn(&scheduler, &reader_tasks[0].task, sleep_main) == 0);
+    BTASSERT(task_scheduler_run(&scheduler) == 0);
+    time_get(&stop);
+    time_subtract(&diff, &stop, &start);
+
+    BTASSERT(reader_tasks[0].res == 0);
+    BTASSERT(strcmp(&order[0], "s") == 0);
+    BTASSERT(diff.seconds == 0);
+    BTASSERT(diff.nanoseconds >= 50000000);
+
+    return (0);
+}
+
+static int test_queue_read(void)
+{
+    BTASSERT(queue_init(&queue[0], &queue_buf[0][0], sizeof(queue_buf[0])) == 0);
+    BTASSERT(queue_init(&queue[1], &queue_buf[1][0], sizeof(queue_buf[1])) == 0);
+
+    /* Waits until all four bytes are available. */
+    reader_tasks[0].mask = 0;
+    reader_tasks[0].timeout.seconds = -1;
+    reader_tasks[0].res = -1;
+
+    /* Times out. */
+    reader_tasks[1].mask = 1;
+    reader_tasks[1].timeout.seconds = 0;
+    reader_tasks[1].timeout.nanoseconds = 20000000;
+    reader_tasks[1].res = -1;
+
+    /* Zero timeout. */
+    reader_tasks[2].mask = 1;
+    reader_tasks[2].timeout.seconds = 0;
+    reader_tasks[2].timeout.nanoseconds = 0;
+    reader_tasks[2].res = -1;
+
+    BTASSERT(thrd_spawn(queue_writer_main,
+                        NULL,
+                        0,
+                        queue_writer_stack,
+                        sizeof(queue_writer_stack)) != NULL);
+
+    BTASSERT(task_spawn(&scheduler,
+                        &reader_tasks[0].task,
+                        queue_reader_main) == 0);
+    BTASSERT(task_spawn(&scheduler,
+                        &reader_tasks[1].task,
+                        queue_reader_main) == 0);
+    BTASSERT(task_spawn(&scheduler,
+                        &reader_tasks[2].task,
+                        queue_reader_main) == 0);
+    BTASSERT(task_scheduler_run(&scheduler) == 0);
+
+    BTASSERT(reader_tasks[0].res == 4);
+    BTASSERT(memcmp(&reader_tasks[0].buf[0], "abcd", 4) == 0);
+    BTASSERT(reader_tasks[1].res == -ETIMEDOUT);
+    BTASSERT(reader_tasks[2].res == -ETIMEDOUT);
+    BTASSERT(queue_size(&queue[0]) == 0);
+
+    return (0);
+}
+
+static int test_event_read(void)
+{
+    BTASSERT(event_init(&event) == 0);
+
+    reader_tasks[0].mask = 0x2;
+    reader_tasks[0].res = -1;
+
+    BTASSERT(thrd_spawn(event_writer_main,
+                        NULL,
+                        0,
+                        event_writer_stack,
+                        sizeof(event_writer_stack)) != NULL);
+
+    BTASSERT(task_spawn(&scheduler,
+                        &reader_tasks[0].task,
+                        event_reader_main) == 0);
+    BTASSERT(task_scheduler_run(&scheduler) == 0);
+
+    BTASSERT(reader_tasks[0].res == sizeof(uint32_t));
+    BTASSERT(reader_tasks[0].mask == 0x2);
+
+    /* Events not read are kept. */
+    BTASSERT(event.mask == 0x5);
+
+    return (0);
+}
+
+static int test_sem_take(void)
+{
+    int i;
+
+    reset_order();
+    BTASSERT(sem_init(&sem, 1, 1) == 0);
+
+    /* Two tasks wait forever, and one times out. */
+    for (i = 0; i < 2; i++) {
+        reader_tasks[i].timeout.seconds = -1;
+        reader_tasks[i].res = -1;
+    }
+
+    reader_tasks[2].timeout.seconds = 0;
+    reader_tasks[2].timeout.nanoseconds = 10000000;
+    reader_tasks[2].res = -1;
+
+    BTASSERT(thrd_spawn(sem_giver_main,
+                        NULL,
+                        0,
+                        sem_giver_stack,
+                        sizeof(sem_giver_stack)) != NULL);
+
+    for (i = 0; i < membersof(reader_tasks); i++) {
+        BTASSERT(task_spawn(&scheduler,
+                            &reader_tasks[i].task,
+                            sem_taker_main) == 0);
+    }
+
+    BTASSERT(task_scheduler_run(&scheduler) == 0);
+
+    BTASSERT(reader_tasks[0].res == 0);
+    BTASSERT(reader_tasks[1].res == 0);
+    BTASSERT(reader_tasks[2].res == -ETIMEDOUT);
+    BTASSERT(strcmp(&order[0], "tt") == 0);
+    BTASSERT(sem.count == 0);
+
+    return (0);
+}
+
+static int test_spawn_from_thread(void)
+{
+    reset_order();
+
+    reader_tasks[0].timeout.seconds = 0;
+    reader_tasks[0].timeout.nanoseconds = 100000000;
+    letter_tasks[0].letter = 'A';
+
+    BTASSERT(thrd_spawn(spawner_main,
+                        NULL,
+                        0,
+                        spawner_stack,
+                        sizeof(spawner_stack)) != NULL);
+
+    BTASSERT(task_spawn(&scheduler, &reader_tasks[0].task, sleep_main) == 0);
+    BTASSERT(task_scheduler_run(&scheduler) == 0);
+
+    /* The spawned task ran while the other task was sleeping. */
+    BTASSERT(strcmp(&order[0], "AAs") == 0);
+
+    return (0);
+}
+
+static int test_benchmark(void)
+{
+    struct time_t start;
+    struct time_t stop;
+    struct time_t diff;
+    unsigned long task_ns;
+    unsigned long thrd_ns;
+    int i;
+
+    benchmark_done = 0;
+
+    time_get(&start);
+
+    for (i = 0; i < membersof(benchmark_tasks); i++) {
+        BTASSERT(task_spawn(&scheduler,
+                            &benchmark_tasks[i].task,
+                            benchmark_main) == 0);
+    }
+
+    BTASSERT(task_scheduler_run(&scheduler) == 0);
+
+    time_get(&stop);
+    time_subtract(&diff, &stop, &start);
+
+    BTASSERT(benchmark_done == NUMBER_OF_BENCHMARK_TASKS);
+
+    task_ns = ((diff.seconds * 1000000000UL + diff.nanoseconds)
+               / (NUMBER_OF_BENCHMARK_TASKS
+                  * (NUMBER_OF_BENCHMARK_YIELDS + 1)));
+
+    /* Two threads with the same priority yielding to each other. */
+    time_get(&start);
+
+    BTASSERT(thrd_spawn(yielder_main,
+                        NULL,
+                        0,
+                        yielder_stack,
+                        sizeof(yielder_stack)) != NULL);
+
+    for (i = 0; i < NUMBER_OF_THRD_YIELDS; i++) {
+        thrd_yield();
+    }
+
+    time_get(&stop);
+    time_subtract(&diff, &stop, &start);
+
+    thrd_ns = ((diff.seconds * 1000000000UL + diff.nanoseconds)
+               / (2 * NUMBER_OF_THRD_YIELDS));
+
+    std_printf(OSTR("%d tasks: %u bytes per task, %lu ns per switch.\r\n"
+                    "Threads: %u bytes per thread with a 1024 bytes "
+                    "stack, %lu ns per switch.\r\n"),
+               NUMBER_OF_BENCHMARK_TASKS,
+               (unsigned)sizeof(benchmark_tasks[0]),
+               task_ns,
+               (unsigned)sizeof(yielder_stack),
+               thrd_ns);
+
+    return (0);
+}
+
+static int test_benchmark_blocked(void)
+{
+    struct time_t start;
+    struct time_t diff;
+    int i;
+
+    BTASSERT(queue_init(&queue[0], &queue_buf[0][0], sizeof(queue_buf[0])) == 0);
+    BTASSERT(sem_init(&blocked_sem, 1, 1) == 0);
+    benchmark_done = 0;
+
+    BTASSERT(thrd_spawn(blocked_writer_main,
+                        NULL,
+                        0,
+                        blocked_writer_stack,
+                        sizeof(blocked_writer_stack)) != NULL);
+
+    /* Most tasks wait for data on a queue while a few are
+       running. */
+    for (i = 0; i < membersof(benchmark_tasks); i++) {
+        BTASSERT(task_spawn(&scheduler,
+                            &benchmark_tasks[i].task,
+                            blocked_main) == 0);
+    }
+
+    for (i = 0; i < membersof(active_tasks); i++) {
+        BTASSERT(task_spawn(&scheduler,
+                            &active_tasks[i].task,
+                            active_main) == 0);
+    }
+
+    time_get(&start);
+    BTASSERT(task_scheduler_run(&scheduler) == 0);
+
+    BTASSERT(benchmark_done == NUMBER_OF_ACTIVE_TASKS);
+    BTASSERT(queue_size(&queue[0]) == 0);
+
+    time_subtract(&diff, &active_stop, &start);
+
+    std_printf(OSTR("%d running tasks and %d waiting tasks: "
+                    "%lu ns per switch.\r\n"),
+               NUMBER_OF_ACTIVE_TASKS,
+               NUMBER_OF_BENCHMARK_TASKS,
+               ((diff.seconds * 1000000000UL + diff.nanoseconds)
+                / (NUMBER_OF_ACTIVE_TASKS * (NUMBER_OF_ACTIVE_YIELDS + 1))));
+
+    return (0);
+}
+
+int main()
+{
+    struct harness_testcase_t testcases[] = {
+        { test_init, "test_init" },
+        { test_yield, "test_yield" },
+        { test_sleep, "test_sleep" },
+        { test_queue_read, "test_queue_read" },
+        { test_event_read, "test_event_read" },
+        { test_sem_take, "test_sem_take" },
+        { test_spawn_from_thread, "test_spawn_from_thread" },
+        { test_benchmark, "test_benchmark" },
+        { test_benchmark_blocked, "test_benchmark_blocked" },
+        { NULL, NULL }
+    };
+
+    sys_start();
+
+    harness_run(testcases);
+
+    return (0);
+}
@@ -352,6 +352,297 @@ int test_prio_list(void)
     return (0);
 }
 
+int test_prio_list_order(void)
+{
+    struct thrd_prio_list_t list;
+    struct thrd_prio_list_elem_t elems[6];
+    struct thrd_t threads[6];
+    int i;
+
+    BTASSERT(thrd_prio_list_init(&list) == 0);
+    BTASSERT(thrd_prio_list_pop_isr(&list) == NULL);
+
+    /* Priorities both within and across levels. */
+    threads[0].prio = 3;
+    threads[1].prio = 1;
+    threads[2].prio = 3;
+    threads[3].prio = -128;
+    threads[4].prio = 127;
+    threads[5].prio = 2;
+
+    for (i = 0; i < membersof(elems); i++) {
+        elems[i].thrd_p = &threads[i];
+        thrd_prio_list_push_isr(&list, &elems[i]);
+    }
+
+    BTASSERT(thrd_prio_list_pop_isr(&list) == &elems[3]);
+    BTASSERT(thrd_prio_list_pop_isr(&list) == &elems[1]);
+    BTASSERT(thrd_prio_list_pop_isr(&list) == &elems[5]);
+    BTASSERT(thrd_prio_list_pop_isr(&list) == &elems[0]);
+    BTASSERT(thrd_prio_list_pop_isr(&list) == &elems[2]);
+    BTASSERT(thrd_prio_list_pop_isr(&list) == &elems[4]);
+    BTASSERT(thrd_prio_list_pop_isr(&list) == NULL);
+
+    /* Remove first, middle and last elements. */
+    for (i = 0; i < membersof(elems); i++) {
+        thrd_prio_list_push_isr(&list, &elems[i]);
+    }
+
+    BTASSERT(thrd_prio_list_remove_isr(&list, &elems[3]) == 0);
+    BTASSERT(thrd_prio_list_remove_isr(&list, &elems[3]) == -1);
+    BTASSERT(thrd_prio_list_remove_isr(&list, &elems[2]) == 0);
+    BTASSERT(thrd_prio_list_remove_isr(&list, &elems[1]) == 0);
+    BTASSERT(thrd_prio_list_pop_isr(&list) == &elems[5]);
+    BTASSERT(thrd_prio_list_pop_isr(&list) == &elems[0]);
+    BTASSERT(thrd_prio_list_remove_isr(&list, &elems[4]) == 0);
+    BTASSERT(thrd_prio_list_pop_isr(&list) == NULL);
+
+    return (0);
+}
+
+#if defined(ARCH_LINUX)
+
+static struct thrd_t benchmark_threads[48];
+static struct thrd_prio_list_elem_t benchmark_elems[48];
+
+int test_prio_list_benchmark(void)
+{
+    struct thrd_prio_list_t list;
+    struct thrd_prio_list_elem_t *elem_p;
+    int i;
+    int start;
+    int elapsed;
+
+    BTASSERT(thrd_prio_list_init(&list) == 0);
+
+    /* Fill the list with worker threads of equal priority. */
+    for (i = 0; i < membersof(benchmark_elems); i++) {
+        benchmark_threads[i].prio = 10;
+        benchmark_elems[i].thrd_p = &benchmark_threads[i];
+        thrd_prio_list_push_isr(&list, &benchmark_elems[i]);
+    }
+
+    /* Pop the first element and push it back, just as the scheduler
+       does when the current thread yields. */
+    start = time_micros();
+
+    for (i = 0; i < 100000; i++) {
+        elem_p = thrd_prio_list_pop_isr(&list);
+        thrd_prio_list_push_isr(&list, elem_p);
+    }
+
+    elapsed = time_micros_elapsed(start, time_micros());
+
+    std_printf(FSTR("%d ready threads: %d pop/push pairs in %d us\r\n"),
+               membersof(benchmark_elems),
+               i,
+               elapsed);
+
+    /* The FIFO order must be intact. */
+    for (i = 0; i < membersof(benchmark_elems); i++) {
+        BTASSERT(thrd_prio_list_pop_isr(&list)
+                 == &benchmark_elems[(100000 + i) % membersof(benchmark_elems)]);
+    }
+
+    BTASSERT(thrd_prio_list_pop_isr(&list) == NULL);
+
+    return (0);
+}
+
+#define SWITCH_BENCHMARK_YIELDS 20000
+
+static THRD_STACK(switch_benchmark_stack, 1024);
+
+static void *switch_benchmark_main(void *arg_p)
+{
+    int i;
+
+    for (i = 0; i < SWITCH_BENCHMARK_YIELDS; i++) {
+        thrd_yield();
+    }
+
+    return (NULL);
+}
+
+int test_switch_benchmark(void)
+{
+    struct thrd_t *thrd_p;
+    int i;
+    int start;
+    int elapsed;
+
+    /* Two threads of equal priority yielding to each other. */
+    thrd_p = thrd_spawn(switch_benchmark_main,
+                        NULL,
+                        thrd_get_prio(),
+                        switch_benchmark_stack,
+                        sizeof(switch_benchmark_stack));
+    BTASSERT(thrd_p != NULL);
+
+    start = time_micros();
+
+    for (i = 0; i < SWITCH_BENCHMARK_YIELDS; i++) {
+        BTASSERT(thrd_yield() == 0);
+    }
+
+    BTASSERT(thrd_join(thrd_p) == 0);
+
+    elapsed = time_micros_elapsed(start, time_micros());
+
+    std_printf(FSTR("%s port: %d context switches in %d us (%d ns each)\r\n"),
+               (CONFIG_THRD_PORT_UCONTEXT == 1 ? "ucontext" : "pthread"),
+               2 * SWITCH_BENCHMARK_YIELDS,
+               elapsed,
+               (int)((1000LL * elapsed) / (2 * SWITCH_BENCHMARK_YIELDS)));
+
+    return (0);
+}
+
+#endif
+
+#if CONFIG_THRD_TRACE == 1
+
+static int test_trace(void)
+{
+    struct thrd_trace_entry_t entries[32];
+    struct thrd_t *self_p;
+    char command[64];
+    int length;
+    int i;
+    int timer;
+    int resume;
+    int switch_in;
+
+    self_p = thrd_self();
+    BTASSERT(thrd_trace_clear() == 0);
+    BTASSERT(thrd_trace_read(&entries[0], membersof(entries)) == 0);
+
+    /* Switch to the idle thread, and back when the timer expires. */
+    thrd_sleep_ms(20);
+
+    length = thrd_trace_read(&entries[0], membersof(entries));
+    BTASSERT(length >= 4);
+
+    timer = -1;
+    resume = -1;
+    switch_in = -1;
+
+    for (i = 0; i < length; i++) {
+        if ((entries[i].type == THRD_TRACE_TYPE_TIMER) && (timer == -1)) {
+            timer = i;
+        } else if ((entries[i].type == THRD_TRACE_TYPE_RESUME)
+                   && (entries[i].thrd_p == self_p)) {
+            resume = i;
+        } else if ((entries[i].type == THRD_TRACE_TYPE_SWITCH)
+                   && (entries[i].thrd_p == self_p)) {
+            switch_in = i;
+        }
+    }
+
+    BTASSERT(entries[0].type == THRD_TRACE_TYPE_SWITCH);
+    BTASSERT(entries[0].arg == (uintptr_t)self_p);
+    BTASSERT(timer > 0);
+    BTASSERT(resume > timer);
+    BTASSERT(switch_in > resume);
+    BTASSERT(entries[switch_in].timestamp - entries[0].timestamp >= 20000);
+
+    /* 64 bit timestamps do not wrap. */
+    BTASSERTI(sizeof(entries[0].timestamp), ==, sizeof(uint64_t));
+
+    for (i = 1; i < length; i++) {
+        BTASSERT(entries[i].timestamp >= entries[i - 1].timestamp);
+    }
+
+    /* Print and clear the trace buffer. */
+    strcpy(command, "/kernel/thrd/trace");
+    BTASSERT(fs_call(command, NULL, sys_get_stdout(), NULL) == 0);
+
+    strcpy(command, "/kernel/thrd/trace chrome");
+    BTASSERT(fs_call(command, NULL, sys_get_stdout(), NULL) == 0);
+
+    strcpy(command, "/kernel/thrd/trace clear");
+    BTASSERT(fs_call(command, NULL, sys_get_stdout(), NULL) == 0);
+    BTASSERT(thrd_trace_read(&entries[0], membersof(entries)) == 0);
+
+    strcpy(command, "/kernel/thrd/trace foo");
+    BTASSERT(fs_call(command, NULL, sys_get_stdout(), NULL) == -EINVAL);
+
+    return (0);
+}
+
+#endif
+
+#if CONFIG_THRD_HISTOGRAMS == 1
+
+static uint32_t histogram_sum(uint32_t *histogram_p)
+{
+    uint32_t sum;
+    int i;
+
+    sum = 0;
+
+    for (i = 0; i < THRD_HISTOGRAM_BINS; i++) {
+        sum += histogram_p[i];
+    }
+
+    return (sum);
+}
+
+static int test_histograms(void)
+{
+    struct thrd_t *self_p;
+    char command[64];
+    uint32_t blocked;
+
+    self_p = thrd_self();
+    BTASSERT(thrd_histograms_clear(self_p) == 0);
+    BTASSERT(histogram_sum(&self_p->statistics.histograms.latency[0]) == 0);
+    BTASSERT(histogram_sum(&self_p->statistics.histograms.run[0]) == 0);
+    BTASSERT(histogram_sum(&self_p->statistics.histograms.blocked[0]) == 0);
+
+    /* Block for 20 ms, in bin [16384, 32767] us, or close to it. */
+    thrd_sleep_ms(20);
+
+    BTASSERT(histogram_sum(&self_p->statistics.histograms.latency[0]) == 1);
+    BTASSERT(histogram_sum(&self_p->statistics.histograms.run[0]) == 1);
+    BTASSERT(histogram_sum(&self_p->statistics.histograms.blocked[0]) == 1);
+    blocked = (self_p->statistics.histograms.blocked[14]
+               + self_p->statistics.histograms.blocked[15]
+               + self_p->statistics.histograms.blocked[16]);
+    BTASSERT(blocked == 1);
+
+    /* Block for longer than a second, in the last bin. */
+    thrd_sleep_ms(1100);
+
+    BTASSERT(histogram_sum(&self_p->statistics.histograms.blocked[0]) == 2);
+    BTASSERT(self_p->statistics.histograms.blocked[19] == 1);
+
+    /* Print the histograms. */
+    BTASSERT(thrd_histograms_print(self_p, sys_get_stdout()) == 0);
+
+    strcpy(command, "/kernel/thrd/histograms");
+    BTASSERT(fs_call(command, NULL, sys_get_stdout(), NULL) == 0);
+
+    strcpy(command, "/kernel/thrd/histograms main");
+    BTASSERT(fs_call(command, NULL, sys_get_stdout(), NULL) == 0);
+
+    strcpy(command, "/kernel/thrd/histograms foo");
+    BTASSERT(fs_call(command, NULL, sys_get_stdout(), NULL) == -ESRCH);
+
+    strcpy(command, "/kernel/thrd/histograms main foo");
+    BTASSERT(fs_call(command, NULL, sys_get_stdout(), NULL) == -EINVAL);
+
+    strcpy(command, "/kernel/thrd/latency/0");
+    BTASSERT(fs_call(command, NULL, sys_get_stdout(), NULL) == 0);
+
+    BTASSERT(thrd_histograms_clear(self_p) == 0);
+    BTASSERT(histogram_sum(&self_p->statistics.histograms.blocked[0]) == 0);
+
+    return (0);
+}
+
+#endif
+
 int main()
 {
     struct harness_testcase_t testcases[] = {
@@ -377,6 +668,17 @@ int main()
 #    endif
         { test_stack_heap, "test_stack_heap" },
         { test_prio_list, "test_prio_list" },
+        { test_prio_list_order, "test_prio_list_order" },
+#    if defined(ARCH_LINUX)
+        { test_prio_list_benchmark, "test_prio_list_benchmark" },
+        { test_switch_benchmark, "test_switch_benchmark" },
+#    endif
+#    if CONFIG_THRD_TRACE == 1
+        { test_trace, "test_trace" },
+#endif
+#if CONFIG_THRD_HISTOGRAMS == 1
+        { test_histograms, "test_histograms" },
+#    endif
 #endif
         { NULL, NULL }
     };
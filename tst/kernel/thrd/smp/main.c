@@ -0,0 +1,378 @@
+/**
+ * @section License
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014-2017, Erik Moqvist
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+#define WORKERS                                             4
+#define YIELDS                                           1000
+
+static THRD_STACK(worker_stacks[WORKERS], 1024);
+static volatile int started;
+static volatile int cores[WORKERS];
+static volatile int spinning;
+static char order[WORKERS];
+static volatile int order_length;
+static volatile int locked;
+static volatile int yielded;
+
+static void *core_main(void *arg_p)
+{
+    int core;
+
+    /* Move to the core with the same number as the argument. */
+    core = (intptr_t)arg_p;
+    thrd_set_affinity(thrd_self(), (1 << core));
+    thrd_yield();
+    cores[core] = thrd_get_core();
+
+    return (NULL);
+}
+
+/**
+ * Spin until all workers are running. Only completes if the workers
+ * run in parallel, as they never give up the core.
+ */
+static void *parallel_main(void *arg_p)
+{
+    sys_lock();
+    started++;
+    sys_unlock();
+
+    while (started < CONFIG_THRD_SMP_CORES);
+
+    cores[(intptr_t)arg_p] = thrd_get_core();
+
+    return (NULL);
+}
+
+static void *work_main(void *arg_p)
+{
+    int i;
+    volatile uint32_t value;
+
+    value = 0;
+
+    for (i = 0; i < 2000000; i++) {
+        value += i;
+
+        /* Give the scheduler a chance to balance the load. */
+        if ((i % 100000) == 0) {
+            thrd_yield();
+        }
+    }
+
+    cores[(intptr_t)arg_p] |= (1 << thrd_get_core());
+
+    return (NULL);
+}
+
+/**
+ * Keep the core busy until told to stop.
+ */
+static void *spinner_main(void *arg_p)
+{
+    spinning = 1;
+
+    while (spinning == 1);
+
+    return (NULL);
+}
+
+static void *letter_main(void *arg_p)
+{
+    sys_lock();
+    order[order_length++] = *(char *)arg_p;
+    sys_unlock();
+
+    cores[*(char *)arg_p - 'A'] = thrd_get_core();
+
+    return (NULL);
+}
+
+/**
+ * Hold the system lock until the main thread has yielded, or give up
+ * after a while.
+ */
+static void *locker_main(void *arg_p)
+{
+    long i;
+
+    sys_lock();
+    locked = 1;
+
+    for (i = 0; (i < 1000000000L) && (yielded == 0); i++);
+
+    locked = 0;
+    sys_unlock();
+
+    return (NULL);
+}
+
+static int run_workers(void *(*main)(void *), int number_of_workers)
+{
+    int i;
+    struct thrd_t *threads[WORKERS];
+
+    for (i = 0; i < number_of_workers; i++) {
+        threads[i] = thrd_spawn(main,
+                                (void *)(intptr_t)i,
+                                10,
+                                worker_stacks[i],
+                                sizeof(worker_stacks[i]));
+        BTASSERT(threads[i] != NULL);
+    }
+
+    for (i = 0; i < number_of_workers; i++) {
+        BTASSERT(thrd_join(threads[i]) == 0);
+    }
+
+    return (0);
+}
+
+int test_affinity(void)
+{
+    int i;
+    struct thrd_t *thrd_p;
+
+    BTASSERT(thrd_get_core() == 0);
+
+    /* Bad masks. */
+    BTASSERT(thrd_set_affinity(thrd_self(), 0) == -EINVAL);
+    BTASSERT(thrd_set_affinity(thrd_self(),
+                               (1 << CONFIG_THRD_SMP_CORES)) == -EINVAL);
+
+    /* A thread bound to each core. */
+    for (i = 0; i < CONFIG_THRD_SMP_CORES; i++) {
+        cores[i] = -1;
+        thrd_p = thrd_spawn(core_main,
+                            (void *)(intptr_t)i,
+                            10,
+                            worker_stacks[i],
+                            sizeof(worker_stacks[i]));
+        BTASSERT(thrd_p != NULL);
+        BTASSERT(thrd_join(thrd_p) == 0);
+        BTASSERT(cores[i] == i);
+    }
+
+    /* Move the main thread to the last core and back. */
+    BTASSERT(thrd_set_affinity(thrd_self(),
+                               (1 << (CONFIG_THRD_SMP_CORES - 1))) == 0);
+    BTASSERT(thrd_yield() == 0);
+    BTASSERT(thrd_get_core() == CONFIG_THRD_SMP_CORES - 1);
+    BTASSERT(thrd_set_affinity(thrd_self(), 0x1) == 0);
+    BTASSERT(thrd_yield() == 0);
+    BTASSERT(thrd_get_core() == 0);
+    BTASSERT(thrd_set_affinity(thrd_self(), 0xffffffff) == 0);
+
+    return (0);
+}
+
+int test_parallel(void)
+{
+    int i;
+
+    started = 0;
+
+    BTASSERT(run_workers(parallel_main, CONFIG_THRD_SMP_CORES) == 0);
+
+    /* All workers ran at the same time on different cores. */
+    for (i = 1; i < CONFIG_THRD_SMP_CORES; i++) {
+        BTASSERT(cores[i] != cores[0]);
+    }
+
+    return (0);
+}
+
+int test_work_stealing(void)
+{
+    int i;
+    int used;
+    int start;
+    int elapsed;
+
+    for (i = 0; i < WORKERS; i++) {
+        cores[i] = 0;
+    }
+
+    start = time_micros();
+    BTASSERT(run_workers(work_main, WORKERS) == 0);
+    elapsed = time_micros_elapsed(start, time_micros());
+
+    used = 0;
+
+    for (i = 0; i < WORKERS; i++) {
+        used |= cores[i];
+    }
+
+    std_printf(FSTR("%d workers on %d cores in %d us, core mask 0x%x.\r\n"),
+               WORKERS,
+               CONFIG_THRD_SMP_CORES,
+               elapsed,
+               used);
+
+    /* Work was spread over all cores. */
+    BTASSERTI(used, ==, (1 << CONFIG_THRD_SMP_CORES) - 1);
+
+    /* Same work on a single core for comparison. */
+    BTASSERT(thrd_set_affinity(thrd_self(), 0x1) == 0);
+
+    start = time_micros();
+
+    for (i = 0; i < WORKERS; i++) {
+        BTASSERT(work_main((void *)(intptr_t)i) == NULL);
+    }
+
+    elapsed = time_micros_elapsed(start, time_micros());
+    BTASSERT(thrd_set_affinity(thrd_self(), 0xffffffff) == 0);
+
+    std_printf(FSTR("%d workers on 1 core in %d us.\r\n"), WORKERS, elapsed);
+
+    return (0);
+}
+
+int test_steal_keeps_order(void)
+{
+    int i;
+    struct thrd_t *threads[WORKERS];
+    static const char letters[] = "ABC";
+
+    BTASSERT(thrd_set_affinity(thrd_self(), 0x1) == 0);
+    spinning = 0;
+    order_length = 0;
+
+    /* Keep core one busy. */
+    threads[3] = thrd_spawn(spinner_main,
+                            NULL,
+                            10,
+                            worker_stacks[3],
+                            sizeof(worker_stacks[3]));
+    BTASSERT(threads[3] != NULL);
+    BTASSERT(thrd_set_affinity(threads[3], 0x2) == 0);
+
+    while (spinning == 0) {
+        thrd_sleep_ms(1);
+    }
+
+    /* Queue A, B and C on core one, where only B may run on core
+       zero. */
+    for (i = 0; i < 3; i++) {
+        threads[i] = thrd_spawn(letter_main,
+                                (void *)&letters[i],
+                                10,
+                                worker_stacks[i],
+                                sizeof(worker_stacks[i]));
+        BTASSERT(threads[i] != NULL);
+        BTASSERT(thrd_set_affinity(threads[i], 0x2) == 0);
+    }
+
+    BTASSERT(thrd_set_affinity(threads[1], 0x3) == 0);
+
+    /* Core zero steals B, behind A, without reordering A and C. */
+    thrd_sleep_ms(20);
+    BTASSERTI(order_length, ==, 1);
+    BTASSERTI(order[0], ==, 'B');
+    BTASSERTI(cores[1], ==, 0);
+
+    spinning = 0;
+
+    for (i = 0; i < 4; i++) {
+        BTASSERT(thrd_join(threads[i]) == 0);
+    }
+
+    BTASSERTM(&order[0], "BAC", 3);
+    BTASSERTI(cores[0], ==, 1);
+    BTASSERTI(cores[2], ==, 1);
+    BTASSERT(thrd_set_affinity(thrd_self(), 0xffffffff) == 0);
+
+    return (0);
+}
+
+int test_yield_system_locked(void)
+{
+    int i;
+    int start;
+    int elapsed;
+    struct thrd_t *thrd_p;
+
+    BTASSERT(thrd_set_affinity(thrd_self(), 0x1) == 0);
+    locked = 0;
+    yielded = 0;
+
+    thrd_p = thrd_spawn(locker_main,
+                        NULL,
+                        10,
+                        worker_stacks[0],
+                        sizeof(worker_stacks[0]));
+    BTASSERT(thrd_p != NULL);
+    BTASSERT(thrd_set_affinity(thrd_p, 0x2) == 0);
+
+    while (locked == 0) {
+        thrd_yield();
+    }
+
+    /* Yielding only takes the scheduler lock. */
+    start = time_micros();
+
+    for (i = 0; i < YIELDS; i++) {
+        BTASSERT(thrd_yield() == 0);
+    }
+
+    elapsed = time_micros_elapsed(start, time_micros());
+    BTASSERTI(locked, ==, 1);
+    yielded = 1;
+
+    std_printf(FSTR("%d yields while core one held the system lock "
+                    "in %d us.\r\n"),
+               YIELDS,
+               elapsed);
+
+    BTASSERT(thrd_join(thrd_p) == 0);
+    BTASSERT(thrd_set_affinity(thrd_self(), 0xffffffff) == 0);
+
+    return (0);
+}
+
+int main()
+{
+    struct harness_testcase_t testcases[] = {
+        { test_affinity, "test_affinity" },
+        { test_parallel, "test_parallel" },
+        { test_work_stealing, "test_work_stealing" },
+        { test_steal_keeps_order, "test_steal_keeps_order" },
+        { test_yield_system_locked, "test_yield_system_locked" },
+        { NULL, NULL }
+    };
+
+    sys_start();
+
+    harness_run(testcases);
+
+    return (0);
+}
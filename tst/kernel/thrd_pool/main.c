@@ -0,0 +1,293 @@
+/**
+ * @section License
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017, Erik Moqvist
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+static struct thrd_pool_t pool1;
+static struct thrd_pool_t pool2;
+static THRD_STACK(pool1_stacks[1], 1024);
+static THRD_STACK(pool2_stacks[2], 1024);
+
+static char order[8];
+static int order_index;
+static struct sem_t blocker_sem;
+
+static void *append_main(void *arg_p)
+{
+    order[order_index++] = (char)(uintptr_t)arg_p;
+
+    return (arg_p);
+}
+
+static void *blocker_main(void *arg_p)
+{
+    sem_take(&blocker_sem, NULL);
+
+    return (NULL);
+}
+
+static void *wait_main(void *arg_p)
+{
+    return ((void *)(intptr_t)thrd_pool_job_wait(arg_p, NULL));
+}
+
+static void *sleep_main(void *arg_p)
+{
+    thrd_sleep_ms(50);
+
+    return (arg_p);
+}
+
+static int test_init(void)
+{
+    BTASSERT(thrd_pool_init(&pool1,
+                            &pool1_stacks[0][0],
+                            sizeof(pool1_stacks[0]),
+                            membersof(pool1_stacks),
+                            4) == 0);
+    BTASSERT(thrd_pool_init(&pool2,
+                            &pool2_stacks[0][0],
+                            sizeof(pool2_stacks[0]),
+                            membersof(pool2_stacks),
+                            4) == 0);
+    BTASSERT(thrd_pool_length(&pool1) == 0);
+
+    return (0);
+}
+
+static int test_priority_order(void)
+{
+    struct thrd_pool_job_t jobs[3];
+    int i;
+
+    order_index = 0;
+    memset(&order[0], 0, sizeof(order));
+
+    /* The worker does not run until the main thread waits, so all
+       three jobs are queued before the first is executed. */
+    BTASSERT(thrd_pool_job_init(&jobs[0],
+                                append_main,
+                                (void *)(uintptr_t)'A',
+                                30) == 0);
+    BTASSERT(thrd_pool_job_init(&jobs[1],
+                                append_main,
+                                (void *)(uintptr_t)'B',
+                                10) == 0);
+    BTASSERT(thrd_pool_job_init(&jobs[2],
+                                append_main,
+                                (void *)(uintptr_t)'C',
+                                20) == 0);
+
+    for (i = 0; i < membersof(jobs); i++) {
+        BTASSERT(thrd_pool_submit(&pool1, &jobs[i], NULL) == 0);
+    }
+
+    BTASSERT(thrd_pool_length(&pool1) == 3);
+
+    for (i = 0; i < membersof(jobs); i++) {
+        BTASSERT(thrd_pool_job_wait(&jobs[i], NULL) == 0);
+        BTASSERT(thrd_pool_job_is_done(&jobs[i]) == 1);
+    }
+
+    BTASSERT(strcmp(&order[0], "BCA") == 0);
+    BTASSERT(jobs[0].res_p == (void *)(uintptr_t)'A');
+    BTASSERT(thrd_pool_length(&pool1) == 0);
+
+    return (0);
+}
+
+static int test_queue_full(void)
+{
+    struct thrd_pool_job_t blocker;
+    struct thrd_pool_job_t jobs[5];
+    struct time_t timeout;
+    int i;
+
+    sem_init(&blocker_sem, 1, 1);
+    order_index = 0;
+    memset(&order[0], 0, sizeof(order));
+
+    /* Occupy the only worker. */
+    BTASSERT(thrd_pool_job_init(&blocker, blocker_main, NULL, 10) == 0);
+    BTASSERT(thrd_pool_submit(&pool1, &blocker, NULL) == 0);
+    thrd_sleep_ms(10);
+    BTASSERT(thrd_pool_length(&pool1) == 0);
+    BTASSERT(thrd_pool_job_is_done(&blocker) == 0);
+
+    /* Fill the queue. */
+    for (i = 0; i < membersof(jobs); i++) {
+        BTASSERT(thrd_pool_job_init(&jobs[i],
+                                    append_main,
+                                    (void *)(uintptr_t)('a' + i),
+                                    10) == 0);
+    }
+
+    for (i = 0; i < 4; i++) {
+        BTASSERT(thrd_pool_submit(&pool1, &jobs[i], NULL) == 0);
+    }
+
+    BTASSERT(thrd_pool_length(&pool1) == 4);
+
+    /* A queued job cannot be submitted again. */
+    BTASSERT(thrd_pool_submit(&pool1, &jobs[0], NULL) == -EBUSY);
+    BTASSERT(thrd_pool_submit(&pool1, &blocker, NULL) == -EBUSY);
+
+    /* The queue is full. */
+    timeout.seconds = 0;
+    timeout.nanoseconds = 0;
+    BTASSERT(thrd_pool_submit(&pool1, &jobs[4], &timeout) == -ETIMEDOUT);
+    BTASSERT(thrd_pool_job_wait(&jobs[0], &timeout) == -ETIMEDOUT);
+    timeout.nanoseconds = 20000000;
+    BTASSERT(thrd_pool_submit(&pool1, &jobs[4], &timeout) == -ETIMEDOUT);
+    BTASSERT(thrd_pool_job_wait(&blocker, &timeout) == -ETIMEDOUT);
+    BTASSERT(thrd_pool_length(&pool1) == 4);
+
+    /* Release the worker. */
+    sem_give(&blocker_sem, 1);
+    BTASSERT(thrd_pool_job_wait(&blocker, NULL) == 0);
+    BTASSERT(thrd_pool_submit(&pool1, &jobs[4], NULL) == 0);
+
+    for (i = 0; i < membersof(jobs); i++) {
+        BTASSERT(thrd_pool_job_wait(&jobs[i], NULL) == 0);
+    }
+
+    BTASSERT(strcmp(&order[0], "abcde") == 0);
+
+    /* A done job may be submitted again. */
+    BTASSERT(thrd_pool_submit(&pool1, &jobs[0], NULL) == 0);
+    BTASSERT(thrd_pool_job_wait(&jobs[0], NULL) == 0);
+    BTASSERT(strcmp(&order[0], "abcdea") == 0);
+
+    return (0);
+}
+
+static int test_multiple_workers(void)
+{
+    struct thrd_pool_job_t jobs[4];
+    struct time_t start;
+    struct time_t stop;
+    struct time_t diff;
+    int i;
+
+    time_get(&start);
+
+    for (i = 0; i < membersof(jobs); i++) {
+        BTASSERT(thrd_pool_job_init(&jobs[i],
+                                    sleep_main,
+                                    (void *)(uintptr_t)i,
+                                    10) == 0);
+        BTASSERT(thrd_pool_submit(&pool2, &jobs[i], NULL) == 0);
+    }
+
+    for (i = 0; i < membersof(jobs); i++) {
+        BTASSERT(thrd_pool_job_wait(&jobs[i], NULL) == 0);
+        BTASSERT(jobs[i].res_p == (void *)(uintptr_t)i);
+    }
+
+    time_get(&stop);
+    time_subtract(&diff, &stop, &start);
+
+    /* Two workers sleep in parallel, so the four jobs take about
+       100 ms instead of 200 ms. */
+    std_printf(FSTR("Four 50 ms jobs took %lu us.\r\n"),
+               (unsigned long)(diff.seconds * 1000000
+                               + diff.nanoseconds / 1000));
+    BTASSERT(diff.seconds == 0);
+    BTASSERT(diff.nanoseconds < 180000000);
+
+    return (0);
+}
+
+static int test_wait_not_submitted(void)
+{
+    struct thrd_pool_job_t job;
+
+    /* Waiting for a job that was never submitted fails instead of
+       blocking forever. */
+    BTASSERT(thrd_pool_job_init(&job,
+                                append_main,
+                                (void *)(uintptr_t)'x',
+                                10) == 0);
+    BTASSERT(thrd_pool_job_wait(&job, NULL) == -EINVAL);
+    BTASSERT(thrd_pool_job_is_done(&job) == 0);
+
+    /* Once submitted it can be waited for. */
+    order_index = 0;
+    BTASSERT(thrd_pool_submit(&pool1, &job, NULL) == 0);
+    BTASSERT(thrd_pool_job_wait(&job, NULL) == 0);
+    BTASSERT(job.res_p == (void *)(uintptr_t)'x');
+
+    return (0);
+}
+
+static int test_wait_busy(void)
+{
+    struct thrd_pool_job_t blocker;
+    struct thrd_pool_job_t waiter;
+
+    sem_init(&blocker_sem, 1, 1);
+
+    /* A job in another pool waits for the blocked job. */
+    BTASSERT(thrd_pool_job_init(&blocker, blocker_main, NULL, 10) == 0);
+    BTASSERT(thrd_pool_submit(&pool1, &blocker, NULL) == 0);
+    BTASSERT(thrd_pool_job_init(&waiter, wait_main, &blocker, 10) == 0);
+    BTASSERT(thrd_pool_submit(&pool2, &waiter, NULL) == 0);
+    thrd_sleep_ms(10);
+
+    /* Only one thread may wait for a job. */
+    BTASSERT(thrd_pool_job_wait(&blocker, NULL) == -EBUSY);
+
+    /* The first waiter is resumed when the job is done. */
+    sem_give(&blocker_sem, 1);
+    BTASSERT(thrd_pool_job_wait(&waiter, NULL) == 0);
+    BTASSERT(waiter.res_p == (void *)0);
+    BTASSERT(thrd_pool_job_is_done(&blocker) == 1);
+
+    return (0);
+}
+
+int main()
+{
+    struct harness_testcase_t testcases[] = {
+        { test_init, "test_init" },
+        { test_priority_order, "test_priority_order" },
+        { test_queue_full, "test_queue_full" },
+        { test_multiple_workers, "test_multiple_workers" },
+        { test_wait_not_submitted, "test_wait_not_submitted" },
+        { test_wait_busy, "test_wait_busy" },
+        { NULL, NULL }
+    };
+
+    sys_start();
+
+    harness_run(testcases);
+
+    return (0);
+}
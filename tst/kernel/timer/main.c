@@ -30,6 +30,10 @@
 
 #include "simba.h"
 
+#if defined(ARCH_LINUX)
+#    include <sys/resource.h>
+#endif
+
 static struct thrd_t *thrd_p;
 struct event_t event;
 
@@ -207,6 +211,249 @@ int test_multiple_timers(void)
     return (0);
 }
 
+static struct timer_t stopped_timer;
+static int stop_res;
+
+static void stop_callback(void *arg_p)
+{
+    stop_res = timer_stop_isr(&stopped_timer);
+    callback(arg_p);
+}
+
+int test_same_slot(void)
+{
+    uint32_t mask;
+    uint32_t callback_masks[2];
+    struct timer_t timer;
+    struct timer_t late_timer;
+    struct time_t timeout = {
+        .seconds = 0,
+        .nanoseconds = 100000000
+    };
+
+    event_init(&event);
+    callback_masks[0] = 0x1;
+    callback_masks[1] = 0x2;
+
+    /* The first timer to expire stops the other timer that expires
+       on the same tick. Start both with the system lock taken to
+       make sure they do. */
+    BTASSERT(timer_init(&timer,
+                        &timeout,
+                        stop_callback,
+                        &callback_masks[0],
+                        0) == 0);
+    BTASSERT(timer_init(&stopped_timer,
+                        &timeout,
+                        callback,
+                        &callback_masks[1],
+                        0) == 0);
+
+    /* A timer that expires one wheel revolution later, in the same
+       slot as the other two. It must not expire with them. */
+#if CONFIG_TIMER_WHEEL == 1
+    st2t(t2st(&timeout) + CONFIG_TIMER_WHEEL_SIZE, &timeout);
+#else
+    timeout.seconds = 30;
+#endif
+    BTASSERT(timer_init(&late_timer,
+                        &timeout,
+                        callback,
+                        &callback_masks[1],
+                        0) == 0);
+
+    stop_res = -1;
+    sys_lock();
+    timer_start_isr(&stopped_timer);
+    timer_start_isr(&late_timer);
+    timer_start_isr(&timer);
+    sys_unlock();
+
+    mask = 0x3;
+    BTASSERT(event_read(&event, &mask, sizeof(mask)) == sizeof(mask));
+    BTASSERTI(mask, ==, 0x1);
+    BTASSERTI(stop_res, ==, 1);
+
+    /* Wait a few ticks to make sure no other timer expires. */
+    thrd_sleep_ms(50);
+    BTASSERTI(event_size(&event), ==, 0);
+
+    BTASSERT(timer_stop(&stopped_timer) == 0);
+    BTASSERT(timer_stop(&late_timer) == 1);
+
+    return (0);
+}
+
+int test_next_timeout(void)
+{
+    int i;
+    struct timer_t timers[3];
+    struct time_t timeout;
+    sys_tick_t timeouts[3] = { 5, 10, 1000 };
+    sys_tick_t next[7];
+
+    for (i = 0; i < membersof(timers); i++) {
+        st2t(timeouts[i], &timeout);
+        BTASSERT(timer_init(&timers[i], &timeout, callback, NULL, 0) == 0);
+    }
+
+    /* The system lock keeps the tick from advancing. Timers expire
+       one tick after their timeout. */
+    sys_lock();
+    next[0] = timer_next_timeout_isr();
+    timer_start_isr(&timers[2]);
+    next[1] = timer_next_timeout_isr();
+    timer_start_isr(&timers[1]);
+    next[2] = timer_next_timeout_isr();
+    timer_start_isr(&timers[0]);
+    next[3] = timer_next_timeout_isr();
+    timer_stop_isr(&timers[0]);
+    next[4] = timer_next_timeout_isr();
+    timer_stop_isr(&timers[1]);
+    next[5] = timer_next_timeout_isr();
+    timer_stop_isr(&timers[2]);
+    next[6] = timer_next_timeout_isr();
+    sys_unlock();
+
+    BTASSERTI(next[0], ==, SYS_TICK_MAX);
+#if CONFIG_TIMER_WHEEL == 1
+    BTASSERTI(next[1], ==, CONFIG_TIMER_WHEEL_SIZE);
+#else
+    BTASSERTI(next[1], ==, 1001);
+#endif
+    BTASSERTI(next[2], ==, 11);
+    BTASSERTI(next[3], ==, 6);
+    BTASSERTI(next[4], ==, 11);
+#if CONFIG_TIMER_WHEEL == 1
+    BTASSERTI(next[5], ==, CONFIG_TIMER_WHEEL_SIZE);
+#else
+    BTASSERTI(next[5], ==, 1001);
+#endif
+    BTASSERTI(next[6], ==, SYS_TICK_MAX);
+
+    return (0);
+}
+
+#if defined(ARCH_LINUX)
+
+static void benchmark_callback(void *arg_p)
+{
+}
+
+static struct timer_t benchmark_timers[4096];
+
+int test_benchmark(void)
+{
+    int i;
+    int start;
+    int elapsed;
+    struct time_t timeout;
+
+    /* Long timeouts spread over a few seconds so that no timer
+       expires during the benchmark. */
+    for (i = 0; i < membersof(benchmark_timers); i++) {
+        timeout.seconds = 10 + (i % 7);
+        timeout.nanoseconds = (1000000L * ((i * 37) % 1000));
+        BTASSERT(timer_init(&benchmark_timers[i],
+                            &timeout,
+                            benchmark_callback,
+                            NULL,
+                            0) == 0);
+    }
+
+    start = time_micros();
+
+    for (i = 0; i < membersof(benchmark_timers); i++) {
+        BTASSERT(timer_start(&benchmark_timers[i]) == 0);
+    }
+
+    elapsed = time_micros_elapsed(start, time_micros());
+
+    std_printf(FSTR("Started %d timers in %d us.\r\n"),
+               membersof(benchmark_timers),
+               elapsed);
+
+    /* Stop every other timer in reverse order, then the rest. */
+    start = time_micros();
+
+    for (i = membersof(benchmark_timers) - 1; i >= 0; i -= 2) {
+        BTASSERT(timer_stop(&benchmark_timers[i]) == 1);
+    }
+
+    for (i = 0; i < membersof(benchmark_timers); i += 2) {
+        BTASSERT(timer_stop(&benchmark_timers[i]) == 1);
+    }
+
+    elapsed = time_micros_elapsed(start, time_micros());
+
+    std_printf(FSTR("Stopped %d timers in %d us.\r\n"),
+               membersof(benchmark_timers),
+               elapsed);
+
+    BTASSERT(timer_stop(&benchmark_timers[0]) == 0);
+
+    return (0);
+}
+
+static void idle_callback(void *arg_p)
+{
+    thrd_resume_isr(arg_p, 0);
+}
+
+/**
+ * Let the system idle while a single timer is active and count the
+ * number of context switches. With CONFIG_SYSTEM_TICKLESS the ticker
+ * only wakes up when the timer expires.
+ */
+int test_idle(void)
+{
+    struct timer_t timer;
+    struct time_t timeout;
+    struct rusage before;
+    struct rusage after;
+    int start;
+    int elapsed;
+    long switches;
+
+    timeout.seconds = 0;
+    timeout.nanoseconds = 500000000L;
+    BTASSERT(timer_init(&timer,
+                        &timeout,
+                        idle_callback,
+                        thrd_self(),
+                        0) == 0);
+
+    getrusage(RUSAGE_SELF, &before);
+    start = time_micros();
+
+    sys_lock();
+    BTASSERT(timer_start_isr(&timer) == 0);
+    thrd_suspend_isr(NULL);
+    sys_unlock();
+
+    elapsed = time_micros_elapsed(start, time_micros());
+    getrusage(RUSAGE_SELF, &after);
+    switches = (after.ru_nvcsw - before.ru_nvcsw);
+
+    std_printf(FSTR("Idled for %d us with %ld voluntary context "
+                    "switches.\r\n"),
+               elapsed,
+               switches);
+
+    BTASSERTI(elapsed, >=, 490000);
+    BTASSERTI(elapsed, <, 1000000);
+
+#if CONFIG_SYSTEM_TICKLESS == 1
+    /* A periodic tick would wake up the ticker pthread once per
+       tick. */
+    BTASSERTI(switches, <, CONFIG_SYSTEM_TICK_FREQUENCY / 4);
+#endif
+
+    return (0);
+}
+
+#endif
+
 int main()
 {
     struct harness_testcase_t testcases[] = {
@@ -214,6 +461,12 @@ int main()
         { test_periodic, "test_periodic" },
 #if !defined(BOARD_ARDUINO_NANO) && !defined(BOARD_ARDUINO_UNO) && !defined(BOARD_ARDUINO_PRO_MICRO)
         { test_multiple_timers, "test_multiple_timers" },
+#endif
+        { test_same_slot, "test_same_slot" },
+        { test_next_timeout, "test_next_timeout" },
+#if defined(ARCH_LINUX)
+        { test_benchmark, "test_benchmark" },
+        { test_idle, "test_idle" },
 #endif
         { NULL, NULL }
     };
@@ -33,6 +33,23 @@
 #define ID_FOO 0x0
 #define ID_BAR 0x1
 
+#define FAN_OUT_LISTENERS                                   10
+#define FAN_OUT_MESSAGE_SIZE                              1024
+#define FAN_OUT_ITERATIONS                                1000
+
+#define DISPATCH_LISTENERS_MAX                             256
+#define DISPATCH_ITERATIONS                              10000
+
+static struct bus_listener_t dispatch_listeners[DISPATCH_LISTENERS_MAX];
+
+static size_t heap_sizes[HEAP_FIXED_SIZES_MAX] = {
+    16, 32, 64, 128, 256, 512, 1024, 2048
+};
+static char heap_buffer[8192];
+static struct heap_t heap;
+static struct queue_t fan_out_queues[FAN_OUT_LISTENERS];
+static char fan_out_buffers[FAN_OUT_LISTENERS][FAN_OUT_MESSAGE_SIZE + 1];
+
 static int test_init(void)
 {
     /* This function may be called multiple times. */
@@ -165,6 +182,442 @@ static int test_multiple_ids(void)
     return (0);
 }
 
+static int test_write_message(void)
+{
+    struct bus_t bus;
+    struct bus_listener_t chans[3];
+    struct queue_t queues[3];
+    char bufs[3][32];
+    struct bus_message_t message;
+    char *buf_p;
+    int i;
+
+    BTASSERT(heap_init(&heap,
+                       &heap_buffer[0],
+                       sizeof(heap_buffer),
+                       heap_sizes) == 0);
+    BTASSERT(bus_init(&bus) == 0);
+    BTASSERT(bus_set_heap(&bus, &heap) == 0);
+
+    for (i = 0; i < 3; i++) {
+        BTASSERT(queue_init(&queues[i], bufs[i], sizeof(bufs[i])) == 0);
+        BTASSERT(bus_listener_init(&chans[i], ID_FOO, &queues[i]) == 0);
+    }
+
+    /* No listener. The buffer is freed by the write, and allocated
+       again. */
+    buf_p = bus_message_alloc(&bus, 6);
+    BTASSERT(buf_p != NULL);
+    BTASSERTI(bus_write_message(&bus, ID_FOO, buf_p, 6), ==, 0);
+    BTASSERT(bus_message_alloc(&bus, 6) == buf_p);
+
+    for (i = 0; i < 3; i++) {
+        BTASSERT(bus_attach(&bus, &chans[i]) == 0);
+    }
+
+    /* All listeners receive the same buffer. */
+    strcpy(buf_p, "hello");
+    BTASSERTI(bus_write_message(&bus, ID_FOO, buf_p, 6), ==, 3);
+
+    for (i = 0; i < 3; i++) {
+        BTASSERT(queue_read(&queues[i],
+                            &message,
+                            sizeof(message)) == sizeof(message));
+        BTASSERTI(message.id, ==, ID_FOO);
+        BTASSERT(message.buf_p == buf_p);
+        BTASSERTI(message.size, ==, 6);
+        BTASSERTM(message.buf_p, "hello", 6);
+        BTASSERTI(bus_message_free(&bus, message.buf_p), ==, 2 - i);
+    }
+
+    for (i = 0; i < 3; i++) {
+        BTASSERT(bus_detach(&bus, &chans[i]) == 0);
+    }
+
+    return (0);
+}
+
+static int test_write_messages(void)
+{
+    struct bus_t bus;
+    struct bus_listener_t chans[3];
+    struct queue_t queues[2];
+    char bufs[2][128];
+    struct bus_message_t messages[3];
+    struct bus_message_t message;
+
+    BTASSERT(heap_init(&heap,
+                       &heap_buffer[0],
+                       sizeof(heap_buffer),
+                       heap_sizes) == 0);
+    BTASSERT(bus_init(&bus) == 0);
+    BTASSERT(bus_set_heap(&bus, &heap) == 0);
+    BTASSERT(queue_init(&queues[0], bufs[0], sizeof(bufs[0])) == 0);
+    BTASSERT(queue_init(&queues[1], bufs[1], sizeof(bufs[1])) == 0);
+    BTASSERT(bus_listener_init(&chans[0], ID_FOO, &queues[0]) == 0);
+    BTASSERT(bus_listener_init(&chans[1], ID_FOO, &queues[1]) == 0);
+    BTASSERT(bus_listener_init(&chans[2], ID_BAR, &queues[1]) == 0);
+    BTASSERT(bus_attach(&bus, &chans[0]) == 0);
+    BTASSERT(bus_attach(&bus, &chans[1]) == 0);
+    BTASSERT(bus_attach(&bus, &chans[2]) == 0);
+
+    /* Two foo messages to two listeners and one bar message to one
+       listener. */
+    messages[0].id = ID_FOO;
+    messages[0].buf_p = bus_message_alloc(&bus, 4);
+    messages[0].size = 4;
+    messages[1].id = ID_BAR;
+    messages[1].buf_p = bus_message_alloc(&bus, 8);
+    messages[1].size = 8;
+    messages[2].id = ID_FOO;
+    messages[2].buf_p = bus_message_alloc(&bus, 4);
+    messages[2].size = 4;
+    BTASSERTI(bus_write_messages(&bus, &messages[0], 3), ==, 5);
+
+    /* Queue 0 has both foo messages. */
+    BTASSERT(queue_read(&queues[0],
+                        &message,
+                        sizeof(message)) == sizeof(message));
+    BTASSERT(message.buf_p == messages[0].buf_p);
+    BTASSERTI(bus_message_free(&bus, message.buf_p), ==, 1);
+    BTASSERT(queue_read(&queues[0],
+                        &message,
+                        sizeof(message)) == sizeof(message));
+    BTASSERT(message.buf_p == messages[2].buf_p);
+    BTASSERTI(bus_message_free(&bus, message.buf_p), ==, 1);
+
+    /* Queue 1 has all three messages in order. */
+    BTASSERT(queue_read(&queues[1],
+                        &message,
+                        sizeof(message)) == sizeof(message));
+    BTASSERT(message.buf_p == messages[0].buf_p);
+    BTASSERTI(bus_message_free(&bus, message.buf_p), ==, 0);
+    BTASSERT(queue_read(&queues[1],
+                        &message,
+                        sizeof(message)) == sizeof(message));
+    BTASSERTI(message.id, ==, ID_BAR);
+    BTASSERTI(message.size, ==, 8);
+    BTASSERTI(bus_message_free(&bus, message.buf_p), ==, 0);
+    BTASSERT(queue_read(&queues[1],
+                        &message,
+                        sizeof(message)) == sizeof(message));
+    BTASSERT(message.buf_p == messages[2].buf_p);
+    BTASSERTI(bus_message_free(&bus, message.buf_p), ==, 0);
+
+    BTASSERT(bus_detach(&bus, &chans[0]) == 0);
+    BTASSERT(bus_detach(&bus, &chans[1]) == 0);
+    BTASSERT(bus_detach(&bus, &chans[2]) == 0);
+
+    return (0);
+}
+
+static int test_fan_out_benchmark(void)
+{
+    struct bus_t bus;
+    struct bus_listener_t chans[FAN_OUT_LISTENERS];
+    char buf[FAN_OUT_MESSAGE_SIZE];
+    struct bus_message_t message;
+    void *buf_p;
+    int i;
+    int j;
+    int start;
+    int copy_time;
+    int shared_time;
+
+    BTASSERT(heap_init(&heap,
+                       &heap_buffer[0],
+                       sizeof(heap_buffer),
+                       heap_sizes) == 0);
+    BTASSERT(bus_init(&bus) == 0);
+    BTASSERT(bus_set_heap(&bus, &heap) == 0);
+
+    for (i = 0; i < FAN_OUT_LISTENERS; i++) {
+        BTASSERT(queue_init(&fan_out_queues[i],
+                            &fan_out_buffers[i][0],
+                            sizeof(fan_out_buffers[i])) == 0);
+        BTASSERT(bus_listener_init(&chans[i],
+                                   ID_FOO,
+                                   &fan_out_queues[i]) == 0);
+        BTASSERT(bus_attach(&bus, &chans[i]) == 0);
+    }
+
+    memset(&buf[0], 0, sizeof(buf));
+
+    /* The message is copied to and from each listener queue. */
+    start = time_micros();
+
+    for (i = 0; i < FAN_OUT_ITERATIONS; i++) {
+        bus_write(&bus, ID_FOO, &buf[0], sizeof(buf));
+
+        for (j = 0; j < FAN_OUT_LISTENERS; j++) {
+            queue_read(&fan_out_queues[j], &buf[0], sizeof(buf));
+        }
+    }
+
+    copy_time = time_micros_elapsed(start, time_micros());
+
+    /* Only a reference is passed to each listener. */
+    start = time_micros();
+
+    for (i = 0; i < FAN_OUT_ITERATIONS; i++) {
+        buf_p = bus_message_alloc(&bus, sizeof(buf));
+        bus_write_message(&bus, ID_FOO, buf_p, sizeof(buf));
+
+        for (j = 0; j < FAN_OUT_LISTENERS; j++) {
+            queue_read(&fan_out_queues[j], &message, sizeof(message));
+            bus_message_free(&bus, message.buf_p);
+        }
+    }
+
+    shared_time = time_micros_elapsed(start, time_micros());
+
+    for (i = 0; i < FAN_OUT_LISTENERS; i++) {
+        BTASSERT(bus_detach(&bus, &chans[i]) == 0);
+    }
+
+    std_printf(OSTR("%d listeners, %d messages of %d bytes:\r\n"
+                    "  bus_write():         %d us\r\n"
+                    "  bus_write_message(): %d us\r\n"),
+               FAN_OUT_LISTENERS,
+               FAN_OUT_ITERATIONS,
+               FAN_OUT_MESSAGE_SIZE,
+               copy_time,
+               shared_time);
+
+    return (0);
+}
+
+static int test_range_mask(void)
+{
+    struct bus_t bus;
+    struct bus_listener_t chans[5];
+    struct queue_t queues[5];
+    char bufs[5][16];
+    int i;
+    int value;
+
+    BTASSERT(bus_init(&bus) == 0);
+
+    for (i = 0; i < 5; i++) {
+        BTASSERT(queue_init(&queues[i], bufs[i], sizeof(bufs[i])) == 0);
+    }
+
+    BTASSERT(bus_listener_init_range(&chans[0], 0x100, 0x1ff, &queues[0]) == 0);
+    BTASSERT(bus_listener_init_range(&chans[1], 0x180, 0x280, &queues[1]) == 0);
+    BTASSERT(bus_listener_init_mask(&chans[2],
+                                    0x1ab,
+                                    0xffffff00,
+                                    &queues[2]) == 0);
+    BTASSERTI(chans[2].type, ==, BUS_LISTENER_TYPE_RANGE);
+    BTASSERT(bus_listener_init_mask(&chans[3], 0x5, 0xf, &queues[3]) == 0);
+    BTASSERTI(chans[3].type, ==, BUS_LISTENER_TYPE_MASK);
+    BTASSERT(bus_listener_init(&chans[4], 0x105, &queues[4]) == 0);
+
+    for (i = 0; i < 5; i++) {
+        BTASSERT(bus_attach(&bus, &chans[i]) == 0);
+    }
+
+    /* Both ranges and the mask. */
+    value = 0x185;
+    BTASSERTI(bus_write(&bus, value, &value, sizeof(value)), ==, 4);
+    BTASSERTI(queue_size(&queues[0]), ==, sizeof(value));
+    BTASSERTI(queue_size(&queues[1]), ==, sizeof(value));
+    BTASSERTI(queue_size(&queues[2]), ==, sizeof(value));
+    BTASSERTI(queue_size(&queues[3]), ==, sizeof(value));
+    BTASSERTI(queue_size(&queues[4]), ==, 0);
+
+    /* The first range, the mask and the id. */
+    value = 0x105;
+    BTASSERTI(bus_write(&bus, value, &value, sizeof(value)), ==, 4);
+    BTASSERTI(queue_size(&queues[1]), ==, sizeof(value));
+    BTASSERTI(queue_size(&queues[4]), ==, sizeof(value));
+
+    /* Only the second range. */
+    value = 0x280;
+    BTASSERTI(bus_write(&bus, value, &value, sizeof(value)), ==, 1);
+    BTASSERTI(queue_size(&queues[1]), ==, 2 * sizeof(value));
+
+    /* Only the mask. */
+    value = 0x15;
+    BTASSERTI(bus_write(&bus, value, &value, sizeof(value)), ==, 1);
+    BTASSERTI(queue_size(&queues[3]), ==, 3 * sizeof(value));
+
+    for (i = 0; i < 5; i++) {
+        BTASSERT(bus_detach(&bus, &chans[i]) == 0);
+        BTASSERT(bus_detach(&bus, &chans[i]) == -1);
+    }
+
+    value = 0x185;
+    BTASSERTI(bus_write(&bus, value, &value, sizeof(value)), ==, 0);
+
+    return (0);
+}
+
+/**
+ * Number of attached ranges in given listeners containing given id.
+ */
+static int count_ranges(struct bus_listener_t *listeners_p,
+                        int *attached_p,
+                        int length,
+                        int id)
+{
+    int i;
+    int count;
+
+    count = 0;
+
+    for (i = 0; i < length; i++) {
+        if (attached_p[i]
+            && (listeners_p[i].id <= id)
+            && (id <= listeners_p[i].id_max)) {
+            count++;
+        }
+    }
+
+    return (count);
+}
+
+static int test_range_overlapping(void)
+{
+    struct bus_t bus;
+    struct chan_t chan;
+    int attached[64];
+    uint32_t seed;
+    int i;
+    int id;
+    int id_min;
+
+    BTASSERT(bus_init(&bus) == 0);
+    BTASSERT(chan_init(&chan,
+                       chan_read_null,
+                       chan_write_null,
+                       chan_size_null) == 0);
+    seed = 1;
+
+    /* Attach overlapping ranges of random lengths, some with the same
+       lowest id. */
+    for (i = 0; i < 64; i++) {
+        seed = (1103515245 * seed + 12345);
+        id_min = ((seed >> 16) % 200);
+        seed = (1103515245 * seed + 12345);
+        BTASSERT(bus_listener_init_range(&dispatch_listeners[i],
+                                         id_min,
+                                         id_min + ((seed >> 16) % 50),
+                                         &chan) == 0);
+        BTASSERT(bus_attach(&bus, &dispatch_listeners[i]) == 0);
+        attached[i] = 1;
+    }
+
+    for (id = -1; id < 260; id++) {
+        BTASSERTI(bus_write(&bus, id, &id, sizeof(id)),
+                  ==,
+                  count_ranges(&dispatch_listeners[0], &attached[0], 64, id));
+    }
+
+    /* Detach every other range. */
+    for (i = 0; i < 64; i += 2) {
+        BTASSERT(bus_detach(&bus, &dispatch_listeners[i]) == 0);
+        attached[i] = 0;
+    }
+
+    for (id = -1; id < 260; id++) {
+        BTASSERTI(bus_write(&bus, id, &id, sizeof(id)),
+                  ==,
+                  count_ranges(&dispatch_listeners[0], &attached[0], 64, id));
+    }
+
+    for (i = 1; i < 64; i += 2) {
+        BTASSERT(bus_detach(&bus, &dispatch_listeners[i]) == 0);
+    }
+
+    for (i = 0; i < membersof(bus.indexes); i++) {
+        BTASSERT(bus.indexes[i].ranges_p == NULL);
+    }
+
+    return (0);
+}
+
+/**
+ * Attach given number of disjoint range or mask listeners, and
+ * return the time in microseconds to write messages each received by
+ * one listener.
+ */
+static int dispatch_time(int number_of_listeners, int type)
+{
+    struct bus_t bus;
+    struct chan_t chan;
+    int i;
+    int id;
+    int start;
+    int time;
+
+    bus_init(&bus);
+    chan_init(&chan, chan_read_null, chan_write_null, chan_size_null);
+
+    for (i = 0; i < number_of_listeners; i++) {
+        if (type == BUS_LISTENER_TYPE_RANGE) {
+            bus_listener_init_range(&dispatch_listeners[i],
+                                    16 * i,
+                                    16 * i + 15,
+                                    &chan);
+        } else {
+            /* The high bits are ignored, so it is not a range. */
+            bus_listener_init_mask(&dispatch_listeners[i],
+                                   16 * i,
+                                   0xff0,
+                                   &chan);
+        }
+
+        bus_attach(&bus, &dispatch_listeners[i]);
+    }
+
+    start = time_micros();
+
+    for (i = 0; i < DISPATCH_ITERATIONS; i++) {
+        id = (16 * (i % number_of_listeners) + 3);
+
+        if (bus_write(&bus, id, &id, sizeof(id)) != 1) {
+            return (-1);
+        }
+    }
+
+    time = time_micros_elapsed(start, time_micros());
+
+    for (i = 0; i < number_of_listeners; i++) {
+        bus_detach(&bus, &dispatch_listeners[i]);
+    }
+
+    return (time);
+}
+
+static int test_dispatch_benchmark(void)
+{
+    int number_of_listeners;
+    int range_time;
+    int mask_time;
+
+    std_printf(OSTR("%d writes, one receiver each:\r\n"
+                    "  listeners   ranges (us)   masks (us)\r\n"),
+               DISPATCH_ITERATIONS);
+
+    for (number_of_listeners = 4;
+         number_of_listeners <= DISPATCH_LISTENERS_MAX;
+         number_of_listeners *= 4) {
+        range_time = dispatch_time(number_of_listeners,
+                                   BUS_LISTENER_TYPE_RANGE);
+        mask_time = dispatch_time(number_of_listeners,
+                                  BUS_LISTENER_TYPE_MASK);
+        BTASSERT(range_time >= 0);
+        BTASSERT(mask_time >= 0);
+        std_printf(OSTR("  %9d   %11d   %10d\r\n"),
+                   number_of_listeners,
+                   range_time,
+                   mask_time);
+    }
+
+    return (0);
+}
+
 int main()
 {
     struct harness_testcase_t testcases[] = {
@@ -172,6 +625,12 @@ int main()
         { test_attach_detach, "test_attach_detach" },
         { test_write_read, "test_write_read" },
         { test_multiple_ids, "test_multiple_ids" },
+        { test_write_message, "test_write_message" },
+        { test_write_messages, "test_write_messages" },
+        { test_fan_out_benchmark, "test_fan_out_benchmark" },
+        { test_range_mask, "test_range_mask" },
+        { test_range_overlapping, "test_range_overlapping" },
+        { test_dispatch_benchmark, "test_dispatch_benchmark" },
         { NULL, NULL }
     };
 
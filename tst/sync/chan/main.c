@@ -30,8 +30,31 @@
 
 #include "simba.h"
 
+#define POLL_BENCHMARK_CHANNELS                             32
+#define POLL_BENCHMARK_ITERATIONS                         5000
+
 static int write_filter_return_value;
 static char buffer[8];
+static struct queue_t queues[POLL_BENCHMARK_CHANNELS];
+static char queue_buffers[POLL_BENCHMARK_CHANNELS][4];
+
+static THRD_STACK(writer_stack, 1024);
+
+static void *writer_main(void *arg_p)
+{
+    char value;
+
+    thrd_set_name("writer");
+
+    /* Test: test_poll_set_wait. */
+    thrd_sleep_ms(10);
+    value = 'a';
+    BTASSERTN(queue_write(&queues[3], &value, 1) == 1);
+
+    thrd_suspend(NULL);
+
+    return (NULL);
+}
 
 static ssize_t read_mock(void *self_p,
                          void *buf_p,
@@ -149,6 +172,37 @@ static int test_null_channels(void)
     return (0);
 }
 
+static int test_read_timeout(void)
+{
+    struct queue_t queue;
+    char queue_buffer[4];
+    char value;
+    struct time_t timeout;
+
+    BTASSERT(queue_init(&queue, &queue_buffer[0], sizeof(queue_buffer)) == 0);
+    timeout.seconds = 0;
+    timeout.nanoseconds = 10000000;
+
+    /* The queue read with timeout callback. */
+    BTASSERTI(chan_read_timeout(&queue, &value, 1, &timeout), ==, -ETIMEDOUT);
+    BTASSERT(queue_write(&queue, "a", 1) == 1);
+    BTASSERTI(chan_read_timeout(&queue, &value, 1, &timeout), ==, 1);
+    BTASSERTI(value, ==, 'a');
+
+    /* Poll and read without the callback. */
+    BTASSERT(chan_set_read_timeout_cb(&queue.base, NULL) == 0);
+    timeout.nanoseconds = 0;
+    BTASSERTI(chan_read_timeout(&queue, &value, 1, &timeout), ==, -ETIMEDOUT);
+    timeout.nanoseconds = 10000000;
+    BTASSERTI(chan_read_timeout(&queue, &value, 1, &timeout), ==, -ETIMEDOUT);
+    BTASSERT(queue.base.reader_p == NULL);
+    BTASSERT(queue_write(&queue, "b", 1) == 1);
+    BTASSERTI(chan_read_timeout(&queue, &value, 1, &timeout), ==, 1);
+    BTASSERTI(value, ==, 'b');
+
+    return (0);
+}
+
 static int test_list(void)
 {
     struct chan_list_t list;
@@ -277,14 +331,207 @@ static int test_putc(void)
     return (0);
 }
 
+static int test_poll_set(void)
+{
+    struct chan_poll_set_t poll_set;
+    struct chan_poll_set_elem_t elements[3];
+    struct chan_poll_set_elem_t other_element;
+    struct time_t timeout;
+    char value;
+    int i;
+
+    for (i = 0; i < POLL_BENCHMARK_CHANNELS; i++) {
+        BTASSERT(queue_init(&queues[i],
+                            &queue_buffers[i][0],
+                            sizeof(queue_buffers[i])) == 0);
+    }
+
+    BTASSERT(chan_poll_set_init(&poll_set) == 0);
+
+    /* Data written before the channel is added is ready. */
+    value = '0';
+    BTASSERT(queue_write(&queues[0], &value, 1) == 1);
+    BTASSERT(chan_poll_set_add(&poll_set,
+                               &elements[0],
+                               &queues[0],
+                               CHAN_POLL_LEVEL_TRIGGERED) == 0);
+    BTASSERT(chan_poll_set_add(&poll_set,
+                               &elements[1],
+                               &queues[1],
+                               CHAN_POLL_EDGE_TRIGGERED) == 0);
+    BTASSERT(chan_poll_set_add(&poll_set,
+                               &elements[2],
+                               &queues[2],
+                               CHAN_POLL_LEVEL_TRIGGERED) == 0);
+    BTASSERT(chan_poll_set_add(&poll_set,
+                               &other_element,
+                               &queues[2],
+                               CHAN_POLL_LEVEL_TRIGGERED) == -EBUSY);
+
+    /* A level triggered channel is returned until read. */
+    timeout.seconds = 0;
+    timeout.nanoseconds = 0;
+    BTASSERT(chan_poll_set_wait(&poll_set, &timeout) == &queues[0]);
+    BTASSERT(chan_poll_set_wait(&poll_set, &timeout) == &queues[0]);
+    BTASSERT(queue_read(&queues[0], &value, 1) == 1);
+    BTASSERT(value == '0');
+    BTASSERT(chan_poll_set_wait(&poll_set, &timeout) == NULL);
+
+    /* An edge triggered channel is returned once per write, even if
+       not read. */
+    value = '1';
+    BTASSERT(queue_write(&queues[1], &value, 1) == 1);
+    BTASSERT(queue_write(&queues[1], &value, 1) == 1);
+    BTASSERT(chan_poll_set_wait(&poll_set, &timeout) == &queues[1]);
+    BTASSERT(chan_poll_set_wait(&poll_set, &timeout) == NULL);
+    BTASSERT(queue_write(&queues[1], &value, 1) == 1);
+    BTASSERT(chan_poll_set_wait(&poll_set, &timeout) == &queues[1]);
+    BTASSERT(queue_ignore(&queues[1], 3) == 3);
+
+    /* Ready channels are returned in write order. */
+    value = '2';
+    BTASSERT(queue_write(&queues[2], &value, 1) == 1);
+    value = '0';
+    BTASSERT(queue_write(&queues[0], &value, 1) == 1);
+    BTASSERT(chan_poll_set_wait(&poll_set, &timeout) == &queues[2]);
+    BTASSERT(chan_poll_set_wait(&poll_set, &timeout) == &queues[0]);
+    BTASSERT(chan_poll_set_wait(&poll_set, &timeout) == &queues[2]);
+    BTASSERT(queue_read(&queues[2], &value, 1) == 1);
+    BTASSERT(chan_poll_set_wait(&poll_set, &timeout) == &queues[0]);
+    BTASSERT(queue_read(&queues[0], &value, 1) == 1);
+
+    /* Timeout. */
+    timeout.nanoseconds = 10000000;
+    BTASSERT(chan_poll_set_wait(&poll_set, &timeout) == NULL);
+
+    /* A removed ready channel is not returned. */
+    BTASSERT(queue_write(&queues[0], &value, 1) == 1);
+    BTASSERT(queue_write(&queues[2], &value, 1) == 1);
+    BTASSERT(chan_poll_set_remove(&poll_set, &queues[2]) == 0);
+    BTASSERT(chan_poll_set_remove(&poll_set, &queues[2]) == -ENOENT);
+    BTASSERT(chan_poll_set_remove(&poll_set, &queues[0]) == 0);
+    BTASSERT(chan_poll_set_wait(&poll_set, &timeout) == NULL);
+    BTASSERT(queue_ignore(&queues[0], 1) == 1);
+    BTASSERT(queue_ignore(&queues[2], 1) == 1);
+    BTASSERT(chan_poll_set_remove(&poll_set, &queues[1]) == 0);
+
+    return (0);
+}
+
+static int test_poll_set_wait(void)
+{
+    struct chan_poll_set_t poll_set;
+    struct chan_poll_set_elem_t elements[POLL_BENCHMARK_CHANNELS];
+    char value;
+    int i;
+
+    BTASSERT(chan_poll_set_init(&poll_set) == 0);
+
+    for (i = 0; i < POLL_BENCHMARK_CHANNELS; i++) {
+        BTASSERT(chan_poll_set_add(&poll_set,
+                                   &elements[i],
+                                   &queues[i],
+                                   CHAN_POLL_LEVEL_TRIGGERED) == 0);
+    }
+
+    /* The other thread writes to a channel. */
+    BTASSERT(thrd_spawn(writer_main,
+                        NULL,
+                        0,
+                        writer_stack,
+                        sizeof(writer_stack)) != NULL);
+    BTASSERT(chan_poll_set_wait(&poll_set, NULL) == &queues[3]);
+    BTASSERT(queue_read(&queues[3], &value, 1) == 1);
+    BTASSERT(value == 'a');
+
+    for (i = 0; i < POLL_BENCHMARK_CHANNELS; i++) {
+        BTASSERT(chan_poll_set_remove(&poll_set, &queues[i]) == 0);
+    }
+
+    return (0);
+}
+
+static int test_poll_benchmark(void)
+{
+    struct chan_list_t list;
+    struct chan_list_elem_t list_elements[POLL_BENCHMARK_CHANNELS];
+    struct chan_poll_set_t poll_set;
+    struct chan_poll_set_elem_t elements[POLL_BENCHMARK_CHANNELS];
+    void *chan_p;
+    char value;
+    int i;
+    int start;
+    int list_time;
+    int poll_set_time;
+
+    BTASSERT(chan_list_init(&list,
+                            &list_elements[0],
+                            membersof(list_elements)) == 0);
+    BTASSERT(chan_poll_set_init(&poll_set) == 0);
+
+    for (i = 0; i < POLL_BENCHMARK_CHANNELS; i++) {
+        BTASSERT(chan_list_add(&list, &queues[i]) == 0);
+    }
+
+    /* Write to and poll the channels in order. */
+    value = 0;
+    start = time_micros();
+
+    for (i = 0; i < POLL_BENCHMARK_ITERATIONS; i++) {
+        chan_p = &queues[i % POLL_BENCHMARK_CHANNELS];
+        queue_write(chan_p, &value, 1);
+        BTASSERT(chan_list_poll(&list, NULL) == chan_p);
+        queue_read(chan_p, &value, 1);
+    }
+
+    list_time = time_micros_elapsed(start, time_micros());
+    BTASSERT(chan_list_destroy(&list) == 0);
+
+    for (i = 0; i < POLL_BENCHMARK_CHANNELS; i++) {
+        BTASSERT(chan_poll_set_add(&poll_set,
+                                   &elements[i],
+                                   &queues[i],
+                                   CHAN_POLL_EDGE_TRIGGERED) == 0);
+    }
+
+    start = time_micros();
+
+    for (i = 0; i < POLL_BENCHMARK_ITERATIONS; i++) {
+        chan_p = &queues[i % POLL_BENCHMARK_CHANNELS];
+        queue_write(chan_p, &value, 1);
+        BTASSERT(chan_poll_set_wait(&poll_set, NULL) == chan_p);
+        queue_read(chan_p, &value, 1);
+    }
+
+    poll_set_time = time_micros_elapsed(start, time_micros());
+
+    for (i = 0; i < POLL_BENCHMARK_CHANNELS; i++) {
+        BTASSERT(chan_poll_set_remove(&poll_set, &queues[i]) == 0);
+    }
+
+    std_printf(OSTR("%d channels, %d write/poll/read iterations:\r\n"
+                    "  chan_list_poll():     %d us\r\n"
+                    "  chan_poll_set_wait(): %d us\r\n"),
+               POLL_BENCHMARK_CHANNELS,
+               POLL_BENCHMARK_ITERATIONS,
+               list_time,
+               poll_set_time);
+
+    return (0);
+}
+
 int main()
 {
     struct harness_testcase_t testcases[] = {
         { test_filter, "test_filter" },
         { test_null_channels, "test_null_channels" },
+        { test_read_timeout, "test_read_timeout" },
         { test_list, "test_list" },
         { test_getc, "test_getc" },
         { test_putc, "test_putc" },
+        { test_poll_set, "test_poll_set" },
+        { test_poll_set_wait, "test_poll_set_wait" },
+        { test_poll_benchmark, "test_poll_benchmark" },
         { NULL, NULL }
     };
 
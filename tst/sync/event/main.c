@@ -165,6 +165,62 @@ static int test_poll_timeout(void)
     return (0);
 }
 
+static int test_read_timeout(void)
+{
+    uint32_t mask;
+    struct event_t event;
+    struct time_t timeout;
+
+    BTASSERT(event_init(&event) == 0);
+
+    /* Zero timeout. */
+    timeout.seconds = 0;
+    timeout.nanoseconds = 0;
+    mask = EVENT_BIT_0;
+    BTASSERTI(event_read_timeout(&event, &mask, sizeof(mask), &timeout),
+              ==,
+              -ETIMEDOUT);
+
+    /* 10 ms timeout. */
+    timeout.nanoseconds = 10000000;
+    BTASSERTI(event_read_timeout(&event, &mask, sizeof(mask), &timeout),
+              ==,
+              -ETIMEDOUT);
+    BTASSERT(event.base.reader_p == NULL);
+
+    /* An event not in the mask does not prevent the timeout. */
+    mask = EVENT_BIT_1;
+    BTASSERT(event_write(&event, &mask, sizeof(mask)) == sizeof(mask));
+    mask = EVENT_BIT_0;
+    BTASSERTI(event_read_timeout(&event, &mask, sizeof(mask), &timeout),
+              ==,
+              -ETIMEDOUT);
+
+    /* Already set. */
+    mask = (EVENT_BIT_1 | EVENT_BIT_0);
+    BTASSERTI(event_read_timeout(&event, &mask, sizeof(mask), &timeout),
+              ==,
+              sizeof(mask));
+    BTASSERTI(mask, ==, EVENT_BIT_1);
+    BTASSERTI(event_size(&event), ==, 0);
+
+    /* The channel read with timeout only waits for events in the
+       mask. */
+    mask = EVENT_BIT_1;
+    BTASSERT(event_write(&event, &mask, sizeof(mask)) == sizeof(mask));
+    mask = EVENT_BIT_0;
+    BTASSERTI(chan_read_timeout(&event, &mask, sizeof(mask), &timeout),
+              ==,
+              -ETIMEDOUT);
+    mask = EVENT_BIT_1;
+    BTASSERTI(chan_read_timeout(&event, &mask, sizeof(mask), &timeout),
+              ==,
+              sizeof(mask));
+    BTASSERTI(mask, ==, EVENT_BIT_1);
+
+    return (0);
+}
+
 static int test_poll_list(void)
 {
     uint32_t mask;
@@ -300,6 +356,7 @@ int main()
         { test_read_write, "test_read_write" },
         { test_poll, "test_poll" },
         { test_poll_timeout, "test_poll_timeout" },
+        { test_read_timeout, "test_read_timeout" },
         { test_poll_list, "test_poll_list" },
         { test_poll_list_timeout, "test_poll_list_timeout" },
         { test_write_not_read_mask, "test_write_not_read_mask" },
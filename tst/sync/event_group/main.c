@@ -0,0 +1,313 @@
+/**
+ * @section License
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017, Erik Moqvist
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+struct waiter_t {
+    uint32_t mask;
+    int flags;
+    int res;
+    struct sem_t start_sem;
+    struct sem_t done_sem;
+};
+
+static struct event_group_t event_group;
+static struct waiter_t waiters[3];
+static struct thrd_t *threads[3];
+
+static THRD_STACK(t0_stack, 1024);
+static THRD_STACK(t1_stack, 1024);
+static THRD_STACK(t2_stack, 1024);
+
+static void *waiter_main(void *arg_p)
+{
+    struct waiter_t *waiter_p;
+
+    waiter_p = arg_p;
+
+    while (1) {
+        /* Wait for the main thread to give the wait parameters. */
+        sem_take(&waiter_p->start_sem, NULL);
+        waiter_p->res = event_group_wait(&event_group,
+                                         &waiter_p->mask,
+                                         waiter_p->flags,
+                                         NULL);
+        sem_give(&waiter_p->done_sem, 1);
+    }
+
+    return (NULL);
+}
+
+/**
+ * Let given waiter wait for given mask.
+ */
+static void start_wait(struct waiter_t *waiter_p,
+                       uint32_t mask,
+                       int flags)
+{
+    waiter_p->mask = mask;
+    waiter_p->flags = flags;
+    waiter_p->res = -1;
+    sem_give(&waiter_p->start_sem, 1);
+    thrd_sleep_ms(5);
+}
+
+static int test_init(void)
+{
+    int i;
+
+    BTASSERT(event_group_init(&event_group) == 0);
+
+    for (i = 0; i < membersof(waiters); i++) {
+        BTASSERT(sem_init(&waiters[i].start_sem, 1, 1) == 0);
+        BTASSERT(sem_init(&waiters[i].done_sem, 1, 1) == 0);
+    }
+
+    threads[0] = thrd_spawn(waiter_main,
+                            &waiters[0],
+                            -1,
+                            t0_stack,
+                            sizeof(t0_stack));
+    BTASSERT(threads[0] != NULL);
+    threads[1] = thrd_spawn(waiter_main,
+                            &waiters[1],
+                            -1,
+                            t1_stack,
+                            sizeof(t1_stack));
+    BTASSERT(threads[1] != NULL);
+    threads[2] = thrd_spawn(waiter_main,
+                            &waiters[2],
+                            -1,
+                            t2_stack,
+                            sizeof(t2_stack));
+    BTASSERT(threads[2] != NULL);
+
+    return (0);
+}
+
+static int test_any_all(void)
+{
+    uint32_t mask;
+
+    mask = 0x5;
+    BTASSERT(event_group_write(&event_group, &mask, sizeof(mask)) == 4);
+    BTASSERT(event_group_size(&event_group) == 1);
+
+    /* Any of the events. */
+    mask = 0x3;
+    BTASSERT(event_group_wait(&event_group,
+                              &mask,
+                              EVENT_GROUP_WAIT_ANY,
+                              NULL) == 0);
+    BTASSERT(mask == 0x1);
+
+    /* All events. */
+    mask = 0x5;
+    BTASSERT(event_group_wait(&event_group,
+                              &mask,
+                              EVENT_GROUP_WAIT_ALL | EVENT_GROUP_CLEAR,
+                              NULL) == 0);
+    BTASSERT(mask == 0x5);
+    BTASSERT(event_group_size(&event_group) == 0);
+
+    return (0);
+}
+
+static int test_timeout(void)
+{
+    uint32_t mask;
+    struct time_t timeout;
+
+    mask = 0x1;
+    BTASSERT(event_group_write(&event_group, &mask, sizeof(mask)) == 4);
+
+    /* Zero timeout. */
+    timeout.seconds = 0;
+    timeout.nanoseconds = 0;
+    mask = 0x3;
+    BTASSERT(event_group_wait(&event_group,
+                              &mask,
+                              EVENT_GROUP_WAIT_ALL,
+                              &timeout) == -ETIMEDOUT);
+
+    /* Ten milliseconds timeout. */
+    timeout.nanoseconds = 10000000;
+    mask = 0x3;
+    BTASSERT(event_group_wait(&event_group,
+                              &mask,
+                              EVENT_GROUP_WAIT_ALL,
+                              &timeout) == -ETIMEDOUT);
+    BTASSERT(event_group.waiters_p == NULL);
+
+    mask = 0x3;
+    BTASSERT(event_group_wait(&event_group,
+                              &mask,
+                              EVENT_GROUP_WAIT_ANY,
+                              &timeout) == 0);
+    BTASSERT(mask == 0x1);
+    BTASSERT(event_group_clear(&event_group, 0x1) == 0);
+    BTASSERT(event_group_size(&event_group) == 0);
+
+    return (0);
+}
+
+static int test_multiple_waiters(void)
+{
+    uint32_t mask;
+
+    start_wait(&waiters[0], 0x1, EVENT_GROUP_WAIT_ANY);
+    start_wait(&waiters[1], 0x3, EVENT_GROUP_WAIT_ALL);
+    start_wait(&waiters[2], 0x6, EVENT_GROUP_WAIT_ANY | EVENT_GROUP_CLEAR);
+
+    /* Only the first waiter is satisfied. */
+    mask = 0x1;
+    BTASSERT(event_group_write(&event_group, &mask, sizeof(mask)) == 4);
+    BTASSERT(sem_take(&waiters[0].done_sem, NULL) == 0);
+    BTASSERT(waiters[0].res == 0);
+    BTASSERT(waiters[0].mask == 0x1);
+
+    /* The second and third waiters are satisfied. The third waiter
+       clears event 0x2, but after the second waiter has been
+       resumed. */
+    mask = 0x2;
+    BTASSERT(event_group_write(&event_group, &mask, sizeof(mask)) == 4);
+    BTASSERT(sem_take(&waiters[1].done_sem, NULL) == 0);
+    BTASSERT(waiters[1].res == 0);
+    BTASSERT(waiters[1].mask == 0x3);
+    BTASSERT(sem_take(&waiters[2].done_sem, NULL) == 0);
+    BTASSERT(waiters[2].res == 0);
+    BTASSERT(waiters[2].mask == 0x2);
+    BTASSERT(event_group.mask == 0x1);
+    BTASSERT(event_group.waiters_p == NULL);
+    BTASSERT(event_group_clear(&event_group, 0xffffffff) == 0);
+
+    /* All three waiters are resumed by one write. */
+    start_wait(&waiters[0], 0x8, EVENT_GROUP_WAIT_ANY | EVENT_GROUP_CLEAR);
+    start_wait(&waiters[1], 0x18, EVENT_GROUP_WAIT_ANY);
+    start_wait(&waiters[2], 0x18, EVENT_GROUP_WAIT_ALL);
+    mask = 0x18;
+    BTASSERT(event_group_write(&event_group, &mask, sizeof(mask)) == 4);
+    BTASSERT(sem_take(&waiters[0].done_sem, NULL) == 0);
+    BTASSERT(waiters[0].mask == 0x8);
+    BTASSERT(sem_take(&waiters[1].done_sem, NULL) == 0);
+    BTASSERT(waiters[1].mask == 0x18);
+    BTASSERT(sem_take(&waiters[2].done_sem, NULL) == 0);
+    BTASSERT(waiters[2].mask == 0x18);
+    BTASSERT(event_group.mask == 0x10);
+    BTASSERT(event_group_clear(&event_group, 0x10) == 0);
+
+    return (0);
+}
+
+static int test_waiter_order(void)
+{
+    uint32_t mask;
+    struct event_group_waiter_t *waiter_p;
+    int i;
+
+    /* Waiters are resumed in the order they started to wait. */
+    start_wait(&waiters[1], 0x1, EVENT_GROUP_WAIT_ANY);
+    start_wait(&waiters[0], 0x1, EVENT_GROUP_WAIT_ANY);
+    start_wait(&waiters[2], 0x1, EVENT_GROUP_WAIT_ANY);
+
+    waiter_p = event_group.waiters_p;
+    BTASSERT(waiter_p->thrd_p == threads[1]);
+    waiter_p = waiter_p->next_p;
+    BTASSERT(waiter_p->thrd_p == threads[0]);
+    waiter_p = waiter_p->next_p;
+    BTASSERT(waiter_p->thrd_p == threads[2]);
+    BTASSERT(waiter_p->next_p == NULL);
+
+    mask = 0x1;
+    BTASSERT(event_group_write(&event_group, &mask, sizeof(mask)) == 4);
+
+    for (i = 0; i < membersof(waiters); i++) {
+        BTASSERT(sem_take(&waiters[i].done_sem, NULL) == 0);
+        BTASSERT(waiters[i].res == 0);
+    }
+
+    BTASSERT(event_group_clear(&event_group, 0x1) == 0);
+
+    return (0);
+}
+
+static int test_resumed(void)
+{
+    /* A waiter resumed by other means than a write gets the resume
+       error code, and is removed from the waiters. */
+    start_wait(&waiters[0], 0x1, EVENT_GROUP_WAIT_ANY);
+    BTASSERT(thrd_resume(threads[0], -EINTR) == 0);
+    BTASSERT(sem_take(&waiters[0].done_sem, NULL) == 0);
+    BTASSERTI(waiters[0].res, ==, -EINTR);
+    BTASSERT(event_group.waiters_p == NULL);
+
+    return (0);
+}
+
+static int test_chan(void)
+{
+    uint32_t mask;
+
+    mask = 0x6;
+    BTASSERT(chan_write(&event_group, &mask, sizeof(mask)) == 4);
+    BTASSERT(chan_poll(&event_group, NULL) == &event_group);
+
+    /* Reading clears the read events. */
+    mask = 0x2;
+    BTASSERT(chan_read(&event_group, &mask, sizeof(mask)) == 4);
+    BTASSERT(mask == 0x2);
+    BTASSERT(chan_size(&event_group) == 1);
+    mask = 0xff;
+    BTASSERT(chan_read(&event_group, &mask, sizeof(mask)) == 4);
+    BTASSERT(mask == 0x4);
+    BTASSERT(chan_size(&event_group) == 0);
+
+    return (0);
+}
+
+int main()
+{
+    struct harness_testcase_t testcases[] = {
+        { test_init, "test_init" },
+        { test_any_all, "test_any_all" },
+        { test_timeout, "test_timeout" },
+        { test_multiple_waiters, "test_multiple_waiters" },
+        { test_waiter_order, "test_waiter_order" },
+        { test_resumed, "test_resumed" },
+        { test_chan, "test_chan" },
+        { NULL, NULL }
+    };
+
+    sys_start();
+
+    harness_run(testcases);
+
+    return (0);
+}
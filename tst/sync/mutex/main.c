@@ -109,10 +109,508 @@ static int test_multi_thread(void)
     return (0);
 }
 
+static struct mutex_t timeout_mutex;
+static struct thrd_t *timeout_main_thrd_p;
+
+#if defined(ARCH_ESP32) || defined(ARCH_PPC)
+static THRD_STACK(holder_stack, 512);
+#else
+static THRD_STACK(holder_stack, 256);
+#endif
+
+/**
+ * Hold the mutex until resumed by the main thread.
+ */
+static void *holder_main(void *arg_p)
+{
+    mutex_lock(&timeout_mutex);
+    thrd_resume(timeout_main_thrd_p, 0);
+    thrd_suspend(NULL);
+    mutex_unlock(&timeout_mutex);
+    thrd_suspend(NULL);
+
+    return (NULL);
+}
+
+static int test_lock_timeout(void)
+{
+    struct thrd_t *holder_thrd_p;
+    struct time_t timeout;
+
+    BTASSERT(mutex_init(&timeout_mutex) == 0);
+    timeout_main_thrd_p = thrd_self();
+
+    /* Not locked. */
+    timeout.seconds = 0;
+    timeout.nanoseconds = 0;
+    BTASSERTI(mutex_lock_timeout(&timeout_mutex, &timeout), ==, 0);
+    BTASSERT(mutex_unlock(&timeout_mutex) == 0);
+
+    holder_thrd_p = thrd_spawn(holder_main,
+                               NULL,
+                               10,
+                               holder_stack,
+                               sizeof(holder_stack));
+    BTASSERT(holder_thrd_p != NULL);
+    BTASSERT(thrd_suspend(NULL) == 0);
+
+    /* Zero timeout. */
+    BTASSERTI(mutex_lock_timeout(&timeout_mutex, &timeout), ==, -ETIMEDOUT);
+
+    /* 10 ms timeout. */
+    timeout.nanoseconds = 10000000;
+    BTASSERTI(mutex_lock_timeout(&timeout_mutex, &timeout), ==, -ETIMEDOUT);
+
+    /* The main thread is no longer waiting for the mutex, and the
+       holder has its own priority again. */
+    BTASSERT(thrd_prio_list_peek_isr(&timeout_mutex.waiters) == NULL);
+    BTASSERTI(holder_thrd_p->prio, ==, 10);
+
+    /* The holder unlocks the mutex before the timeout. */
+    BTASSERT(thrd_resume(holder_thrd_p, 0) == 0);
+    timeout.seconds = 1;
+    BTASSERTI(mutex_lock_timeout(&timeout_mutex, &timeout), ==, 0);
+    BTASSERT(mutex_unlock(&timeout_mutex) == 0);
+
+    return (0);
+}
+
+#define CONTENDED_ITERATIONS 1000
+
+static struct mutex_t handoff_mutex;
+static int waiter_res;
+static struct mutex_t contended_mutex;
+static int contended_counter;
+static int contended_is_locked;
+static int contender_counters[2];
+
+#if defined(ARCH_ESP32) || defined(ARCH_PPC)
+static THRD_STACK(handoff_waiter_stack, 512);
+static THRD_STACK(contender_stacks[2], 512);
+#else
+static THRD_STACK(handoff_waiter_stack, 256);
+static THRD_STACK(contender_stacks[2], 256);
+#endif
+
+static void *handoff_waiter_main(void *arg_p)
+{
+    struct time_t timeout;
+
+    /* Suspends, as the main thread holds the mutex. */
+    mutex_lock(&handoff_mutex);
+    mutex_unlock(&handoff_mutex);
+    thrd_suspend(NULL);
+
+    /* Times out, leaving the waiters flag set. */
+    timeout.seconds = 0;
+    timeout.nanoseconds = 1000000;
+    waiter_res = mutex_lock_timeout(&handoff_mutex, &timeout);
+    thrd_suspend(NULL);
+
+    return (NULL);
+}
+
+static int test_handoff(void)
+{
+    struct thrd_t *waiter_p;
+
+    BTASSERT(mutex_init(&handoff_mutex) == 0);
+    BTASSERT(mutex_lock(&handoff_mutex) == 0);
+
+    /* The lower priority waiter sets the waiters flag and suspends
+       while the main thread sleeps. */
+    waiter_p = thrd_spawn(handoff_waiter_main,
+                          NULL,
+                          thrd_get_prio() + 1,
+                          handoff_waiter_stack,
+                          sizeof(handoff_waiter_stack));
+    BTASSERT(waiter_p != NULL);
+    thrd_sleep_ms(5);
+    BTASSERTI(handoff_mutex.has_waiters, ==, 1);
+    BTASSERT(thrd_prio_list_peek_isr(&handoff_mutex.waiters)->thrd_p
+             == waiter_p);
+
+    /* The unlock sees the waiters flag and hands the mutex over to
+       the waiter before it runs. */
+    BTASSERT(mutex_unlock(&handoff_mutex) == 0);
+#if CONFIG_THRD_SMP == 0
+    /* With SMP the waiter may already run on another core. */
+    BTASSERT(handoff_mutex.owner_p == waiter_p);
+#endif
+    BTASSERTI(handoff_mutex.has_waiters, ==, 0);
+    thrd_sleep_ms(5);
+    BTASSERT(handoff_mutex.owner_p == NULL);
+
+    /* A waiter that timed out leaves the waiters flag set, and the
+       next unlock clears it. */
+    BTASSERT(mutex_lock(&handoff_mutex) == 0);
+    waiter_res = 1;
+    BTASSERT(thrd_resume(waiter_p, 0) == 0);
+    thrd_sleep_ms(50);
+    BTASSERTI(waiter_res, ==, -ETIMEDOUT);
+    BTASSERTI(handoff_mutex.has_waiters, ==, 1);
+    BTASSERT(thrd_prio_list_peek_isr(&handoff_mutex.waiters) == NULL);
+    BTASSERT(mutex_unlock(&handoff_mutex) == 0);
+    BTASSERTI(handoff_mutex.has_waiters, ==, 0);
+    BTASSERT(handoff_mutex.owner_p == NULL);
+
+    return (0);
+}
+
+static void *contender_main(void *arg_p)
+{
+    int i;
+    int *counter_p;
+
+    counter_p = arg_p;
+
+    for (i = 0; i < CONTENDED_ITERATIONS; i++) {
+        mutex_lock(&contended_mutex);
+
+        if (contended_is_locked == 1) {
+            break;
+        }
+
+        /* Let the other threads try to lock the mutex. */
+        contended_is_locked = 1;
+        thrd_yield();
+        contended_is_locked = 0;
+        contended_counter++;
+        mutex_unlock(&contended_mutex);
+        (*counter_p)++;
+        thrd_yield();
+    }
+
+    thrd_suspend(NULL);
+
+    return (NULL);
+}
+
+static int test_contended(void)
+{
+    int i;
+    int done;
+
+    BTASSERT(mutex_init(&contended_mutex) == 0);
+    contended_counter = 0;
+
+    for (i = 0; i < membersof(contender_stacks); i++) {
+        contender_counters[i] = 0;
+        BTASSERT(thrd_spawn(contender_main,
+                            &contender_counters[i],
+                            thrd_get_prio(),
+                            contender_stacks[i],
+                            sizeof(contender_stacks[i])) != NULL);
+    }
+
+    /* The main thread contends for the mutex as well. */
+    for (i = 0; i < CONTENDED_ITERATIONS; i++) {
+        BTASSERT(mutex_lock(&contended_mutex) == 0);
+        BTASSERTI(contended_is_locked, ==, 0);
+        contended_is_locked = 1;
+        thrd_yield();
+        contended_is_locked = 0;
+        contended_counter++;
+        BTASSERT(mutex_unlock(&contended_mutex) == 0);
+        thrd_yield();
+    }
+
+    done = 0;
+
+    while (done == 0) {
+        sys_lock();
+        done = ((contender_counters[0] == CONTENDED_ITERATIONS)
+                && (contender_counters[1] == CONTENDED_ITERATIONS));
+        sys_unlock();
+        thrd_yield();
+    }
+
+    BTASSERTI(contended_counter, ==, 3 * CONTENDED_ITERATIONS);
+    BTASSERTI(contended_mutex.has_waiters, ==, 0);
+    BTASSERT(contended_mutex.owner_p == NULL);
+
+    return (0);
+}
+
+#if CONFIG_MUTEX_PRIO_INHERIT == 1
+
+#if defined(ARCH_ESP32) || defined(ARCH_PPC)
+#    define PRIO_STACK_SIZE 512
+#else
+#    define PRIO_STACK_SIZE 256
+#endif
+
+/* One set of stacks per testcase as threads never terminate. */
+static THRD_STACK(low_stacks[2], PRIO_STACK_SIZE);
+static THRD_STACK(medium_stacks[2], PRIO_STACK_SIZE);
+static THRD_STACK(high_stacks[2], PRIO_STACK_SIZE);
+static THRD_STACK(middle_stack, PRIO_STACK_SIZE);
+static THRD_STACK(waiter_stacks[2], PRIO_STACK_SIZE);
+
+static struct mutex_t mutexes[2];
+static struct sem_t done_sem;
+static struct thrd_t *main_thrd_p;
+static struct thrd_t *low_thrd_p;
+static char order[8];
+static int order_length;
+static int low_prio;
+static int middle_prio;
+
+static void log_order(char c)
+{
+    order[order_length++] = c;
+    order[order_length] = '\0';
+}
+
+static void done(void)
+{
+    sem_give(&done_sem, 1);
+    thrd_suspend(NULL);
+}
+
+/**
+ * Lock the first mutex and let the main thread spawn the other
+ * threads before unlocking it.
+ */
+static void *low_main(void *arg_p)
+{
+    mutex_lock(&mutexes[0]);
+    thrd_resume(main_thrd_p, 0);
+    thrd_suspend(NULL);
+    low_prio = thrd_get_prio();
+    log_order('L');
+    mutex_unlock(&mutexes[0]);
+
+    /* The inherited priority is dropped on unlock. */
+    if (thrd_get_prio() != 10) {
+        log_order('!');
+    }
+
+    done();
+
+    return (NULL);
+}
+
+/**
+ * Lock the second mutex and wait for the first one.
+ */
+static void *middle_main(void *arg_p)
+{
+    mutex_lock(&mutexes[1]);
+    thrd_resume(main_thrd_p, 0);
+    mutex_lock(&mutexes[0]);
+    middle_prio = thrd_get_prio();
+    log_order('I');
+    mutex_unlock(&mutexes[0]);
+    mutex_unlock(&mutexes[1]);
+
+    if (thrd_get_prio() != 8) {
+        log_order('!');
+    }
+
+    done();
+
+    return (NULL);
+}
+
+/**
+ * A CPU bound thread with priority between the low and the high
+ * priority threads.
+ */
+static void *medium_main(void *arg_p)
+{
+    log_order('M');
+    done();
+
+    return (NULL);
+}
+
+static void *high_main(void *arg_p)
+{
+    mutex_lock(arg_p);
+    log_order('H');
+    mutex_unlock(arg_p);
+    done();
+
+    return (NULL);
+}
+
+static void *waiter_main(void *arg_p)
+{
+    mutex_lock(&mutexes[0]);
+    log_order(*(char *)arg_p);
+    mutex_unlock(&mutexes[0]);
+    done();
+
+    return (NULL);
+}
+
+/**
+ * Spawn the low priority thread and wait for it to lock the first
+ * mutex.
+ */
+static int spawn_low(int test)
+{
+    BTASSERT(mutex_init(&mutexes[0]) == 0);
+    BTASSERT(mutex_init(&mutexes[1]) == 0);
+    BTASSERT(sem_init(&done_sem, 4, 4) == 0);
+    main_thrd_p = thrd_self();
+    order_length = 0;
+    low_prio = 0;
+    middle_prio = 0;
+
+    low_thrd_p = thrd_spawn(low_main,
+                            NULL,
+                            10,
+                            low_stacks[test],
+                            sizeof(low_stacks[test]));
+    BTASSERT(low_thrd_p != NULL);
+    BTASSERT(thrd_suspend(NULL) == 0);
+
+    return (0);
+}
+
+static int test_priority_inheritance(void)
+{
+    int i;
+
+    BTASSERT(spawn_low(0) == 0);
+
+    /* The low priority thread holds the mutex. Make it ready and
+       spawn the other threads. */
+    BTASSERT(thrd_resume(low_thrd_p, 0) == 0);
+    BTASSERT(thrd_spawn(medium_main,
+                        NULL,
+                        5,
+                        medium_stacks[0],
+                        sizeof(medium_stacks[0])) != NULL);
+    BTASSERT(thrd_spawn(high_main,
+                        &mutexes[0],
+                        -5,
+                        high_stacks[0],
+                        sizeof(high_stacks[0])) != NULL);
+
+    for (i = 0; i < 3; i++) {
+        BTASSERT(sem_take(&done_sem, NULL) == 0);
+    }
+
+    /* The low priority thread runs before the medium priority thread
+       as it inherited the priority of the high priority thread. */
+    BTASSERTM(&order[0], "LHM", 4);
+    BTASSERTI(low_prio, ==, -5);
+
+    return (0);
+}
+
+static int test_priority_inheritance_chain(void)
+{
+    int i;
+
+    BTASSERT(spawn_low(1) == 0);
+
+    /* Let the middle thread lock the second mutex and wait for the
+       first one. */
+    BTASSERT(thrd_spawn(middle_main,
+                        NULL,
+                        8,
+                        middle_stack,
+                        sizeof(middle_stack)) != NULL);
+    BTASSERT(thrd_suspend(NULL) == 0);
+
+    BTASSERT(thrd_resume(low_thrd_p, 0) == 0);
+    BTASSERT(thrd_spawn(medium_main,
+                        NULL,
+                        5,
+                        medium_stacks[1],
+                        sizeof(medium_stacks[1])) != NULL);
+    BTASSERT(thrd_spawn(high_main,
+                        &mutexes[1],
+                        -5,
+                        high_stacks[1],
+                        sizeof(high_stacks[1])) != NULL);
+
+    for (i = 0; i < 4; i++) {
+        BTASSERT(sem_take(&done_sem, NULL) == 0);
+    }
+
+    /* The high priority thread waits for the middle thread, which
+       waits for the low priority thread. Both inherit the high
+       priority. */
+    BTASSERTM(&order[0], "LIHM", 5);
+    BTASSERTI(low_prio, ==, -5);
+    BTASSERTI(middle_prio, ==, -5);
+
+    return (0);
+}
+
+static int test_set_prio(void)
+{
+    struct thrd_t *a_thrd_p;
+    struct thrd_t *b_thrd_p;
+    int i;
+
+    BTASSERT(mutex_init(&mutexes[0]) == 0);
+    BTASSERT(sem_init(&done_sem, 2, 2) == 0);
+    order_length = 0;
+
+    /* Lowering the priority of a thread holding a mutex without
+       waiters takes effect immediately. */
+    BTASSERT(mutex_lock(&mutexes[0]) == 0);
+    BTASSERT(thrd_set_prio(thrd_self(), 10) == 0);
+    BTASSERTI(thrd_get_prio(), ==, 10);
+
+    /* Two waiters with higher priority than the holder. */
+    a_thrd_p = thrd_spawn(waiter_main,
+                          "A",
+                          5,
+                          waiter_stacks[0],
+                          sizeof(waiter_stacks[0]));
+    BTASSERT(a_thrd_p != NULL);
+    b_thrd_p = thrd_spawn(waiter_main,
+                          "B",
+                          6,
+                          waiter_stacks[1],
+                          sizeof(waiter_stacks[1]));
+    BTASSERT(b_thrd_p != NULL);
+    thrd_sleep_ms(10);
+    BTASSERTI(thrd_get_prio(), ==, 5);
+
+    /* The second waiter is moved first in the wait list, and the
+       holder inherits its new priority. */
+    BTASSERT(thrd_set_prio(b_thrd_p, 3) == 0);
+    BTASSERTI(b_thrd_p->prio, ==, 3);
+    BTASSERTI(thrd_get_prio(), ==, 3);
+
+    /* The inherited priority is kept until the mutex is unlocked. */
+    BTASSERT(thrd_set_prio(thrd_self(), 20) == 0);
+    BTASSERTI(thrd_get_prio(), ==, 3);
+    BTASSERT(mutex_unlock(&mutexes[0]) == 0);
+
+    for (i = 0; i < 2; i++) {
+        BTASSERT(sem_take(&done_sem, NULL) == 0);
+    }
+
+    BTASSERTI(thrd_get_prio(), ==, 20);
+    BTASSERTM(&order[0], "BA", 3);
+    BTASSERT(thrd_set_prio(thrd_self(), 0) == 0);
+
+    return (0);
+}
+
+#endif
+
 int main()
 {
     struct harness_testcase_t testcases[] = {
         { test_multi_thread, "test_multi_thread" },
+        { test_lock_timeout, "test_lock_timeout" },
+        { test_handoff, "test_handoff" },
+        { test_contended, "test_contended" },
+#if CONFIG_MUTEX_PRIO_INHERIT == 1
+        { test_priority_inheritance, "test_priority_inheritance" },
+        { test_priority_inheritance_chain, "test_priority_inheritance_chain" },
+        { test_set_prio, "test_set_prio" },
+#endif
         { NULL, NULL }
     };
 
@@ -34,9 +34,48 @@ static struct queue_t queue[2];
 static struct queue_t buffered_queue;
 static char buffer[8];
 static struct event_t event;
+static struct queue_t zero_copy_queue;
+static char zero_copy_buffer[8];
 
 static THRD_STACK(t0_stack, 512);
 static THRD_STACK(t1_stack, 512);
+static THRD_STACK(t2_stack, 512);
+static THRD_STACK(t3_stack, 512);
+static ssize_t t3_res;
+
+static void *t3_main(void *arg_p)
+{
+    thrd_set_name("t3");
+
+    /* Test: test_peek_release_writer. */
+    t3_res = queue_write(&zero_copy_queue, "abcdefghijklmnopqrst", 20);
+
+    thrd_suspend(NULL);
+
+    return (0);
+}
+
+static void *t2_main(void *arg_p)
+{
+    struct queue_view_t view;
+
+    thrd_set_name("t2");
+
+    /* Test: test_commit_to_reader. */
+    thrd_sleep_ms(10);
+    BTASSERTN(queue_write_reserve(&zero_copy_queue, &view, 3) == 3);
+    memcpy(view.arrays[0].buf_p, "abc", 3);
+    BTASSERTN(queue_write_commit(&zero_copy_queue, 3) == 3);
+
+    thrd_sleep_ms(10);
+    BTASSERTN(queue_write_reserve(&zero_copy_queue, &view, 2) == 2);
+    memcpy(view.arrays[0].buf_p, "de", 2);
+    BTASSERTN(queue_write_commit(&zero_copy_queue, 2) == 2);
+
+    thrd_suspend(NULL);
+
+    return (0);
+}
 
 static void *t0_main(void *arg_p)
 {
@@ -545,6 +584,199 @@ static int test_read_write_zero(void)
     return (0);
 }
 
+static int test_reserve_commit(void)
+{
+    struct queue_view_t view;
+    char buf[8];
+
+    BTASSERT(queue_init(&zero_copy_queue,
+                        &zero_copy_buffer[0],
+                        sizeof(zero_copy_buffer)) == 0);
+
+    /* Seven bytes fits in the queue buffer. */
+    BTASSERT(queue_write_reserve(&zero_copy_queue, &view, 16) == 7);
+    BTASSERT(view.arrays[0].buf_p == &zero_copy_buffer[0]);
+    BTASSERT(view.arrays[0].size == 7);
+    BTASSERT(view.arrays[1].size == 0);
+
+    /* Write five bytes in place, but only commit four of them. */
+    memcpy(view.arrays[0].buf_p, "12345", 5);
+    BTASSERT(queue_write_commit(&zero_copy_queue, 4) == 4);
+    BTASSERT(queue_size(&zero_copy_queue) == 4);
+    BTASSERT(queue_read(&zero_copy_queue, &buf[0], 3) == 3);
+    BTASSERT(memcmp(&buf[0], "123", 3) == 0);
+
+    /* The reserved bytes wraps around the end of the buffer. */
+    BTASSERT(queue_write_reserve(&zero_copy_queue, &view, 6) == 6);
+    BTASSERT(view.arrays[0].buf_p == &zero_copy_buffer[4]);
+    BTASSERT(view.arrays[0].size == 4);
+    BTASSERT(view.arrays[1].buf_p == &zero_copy_buffer[0]);
+    BTASSERT(view.arrays[1].size == 2);
+    memcpy(view.arrays[0].buf_p, "5678", 4);
+    memcpy(view.arrays[1].buf_p, "9a", 2);
+    BTASSERT(queue_write_commit(&zero_copy_queue, 6) == 6);
+
+    /* Full queue. */
+    BTASSERT(queue_write_reserve(&zero_copy_queue, &view, 1) == 0);
+    BTASSERT(queue_read(&zero_copy_queue, &buf[0], 7) == 7);
+    BTASSERT(memcmp(&buf[0], "456789a", 7) == 0);
+
+    /* Stopped queue. */
+    BTASSERT(queue_stop(&zero_copy_queue) == 0);
+    BTASSERT(queue_write_reserve(&zero_copy_queue, &view, 1) == -1);
+    BTASSERT(queue_start(&zero_copy_queue) == 0);
+
+    return (0);
+}
+
+static int test_peek_release(void)
+{
+    struct queue_view_t view;
+
+    BTASSERT(queue_init(&zero_copy_queue,
+                        &zero_copy_buffer[0],
+                        sizeof(zero_copy_buffer)) == 0);
+
+    /* Nothing to peek in an empty queue. */
+    BTASSERT(queue_read_peek(&zero_copy_queue, &view, 4) == 0);
+    BTASSERT(view.arrays[0].size == 0);
+    BTASSERT(view.arrays[1].size == 0);
+
+    BTASSERT(queue_write(&zero_copy_queue, "12345", 5) == 5);
+
+    /* Peek at three bytes, and release two of them. */
+    BTASSERT(queue_read_peek(&zero_copy_queue, &view, 3) == 3);
+    BTASSERT(view.arrays[0].buf_p == &zero_copy_buffer[0]);
+    BTASSERT(view.arrays[0].size == 3);
+    BTASSERT(view.arrays[1].size == 0);
+    BTASSERT(memcmp(view.arrays[0].buf_p, "123", 3) == 0);
+    BTASSERT(queue_read_release(&zero_copy_queue, 2) == 2);
+    BTASSERT(queue_size(&zero_copy_queue) == 3);
+
+    /* The peeked bytes wraps around the end of the buffer. */
+    BTASSERT(queue_write(&zero_copy_queue, "6789", 4) == 4);
+    BTASSERT(queue_read_peek(&zero_copy_queue, &view, 16) == 7);
+    BTASSERT(view.arrays[0].buf_p == &zero_copy_buffer[2]);
+    BTASSERT(view.arrays[0].size == 6);
+    BTASSERT(memcmp(view.arrays[0].buf_p, "345678", 6) == 0);
+    BTASSERT(view.arrays[1].buf_p == &zero_copy_buffer[0]);
+    BTASSERT(view.arrays[1].size == 1);
+    BTASSERT(memcmp(view.arrays[1].buf_p, "9", 1) == 0);
+    BTASSERT(queue_read_release(&zero_copy_queue, 16) == 7);
+    BTASSERT(queue_size(&zero_copy_queue) == 0);
+
+    return (0);
+}
+
+static int test_peek_release_writer(void)
+{
+    struct queue_view_t view;
+    char buf[20];
+    size_t size;
+    ssize_t n;
+
+    BTASSERT(queue_init(&zero_copy_queue,
+                        &zero_copy_buffer[0],
+                        sizeof(zero_copy_buffer)) == 0);
+    t3_res = 0;
+    BTASSERT(thrd_spawn(t3_main,
+                        NULL,
+                        0,
+                        t3_stack,
+                        sizeof(t3_stack)) != NULL);
+
+    /* The writer fills the buffer and waits for room. */
+    thrd_sleep_ms(10);
+    BTASSERTI(queue_size(&zero_copy_queue), ==, 20);
+    BTASSERTI(t3_res, ==, 0);
+
+    /* Drain the queue using peek and release only. */
+    size = 0;
+
+    while (size < sizeof(buf)) {
+        n = queue_read_peek(&zero_copy_queue, &view, 3);
+        BTASSERTI(n, >, 0);
+        memcpy(&buf[size], view.arrays[0].buf_p, view.arrays[0].size);
+        memcpy(&buf[size + view.arrays[0].size],
+               view.arrays[1].buf_p,
+               view.arrays[1].size);
+        BTASSERTI(queue_read_release(&zero_copy_queue, n), ==, n);
+        size += n;
+    }
+
+    BTASSERTM(&buf[0], "abcdefghijklmnopqrst", 20);
+    BTASSERTI(queue_size(&zero_copy_queue), ==, 0);
+
+    /* The writer was resumed when all its data fitted in the
+       buffer. */
+    thrd_sleep_ms(10);
+    BTASSERTI(t3_res, ==, 20);
+    BTASSERT(zero_copy_queue.writer_p == NULL);
+
+    return (0);
+}
+
+static int test_commit_to_reader(void)
+{
+    char buf[5];
+
+    BTASSERT(queue_init(&zero_copy_queue,
+                        &zero_copy_buffer[0],
+                        sizeof(zero_copy_buffer)) == 0);
+    BTASSERT(thrd_spawn(t2_main,
+                        NULL,
+                        0,
+                        t2_stack,
+                        sizeof(t2_stack)) != NULL);
+
+    /* The other thread commits three and two bytes. */
+    BTASSERT(queue_read(&zero_copy_queue, &buf[0], 5) == 5);
+    BTASSERT(memcmp(&buf[0], "abcde", 5) == 0);
+    BTASSERT(queue_size(&zero_copy_queue) == 0);
+
+    return (0);
+}
+
+static int test_read_write_timeout(void)
+{
+    struct queue_t queue;
+    char buf[5];
+    struct time_t timeout;
+
+    BTASSERT(queue_init(&queue, &buf[0], sizeof(buf)) == 0);
+
+    /* Zero timeout. */
+    timeout.seconds = 0;
+    timeout.nanoseconds = 0;
+    BTASSERTI(queue_read_timeout(&queue, &buf[0], 1, &timeout),
+              ==,
+              -ETIMEDOUT);
+
+    /* 10 ms timeout. */
+    timeout.nanoseconds = 10000000;
+    BTASSERTI(queue_read_timeout(&queue, &buf[0], 1, &timeout),
+              ==,
+              -ETIMEDOUT);
+    BTASSERT(queue.base.reader_p == NULL);
+
+    /* The buffer fits four bytes, so two of six are written. */
+    BTASSERTI(queue_write_timeout(&queue, "ab", 2, &timeout), ==, 2);
+    BTASSERTI(queue_write_timeout(&queue, "cdefgh", 6, &timeout), ==, 2);
+    BTASSERT(queue.writer_p == NULL);
+    BTASSERT(thrd_prio_list_peek_isr(&queue.writers) == NULL);
+    BTASSERTI(queue_write_timeout(&queue, "g", 1, &timeout),
+              ==,
+              -ETIMEDOUT);
+
+    /* Four bytes available, so a partial read. */
+    BTASSERTI(queue_read_timeout(&queue, &buf[0], 5, &timeout), ==, 4);
+    BTASSERTM(&buf[0], "abcd", 4);
+    BTASSERT(queue.base.reader_p == NULL);
+    BTASSERTI(queue_size(&queue), ==, 0);
+
+    return (0);
+}
+
 int main()
 {
     struct harness_testcase_t testcases[] = {
@@ -559,6 +791,11 @@ int main()
         { test_non_blocking, "test_non_blocking" },
         { test_ignore, "test_ignore" },
         { test_read_write_zero, "test_read_write_zero" },
+        { test_reserve_commit, "test_reserve_commit" },
+        { test_peek_release, "test_peek_release" },
+        { test_peek_release_writer, "test_peek_release_writer" },
+        { test_commit_to_reader, "test_commit_to_reader" },
+        { test_read_write_timeout, "test_read_write_timeout" },
         { NULL, NULL }
     };
 
@@ -0,0 +1,251 @@
+/**
+ * @section License
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017, Erik Moqvist
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+#define BENCHMARK_ITERATIONS                            100000
+
+struct config_t {
+    int value;
+};
+
+static struct config_t configs[2];
+static struct config_t *config_p;
+static volatile int reader_value;
+static volatile int reader_done;
+
+static volatile int reader_state;
+
+static THRD_STACK(reader_stack, 1024);
+static THRD_STACK(blocking_reader_stack, 1024);
+
+static void *reader_main(void *arg_p)
+{
+    struct config_t *current_p;
+
+    rcu_read_lock();
+    current_p = RCU_DEREFERENCE(config_p);
+
+    /* Block in the critical section while the writer publishes a new
+       version and waits for a grace period. */
+    thrd_sleep_ms(20);
+
+    reader_value = current_p->value;
+    reader_done = 1;
+    rcu_read_unlock();
+
+    return (NULL);
+}
+
+static void *blocking_reader_main(void *arg_p)
+{
+    struct config_t *current_p;
+
+    rcu_read_lock();
+    current_p = RCU_DEREFERENCE(config_p);
+
+    /* Block in the critical section. */
+    thrd_sleep_ms(20);
+
+    reader_value = current_p->value;
+    reader_done = 1;
+    rcu_read_unlock();
+
+    /* The end of the critical section was reported to the writer
+       before this thread is switched out. */
+    reader_state = thrd_self()->rcu.state;
+
+    thrd_suspend(NULL);
+
+    return (NULL);
+}
+
+static int test_nesting(void)
+{
+    BTASSERT(thrd_self()->rcu.nesting == 0);
+
+    rcu_read_lock();
+    rcu_read_lock();
+    BTASSERT(thrd_self()->rcu.nesting == 2);
+    rcu_read_unlock();
+    BTASSERT(thrd_self()->rcu.nesting == 1);
+    rcu_read_unlock();
+
+    BTASSERT(thrd_self()->rcu.nesting == 0);
+
+    return (0);
+}
+
+static int test_synchronize_no_readers(void)
+{
+    configs[0].value = 1;
+    RCU_ASSIGN(config_p, &configs[0]);
+
+    BTASSERT(rcu_synchronize() == 0);
+
+    rcu_read_lock();
+    BTASSERT(RCU_DEREFERENCE(config_p)->value == 1);
+    rcu_read_unlock();
+
+    return (0);
+}
+
+static int test_synchronize_preempted_reader(void)
+{
+    configs[0].value = 1;
+    RCU_ASSIGN(config_p, &configs[0]);
+    reader_done = 0;
+
+    /* The reader has lower priority than the main thread. */
+    BTASSERT(thrd_spawn(reader_main,
+                        NULL,
+                        10,
+                        reader_stack,
+                        sizeof(reader_stack)) != NULL);
+
+    /* Let the reader enter its critical section. */
+    thrd_sleep_ms(10);
+    BTASSERT(reader_done == 0);
+
+    /* Publish a new version. The old version must not be modified
+       until the reader leaves its critical section. */
+    configs[1].value = 2;
+    RCU_ASSIGN(config_p, &configs[1]);
+
+    BTASSERT(rcu_synchronize() == 0);
+    BTASSERT(reader_done == 1);
+    BTASSERT(reader_value == 1);
+
+    /* Now safe to reuse. */
+    configs[0].value = 3;
+
+    /* No readers, no wait. */
+    BTASSERT(rcu_synchronize() == 0);
+
+    return (0);
+}
+
+static int test_synchronize_blocking_reader(void)
+{
+    configs[0].value = 4;
+    RCU_ASSIGN(config_p, &configs[0]);
+    reader_done = 0;
+    reader_state = -1;
+
+    /* The reader has lower priority than the main thread. */
+    BTASSERT(thrd_spawn(blocking_reader_main,
+                        NULL,
+                        10,
+                        blocking_reader_stack,
+                        sizeof(blocking_reader_stack)) != NULL);
+
+    /* Let the reader enter its critical section and block. */
+    thrd_sleep_ms(10);
+    BTASSERT(reader_done == 0);
+
+    configs[1].value = 5;
+    RCU_ASSIGN(config_p, &configs[1]);
+
+    BTASSERT(rcu_synchronize() == 0);
+    BTASSERT(reader_done == 1);
+    BTASSERT(reader_value == 4);
+
+    /* Let the reader save its state, in case it runs on another
+       core. */
+    thrd_sleep_ms(10);
+    BTASSERTI(reader_state, ==, 0);
+
+    return (0);
+}
+
+static int test_read_benchmark(void)
+{
+    struct rwlock_t rwlock;
+    int i;
+    int sum;
+    int start;
+    int rcu_time;
+    int rwlock_time;
+
+    configs[0].value = 1;
+    RCU_ASSIGN(config_p, &configs[0]);
+    rwlock_init(&rwlock);
+    sum = 0;
+
+    start = time_micros();
+
+    for (i = 0; i < BENCHMARK_ITERATIONS; i++) {
+        rcu_read_lock();
+        sum += RCU_DEREFERENCE(config_p)->value;
+        rcu_read_unlock();
+    }
+
+    rcu_time = (time_micros() - start);
+    start = time_micros();
+
+    for (i = 0; i < BENCHMARK_ITERATIONS; i++) {
+        rwlock_reader_take(&rwlock);
+        sum += config_p->value;
+        rwlock_reader_give(&rwlock);
+    }
+
+    rwlock_time = (time_micros() - start);
+
+    BTASSERT(sum == 2 * BENCHMARK_ITERATIONS);
+
+    std_printf(OSTR("%d reads:\r\n"
+                    "  rcu_read_lock():      %d us\r\n"
+                    "  rwlock_reader_take(): %d us\r\n"),
+               BENCHMARK_ITERATIONS,
+               rcu_time,
+               rwlock_time);
+
+    return (0);
+}
+
+int main()
+{
+    struct harness_testcase_t testcases[] = {
+        { test_nesting, "test_nesting" },
+        { test_synchronize_no_readers, "test_synchronize_no_readers" },
+        { test_synchronize_preempted_reader,
+          "test_synchronize_preempted_reader" },
+        { test_synchronize_blocking_reader,
+          "test_synchronize_blocking_reader" },
+        { test_read_benchmark, "test_read_benchmark" },
+        { NULL, NULL }
+    };
+
+    sys_start();
+
+    harness_run(testcases);
+
+    return (0);
+}
@@ -0,0 +1,398 @@
+/**
+ * @section License
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017, Erik Moqvist
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+#define BENCHMARK_BURSTS                                 10000
+#define BENCHMARK_BURST_SIZE                                16
+
+static struct ring_t ring;
+static char buffer[16];
+static struct queue_t queue;
+static char queue_buffer[16];
+static struct ring_t benchmark_ring;
+static char benchmark_buffer[BENCHMARK_BURST_SIZE];
+static struct queue_t benchmark_queue;
+static char benchmark_queue_buffer[2 * BENCHMARK_BURST_SIZE];
+static struct timer_t timer;
+static int timer_count;
+
+static THRD_STACK(producer_stack, 1024);
+
+static void *producer_main(void *arg_p)
+{
+    uint8_t buf[7];
+    int value;
+    int i;
+    size_t size;
+    ssize_t res;
+
+    thrd_set_name("producer");
+
+    /* Test: test_blocking_read. */
+    thrd_sleep_ms(20);
+    BTASSERTN(ring_write(&ring, "12", 2) == 2);
+    thrd_sleep_ms(20);
+    BTASSERTN(ring_write(&ring, "34", 2) == 2);
+
+    /* Test: test_poll. */
+    thrd_sleep_ms(20);
+    BTASSERTN(chan_write(&ring, "5", 1) == 1);
+
+    /* Test: test_stream. Write an increasing sequence of bytes in
+       chunks, yielding to the consumer when the ring is full. */
+    value = 0;
+
+    while (value < 10000) {
+        for (i = 0; i < membersof(buf); i++) {
+            buf[i] = (value + i);
+        }
+
+        size = MIN(membersof(buf), 10000 - value);
+        res = ring_write(&ring, &buf[0], size);
+        BTASSERTN(res >= 0);
+        value += res;
+
+        if (res < size) {
+            thrd_yield();
+        }
+    }
+
+    thrd_suspend(NULL);
+
+    return (NULL);
+}
+
+/**
+ * Timer callback, running in interrupt context.
+ */
+static void timer_cb(void *arg_p)
+{
+    uint8_t byte;
+
+    byte = timer_count;
+
+    if (ring_write_isr(&ring, &byte, sizeof(byte)) == 1) {
+        timer_count++;
+    }
+
+    if (timer_count == 4) {
+        timer_stop_isr(&timer);
+    }
+}
+
+static int test_init(void)
+{
+    BTASSERT(ring_init(&ring, &buffer[0], 0) == -EINVAL);
+    BTASSERT(ring_init(&ring, &buffer[0], 12) == -EINVAL);
+    BTASSERT(ring_init(&ring, &buffer[0], sizeof(buffer)) == 0);
+    BTASSERT(queue_init(&queue, &queue_buffer[0], sizeof(queue_buffer)) == 0);
+
+    BTASSERT(thrd_spawn(producer_main,
+                        NULL,
+                        0,
+                        producer_stack,
+                        sizeof(producer_stack)) != NULL);
+
+    return (0);
+}
+
+static int test_read_write(void)
+{
+    char buf[17];
+    int i;
+
+    BTASSERT(ring_size(&ring) == 0);
+    BTASSERT(ring_unused_size(&ring) == 16);
+
+    /* Write and read five bytes. */
+    BTASSERT(ring_write(&ring, "abcde", 5) == 5);
+    BTASSERT(ring_size(&ring) == 5);
+    BTASSERT(chan_size(&ring) == 5);
+    BTASSERT(ring_unused_size(&ring) == 11);
+    BTASSERT(ring_read(&ring, &buf[0], 5) == 5);
+    BTASSERT(memcmp(&buf[0], "abcde", 5) == 0);
+
+    /* Only 16 bytes fits in the ring, and the data wraps around the
+       end of the buffer. */
+    for (i = 0; i < 17; i++) {
+        buf[i] = ('A' + i);
+    }
+
+    BTASSERT(ring_write(&ring, &buf[0], 17) == 16);
+    BTASSERT(ring_write(&ring, &buf[0], 1) == 0);
+    BTASSERT(ring_size(&ring) == 16);
+    BTASSERT(ring_unused_size(&ring) == 0);
+    memset(&buf[0], 0, sizeof(buf));
+    BTASSERT(chan_read(&ring, &buf[0], 16) == 16);
+    BTASSERT(memcmp(&buf[0], "ABCDEFGHIJKLMNOP", 16) == 0);
+    BTASSERT(ring_size(&ring) == 0);
+
+    /* Zero bytes. */
+    BTASSERT(ring_write(&ring, &buf[0], 0) == 0);
+    BTASSERT(ring_read(&ring, &buf[0], 0) == 0);
+
+    return (0);
+}
+
+static int test_non_blocking(void)
+{
+    char buf[4];
+
+    BTASSERT(chan_control(&ring, CHAN_CONTROL_NON_BLOCKING_READ) == 0);
+    BTASSERT(ring_read(&ring, &buf[0], sizeof(buf)) == -EAGAIN);
+    BTASSERT(ring_write(&ring, "ab", 2) == 2);
+    BTASSERT(ring_read(&ring, &buf[0], sizeof(buf)) == 2);
+    BTASSERT(memcmp(&buf[0], "ab", 2) == 0);
+    BTASSERT(chan_control(&ring, CHAN_CONTROL_BLOCKING_READ) == 0);
+    BTASSERT(chan_control(&ring, 1000) == -EINVAL);
+
+    return (0);
+}
+
+static int test_blocking_read(void)
+{
+    char buf[4];
+
+    /* The producer writes two bytes twice. */
+    BTASSERT(ring_read(&ring, &buf[0], sizeof(buf)) == sizeof(buf));
+    BTASSERT(memcmp(&buf[0], "1234", 4) == 0);
+
+    return (0);
+}
+
+static int test_poll(void)
+{
+    char buf[1];
+    struct chan_list_t list;
+    struct chan_list_elem_t elements[2];
+
+    BTASSERT(chan_list_init(&list, &elements[0], membersof(elements)) == 0);
+    BTASSERT(chan_list_add(&list, &queue) == 0);
+    BTASSERT(chan_list_add(&list, &ring) == 0);
+
+    /* The producer writes one byte. */
+    BTASSERT(chan_list_poll(&list, NULL) == &ring);
+    BTASSERT(chan_read(&ring, &buf[0], sizeof(buf)) == sizeof(buf));
+    BTASSERT(buf[0] == '5');
+
+    BTASSERT(chan_list_destroy(&list) == 0);
+
+    return (0);
+}
+
+static int test_stream(void)
+{
+    uint8_t buf[13];
+    int value;
+    int i;
+
+    value = 0;
+
+    while (value < 10000 - membersof(buf)) {
+        BTASSERT(ring_read(&ring, &buf[0], sizeof(buf)) == sizeof(buf));
+
+        for (i = 0; i < membersof(buf); i++) {
+            BTASSERT(buf[i] == (uint8_t)(value + i));
+        }
+
+        value += membersof(buf);
+    }
+
+    BTASSERT(ring_read(&ring, &buf[0], 10000 - value) == 10000 - value);
+
+    for (i = 0; i < 10000 - value; i++) {
+        BTASSERT(buf[i] == (uint8_t)(value + i));
+    }
+
+    BTASSERT(ring_size(&ring) == 0);
+
+    return (0);
+}
+
+static int test_isr(void)
+{
+    uint8_t buf[4];
+    struct time_t timeout;
+
+    timer_count = 0;
+    timeout.seconds = 0;
+    timeout.nanoseconds = 1000000;
+    BTASSERT(timer_init(&timer,
+                        &timeout,
+                        timer_cb,
+                        NULL,
+                        TIMER_PERIODIC) == 0);
+    BTASSERT(timer_start(&timer) == 0);
+
+    /* Resumed by the timer callback. */
+    BTASSERT(ring_read(&ring, &buf[0], sizeof(buf)) == sizeof(buf));
+    BTASSERT(buf[0] == 0);
+    BTASSERT(buf[1] == 1);
+    BTASSERT(buf[2] == 2);
+    BTASSERT(buf[3] == 3);
+
+    return (0);
+}
+
+static int test_poll_set(void)
+{
+    char buf[4];
+    struct chan_poll_set_t poll_set;
+    struct chan_poll_set_elem_t elem;
+    struct time_t timeout;
+
+    timeout.seconds = 0;
+    timeout.nanoseconds = 0;
+
+    BTASSERT(chan_poll_set_init(&poll_set) == 0);
+    BTASSERT(chan_poll_set_add(&poll_set,
+                               &elem,
+                               &ring,
+                               CHAN_POLL_EDGE_TRIGGERED) == 0);
+    BTASSERT(chan_poll_set_wait(&poll_set, &timeout) == NULL);
+
+    /* Only the write to the empty ring makes it ready. */
+    BTASSERT(ring_write(&ring, "a", 1) == 1);
+    BTASSERT(chan_poll_set_wait(&poll_set, &timeout) == &ring);
+    BTASSERT(ring_write(&ring, "b", 1) == 1);
+    BTASSERT(chan_poll_set_wait(&poll_set, &timeout) == NULL);
+
+    /* Ready again after the ring has been emptied. */
+    BTASSERT(ring_read(&ring, &buf[0], 2) == 2);
+    BTASSERT(memcmp(&buf[0], "ab", 2) == 0);
+    sys_lock();
+    BTASSERT(ring_write_isr(&ring, "c", 1) == 1);
+    BTASSERT(ring_write_isr(&ring, "d", 1) == 1);
+    sys_unlock();
+    BTASSERT(chan_poll_set_wait(&poll_set, &timeout) == &ring);
+    BTASSERT(chan_poll_set_wait(&poll_set, &timeout) == NULL);
+    BTASSERT(ring_read(&ring, &buf[0], 2) == 2);
+    BTASSERT(memcmp(&buf[0], "cd", 2) == 0);
+
+    BTASSERT(chan_poll_set_remove(&poll_set, &ring) == 0);
+
+    return (0);
+}
+
+static int test_benchmark(void)
+{
+    uint8_t buf[BENCHMARK_BURST_SIZE];
+    int i;
+    int j;
+    int start;
+    int queue_time;
+    int ring_time;
+
+    BTASSERT(queue_init(&benchmark_queue,
+                        &benchmark_queue_buffer[0],
+                        sizeof(benchmark_queue_buffer)) == 0);
+    BTASSERT(ring_init(&benchmark_ring,
+                       &benchmark_buffer[0],
+                       sizeof(benchmark_buffer)) == 0);
+
+    /* A simulated ISR writes one byte at a time with the system lock
+       taken, and a thread reads a burst of bytes. */
+    start = time_micros();
+
+    for (i = 0; i < BENCHMARK_BURSTS; i++) {
+        sys_lock();
+
+        for (j = 0; j < BENCHMARK_BURST_SIZE; j++) {
+            buf[0] = j;
+            queue_write_isr(&benchmark_queue, &buf[0], 1);
+        }
+
+        sys_unlock();
+
+        BTASSERT(queue_read(&benchmark_queue,
+                            &buf[0],
+                            sizeof(buf)) == sizeof(buf));
+    }
+
+    queue_time = time_micros_elapsed(start, time_micros());
+
+    start = time_micros();
+
+    for (i = 0; i < BENCHMARK_BURSTS; i++) {
+        sys_lock();
+
+        for (j = 0; j < BENCHMARK_BURST_SIZE; j++) {
+            buf[0] = j;
+            ring_write_isr(&benchmark_ring, &buf[0], 1);
+        }
+
+        sys_unlock();
+
+        BTASSERT(ring_read(&benchmark_ring,
+                           &buf[0],
+                           sizeof(buf)) == sizeof(buf));
+    }
+
+    ring_time = time_micros_elapsed(start, time_micros());
+
+    BTASSERT(buf[BENCHMARK_BURST_SIZE - 1] == BENCHMARK_BURST_SIZE - 1);
+
+    std_printf(OSTR("%d bytes in bursts of %d bytes:\r\n"
+                    "  queue: %d us (%d ns per byte)\r\n"
+                    "  ring:  %d us (%d ns per byte)\r\n"),
+               BENCHMARK_BURSTS * BENCHMARK_BURST_SIZE,
+               BENCHMARK_BURST_SIZE,
+               queue_time,
+               (int)((1000LL * queue_time)
+                     / (BENCHMARK_BURSTS * BENCHMARK_BURST_SIZE)),
+               ring_time,
+               (int)((1000LL * ring_time)
+                     / (BENCHMARK_BURSTS * BENCHMARK_BURST_SIZE)));
+
+    return (0);
+}
+
+int main()
+{
+    struct harness_testcase_t testcases[] = {
+        { test_init, "test_init" },
+        { test_read_write, "test_read_write" },
+        { test_non_blocking, "test_non_blocking" },
+        { test_blocking_read, "test_blocking_read" },
+        { test_poll, "test_poll" },
+        { test_stream, "test_stream" },
+        { test_isr, "test_isr" },
+        { test_poll_set, "test_poll_set" },
+        { test_benchmark, "test_benchmark" },
+        { NULL, NULL }
+    };
+
+    sys_start();
+
+    harness_run(testcases);
+
+    return (0);
+}
@@ -35,10 +35,64 @@ static THRD_STACK(writer_1_stack, 512);
 static THRD_STACK(writer_2_stack, 512);
 static THRD_STACK(reader_0_stack, 512);
 static THRD_STACK(reader_1_stack, 512);
+static THRD_STACK(order_0_stack, 512);
+static THRD_STACK(order_1_stack, 512);
+static THRD_STACK(order_2_stack, 512);
+
+static void *order_stacks[] = {
+    order_0_stack,
+    order_1_stack,
+    order_2_stack
+};
 
 static volatile int count;
 struct rwlock_t count_lock;
 
+static struct rwlock_t order_lock;
+static char order[8];
+static volatile int order_length;
+static struct queue_t qout;
+static char qoutbuf[64];
+
+static struct sem_t order_start[3];
+static struct sem_t order_done;
+static volatile char order_roles[3];
+
+/**
+ * Take and give the order lock in the role set by the main thread,
+ * and log when the lock was taken.
+ */
+static void *order_main(void *arg_p)
+{
+    struct sem_t *start_p;
+    char role;
+
+    start_p = arg_p;
+
+    while (1) {
+        sem_take(start_p, NULL);
+        role = order_roles[start_p - &order_start[0]];
+
+        if (role == 'R') {
+            rwlock_reader_take(&order_lock);
+        } else {
+            rwlock_writer_take(&order_lock);
+        }
+
+        order[order_length++] = role;
+
+        if (role == 'R') {
+            rwlock_reader_give(&order_lock);
+        } else {
+            rwlock_writer_give(&order_lock);
+        }
+
+        sem_give(&order_done, 1);
+    }
+
+    return (NULL);
+}
+
 static void *writer_main(void *arg_p)
 {
     int i;
@@ -84,6 +138,208 @@ static int test_one_thread(void)
     return (0);
 }
 
+static int test_take_timeout(void)
+{
+    struct rwlock_t foo;
+    struct time_t timeout;
+
+    BTASSERT(rwlock_init(&foo) == 0);
+
+    /* Readers and writers time out while a writer has the lock. */
+    BTASSERT(rwlock_writer_take(&foo) == 0);
+    timeout.seconds = 0;
+    timeout.nanoseconds = 0;
+    BTASSERTI(rwlock_reader_take_timeout(&foo, &timeout), ==, -ETIMEDOUT);
+    timeout.nanoseconds = 10000000;
+    BTASSERTI(rwlock_reader_take_timeout(&foo, &timeout), ==, -ETIMEDOUT);
+    BTASSERTI(rwlock_writer_take_timeout(&foo, &timeout), ==, -ETIMEDOUT);
+    BTASSERTI(foo.number_of_readers, ==, 0);
+    BTASSERTI(foo.number_of_writers, ==, 1);
+    BTASSERT(foo.readers_p == NULL);
+    BTASSERT(foo.writers_p == NULL);
+    BTASSERT(rwlock_writer_give(&foo) == 0);
+
+    /* Writers time out while a reader has the lock. */
+    BTASSERT(rwlock_reader_take_timeout(&foo, &timeout) == 0);
+    BTASSERTI(rwlock_writer_take_timeout(&foo, &timeout), ==, -ETIMEDOUT);
+    BTASSERTI(foo.number_of_writers, ==, 0);
+    BTASSERT(foo.writers_p == NULL);
+    BTASSERT(rwlock_reader_take_timeout(&foo, &timeout) == 0);
+    BTASSERT(rwlock_reader_give(&foo) == 0);
+    BTASSERT(rwlock_reader_give(&foo) == 0);
+
+    /* Free. */
+    BTASSERT(rwlock_writer_take_timeout(&foo, &timeout) == 0);
+    BTASSERT(rwlock_writer_give(&foo) == 0);
+
+    return (0);
+}
+
+/**
+ * Let threads with given roles wait, one by one, for the order lock
+ * taken by the main thread as given role. Then give it and return
+ * the order in which the threads took the lock.
+ */
+static const char *take_order(int policy,
+                              char main_role,
+                              const char *roles_p)
+{
+    int i;
+    int length;
+
+    length = strlen(roles_p);
+    rwlock_init(&order_lock);
+    rwlock_set_policy(&order_lock, policy);
+    order_length = 0;
+
+    if (main_role == 'R') {
+        rwlock_reader_take(&order_lock);
+    } else {
+        rwlock_writer_take(&order_lock);
+    }
+
+    for (i = 0; i < length; i++) {
+        order_roles[i] = roles_p[i];
+        sem_give(&order_start[i], 1);
+        thrd_sleep_ms(2);
+    }
+
+    if (main_role == 'R') {
+        rwlock_reader_give(&order_lock);
+    } else {
+        rwlock_writer_give(&order_lock);
+    }
+
+    for (i = 0; i < length; i++) {
+        sem_take(&order_done, NULL);
+    }
+
+    order[order_length] = '\0';
+
+    return (&order[0]);
+}
+
+static int test_policies(void)
+{
+    struct rwlock_t foo;
+    int policy;
+    int i;
+
+    BTASSERT(sem_init(&order_done, 3, 3) == 0);
+
+    for (i = 0; i < membersof(order_start); i++) {
+        BTASSERT(sem_init(&order_start[i], 1, 1) == 0);
+        BTASSERT(thrd_spawn(order_main,
+                            &order_start[i],
+                            0,
+                            order_stacks[i],
+                            sizeof(order_0_stack)) != NULL);
+    }
+
+    BTASSERT(rwlock_init(&foo) == 0);
+    BTASSERTI(foo.policy, ==, RWLOCK_POLICY_WRITER_PREFERRING);
+
+    for (policy = RWLOCK_POLICY_READER_PREFERRING;
+         policy <= RWLOCK_POLICY_PHASE_FAIR;
+         policy++) {
+        BTASSERT(rwlock_set_policy(&foo, policy) == 0);
+        BTASSERTI(foo.policy, ==, policy);
+    }
+
+    /* A writer and then a reader wait for a writer. */
+    BTASSERTM(take_order(RWLOCK_POLICY_READER_PREFERRING, 'W', "WR"),
+              "RW",
+              3);
+    BTASSERTM(take_order(RWLOCK_POLICY_WRITER_PREFERRING, 'W', "WR"),
+              "WR",
+              3);
+    BTASSERTM(take_order(RWLOCK_POLICY_PHASE_FAIR, 'W', "WR"),
+              "RW",
+              3);
+
+    /* A reader arrives while a writer waits for a reader. */
+    BTASSERTM(take_order(RWLOCK_POLICY_READER_PREFERRING, 'R', "WR"),
+              "RW",
+              3);
+    BTASSERTM(take_order(RWLOCK_POLICY_WRITER_PREFERRING, 'R', "WR"),
+              "WR",
+              3);
+    BTASSERTM(take_order(RWLOCK_POLICY_PHASE_FAIR, 'R', "WR"),
+              "WR",
+              3);
+
+    /* Writers and readers take turns only in the phase-fair
+       policy. */
+    BTASSERTM(take_order(RWLOCK_POLICY_READER_PREFERRING, 'W', "WRW"),
+              "RWW",
+              4);
+    BTASSERTM(take_order(RWLOCK_POLICY_WRITER_PREFERRING, 'W', "WRW"),
+              "WWR",
+              4);
+    BTASSERTM(take_order(RWLOCK_POLICY_PHASE_FAIR, 'W', "WRW"),
+              "RWW",
+              4);
+    BTASSERTM(take_order(RWLOCK_POLICY_PHASE_FAIR, 'R', "WRW"),
+              "WRW",
+              4);
+
+    return (0);
+}
+
+/**
+ * Read given counter as a string.
+ */
+static int read_counter(const char *path_p, char *value_p)
+{
+    char command[64];
+
+    strcpy(&command[0], path_p);
+
+    if (fs_call(&command[0], NULL, &qout, NULL) != 0) {
+        return (-1);
+    }
+
+    if (queue_read(&qout, value_p, 18) != 18) {
+        return (-1);
+    }
+
+    value_p[16] = '\0';
+
+    return (0);
+}
+
+static int test_counters(void)
+{
+    struct rwlock_t foo;
+    struct time_t timeout;
+    char value[18];
+
+    BTASSERT(queue_init(&qout, &qoutbuf[0], sizeof(qoutbuf)) == 0);
+
+    BTASSERT(rwlock_init(&foo) == 0);
+    BTASSERT(rwlock_writer_take(&foo) == 0);
+    timeout.seconds = 0;
+    timeout.nanoseconds = 2000000;
+    BTASSERTI(rwlock_reader_take_timeout(&foo, &timeout), ==, -ETIMEDOUT);
+    BTASSERTI(rwlock_writer_take_timeout(&foo, &timeout), ==, -ETIMEDOUT);
+    BTASSERTI(rwlock_writer_take_timeout(&foo, &timeout), ==, -ETIMEDOUT);
+    BTASSERT(rwlock_writer_give(&foo) == 0);
+
+    BTASSERT(read_counter("/sync/rwlock/reader/waits", &value[0]) == 0);
+    BTASSERTM(&value[0], "0000000000000001", 17);
+    BTASSERT(read_counter("/sync/rwlock/reader/timeouts", &value[0]) == 0);
+    BTASSERTM(&value[0], "0000000000000001", 17);
+    BTASSERT(read_counter("/sync/rwlock/reader/wait_time_us",
+                          &value[0]) == 0);
+    BTASSERT(strcmp(&value[0], "0000000000000000") != 0);
+    BTASSERT(read_counter("/sync/rwlock/writer/waits", &value[0]) == 0);
+    BTASSERTM(&value[0], "0000000000000002", 17);
+    BTASSERT(read_counter("/sync/rwlock/writer/timeouts", &value[0]) == 0);
+    BTASSERTM(&value[0], "0000000000000002", 17);
+
+    return (0);
+}
+
 static int test_multi_thread(void)
 {
     struct thrd_t *reader_0_p;
@@ -134,6 +390,9 @@ int main()
 {
     struct harness_testcase_t testcases[] = {
         { test_one_thread, "test_one_thread" },
+        { test_counters, "test_counters" },
+        { test_take_timeout, "test_take_timeout" },
+        { test_policies, "test_policies" },
         { test_multi_thread, "test_multi_thread" },
         { NULL, NULL }
     };
@@ -41,6 +41,21 @@ static THRD_STACK(t0_stack, 224);
 static THRD_STACK(t1_stack, 224);
 #endif
 
+#define CONTENDED_ITERATIONS 1000
+
+static struct sem_t handoff_sem;
+static struct sem_t ping_sem;
+static struct sem_t pong_sem;
+static int pings;
+
+#if defined(ARCH_ESP32) || defined(ARCH_PPC)
+static THRD_STACK(taker_stack, 512);
+static THRD_STACK(ponger_stack, 512);
+#else
+static THRD_STACK(taker_stack, 256);
+static THRD_STACK(ponger_stack, 256);
+#endif
+
 /* Defined in the linker script. */
 extern char __simba_stack_begin;
 extern char __simba_stack_size;
@@ -118,11 +133,132 @@ static int test_binary(void)
     return (0);
 }
 
+static int test_add_waiter(void)
+{
+    struct thrd_prio_list_elem_t elem;
+
+    elem.thrd_p = thrd_self();
+    BTASSERT(sem_init(&sem, 1, 1) == 0);
+
+    /* No resource is available, so the caller may suspend. The
+       waiters flag is set before the count is checked. */
+    sys_lock();
+    BTASSERT(sem_add_waiter_isr(&sem, &elem) == 0);
+    BTASSERTI(sem.has_waiters, ==, 1);
+    BTASSERT(thrd_prio_list_peek_isr(&sem.waiters) == &elem);
+    BTASSERT(thrd_prio_list_remove_isr(&sem.waiters, &elem) == 0);
+    sys_unlock();
+
+    /* A give with the waiters flag set and no waiters clears the
+       flag. */
+    BTASSERT(sem_give(&sem, 1) == 0);
+    BTASSERTI(sem.has_waiters, ==, 0);
+    BTASSERTI(sem.count, ==, 0);
+
+    /* A resource given without the system lock before the waiters
+       flag is set is found by the check after setting it. */
+    BTASSERT(sem_take(&sem, NULL) == 0);
+    BTASSERT(sem_give(&sem, 1) == 0);
+    sys_lock();
+    BTASSERT(sem_add_waiter_isr(&sem, &elem) == 1);
+    BTASSERT(thrd_prio_list_remove_isr(&sem.waiters, &elem) == 0);
+    sys_unlock();
+    BTASSERT(sem_take(&sem, NULL) == 0);
+    BTASSERT(sem_give(&sem, 1) == 0);
+    BTASSERTI(sem.has_waiters, ==, 0);
+
+    return (0);
+}
+
+static void *taker_main(void *arg_p)
+{
+    /* Suspends, as all resources are taken. */
+    sem_take(&handoff_sem, NULL);
+
+    return (NULL);
+}
+
+static int test_handoff(void)
+{
+    struct thrd_t *taker_p;
+
+    BTASSERT(sem_init(&handoff_sem, 1, 1) == 0);
+
+    /* The lower priority taker waits while the main thread
+       sleeps. */
+    taker_p = thrd_spawn(taker_main,
+                         NULL,
+                         thrd_get_prio() + 1,
+                         taker_stack,
+                         sizeof(taker_stack));
+    BTASSERT(taker_p != NULL);
+    thrd_sleep_ms(5);
+    BTASSERTI(handoff_sem.has_waiters, ==, 1);
+    BTASSERT(thrd_prio_list_peek_isr(&handoff_sem.waiters)->thrd_p
+             == taker_p);
+
+    /* The give takes the resource on behalf of the waiter before the
+       waiter runs. */
+    BTASSERT(sem_give(&handoff_sem, 1) == 0);
+    BTASSERTI(handoff_sem.count, ==, 1);
+    BTASSERTI(handoff_sem.has_waiters, ==, 0);
+    BTASSERT(thrd_prio_list_peek_isr(&handoff_sem.waiters) == NULL);
+    thrd_sleep_ms(5);
+
+    return (0);
+}
+
+static void *ponger_main(void *arg_p)
+{
+    int i;
+
+    for (i = 0; i < CONTENDED_ITERATIONS; i++) {
+        sem_take(&ping_sem, NULL);
+        pings++;
+        thrd_yield();
+        sem_give(&pong_sem, 1);
+    }
+
+    return (NULL);
+}
+
+static int test_contended(void)
+{
+    int i;
+
+    BTASSERT(sem_init(&ping_sem, 1, 1) == 0);
+    BTASSERT(sem_init(&pong_sem, 1, 1) == 0);
+    pings = 0;
+
+    /* Both threads give while the other one is about to wait, or
+       waiting, for the given semaphore. */
+    BTASSERT(thrd_spawn(ponger_main,
+                        NULL,
+                        thrd_get_prio(),
+                        ponger_stack,
+                        sizeof(ponger_stack)) != NULL);
+
+    for (i = 0; i < CONTENDED_ITERATIONS; i++) {
+        BTASSERT(sem_give(&ping_sem, 1) == 0);
+        thrd_yield();
+        BTASSERT(sem_take(&pong_sem, NULL) == 0);
+        BTASSERTI(pings, ==, i + 1);
+    }
+
+    BTASSERTI(ping_sem.has_waiters, ==, 0);
+    BTASSERTI(pong_sem.has_waiters, ==, 0);
+
+    return (0);
+}
+
 int main()
 {
     struct harness_testcase_t testcases[] = {
         { test_multi_thread, "test_multi_thread" },
         { test_binary, "test_binary" },
+        { test_add_waiter, "test_add_waiter" },
+        { test_handoff, "test_handoff" },
+        { test_contended, "test_contended" },
         { NULL, NULL }
     };
 